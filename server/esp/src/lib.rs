@@ -35,6 +35,8 @@ pub enum DecodeError {
     InvalidStringValue,
     NonFiniteValue,
     ChecksumMismatch,
+    VarIntTooLong,
+    MissingDeltaBase,
 }
 
 impl Display for DecodeError {
@@ -46,6 +48,8 @@ impl Display for DecodeError {
             Self::InvalidStringValue => f.write_str("invalid string was passed, likely not properly UTF-8 encoded"),
             Self::NonFiniteValue => f.write_str("NaN or inf was passed as a data field expecting a finite f32 or f64 value"),
             Self::ChecksumMismatch => f.write_str("data checksum was invalid"),
+            Self::VarIntTooLong => f.write_str("variable-length integer was encoded with too many bytes"),
+            Self::MissingDeltaBase => f.write_str("received delta encoded data, but the frame it is based on is not available"),
         }
     }
 }
@@ -243,6 +247,12 @@ pub trait ByteBufferExtWrite {
 
     /// calculate the checksum of the entire buffer and write it at the current position (4 bytes)
     fn append_self_checksum(&mut self);
+
+    /// write a `u32` as a LEB128 varint (1-5 bytes)
+    fn write_varuint(&mut self, val: u32);
+
+    /// write an `i32` as a zigzag encoded varint, so that small negative values are small as well
+    fn write_varint(&mut self, val: i32);
 }
 
 pub trait ByteBufferExtRead {
@@ -274,6 +284,12 @@ pub trait ByteBufferExtRead {
 
     /// read the checksum at the end of the buffer (4 bytes) and verify the rest of the buffer matches
     fn validate_self_checksum(&mut self) -> DecodeResult<()>;
+
+    /// read a `u32` encoded as a LEB128 varint
+    fn read_varuint(&mut self) -> DecodeResult<u32>;
+
+    /// read an `i32` encoded as a zigzag varint
+    fn read_varint(&mut self) -> DecodeResult<i32>;
 }
 
 /* ByteBuffer extension implementation for ByteBuffer, ByteReader and FastByteBuffer */
@@ -324,6 +340,22 @@ macro_rules! impl_extwrite {
 
             self.write_u32(checksum);
         }
+
+        #[inline]
+        fn write_varuint(&mut self, val: u32) {
+            let mut val = val;
+            while val >= 0x80 {
+                self.write_u8((val as u8) | 0x80);
+                val >>= 7;
+            }
+
+            self.write_u8(val as u8);
+        }
+
+        #[inline]
+        fn write_varint(&mut self, val: i32) {
+            self.write_varuint(((val << 1) ^ (val >> 31)) as u32);
+        }
     };
 }
 
@@ -432,6 +464,29 @@ macro_rules! impl_extread {
 
             Ok(())
         }
+
+        #[inline]
+        fn read_varuint(&mut self) -> DecodeResult<u32> {
+            let mut val = 0u32;
+
+            // a u32 takes up at most 5 bytes
+            for i in 0..5 {
+                let byte = self.read_u8()?;
+                val |= u32::from(byte & 0x7f) << (i * 7);
+
+                if byte & 0x80 == 0 {
+                    return Ok(val);
+                }
+            }
+
+            Err(DecodeError::VarIntTooLong)
+        }
+
+        #[inline]
+        fn read_varint(&mut self) -> DecodeResult<i32> {
+            let val = self.read_varuint()?;
+            Ok(((val >> 1) as i32) ^ -((val & 1) as i32))
+        }
     };
 }
 
@@ -485,6 +540,29 @@ mod tests {
         assert!(reader.validate_self_checksum().is_ok(), "failed to validate checksum");
     }
 
+    #[test]
+    fn varint() {
+        let values = [0i32, 1, -1, 63, -64, 64, 1000, -1000, i32::MAX, i32::MIN];
+
+        let mut buf = ByteBuffer::new();
+        for val in values {
+            buf.write_varint(val);
+        }
+
+        buf.write_varuint(u32::MAX);
+
+        let mut reader = ByteReader::from_bytes(buf.as_bytes());
+        for val in values {
+            assert_eq!(reader.read_varint().unwrap(), val);
+        }
+
+        assert_eq!(reader.read_varuint().unwrap(), u32::MAX);
+
+        // 6 continuation bytes is never valid
+        let mut reader = ByteReader::from_bytes(&[0xff, 0xff, 0xff, 0xff, 0xff, 0x01]);
+        assert!(reader.read_varuint().is_err());
+    }
+
     #[test]
     fn fast_vec() {
         let mut vec = FastVec::<String, 128>::new();
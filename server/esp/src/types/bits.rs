@@ -11,6 +11,15 @@ impl<const N: usize> Bits<N> {
         Self { buffer: [0u8; N] }
     }
 
+    pub fn from_bytes(buffer: [u8; N]) -> Self {
+        Self { buffer }
+    }
+
+    #[inline]
+    pub fn to_bytes(&self) -> [u8; N] {
+        self.buffer
+    }
+
     #[inline]
     pub fn reset(&mut self) {
         for i in 0..N {
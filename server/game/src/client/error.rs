@@ -13,6 +13,7 @@ pub enum PacketHandlingError {
     WrongCryptoBoxState,                   // cryptobox was either Some or None when should've been the other one
     EncryptionError,                       // failed to encrypt data
     DecryptionError,                       // failed to decrypt data
+    ReplayedMessage,                       // encrypted message with a counter that was already received, or is too old
     IOError(std::io::Error),               // generic IO error
     MalformedMessage,                      // packet is missing a header
     MalformedLoginAttempt,                 // LoginPacket with cleartext credentials
@@ -92,6 +93,7 @@ impl Display for PacketHandlingError {
             Self::WrongCryptoBoxState => f.write_str("wrong crypto box state for the given operation"),
             Self::EncryptionError => f.write_str("Encryption failed"),
             Self::DecryptionError => f.write_str("Decryption failed"),
+            Self::ReplayedMessage => f.write_str("replayed or very late encrypted message"),
             Self::MalformedCiphertext => f.write_str("malformed ciphertext in an encrypted packet"),
             Self::MalformedMessage => f.write_str("malformed message structure"),
             Self::MalformedLoginAttempt => f.write_str("malformed login attempt"),
@@ -1,15 +1,20 @@
 pub mod error;
 pub mod macros;
+pub mod player_data_codec;
+pub mod session_cipher;
 pub mod socket;
 pub mod state;
 pub mod thread;
 pub mod translator;
+pub mod udp_sequence;
 pub mod unauthorized;
 
 pub use error::{PacketHandlingError, Result};
 pub use macros::*;
+pub use player_data_codec::PlayerDataCodec;
+pub use session_cipher::{CipherStream, SessionCipher};
 pub use socket::ClientSocket;
 pub use state::{AtomicClientThreadState, ClientThreadState};
 pub use thread::{ClientThread, ServerThreadMessage};
 pub use translator::*;
-pub use unauthorized::{UnauthorizedThread, UnauthorizedThreadOutcome};
+pub use unauthorized::{RESUME_PROOF_SIZE, RecoverRequest, ResumeProof, ResumeTicket, UnauthorizedThread, UnauthorizedThreadOutcome};
@@ -0,0 +1,145 @@
+use crate::data::*;
+
+/// How many frames are remembered in each direction
+pub const HISTORY_SIZE: usize = 32;
+/// Force a keyframe every this many frames, so that a desync can never last long
+pub const KEYFRAME_INTERVAL: usize = 90;
+
+#[derive(Default)]
+struct ReceivedFrame {
+    id: u8,
+    data: QuantizedPlayerData,
+}
+
+#[derive(Default)]
+struct SentFrame {
+    id: u8,
+    players: Vec<(i32, QuantizedPlayerData)>,
+}
+
+/// State for the compact player data encoding (protocol v14), counterpart of `PlayerDataCodec` on the client.
+///
+/// Every frame is delta encoded against the newest frame the other side has acknowledged.
+/// Acknowledgements are piggybacked on the packets going the other way, and frame IDs are a wrapping counter that skips 0.
+pub struct PlayerDataCodec {
+    received_frames: [ReceivedFrame; HISTORY_SIZE],
+    sent_frames: [SentFrame; HISTORY_SIZE],
+    last_received_frame: u8,
+    last_sent_frame: u8,
+    acked_sent_frame: u8,
+    since_keyframe: usize,
+}
+
+impl PlayerDataCodec {
+    pub fn new() -> Self {
+        Self {
+            received_frames: Default::default(),
+            sent_frames: Default::default(),
+            last_received_frame: 0,
+            last_sent_frame: 0,
+            acked_sent_frame: 0,
+            since_keyframe: 0,
+        }
+    }
+
+    /// Returns the frame that the client encoded its data against, or `None` if it sent a keyframe.
+    pub fn received_base(&self, base_frame: u8) -> DecodeResult<Option<QuantizedPlayerData>> {
+        if base_frame == 0 {
+            return Ok(None);
+        }
+
+        let slot = &self.received_frames[base_frame as usize % HISTORY_SIZE];
+        if slot.id != base_frame {
+            return Err(DecodeError::MissingDeltaBase);
+        }
+
+        Ok(Some(slot.data))
+    }
+
+    /// Remember a frame that was successfully decoded, returns the id that should be acknowledged to the client.
+    pub fn store_received(&mut self, frame: u8, data: &QuantizedPlayerData) -> u8 {
+        self.received_frames[frame as usize % HISTORY_SIZE] = ReceivedFrame { id: frame, data: *data };
+
+        if self.last_received_frame == 0 || is_newer(frame, self.last_received_frame) {
+            self.last_received_frame = frame;
+        }
+
+        self.last_received_frame
+    }
+
+    /// Handle an acknowledgement of one of our frames, sent by the client.
+    pub fn acknowledge(&mut self, frame: u8) {
+        if frame != 0 && (self.acked_sent_frame == 0 || is_newer(frame, self.acked_sent_frame)) {
+            self.acked_sent_frame = frame;
+        }
+    }
+
+    /// Allocate an id for a new frame and pick the frame it should be delta encoded against.
+    /// Returns `(frame, base_frame)`, `base_frame` is 0 if this should be a keyframe.
+    pub fn begin_frame(&mut self) -> (u8, u8) {
+        self.last_sent_frame = next_frame_id(self.last_sent_frame);
+
+        let acked = self.acked_sent_frame;
+        let usable = acked != 0
+            && self.sent_frames[acked as usize % HISTORY_SIZE].id == acked
+            && (self.last_sent_frame.wrapping_sub(acked) as usize) < HISTORY_SIZE
+            && self.since_keyframe < KEYFRAME_INTERVAL;
+
+        if usable {
+            self.since_keyframe += 1;
+            (self.last_sent_frame, acked)
+        } else {
+            self.since_keyframe = 0;
+            (self.last_sent_frame, 0)
+        }
+    }
+
+    /// Find the data of the given player in the frame `base_frame`. `index_hint` is checked first,
+    /// as players are usually sent in the same order every time.
+    pub fn sent_base(&self, base_frame: u8, account_id: i32, index_hint: usize) -> Option<&QuantizedPlayerData> {
+        if base_frame == 0 {
+            return None;
+        }
+
+        let players = &self.sent_frames[base_frame as usize % HISTORY_SIZE].players;
+
+        match players.get(index_hint) {
+            Some((id, data)) if *id == account_id => Some(data),
+            _ => players.iter().find(|(id, _)| *id == account_id).map(|(_, data)| data),
+        }
+    }
+
+    /// Take the player list of the slot `frame` will be stored in, so that its allocation can be reused.
+    /// `begin_frame` guarantees this is never the slot of the base frame.
+    pub fn take_frame_storage(&mut self, frame: u8) -> Vec<(i32, QuantizedPlayerData)> {
+        let mut players = std::mem::take(&mut self.sent_frames[frame as usize % HISTORY_SIZE].players);
+        players.clear();
+        players
+    }
+
+    /// Remember what was sent in the frame `frame`.
+    pub fn store_sent(&mut self, frame: u8, players: Vec<(i32, QuantizedPlayerData)>) {
+        self.sent_frames[frame as usize % HISTORY_SIZE] = SentFrame { id: frame, players };
+    }
+}
+
+impl Default for PlayerDataCodec {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[inline]
+fn next_frame_id(id: u8) -> u8 {
+    match id.wrapping_add(1) {
+        0 => 1,
+        x => x,
+    }
+}
+
+/// Returns true if `id` is newer than `than`, taking wrapping into account
+#[inline]
+fn is_newer(id: u8, than: u8) -> bool {
+    let diff = id.wrapping_sub(than);
+    diff != 0 && diff < 128
+}
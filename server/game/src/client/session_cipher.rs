@@ -0,0 +1,220 @@
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+
+use globed_shared::{
+    SyncMutex,
+    crypto_secretbox::{
+        KeyInit, XChaCha20Poly1305,
+        aead::{AeadInPlace, OsRng},
+    },
+};
+
+use super::error::{PacketHandlingError, Result};
+
+pub const KEY_SIZE: usize = 32;
+pub const COUNTER_SIZE: usize = 4;
+pub const MAC_SIZE: usize = 16;
+/// counter and mac, which is everything an encrypted message carries on top of the ciphertext
+pub const PREFIX_SIZE: usize = COUNTER_SIZE + MAC_SIZE;
+
+const NONCE_SIZE: usize = 24;
+/// how far behind the newest received message a message can arrive and still be accepted
+const REPLAY_WINDOW: u64 = 64;
+
+/// Every stream has its own counter and replay window, so that reordering between TCP and UDP can't get messages rejected.
+#[derive(Clone, Copy)]
+pub enum CipherStream {
+    Tcp = 0,
+    Udp = 1,
+}
+
+#[derive(Default)]
+struct ReplayWindow {
+    /// highest counter received so far, 0 if nothing was received yet (counters start at 1)
+    highest: u64,
+    /// bit `n` is set if `highest - n` was received
+    seen: u64,
+}
+
+impl ReplayWindow {
+    /// reconstruct the full counter from the truncated one on the wire, picking the value closest to the next expected one
+    fn expand(&self, truncated: u32) -> u64 {
+        const SPAN: u64 = 1 << 32;
+        const HALF: u64 = SPAN / 2;
+
+        let expected = self.highest + 1;
+        let candidate = (expected & !(SPAN - 1)) | u64::from(truncated);
+
+        if expected >= HALF && candidate <= expected - HALF && candidate <= u64::MAX - SPAN {
+            candidate + SPAN
+        } else if candidate > expected + HALF && candidate >= SPAN {
+            candidate - SPAN
+        } else {
+            candidate
+        }
+    }
+
+    fn can_accept(&self, counter: u64) -> bool {
+        if counter == 0 {
+            return false;
+        }
+
+        if counter > self.highest {
+            return true;
+        }
+
+        let behind = self.highest - counter;
+        behind < REPLAY_WINDOW && self.seen & (1 << behind) == 0
+    }
+
+    fn accept(&mut self, counter: u64) {
+        if counter > self.highest {
+            let shift = counter - self.highest;
+            self.seen = if shift >= REPLAY_WINDOW { 0 } else { self.seen << shift };
+            self.seen |= 1;
+            self.highest = counter;
+        } else {
+            self.seen |= 1 << (self.highest - counter);
+        }
+    }
+}
+
+/// Session cipher (protocol v16), replaces the random 24-byte nonce of every encrypted packet with an implicit counter.
+///
+/// Each direction has its own key, generated by us and sent to the client with `SessionKeysPacket` through the crypto box.
+/// The nonce is the stream id and a 64-bit counter, only the low 32 bits of the counter and the mac go on the wire,
+/// so an encrypted message is `counter (u32) | mac | ciphertext`.
+pub struct SessionCipher {
+    send: XChaCha20Poly1305,
+    recv: XChaCha20Poly1305,
+    send_counters: [AtomicU64; 2],
+    windows: [SyncMutex<ReplayWindow>; 2],
+    /// whether the client has sent anything with this cipher yet. until then, messages made with the crypto box are still accepted.
+    confirmed: AtomicBool,
+}
+
+/// keys as seen from the client, to be put in a `SessionKeysPacket`
+pub struct ClientSessionKeys {
+    pub send_key: [u8; KEY_SIZE],
+    pub recv_key: [u8; KEY_SIZE],
+}
+
+impl SessionCipher {
+    pub fn generate() -> (Self, ClientSessionKeys) {
+        let client_send = XChaCha20Poly1305::generate_key(&mut OsRng);
+        let client_recv = XChaCha20Poly1305::generate_key(&mut OsRng);
+
+        let cipher = Self {
+            send: XChaCha20Poly1305::new(&client_recv),
+            recv: XChaCha20Poly1305::new(&client_send),
+            send_counters: Default::default(),
+            windows: Default::default(),
+            confirmed: AtomicBool::new(false),
+        };
+
+        let keys = ClientSessionKeys {
+            send_key: client_send.into(),
+            recv_key: client_recv.into(),
+        };
+
+        (cipher, keys)
+    }
+
+    #[inline]
+    fn make_nonce(stream: CipherStream, counter: u64) -> [u8; NONCE_SIZE] {
+        let mut nonce = [0u8; NONCE_SIZE];
+        nonce[0] = stream as u8;
+        nonce[NONCE_SIZE - 8..].copy_from_slice(&counter.to_be_bytes());
+        nonce
+    }
+
+    pub fn is_confirmed(&self) -> bool {
+        self.confirmed.load(Ordering::Relaxed)
+    }
+
+    /// encrypt `data` in place, writing the counter and the mac into `prefix`
+    pub fn encrypt_in_place(&self, stream: CipherStream, prefix: &mut [u8], data: &mut [u8]) -> Result<()> {
+        debug_assert!(prefix.len() == PREFIX_SIZE);
+
+        let counter = self.send_counters[stream as usize].fetch_add(1, Ordering::Relaxed) + 1;
+        let nonce = Self::make_nonce(stream, counter).into();
+
+        let tag = self
+            .send
+            .encrypt_in_place_detached(&nonce, b"", data)
+            .map_err(|_| PacketHandlingError::EncryptionError)?;
+
+        prefix[..COUNTER_SIZE].copy_from_slice(&(counter as u32).to_be_bytes());
+        prefix[COUNTER_SIZE..].copy_from_slice(&tag);
+
+        Ok(())
+    }
+
+    /// decrypt a message (starting with the counter) in place, the plaintext starts at `PREFIX_SIZE`.
+    /// on failure the message is left untouched, so it can still be tried with the crypto box.
+    pub fn decrypt_in_place(&self, stream: CipherStream, message: &mut [u8]) -> Result<()> {
+        if message.len() < PREFIX_SIZE {
+            return Err(PacketHandlingError::MalformedCiphertext);
+        }
+
+        let truncated = u32::from_be_bytes([message[0], message[1], message[2], message[3]]);
+
+        let mut window = self.windows[stream as usize].lock();
+
+        let counter = window.expand(truncated);
+        if !window.can_accept(counter) {
+            return Err(PacketHandlingError::ReplayedMessage);
+        }
+
+        let nonce = Self::make_nonce(stream, counter).into();
+
+        let mut mac = [0u8; MAC_SIZE];
+        mac.copy_from_slice(&message[COUNTER_SIZE..PREFIX_SIZE]);
+        let mac = mac.into();
+
+        // only authenticated messages may move the window
+        self.recv
+            .decrypt_in_place_detached(&nonce, b"", &mut message[PREFIX_SIZE..], &mac)
+            .map_err(|_| PacketHandlingError::DecryptionError)?;
+
+        window.accept(counter);
+        self.confirmed.store(true, Ordering::Relaxed);
+
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn replay_window() {
+        let mut window = ReplayWindow::default();
+
+        for counter in [1, 2, 5, 4, 70] {
+            assert!(window.can_accept(counter));
+            window.accept(counter);
+        }
+
+        // already seen
+        assert!(!window.can_accept(70));
+        // out of the window
+        assert!(!window.can_accept(5));
+        // reordered, but still in the window
+        assert!(window.can_accept(69));
+        assert!(!window.can_accept(0));
+    }
+
+    #[test]
+    fn counter_expansion() {
+        let mut window = ReplayWindow::default();
+        assert_eq!(window.expand(1), 1);
+
+        window.highest = 0xffff_fff0;
+        assert_eq!(window.expand(0x0000_0005), 0x1_0000_0005);
+        assert_eq!(window.expand(0xffff_ffe0), 0xffff_ffe0);
+
+        window.highest = 0x1_0000_0010;
+        assert_eq!(window.expand(0xffff_fff0), 0xffff_fff0);
+    }
+}
@@ -1,5 +1,5 @@
 use std::{
-    net::{SocketAddr, SocketAddrV4},
+    net::SocketAddr,
     sync::OnceLock,
     time::Duration,
 };
@@ -17,23 +17,28 @@ use globed_shared::{
         ChaChaBox,
         aead::{AeadCore, AeadInPlace, OsRng},
     },
-    trace,
+    SyncMutex, trace,
 };
 
 use super::{
     error::{PacketHandlingError, Result},
     macros::*,
+    session_cipher::{self, CipherStream, SessionCipher},
+    udp_sequence::{MARKER_UDP_SEQUENCED, SequenceHeader, UdpSequencer},
 };
 use crate::{data::*, server::GameServer};
 
 pub struct ClientSocket {
     pub socket: TcpStream,
 
-    pub tcp_peer: SocketAddrV4,
-    pub udp_peer: Option<SocketAddrV4>,
+    pub tcp_peer: SocketAddr,
+    pub udp_peer: Option<SocketAddr>,
     crypto_box: OnceLock<ChaChaBox>,
+    session_cipher: OnceLock<SessionCipher>,
+    udp_sequencer: SyncMutex<UdpSequencer>,
     game_server: &'static GameServer,
     mtu: usize,
+    udp_bundle: Option<UdpBundle>,
 }
 
 // do not touch those, encryption related
@@ -45,16 +50,111 @@ pub const INLINE_BUFFER_SIZE: usize = 164;
 
 const MARKER_UDP_PACKET: u8 = 0xb1;
 const MARKER_UDP_FRAME: u8 = 0xa7;
+const MARKER_UDP_BUNDLE: u8 = 0xb2;
+
+// marker and encrypted sequence header in front of every datagram once sequencing is enabled
+const SEQUENCED_PREFIX_SIZE: usize = size_of_types!(u8) + session_cipher::PREFIX_SIZE + SequenceHeader::SIZE;
+
+// bundles never grow past this many bytes, which is comfortably below the minimum MTU of IPv6
+const BUNDLE_BUDGET: usize = 1200;
+
+/// UDP packets that are collected while a bundle from the client is being handled, and then sent together in a single datagram.
+/// Encoded as `MARKER_UDP_BUNDLE`, the encryption prefix (nonce or counter, and mac) and a list of packets,
+/// each one prefixed with its length as a u16.
+struct UdpBundle {
+    data: Vec<u8>,
+    budget: usize,
+    /// marker and the encryption prefix
+    prefix_size: usize,
+    count: usize,
+    has_encrypted: bool,
+}
+
+impl UdpBundle {
+    fn new(budget: usize, crypto_prefix_size: usize) -> Self {
+        let prefix_size = size_of_types!(u8) + crypto_prefix_size;
+
+        let mut data = Vec::with_capacity(budget);
+        data.resize(prefix_size, 0);
+
+        Self {
+            data,
+            budget,
+            prefix_size,
+            count: 0,
+            has_encrypted: false,
+        }
+    }
+
+    #[inline]
+    const fn entry_size(packet_size: usize) -> usize {
+        size_of_types!(u16) + PacketHeader::SIZE + packet_size
+    }
+
+    /// whether a packet of this size can be bundled at all
+    #[inline]
+    fn can_hold(&self, packet_size: usize) -> bool {
+        self.prefix_size + Self::entry_size(packet_size) <= self.budget
+    }
+
+    /// whether a packet of this size fits in the space that is left
+    #[inline]
+    fn has_room_for(&self, packet_size: usize) -> bool {
+        self.data.len() + Self::entry_size(packet_size) <= self.budget
+    }
+
+    fn push<P: Packet, F>(&mut self, packet_size: usize, encode_fn: F)
+    where
+        F: FnOnce(&mut FastByteBuffer),
+    {
+        let start = self.data.len();
+        self.data.resize(start + Self::entry_size(packet_size), 0);
+
+        let written = {
+            let mut buf = FastByteBuffer::new(&mut self.data[start..]);
+
+            // reserve space for the length
+            buf.write_u16(0);
+
+            // the packet itself is never encrypted, the whole bundle is
+            buf.write_value(&PacketHeader {
+                packet_id: P::PACKET_ID,
+                encrypted: false,
+            });
+
+            encode_fn(&mut buf);
+            buf.len()
+        };
+
+        // `packet_size` is only an upper bound
+        self.data.truncate(start + written);
+
+        let entry_len = (written - size_of_types!(u16)) as u16;
+        self.data[start..start + size_of_types!(u16)].copy_from_slice(&entry_len.to_be_bytes());
+
+        self.count += 1;
+        self.has_encrypted |= P::ENCRYPTED;
+    }
+
+    fn clear(&mut self) {
+        self.data.truncate(self.prefix_size);
+        self.count = 0;
+        self.has_encrypted = false;
+    }
+}
 
 impl ClientSocket {
-    pub fn new(socket: TcpStream, tcp_peer: SocketAddrV4, mtu: usize, game_server: &'static GameServer) -> Self {
+    pub fn new(socket: TcpStream, tcp_peer: SocketAddr, mtu: usize, game_server: &'static GameServer) -> Self {
         Self {
             socket,
             tcp_peer,
             udp_peer: None,
             crypto_box: OnceLock::new(),
+            session_cipher: OnceLock::new(),
+            udp_sequencer: SyncMutex::new(UdpSequencer::default()),
             game_server,
             mtu,
+            udp_bundle: None,
         }
     }
 
@@ -107,7 +207,67 @@ impl ClientSocket {
         Ok(())
     }
 
-    pub fn set_udp_peer(&mut self, udp_peer: SocketAddrV4) {
+    /// switch to the session cipher (protocol v16). the keys must already be on their way to the client.
+    pub fn init_session_cipher(&self, cipher: SessionCipher) -> Result<()> {
+        if self.crypto_box.get().is_none() || self.session_cipher.get().is_some() {
+            return Err(PacketHandlingError::WrongCryptoBoxState);
+        }
+
+        let _ = self.session_cipher.set(cipher);
+
+        Ok(())
+    }
+
+    pub fn has_session_cipher(&self) -> bool {
+        self.session_cipher.get().is_some()
+    }
+
+    /// check a resumption proof, which must be `plaintext` encrypted with the session cipher on the tcp stream.
+    /// the crypto box is never accepted here.
+    pub fn verify_resume_proof(&self, proof: &mut [u8], plaintext: &[u8]) -> bool {
+        let Some(session) = self.session_cipher.get() else {
+            return false;
+        };
+
+        session.decrypt_in_place(CipherStream::Tcp, proof).is_ok() && proof[session_cipher::PREFIX_SIZE..] == *plaintext
+    }
+
+    /// put a sequence header in front of every udp datagram from now on (protocol v17).
+    /// must only be called once the session cipher is installed, as the header is encrypted with it.
+    pub fn enable_udp_sequencing(&self) {
+        debug_assert!(self.has_session_cipher());
+
+        self.udp_sequencer.lock().enable();
+    }
+
+    /// record the sequence header of a datagram from the client, so it gets acked
+    pub fn on_udp_sequence(&self, header: &SequenceHeader) {
+        self.udp_sequencer.lock().on_received(header);
+    }
+
+    /// how many bytes `send_buffer_udp` adds in front of every datagram
+    #[inline]
+    fn udp_prefix_size(&self) -> usize {
+        if self.udp_sequencer.lock().is_enabled() { SEQUENCED_PREFIX_SIZE } else { 0 }
+    }
+
+    /// the largest buffer that can be passed to `send_buffer_udp` without the datagram exceeding the mtu
+    #[inline]
+    fn udp_payload_limit(&self) -> usize {
+        self.mtu.saturating_sub(self.udp_prefix_size())
+    }
+
+    /// how many bytes encryption adds in front of the ciphertext
+    #[inline]
+    fn crypto_prefix_size(&self) -> usize {
+        if self.session_cipher.get().is_some() {
+            session_cipher::PREFIX_SIZE
+        } else {
+            NONCE_SIZE + MAC_SIZE
+        }
+    }
+
+    pub fn set_udp_peer(&mut self, udp_peer: SocketAddr) {
         self.udp_peer.replace(udp_peer);
     }
 
@@ -115,7 +275,29 @@ impl ClientSocket {
         self.mtu = mtu;
     }
 
-    pub fn decrypt<'a>(&self, message: &'a mut [u8]) -> Result<ByteReader<'a>> {
+    pub fn decrypt<'a>(&self, message: &'a mut [u8], stream: CipherStream) -> Result<ByteReader<'a>> {
+        Ok(ByteReader::from_bytes(self.decrypt_in_place(message, stream)?))
+    }
+
+    /// decrypt a message in place, returning the plaintext without the packet header
+    pub fn decrypt_in_place<'a>(&self, message: &'a mut [u8], stream: CipherStream) -> Result<&'a mut [u8]> {
+        if message.len() < PacketHeader::SIZE {
+            return Err(PacketHandlingError::MalformedCiphertext);
+        }
+
+        if let Some(session) = self.session_cipher.get() {
+            match session.decrypt_in_place(stream, &mut message[PacketHeader::SIZE..]) {
+                Ok(()) => return Ok(&mut message[PacketHeader::SIZE + session_cipher::PREFIX_SIZE..]),
+                Err(e) if session.is_confirmed() => return Err(e),
+                // the client might not have received the keys yet when it sent this
+                Err(_) => {}
+            }
+        }
+
+        self.decrypt_with_box(message)
+    }
+
+    fn decrypt_with_box<'a>(&self, message: &'a mut [u8]) -> Result<&'a mut [u8]> {
         if message.len() < PacketHeader::SIZE + NONCE_SIZE + MAC_SIZE {
             return Err(PacketHandlingError::MalformedCiphertext);
         }
@@ -143,7 +325,50 @@ impl ClientSocket {
         cbox.decrypt_in_place_detached(&nonce, b"", &mut message[ciphertext_start..], &mac)
             .map_err(|_| PacketHandlingError::DecryptionError)?;
 
-        Ok(ByteReader::from_bytes(&message[ciphertext_start..]))
+        Ok(&mut message[ciphertext_start..])
+    }
+
+    /// encrypt a message in place. the first `crypto_prefix_size()` bytes are overwritten with the nonce (or counter) and the mac,
+    /// everything after them is encrypted.
+    fn encrypt_in_place(&self, stream: CipherStream, message: &mut [u8]) -> Result<()> {
+        let (prefix, data) = message.split_at_mut(self.crypto_prefix_size());
+
+        if let Some(session) = self.session_cipher.get() {
+            return session.encrypt_in_place(stream, prefix, data);
+        }
+
+        // this unwrap is safe, as an encrypted packet can only be sent downstream after the handshake is established.
+        let cbox = self.crypto_box.get().unwrap();
+
+        let nonce = ChaChaBox::generate_nonce(&mut OsRng);
+        let tag = cbox
+            .encrypt_in_place_detached(&nonce, b"", data)
+            .map_err(|_| PacketHandlingError::EncryptionError)?;
+
+        prefix[..NONCE_SIZE].copy_from_slice(nonce.as_slice());
+        prefix[NONCE_SIZE..].copy_from_slice(&tag);
+
+        Ok(())
+    }
+
+    /// until `end_udp_bundle` is called, collect all udp packets into a bundle instead of sending them right away.
+    /// does nothing if the crypto box isn't initialized yet, as bundles are always encrypted.
+    pub fn begin_udp_bundle(&mut self) {
+        if self.crypto_box.get().is_none() || self.udp_bundle.is_some() {
+            return;
+        }
+
+        let budget = BUNDLE_BUDGET - self.udp_prefix_size();
+        let budget = if self.mtu == 0 { budget } else { budget.min(self.udp_payload_limit()) };
+        self.udp_bundle = Some(UdpBundle::new(budget, self.crypto_prefix_size()));
+    }
+
+    /// send the bundle started with `begin_udp_bundle`, and go back to sending udp packets right away
+    pub async fn end_udp_bundle(&mut self) -> Result<()> {
+        match self.udp_bundle.take() {
+            Some(mut bundle) => self.send_udp_bundle(&mut bundle).await,
+            None => Ok(()),
+        }
     }
 
     // packet encoding and sending functions
@@ -199,13 +424,21 @@ impl ClientSocket {
             self.print_packet::<P>(true, Some(if P::ENCRYPTED { "fast + encrypted" } else { "fast" }));
         }
 
+        if !P::SHOULD_USE_TCP && self.udp_bundle.as_ref().is_some_and(|b| b.can_hold(packet_size)) {
+            let mut bundle = self.udp_bundle.take().unwrap();
+            let result = self.push_to_udp_bundle::<P, F>(&mut bundle, packet_size, encode_fn).await;
+            self.udp_bundle = Some(bundle);
+
+            return result;
+        }
+
         if P::ENCRYPTED {
             // gs_inline_encode! doesn't work here because the borrow checker is silly :(
             let header_start = if P::SHOULD_USE_TCP { size_of_types!(u32) } else { size_of_types!(u8) };
+            let stream = if P::SHOULD_USE_TCP { CipherStream::Tcp } else { CipherStream::Udp };
 
-            let nonce_start = header_start + PacketHeader::SIZE;
-            let mac_start = nonce_start + NONCE_SIZE;
-            let raw_data_start = mac_start + MAC_SIZE;
+            let prefix_start = header_start + PacketHeader::SIZE;
+            let raw_data_start = prefix_start + self.crypto_prefix_size();
             let total_size = raw_data_start + packet_size;
 
             gs_alloca_check_size!(total_size);
@@ -231,20 +464,8 @@ impl ClientSocket {
                 // if the written size isn't equal to `packet_size`, we use buffer length instead
                 let raw_data_end = raw_data_start + buf.len();
 
-                // this unwrap is safe, as an encrypted packet can only be sent downstream after the handshake is established.
-                let cbox = self.crypto_box.get().unwrap();
-
-                // encrypt in place
-                let nonce = ChaChaBox::generate_nonce(&mut OsRng);
-                let tag = cbox
-                    .encrypt_in_place_detached(&nonce, b"", &mut data[raw_data_start..raw_data_end])
-                    .map_err(|_| PacketHandlingError::EncryptionError)?;
-
-                // prepend the nonces
-                data[nonce_start..mac_start].copy_from_slice(nonce.as_slice());
-
-                // prepend the mac tag
-                data[mac_start..raw_data_start].copy_from_slice(&tag);
+                // encrypt in place, filling in the prefix
+                self.encrypt_in_place(stream, &mut data[prefix_start..raw_data_end])?;
 
                 if P::SHOULD_USE_TCP {
                     // write total packet length
@@ -287,7 +508,7 @@ impl ClientSocket {
             let total_payload_size = prefix_sz + PacketHeader::SIZE + packet_size;
 
             // ok so now umm
-            let should_fragment = !P::SHOULD_USE_TCP && self.mtu != 0 && total_payload_size > self.mtu;
+            let should_fragment = !P::SHOULD_USE_TCP && self.mtu != 0 && total_payload_size > self.udp_payload_limit();
 
             // so yeah
             if should_fragment {
@@ -398,43 +619,155 @@ impl ClientSocket {
 
     /// sends a buffer to our peer via the udp socket
     async fn send_buffer_udp(&self, buffer: &[u8]) -> Result<()> {
-        match self.udp_peer.as_ref() {
-            Some(udp_peer) => self
+        let Some(udp_peer) = self.udp_peer else {
+            return Err(PacketHandlingError::UnableToSendUdp);
+        };
+
+        let Some(header) = self.next_udp_sequence() else {
+            return self
                 .game_server
                 .udp_socket
                 .send_to(buffer, udp_peer)
                 .await
                 .map(|_size| ())
-                .map_err(PacketHandlingError::SocketSendFailed),
+                .map_err(PacketHandlingError::SocketSendFailed);
+        };
 
-            None => Err(PacketHandlingError::UnableToSendUdp),
+        // udp sends almost never block, so try to avoid the allocation below
+        match self.send_buffer_udp_immediate(buffer) {
+            Err(PacketHandlingError::SocketWouldBlock) => {}
+            other => return other.map(|_size| ()),
         }
+
+        let mut data = vec![0u8; SEQUENCED_PREFIX_SIZE + buffer.len()];
+        self.write_sequenced(&mut data, &header, buffer)?;
+
+        self.game_server
+            .udp_socket
+            .send_to(&data, udp_peer)
+            .await
+            .map_err(PacketHandlingError::SocketSendFailed)?;
+
+        self.udp_sequencer.lock().commit();
+
+        Ok(())
     }
 
     /// non async version of `send_buffer_udp`
     fn send_buffer_udp_immediate(&self, buffer: &[u8]) -> Result<usize> {
-        match self.udp_peer.as_ref() {
-            Some(udp_peer) => self.game_server.udp_socket.try_send_to(buffer, SocketAddr::V4(*udp_peer)).map_err(|e| {
-                if e.kind() == std::io::ErrorKind::WouldBlock {
-                    PacketHandlingError::SocketWouldBlock
-                } else {
-                    PacketHandlingError::SocketSendFailed(e)
-                }
-            }),
+        let Some(udp_peer) = self.udp_peer else {
+            return Err(PacketHandlingError::UnableToSendUdp);
+        };
+
+        let Some(header) = self.next_udp_sequence() else {
+            return self.try_send_udp(buffer, udp_peer);
+        };
 
-            None => Err(PacketHandlingError::UnableToSendUdp),
+        let total_size = SEQUENCED_PREFIX_SIZE + buffer.len();
+
+        let written = gs_with_alloca_guarded!(self.game_server, total_size, data, {
+            let data = &mut data[..total_size];
+            self.write_sequenced(data, &header, buffer)
+                .and_then(|()| self.try_send_udp(data, udp_peer))
+        })?;
+
+        self.udp_sequencer.lock().commit();
+
+        // the caller only knows about its own buffer
+        Ok(written.saturating_sub(SEQUENCED_PREFIX_SIZE))
+    }
+
+    fn try_send_udp(&self, data: &[u8], udp_peer: SocketAddr) -> Result<usize> {
+        self.game_server.udp_socket.try_send_to(data, udp_peer).map_err(|e| {
+            if e.kind() == std::io::ErrorKind::WouldBlock {
+                PacketHandlingError::SocketWouldBlock
+            } else {
+                PacketHandlingError::SocketSendFailed(e)
+            }
+        })
+    }
+
+    /// the sequence header for the next datagram, if sequencing is enabled
+    fn next_udp_sequence(&self) -> Option<SequenceHeader> {
+        let sequencer = self.udp_sequencer.lock();
+        sequencer.is_enabled().then(|| sequencer.next_header())
+    }
+
+    /// the header is encrypted with the session cipher, so that a spoofed datagram can't feed fake acks into the client's link estimates
+    fn write_sequenced(&self, out: &mut [u8], header: &SequenceHeader, datagram: &[u8]) -> Result<()> {
+        // sequencing is only enabled together with the session cipher
+        let session = self.session_cipher.get().ok_or(PacketHandlingError::WrongCryptoBoxState)?;
+
+        out[0] = MARKER_UDP_SEQUENCED;
+
+        let (prefix, rest) = out[size_of_types!(u8)..].split_at_mut(session_cipher::PREFIX_SIZE);
+        let (encrypted_header, payload) = rest.split_at_mut(SequenceHeader::SIZE);
+
+        header.write(encrypted_header);
+        session.encrypt_in_place(CipherStream::Udp, prefix, encrypted_header)?;
+
+        payload.copy_from_slice(datagram);
+
+        Ok(())
+    }
+
+    /// add a packet to the bundle, sending the bundle first if the packet doesn't fit in it anymore
+    async fn push_to_udp_bundle<P: Packet, F>(&self, bundle: &mut UdpBundle, packet_size: usize, encode_fn: F) -> Result<()>
+    where
+        F: FnOnce(&mut FastByteBuffer),
+    {
+        if !bundle.has_room_for(packet_size) {
+            self.send_udp_bundle(bundle).await?;
         }
+
+        bundle.push::<P, F>(packet_size, encode_fn);
+
+        Ok(())
+    }
+
+    /// encrypt and send a bundle, leaving it empty
+    async fn send_udp_bundle(&self, bundle: &mut UdpBundle) -> Result<()> {
+        if bundle.count == 0 {
+            return Ok(());
+        }
+
+        let result = if bundle.count == 1 && !bundle.has_encrypted {
+            // nothing to gain from a bundle here, turn the entry into a regular packet by replacing its length with the marker
+            let start = bundle.prefix_size + size_of_types!(u16) - 1;
+            bundle.data[start] = MARKER_UDP_PACKET;
+
+            self.send_buffer_udp(&bundle.data[start..]).await
+        } else {
+            match self.encrypt_udp_bundle(bundle) {
+                Ok(()) => self.send_buffer_udp(&bundle.data).await,
+                Err(e) => Err(e),
+            }
+        };
+
+        // whatever happened, these packets are gone now
+        bundle.clear();
+
+        result
+    }
+
+    fn encrypt_udp_bundle(&self, bundle: &mut UdpBundle) -> Result<()> {
+        // bundles are only started once the crypto box exists
+        self.encrypt_in_place(CipherStream::Udp, &mut bundle.data[size_of_types!(u8)..])?;
+        bundle.data[0] = MARKER_UDP_BUNDLE;
+
+        Ok(())
     }
 
     /// fragmented udp send
     async fn send_fragmented_udp_payload(&self, buffer: &[u8]) -> Result<()> {
-        let mut vec = vec![0u8; self.mtu];
+        let datagram_size = self.udp_payload_limit();
+        let mut vec = vec![0u8; datagram_size];
         let mut buf = FastByteBuffer::new(&mut vec[..]);
 
         let unique_id: u32 = globed_shared::rand::rng().random();
 
         // // ok
-        let chunk_size = self.mtu - 8;
+        let chunk_size = datagram_size - 8;
         let chunk_count = buffer.len().div_ceil(chunk_size);
 
         if chunk_count > u8::MAX as usize {
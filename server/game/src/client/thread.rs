@@ -1,7 +1,7 @@
 use std::{
     borrow::Cow,
     collections::VecDeque,
-    net::SocketAddrV4,
+    net::SocketAddr,
     sync::{
         Arc,
         atomic::{AtomicBool, AtomicI32, AtomicU16, AtomicU32, Ordering},
@@ -57,6 +57,7 @@ pub struct ClientThread {
     connection_state: AtomicClientThreadState,
 
     pub secret_key: u32,
+    pub resume_ticket: SyncMutex<Option<ResumeTicket>>,
     pub protocol_version: AtomicU16,
 
     pub account_id: AtomicI32,
@@ -79,6 +80,7 @@ pub struct ClientThread {
     rate_limiter: LockfreeMutCell<SimpleRateLimiter>,
     voice_rate_limiter: LockfreeMutCell<SimpleRateLimiter>,
     chat_rate_limiter: Option<LockfreeMutCell<SimpleRateLimiter>>,
+    player_data_codec: LockfreeMutCell<PlayerDataCodec>,
     translator: PacketTranslator,
 
     pub destruction_notify: Arc<Notify>,
@@ -121,6 +123,7 @@ impl ClientThread {
             connection_state: thread.connection_state,
 
             secret_key: thread.secret_key,
+            resume_ticket: thread.resume_ticket,
             protocol_version: thread.protocol_version,
 
             account_id: thread.account_id,
@@ -143,6 +146,7 @@ impl ClientThread {
             rate_limiter: LockfreeMutCell::new(rate_limiter),
             voice_rate_limiter: LockfreeMutCell::new(voice_rate_limiter),
             chat_rate_limiter: chat_rate_limiter.map(LockfreeMutCell::new),
+            player_data_codec: LockfreeMutCell::new(PlayerDataCodec::new()),
             translator,
 
             destruction_notify: thread.destruction_notify,
@@ -274,7 +278,7 @@ impl ClientThread {
     /* private utilities */
 
     /// get the tcp address of the connected peer. do not call this from another clientthread
-    fn get_tcp_peer(&self) -> SocketAddrV4 {
+    fn get_tcp_peer(&self) -> SocketAddr {
         // safety: we trust this function is not called from the oustide
         unsafe { self.socket.get() }.tcp_peer
     }
@@ -319,6 +323,7 @@ impl ClientThread {
                 // these can likely never happen unless network corruption or someone is pentesting, so ignore in release
                 PacketHandlingError::MalformedMessage
                 | PacketHandlingError::MalformedCiphertext
+                | PacketHandlingError::ReplayedMessage
                 | PacketHandlingError::MalformedLoginAttempt
                 | PacketHandlingError::MalformedPacketStructure(_)
                 | PacketHandlingError::SocketWouldBlock
@@ -381,14 +386,16 @@ impl ClientThread {
     async fn recv_and_handle(&self, message_size: usize) -> Result<()> {
         // safety: only we can receive data from our client.
         let socket = unsafe { self.socket.get_mut() };
-        socket.recv_and_handle(message_size, async |buf| self.handle_packet(buf).await).await
+        socket
+            .recv_and_handle(message_size, async |buf| self.handle_packet(buf, CipherStream::Tcp).await)
+            .await
     }
 
     /// handle a message sent from the `GameServer`
     async fn handle_message(&self, message: ServerThreadMessage) -> Result<()> {
         match message {
-            ServerThreadMessage::Packet(mut packet) => self.handle_packet(&mut packet).await?,
-            ServerThreadMessage::SmallPacket((mut packet, len)) => self.handle_packet(&mut packet[..len]).await?,
+            ServerThreadMessage::Packet(mut packet) => self.handle_datagram(&mut packet).await?,
+            ServerThreadMessage::SmallPacket((mut packet, len)) => self.handle_datagram(&mut packet[..len]).await?,
             ServerThreadMessage::BroadcastText(text_packet) => self.send_packet_static(&text_packet).await?,
             ServerThreadMessage::BroadcastVoice(voice_packet) => self.send_packet_dynamic(&*voice_packet).await?,
             ServerThreadMessage::BroadcastNotice(packet) => {
@@ -415,8 +422,75 @@ impl ClientThread {
         Ok(())
     }
 
-    /// handle an incoming packet
-    async fn handle_packet(&self, message: &mut [u8]) -> Result<()> {
+    /// handle a datagram forwarded by the `GameServer`, which is either a single packet or a bundle of them
+    async fn handle_datagram(&self, message: &mut [u8]) -> Result<()> {
+        let message = self.strip_sequence_header(message)?;
+
+        let is_bundle = message.len() >= PacketHeader::SIZE
+            && ByteReader::from_bytes(message).read_packet_header()?.packet_id == PacketBundlePacket::PACKET_ID;
+
+        if is_bundle {
+            self.handle_packet_bundle(message).await
+        } else {
+            self.handle_packet(message, CipherStream::Udp).await
+        }
+    }
+
+    /// if the datagram is wrapped in a `SequencedDatagramPacket`, record its sequence number and return the datagram inside
+    fn strip_sequence_header<'a>(&self, message: &'a mut [u8]) -> Result<&'a mut [u8]> {
+        if message.len() < PacketHeader::SIZE
+            || ByteReader::from_bytes(message).read_packet_header()?.packet_id != SequencedDatagramPacket::PACKET_ID
+        {
+            return Ok(message);
+        }
+
+        let header = udp_sequence::SequenceHeader::read(&message[PacketHeader::SIZE..]).ok_or(PacketHandlingError::MalformedMessage)?;
+        // safety: only we can use our socket.
+        unsafe { self.socket.get() }.on_udp_sequence(&header);
+
+        Ok(&mut message[PacketHeader::SIZE + udp_sequence::SequenceHeader::SIZE..])
+    }
+
+    /// decrypt a bundle and handle every packet in it. any udp packets sent in response are bundled as well,
+    /// and go out together once the whole bundle has been handled.
+    async fn handle_packet_bundle(&self, message: &mut [u8]) -> Result<()> {
+        // safety: only we can use our socket.
+        let mut rest = unsafe { self.socket.get_mut() }.decrypt_in_place(message, CipherStream::Udp)?;
+
+        unsafe { self.socket.get_mut() }.begin_udp_bundle();
+
+        let mut result = Ok(());
+
+        while !rest.is_empty() {
+            if rest.len() < size_of_types!(u16) {
+                result = Err(PacketHandlingError::MalformedMessage);
+                break;
+            }
+
+            let entry_len = u16::from_be_bytes([rest[0], rest[1]]) as usize;
+            let entry_end = size_of_types!(u16) + entry_len;
+
+            if rest.len() < entry_end {
+                result = Err(PacketHandlingError::MalformedMessage);
+                break;
+            }
+
+            let (entry, tail) = std::mem::take(&mut rest).split_at_mut(entry_end);
+            rest = tail;
+
+            // a bad packet shouldn't take the rest of the bundle down with it
+            if let Err(e) = self.handle_packet(&mut entry[size_of_types!(u16)..], CipherStream::Udp).await {
+                self.print_error(&e);
+            }
+        }
+
+        unsafe { self.socket.get_mut() }.end_udp_bundle().await?;
+
+        result
+    }
+
+    /// handle an incoming packet, `stream` is the transport it arrived on
+    async fn handle_packet(&self, message: &mut [u8], stream: CipherStream) -> Result<()> {
         #[cfg(debug_assertions)]
         if message.len() < PacketHeader::SIZE {
             return Err(PacketHandlingError::MalformedMessage);
@@ -432,6 +506,10 @@ impl ClientThread {
         let header = data.read_packet_header()?;
 
         // by far the most common packet, so we try it early
+        if header.packet_id == PlayerDataCompactPacket::PACKET_ID {
+            return self.handle_player_data_compact(&mut data).await;
+        }
+
         if header.packet_id == PlayerDataPacket::PACKET_ID {
             return self.handle_player_data(&mut data).await;
         }
@@ -447,7 +525,7 @@ impl ClientThread {
 
         // decrypt the packet in-place if encrypted
         if header.encrypted {
-            data = unsafe { self.socket.get_mut().decrypt(message)? };
+            data = unsafe { self.socket.get_mut().decrypt(message, stream)? };
         }
 
         match header.packet_id {
@@ -471,6 +549,7 @@ impl ClientThread {
             LevelJoinPacket::PACKET_ID => self.handle_level_join(&mut data).await,
             LevelLeavePacket::PACKET_ID => self.handle_level_leave(&mut data).await,
             PlayerDataPacket::PACKET_ID => self.handle_player_data(&mut data).await,
+            PlayerDataCompactPacket::PACKET_ID => self.handle_player_data_compact(&mut data).await,
             VoicePacket::PACKET_ID => self.handle_voice(&mut data).await,
             ChatMessagePacket::PACKET_ID => self.handle_chat_message(&mut data).await,
 
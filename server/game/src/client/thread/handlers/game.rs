@@ -53,52 +53,8 @@ impl ClientThread {
 
         let is_mod = self.can_moderate();
 
-        let (written_players, metadatas, estimated_size) = {
-            let room = self.room.lock();
-
-            let mut manager = room.manager.write();
-            // set metadata
-            manager.set_player_data(account_id, &packet.data);
-
-            // run custom item id changes
-            if !packet.counter_changes.is_empty() {
-                manager.run_counter_actions_on_level(level_id, &packet.counter_changes);
-            }
-
-            // this unwrap should be safe and > 0 given that self.level_id != 0, but we leave a default just in case
-            let player_count = manager.get_player_count_on_level(level_id).unwrap_or(1) - 1;
-
-            // retrieve metadata of other players, if was asked
-            let mut metavec = Vec::new();
-            let mut estimated_size = 0usize;
-            let mut should_add_meta = false;
-
-            if let Some(meta) = packet.meta {
-                manager.set_player_meta(account_id, &meta);
-                metavec = Vec::with_capacity(player_count);
-                should_add_meta = true;
-            }
-
-            manager.for_each_player_on_level(level_id, |player| {
-                if player.account_id != account_id && (!player.is_invisible || is_mod) {
-                    if should_add_meta {
-                        metavec.push(AssociatedPlayerMetadata {
-                            account_id: player.account_id,
-                            data: player.meta.clone(),
-                        });
-                    }
-
-                    estimated_size += player.data.encoded_size() + size_of_types!(i32);
-                }
-            });
-
-            // add the size of the custom items as well
-            if let Some(level) = manager.get_level(level_id) {
-                estimated_size += level.custom_items.encoded_size();
-            }
-
-            (player_count, metavec, estimated_size)
-        };
+        let (written_players, metadatas, estimated_size) =
+            self._update_player_data(account_id, level_id, is_mod, &packet.data, packet.meta.as_ref(), &packet.counter_changes);
 
         // no one else on the level, if no item ids changed there is no need to send a response packet
         if written_players == 0 {
@@ -162,6 +118,156 @@ impl ClientThread {
         Ok(())
     });
 
+    /// Handles `PlayerDataCompactPacket`. This can't use `gs_handler!`, as the data after the header can only be decoded with the codec state.
+    pub(crate) async fn handle_player_data_compact(&self, buf: &mut esp::ByteReader<'_>) -> crate::client::Result<()> {
+        let packet: PlayerDataCompactPacket = match self.translator.translate_packet::<PlayerDataCompactPacket>(buf) {
+            Ok(pkt) => pkt?,
+            Err(e) => return Err(PacketHandlingError::TranslationError(e)),
+        };
+
+        #[cfg(debug_assertions)]
+        unsafe { self.socket.get_mut() }.print_packet::<PlayerDataCompactPacket>(false, None);
+
+        let account_id = gs_needauth!(self);
+
+        let level_id = self.level_id.load(Ordering::Relaxed);
+        if level_id == 0 {
+            return Err(PacketHandlingError::UnexpectedPlayerData);
+        }
+
+        // safety: only we can use the codec.
+        let codec = unsafe { self.player_data_codec.get_mut() };
+
+        let base = codec.received_base(packet.base_frame)?;
+        let data = CompactPlayerData::decode(buf, base.as_ref())?;
+        let meta: Option<PlayerMetadata> = buf.read_value()?;
+        let counter_changes: Vec1L<GlobedCounterChange> = buf.read_value()?;
+
+        codec.acknowledge(packet.level_data_ack);
+        let player_data_ack = codec.store_received(packet.frame, &data.quantized);
+
+        let is_mod = self.can_moderate();
+
+        let (written_players, metadatas, _) =
+            self._update_player_data(account_id, level_id, is_mod, &data.to_player_data(), meta.as_ref(), &counter_changes);
+
+        // unlike with `LevelDataPacket`, we respond even if no one else is on the level, as the client needs our acks
+        let (frame, base_frame) = codec.begin_frame();
+
+        let custom_items = self.room.lock().manager.read().get_level(level_id).map(|x| x.custom_items.clone());
+        let custom_items_size = custom_items.as_ref().map_or(0, DynamicSize::encoded_size);
+
+        let calc_size = LevelDataCompactPacket::ENCODED_SIZE
+            + size_of_types!(VarLength)
+            + written_players * (size_of_types!(i32) + CompactPlayerData::MAX_ENCODED_SIZE)
+            + size_of_types!(bool)
+            + custom_items_size;
+
+        self.send_packet_alloca_with::<LevelDataCompactPacket, _>(calc_size, |buf| {
+            buf.write_value(&LevelDataCompactPacket {
+                frame,
+                base_frame,
+                player_data_ack,
+            });
+
+            let mut sent = codec.take_frame_storage(frame);
+
+            {
+                let room = self.room.lock();
+                let manager = room.manager.read();
+
+                buf.write_list_with(written_players, |buf| {
+                    manager.for_each_player_on_level(level_id, |player| {
+                        if sent.len() < written_players && player.account_id != account_id && (!player.is_invisible || is_mod) {
+                            let compact = CompactPlayerData::from_player_data(&player.data);
+
+                            buf.write_i32(player.account_id);
+                            compact.encode(buf, codec.sent_base(base_frame, player.account_id, sent.len()));
+
+                            sent.push((player.account_id, compact.quantized));
+                        }
+                    });
+
+                    sent.len()
+                });
+            }
+
+            codec.store_sent(frame, sent);
+
+            match custom_items {
+                Some(items) if !items.is_empty() => {
+                    buf.write_bool(true);
+                    buf.write_value(&items);
+                }
+                _ => buf.write_bool(false),
+            }
+        })
+        .await?;
+
+        if !metadatas.is_empty() {
+            self.send_packet_dynamic(&LevelPlayerMetadataPacket { players: metadatas }).await?;
+        }
+
+        Ok(())
+    }
+
+    /// Stores the player data and metadata, runs the counter changes and collects what is needed for the response.
+    /// Returns the amount of other players on the level, their metadata if `meta` is not `None`, and the estimated size of their data.
+    fn _update_player_data(
+        &self,
+        account_id: i32,
+        level_id: LevelId,
+        is_mod: bool,
+        data: &PlayerData,
+        meta: Option<&PlayerMetadata>,
+        counter_changes: &[GlobedCounterChange],
+    ) -> (usize, Vec<AssociatedPlayerMetadata>, usize) {
+        let room = self.room.lock();
+
+        let mut manager = room.manager.write();
+        // set metadata
+        manager.set_player_data(account_id, data);
+
+        // run custom item id changes
+        if !counter_changes.is_empty() {
+            manager.run_counter_actions_on_level(level_id, counter_changes);
+        }
+
+        // this unwrap should be safe and > 0 given that self.level_id != 0, but we leave a default just in case
+        let player_count = manager.get_player_count_on_level(level_id).unwrap_or(1) - 1;
+
+        // retrieve metadata of other players, if was asked
+        let mut metavec = Vec::new();
+        let mut estimated_size = 0usize;
+        let mut should_add_meta = false;
+
+        if let Some(meta) = meta {
+            manager.set_player_meta(account_id, meta);
+            metavec = Vec::with_capacity(player_count);
+            should_add_meta = true;
+        }
+
+        manager.for_each_player_on_level(level_id, |player| {
+            if player.account_id != account_id && (!player.is_invisible || is_mod) {
+                if should_add_meta {
+                    metavec.push(AssociatedPlayerMetadata {
+                        account_id: player.account_id,
+                        data: player.meta.clone(),
+                    });
+                }
+
+                estimated_size += player.data.encoded_size() + size_of_types!(i32);
+            }
+        });
+
+        // add the size of the custom items as well
+        if let Some(level) = manager.get_level(level_id) {
+            estimated_size += level.custom_items.encoded_size();
+        }
+
+        (player_count, metavec, estimated_size)
+    }
+
     gs_handler!(self, handle_request_profiles, RequestPlayerProfilesPacket, packet, {
         let _ = gs_needauth!(self);
 
@@ -3,6 +3,7 @@ use super::*;
 impl Translatable for LevelJoinPacket {}
 impl Translatable for LevelLeavePacket {}
 impl Translatable for PlayerDataPacket {}
+impl Translatable for PlayerDataCompactPacket {}
 impl Translatable for RequestPlayerProfilesPacket {}
 impl Translatable for VoicePacket {}
 impl Translatable for ChatMessagePacket {}
@@ -0,0 +1,178 @@
+use std::time::Instant;
+
+pub const MARKER_UDP_SEQUENCED: u8 = 0xb3;
+
+/// Sent in front of every UDP datagram (protocol v17+).
+/// From the server, it's `MARKER_UDP_SEQUENCED`, this header encrypted with the session cipher (so the client can trust the acks in it)
+/// and then the usual datagram (starting with its own marker).
+/// From the client, it's the header of a `SequencedDatagramPacket`, this header in cleartext and then the usual datagram.
+#[derive(Clone, Copy, Default, Debug, PartialEq, Eq)]
+pub struct SequenceHeader {
+    /// sequence number of this datagram, starts at 1 and wraps around, skipping 0
+    pub sequence: u16,
+    /// newest sequence number received from the peer, 0 if nothing was received yet
+    pub ack: u16,
+    /// bit `n` is set if `ack - 1 - n` was received as well
+    pub ack_bits: u32,
+    /// microseconds since the sender started counting, wraps around. used for measuring jitter
+    pub timestamp: u32,
+}
+
+impl SequenceHeader {
+    pub const SIZE: usize = 12;
+
+    pub fn read(data: &[u8]) -> Option<Self> {
+        if data.len() < Self::SIZE {
+            return None;
+        }
+
+        Some(Self {
+            sequence: u16::from_be_bytes([data[0], data[1]]),
+            ack: u16::from_be_bytes([data[2], data[3]]),
+            ack_bits: u32::from_be_bytes([data[4], data[5], data[6], data[7]]),
+            timestamp: u32::from_be_bytes([data[8], data[9], data[10], data[11]]),
+        })
+    }
+
+    pub fn write(&self, out: &mut [u8]) {
+        out[0..2].copy_from_slice(&self.sequence.to_be_bytes());
+        out[2..4].copy_from_slice(&self.ack.to_be_bytes());
+        out[4..8].copy_from_slice(&self.ack_bits.to_be_bytes());
+        out[8..12].copy_from_slice(&self.timestamp.to_be_bytes());
+    }
+}
+
+/// Numbers our datagrams and keeps track of which of the client's datagrams arrived, so they can be acked.
+/// All the measuring is done by the client, we only provide the numbers.
+pub struct UdpSequencer {
+    enabled: bool,
+    next_sequence: u16,
+    received_any: bool,
+    highest_received: u16,
+    received_bits: u32,
+    started_at: Instant,
+}
+
+impl Default for UdpSequencer {
+    fn default() -> Self {
+        Self {
+            enabled: false,
+            next_sequence: 1,
+            received_any: false,
+            highest_received: 0,
+            received_bits: 0,
+            started_at: Instant::now(),
+        }
+    }
+}
+
+impl UdpSequencer {
+    pub fn enable(&mut self) {
+        self.enabled = true;
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.enabled
+    }
+
+    /// header for the next datagram. the sequence number is only used up once `commit` is called,
+    /// so a datagram that could not be sent doesn't look lost to the client.
+    pub fn next_header(&self) -> SequenceHeader {
+        SequenceHeader {
+            sequence: self.next_sequence,
+            ack: self.highest_received,
+            ack_bits: self.received_bits,
+            timestamp: self.started_at.elapsed().as_micros() as u32,
+        }
+    }
+
+    pub fn commit(&mut self) {
+        // 0 means "nothing received" in acks, so it is never used as a sequence number
+        self.next_sequence = match self.next_sequence.wrapping_add(1) {
+            0 => 1,
+            x => x,
+        };
+    }
+
+    pub fn on_received(&mut self, header: &SequenceHeader) {
+        let sequence = header.sequence;
+
+        if !self.received_any {
+            self.received_any = true;
+            self.highest_received = sequence;
+            return;
+        }
+
+        // positive if newer than the highest one so far, negative if older
+        let diff = sequence.wrapping_sub(self.highest_received) as i16;
+
+        if diff > 0 {
+            let shift = diff as u32;
+            self.received_bits = if shift > 32 {
+                0
+            } else {
+                // the previous highest becomes bit `shift - 1`
+                ((u64::from(self.received_bits) << shift) | (1u64 << (shift - 1))) as u32
+            };
+            self.highest_received = sequence;
+        } else if diff < 0 && -(diff as i32) <= 32 {
+            self.received_bits |= 1 << (-(diff as i32) - 1);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn header_roundtrip() {
+        let header = SequenceHeader {
+            sequence: 0x1234,
+            ack: 0xfffe,
+            ack_bits: 0xdead_beef,
+            timestamp: 42,
+        };
+
+        let mut buf = [0u8; SequenceHeader::SIZE];
+        header.write(&mut buf);
+        assert_eq!(SequenceHeader::read(&buf), Some(header));
+    }
+
+    #[test]
+    fn acks() {
+        let mut seq = UdpSequencer::default();
+        let recv = |seq: &mut UdpSequencer, sequence: u16| {
+            seq.on_received(&SequenceHeader { sequence, ..Default::default() });
+        };
+
+        recv(&mut seq, 1);
+        recv(&mut seq, 2);
+        recv(&mut seq, 4);
+        let header = seq.next_header();
+        assert_eq!(header.ack, 4);
+        // 3 is missing, 2 and 1 arrived
+        assert_eq!(header.ack_bits, 0b110);
+
+        // late arrival
+        recv(&mut seq, 3);
+        assert_eq!(seq.next_header().ack_bits, 0b111);
+
+        // wraps around
+        seq.highest_received = 65535;
+        seq.received_bits = 0;
+        recv(&mut seq, 1);
+        assert_eq!(seq.next_header().ack, 1);
+        assert_eq!(seq.next_header().ack_bits, 0b10);
+    }
+
+    #[test]
+    fn sequence_skips_zero() {
+        let mut seq = UdpSequencer::default();
+        seq.next_sequence = 65535;
+
+        assert_eq!(seq.next_header().sequence, 65535);
+        seq.commit();
+        assert_eq!(seq.next_header().sequence, 1);
+    }
+}
@@ -1,6 +1,6 @@
 use std::{
     borrow::Cow,
-    net::SocketAddrV4,
+    net::SocketAddr,
     sync::{
         atomic::{AtomicBool, AtomicI32, AtomicU16, AtomicU32, Ordering},
         Arc,
@@ -34,12 +34,14 @@ use crate::{
 /// 2. `LoginRecoverPacket` -> merge with the found `UnauthorizedThread` -> `ClaimThreadPacket` -> thread gets upgraded
 ///
 /// In the second mode, the server waits for someone to try and recover this thread, while it's in `Disconnected` state.
+/// With protocol v18, a client that still has the session keys can resume instead, using the ticket from `SessionTicketPacket`.
 pub struct UnauthorizedThread {
     pub game_server: &'static GameServer,
     pub socket: LockfreeMutCell<ClientSocket>,
     pub connection_state: AtomicClientThreadState,
 
     pub secret_key: u32,
+    pub resume_ticket: SyncMutex<Option<ResumeTicket>>,
     pub protocol_version: AtomicU16,
 
     pub account_id: AtomicI32,
@@ -53,10 +55,10 @@ pub struct UnauthorizedThread {
     pub user_entry: SyncMutex<Option<ServerUserEntry>>,
     pub user_role: SyncMutex<Option<ComputedRole>>,
 
-    pub claim_udp_peer: SyncMutex<Option<SocketAddrV4>>,
+    pub claim_udp_peer: SyncMutex<Option<SocketAddr>>,
     pub claim_udp_notify: Notify,
 
-    pub recover_stream: SyncMutex<Option<(TcpStream, SocketAddrV4)>>,
+    pub recover_stream: SyncMutex<Option<RecoverRequest>>,
     pub recover_notify: Notify,
 
     pub terminate_notify: Notify,
@@ -67,6 +69,19 @@ pub struct UnauthorizedThread {
     pub privacy_settings: SyncMutex<UserPrivacyFlags>,
 }
 
+pub type ResumeTicket = [u8; 16];
+
+/// the ticket, encrypted with the session cipher (tcp stream), proving that the client still has the session keys
+pub const RESUME_PROOF_SIZE: usize = session_cipher::PREFIX_SIZE + size_of::<ResumeTicket>();
+pub type ResumeProof = [u8; RESUME_PROOF_SIZE];
+
+/// A new tcp stream for a disconnected thread. `proof` is only set if the client is resuming with a ticket.
+pub struct RecoverRequest {
+    pub stream: TcpStream,
+    pub peer: SocketAddr,
+    pub proof: Option<ResumeProof>,
+}
+
 pub enum UnauthorizedThreadOutcome {
     Upgrade,
     Terminate,
@@ -75,13 +90,14 @@ pub enum UnauthorizedThreadOutcome {
 const TIMEOUT: Duration = Duration::from_secs(90);
 
 impl UnauthorizedThread {
-    pub fn new(socket: TcpStream, peer: SocketAddrV4, game_server: &'static GameServer) -> Self {
+    pub fn new(socket: TcpStream, peer: SocketAddr, game_server: &'static GameServer) -> Self {
         Self {
             game_server,
             socket: LockfreeMutCell::new(ClientSocket::new(socket, peer, 0, game_server)),
             connection_state: AtomicClientThreadState::default(),
 
             secret_key: rand::rng().random(),
+            resume_ticket: SyncMutex::new(None),
             protocol_version: AtomicU16::new(0),
 
             account_id: AtomicI32::new(0),
@@ -117,6 +133,7 @@ impl UnauthorizedThread {
             connection_state: AtomicClientThreadState::new(ClientThreadState::Disconnected),
 
             secret_key: thread.secret_key,
+            resume_ticket: thread.resume_ticket,
             protocol_version: thread.protocol_version,
 
             account_id: thread.account_id,
@@ -157,7 +174,15 @@ impl UnauthorizedThread {
                 /* disconnected state, wait until another tcp stream tries to recover us */
                 ClientThreadState::Disconnected => tokio::select! {
                     x = tokio::time::timeout(TIMEOUT, self.wait_for_recovered()) => match x {
-                        Ok((stream, tcp_peer)) => {
+                        Ok(RecoverRequest { mut stream, peer: tcp_peer, proof }) => {
+                            // whoever resumes has to prove that they have the session keys, the ticket alone isn't enough.
+                            // if they don't, drop their stream and stay disconnected, the real client might still come back.
+                            if let Some(mut proof) = proof && !self.verify_resume_proof(&mut proof) {
+                                warn!("[{tcp_peer}] failed to resume a session, invalid proof");
+                                GameServer::send_recovery_failed(&mut stream).await;
+                                continue;
+                            }
+
                             // we just got recovered yay
                             let socket = self.get_socket();
 
@@ -251,16 +276,37 @@ impl UnauthorizedThread {
         }
     }
 
-    pub fn claim(&self, udp_peer: SocketAddrV4) {
+    pub fn claim(&self, udp_peer: SocketAddr) {
         *self.claim_udp_peer.lock() = Some(udp_peer);
         self.claim_udp_notify.notify_one();
     }
 
-    pub fn recover(&self, tcp_stream: TcpStream, peer: SocketAddrV4) {
-        *self.recover_stream.lock() = Some((tcp_stream, peer));
+    pub fn recover(&self, tcp_stream: TcpStream, peer: SocketAddr, proof: Option<ResumeProof>) {
+        *self.recover_stream.lock() = Some(RecoverRequest {
+            stream: tcp_stream,
+            peer,
+            proof,
+        });
         self.recover_notify.notify_one();
     }
 
+    /// whether `ticket` is the current resume ticket of this thread, in constant time
+    pub fn matches_resume_ticket(&self, ticket: &ResumeTicket) -> bool {
+        self.resume_ticket
+            .lock()
+            .as_ref()
+            .is_some_and(|current| current.iter().zip(ticket).fold(0u8, |acc, (a, b)| acc | (a ^ b)) == 0)
+    }
+
+    fn verify_resume_proof(&self, proof: &mut ResumeProof) -> bool {
+        let Some(ticket) = *self.resume_ticket.lock() else {
+            return false;
+        };
+
+        let socket = self.get_socket();
+        socket.verify_resume_proof(proof, &ticket)
+    }
+
     #[inline]
     async fn recv_and_handle(&self, message_size: usize) -> Result<()> {
         // safety: only we can receive data from our client.
@@ -284,7 +330,7 @@ impl UnauthorizedThread {
 
         // decrypt the packet in-place if encrypted
         if header.encrypted {
-            data = self.get_socket().decrypt(message)?;
+            data = self.get_socket().decrypt(message, CipherStream::Tcp)?;
         }
 
         match header.packet_id {
@@ -482,6 +528,10 @@ impl UnauthorizedThread {
         let all_roles = self.game_server.state.role_manager.get_all_roles();
         let special_user_data = self.account_data.lock().special_user_data.clone();
 
+        // tell the client which protocol we are going to speak, so it doesn't use features its version supports but we don't
+        let protocol = self.protocol_version.load(Ordering::Relaxed);
+        let server_protocol = if protocol == 0xffff { MAX_SUPPORTED_PROTOCOL } else { protocol };
+
         let socket = self.get_socket();
 
         socket
@@ -490,9 +540,38 @@ impl UnauthorizedThread {
                 all_roles,
                 secret_key: self.secret_key,
                 special_user_data,
-                server_protocol: MAX_SUPPORTED_PROTOCOL,
+                server_protocol,
             })
-            .await
+            .await?;
+
+        // a recovered thread keeps the session cipher it already had
+        if server_protocol >= 16 && !socket.has_session_cipher() {
+            let (cipher, keys) = SessionCipher::generate();
+
+            // this still goes through the crypto box, the cipher is only installed once the keys are sent
+            socket
+                .send_packet_static(&SessionKeysPacket {
+                    send_key: keys.send_key,
+                    recv_key: keys.recv_key,
+                })
+                .await?;
+
+            socket.init_session_cipher(cipher)?;
+        }
+
+        if server_protocol >= 17 && socket.has_session_cipher() {
+            socket.enable_udp_sequencing();
+        }
+
+        // a new ticket every time, so a resumption can't be replayed
+        if server_protocol >= 18 && socket.has_session_cipher() {
+            let ticket: ResumeTicket = rand::rng().random();
+            *self.resume_ticket.lock() = Some(ticket);
+
+            socket.send_packet_static(&SessionTicketPacket { ticket }).await?;
+        }
+
+        Ok(())
     }
 
     /// Blocks until we get notified that we got claimed by a UDP socket.
@@ -517,7 +596,7 @@ impl UnauthorizedThread {
     }
 
     /// Blocks until we get notified that we got recovered and have an assigned TCP stream
-    async fn wait_for_recovered(&self) -> (TcpStream, SocketAddrV4) {
+    async fn wait_for_recovered(&self) -> RecoverRequest {
         {
             let mut p = self.recover_stream.lock();
             if p.is_some() {
@@ -564,7 +643,7 @@ impl UnauthorizedThread {
     }
 
     /// get the tcp address of the connected peer. do not call this from another clientthread
-    fn get_tcp_peer(&self) -> SocketAddrV4 {
+    fn get_tcp_peer(&self) -> SocketAddr {
         self.get_socket().tcp_peer
     }
 
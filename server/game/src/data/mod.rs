@@ -15,9 +15,13 @@ pub use types::*;
 
 pub mod v13;
 pub mod v14;
+pub mod v15;
+pub mod v16;
+pub mod v17;
+pub mod v18;
 
 // change this to the latest version as needed
-pub use v13 as v_current;
+pub use v18 as v_current;
 
 // our own extension
 
@@ -1 +1,22 @@
 pub use crate::data::v13::packets::*;
+
+use crate::data::*;
+
+// Only the header is decoded here. It's followed by `CompactPlayerData`, `Option<PlayerMetadata>` and `Vec1L<GlobedCounterChange>`,
+// and the data can't be decoded without the frames received previously, see `handle_player_data_compact`.
+#[derive(Packet, Decodable)]
+#[packet(id = 12005)]
+pub struct PlayerDataCompactPacket {
+    pub frame: u8,          // id of this frame, never 0
+    pub base_frame: u8,     // id of the frame the data is delta encoded against, 0 for keyframes
+    pub level_data_ack: u8, // id of the last `LevelDataCompactPacket` the client received, 0 if none
+}
+
+// Only the header, it's followed by a list of (account id, `CompactPlayerData`) and `Option<IntMap<u16, i32>>`.
+#[derive(Packet, Encodable, StaticSize)]
+#[packet(id = 22003, tcp = false)]
+pub struct LevelDataCompactPacket {
+    pub frame: u8,           // id of this frame, never 0
+    pub base_frame: u8,      // id of the frame the entries are delta encoded against, 0 if all of them are keyframes
+    pub player_data_ack: u8, // id of the last `PlayerDataCompactPacket` we received, 0 if none
+}
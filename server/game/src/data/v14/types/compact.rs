@@ -0,0 +1,251 @@
+use crate::data::*;
+
+/* Compact PlayerData encoding (v14) */
+// Every frame is a delta against a previous frame that the other side has acknowledged, or against an all-zero frame if it's a keyframe.
+// See `CompactPlayerData` on the client for the exact format, the two must be kept in sync.
+
+const MASK_DELTA: u8 = 1 << 0;
+const MASK_PLAYER1_STATE: u8 = 1 << 1;
+const MASK_PLAYER2_STATE: u8 = 1 << 2;
+const MASK_PLAYER1_SPIDER: u8 = 1 << 3;
+const MASK_PLAYER2_SPIDER: u8 = 1 << 4;
+const MASK_DEATH_TIMESTAMP: u8 = 1 << 5;
+const MASK_PERCENTAGE: u8 = 1 << 6;
+const MASK_FLAGS: u8 = 1 << 7;
+
+#[derive(Clone, Copy, Default)]
+pub struct QuantizedIcon {
+    pub x: i32,
+    pub y: i32,
+    pub rotation: i32,
+    pub icon_type: PlayerIconType,
+    pub flags: u16, // contents of `SpecificIconData::flags`
+}
+
+impl QuantizedIcon {
+    fn state_differs(&self, other: &Self) -> bool {
+        self.icon_type as u8 != other.icon_type as u8 || self.flags != other.flags
+    }
+
+    fn from_icon_data(data: &SpecificIconData) -> Self {
+        Self {
+            x: quantize(data.position.x.0, QuantizedPlayerData::POSITION_SCALE),
+            y: quantize(data.position.y.0, QuantizedPlayerData::POSITION_SCALE),
+            rotation: quantize(data.rotation.0, QuantizedPlayerData::ROTATION_SCALE),
+            icon_type: data.icon_type,
+            flags: u16::from_be_bytes(data.flags.to_bytes()),
+        }
+    }
+
+    fn to_icon_data(self, spider_teleport_data: Option<SpiderTeleportData>) -> SpecificIconData {
+        SpecificIconData {
+            position: Point {
+                x: FiniteF32(dequantize(self.x, QuantizedPlayerData::POSITION_SCALE)),
+                y: FiniteF32(dequantize(self.y, QuantizedPlayerData::POSITION_SCALE)),
+            },
+            rotation: FiniteF32(dequantize(self.rotation, QuantizedPlayerData::ROTATION_SCALE)),
+            icon_type: self.icon_type,
+            flags: Bits::from_bytes(self.flags.to_be_bytes()),
+            spider_teleport_data,
+        }
+    }
+}
+
+/// Fixed-point representation of `PlayerData`, used as the base for delta encoding.
+#[derive(Clone, Copy, Default)]
+pub struct QuantizedPlayerData {
+    pub timestamp: i32,
+    pub player1: QuantizedIcon,
+    pub player2: QuantizedIcon,
+    pub last_death_timestamp: i32,
+    pub percentage: i32,
+    pub flags: u8, // contents of `PlayerData::flags`
+}
+
+impl QuantizedPlayerData {
+    pub const POSITION_SCALE: f32 = 64.0; // 1/64 of a unit
+    pub const ROTATION_SCALE: f32 = 16.0; // 1/16 of a degree
+    pub const TIME_SCALE: f32 = 1000.0; // milliseconds
+    pub const PERCENTAGE_SCALE: f32 = 100.0; // 1/100 of a percent
+}
+
+#[derive(Clone, Default)]
+pub struct CompactPlayerData {
+    pub quantized: QuantizedPlayerData,
+    pub spider_teleport1: Option<SpiderTeleportData>,
+    pub spider_teleport2: Option<SpiderTeleportData>,
+}
+
+impl CompactPlayerData {
+    // mask + 9 varint deltas + 2 icon states + 2 spider teleports + flags
+    pub const MAX_ENCODED_SIZE: usize = 1 + 9 * 5 + 2 * 3 + 2 * SpiderTeleportData::ENCODED_SIZE + 1;
+
+    pub fn from_player_data(data: &PlayerData) -> Self {
+        Self {
+            quantized: QuantizedPlayerData {
+                timestamp: quantize(data.timestamp.0, QuantizedPlayerData::TIME_SCALE),
+                player1: QuantizedIcon::from_icon_data(&data.player1),
+                player2: QuantizedIcon::from_icon_data(&data.player2),
+                last_death_timestamp: quantize(data.last_death_timestamp.0, QuantizedPlayerData::TIME_SCALE),
+                percentage: quantize(data.current_percentage.0, QuantizedPlayerData::PERCENTAGE_SCALE),
+                flags: data.flags.to_bytes()[0],
+            },
+            spider_teleport1: data.player1.spider_teleport_data.clone(),
+            spider_teleport2: data.player2.spider_teleport_data.clone(),
+        }
+    }
+
+    pub fn to_player_data(&self) -> PlayerData {
+        let q = &self.quantized;
+
+        PlayerData {
+            timestamp: FiniteF32(dequantize(q.timestamp, QuantizedPlayerData::TIME_SCALE)),
+            player1: q.player1.to_icon_data(self.spider_teleport1.clone()),
+            player2: q.player2.to_icon_data(self.spider_teleport2.clone()),
+            last_death_timestamp: FiniteF32(dequantize(q.last_death_timestamp, QuantizedPlayerData::TIME_SCALE)),
+            current_percentage: FiniteF32(dequantize(q.percentage, QuantizedPlayerData::PERCENTAGE_SCALE)),
+            flags: Bits::from_bytes([q.flags]),
+        }
+    }
+
+    /// Encode as a delta against `base`, or as a keyframe if `base` is `None`
+    pub fn encode(&self, buf: &mut FastByteBuffer, base: Option<&QuantizedPlayerData>) {
+        let zero = QuantizedPlayerData::default();
+        let prev = base.unwrap_or(&zero);
+        let cur = &self.quantized;
+
+        let mut mask = 0u8;
+        if base.is_some() {
+            mask |= MASK_DELTA;
+        }
+
+        if cur.player1.state_differs(&prev.player1) {
+            mask |= MASK_PLAYER1_STATE;
+        }
+
+        if cur.player2.state_differs(&prev.player2) {
+            mask |= MASK_PLAYER2_STATE;
+        }
+
+        if self.spider_teleport1.is_some() {
+            mask |= MASK_PLAYER1_SPIDER;
+        }
+
+        if self.spider_teleport2.is_some() {
+            mask |= MASK_PLAYER2_SPIDER;
+        }
+
+        if cur.last_death_timestamp != prev.last_death_timestamp {
+            mask |= MASK_DEATH_TIMESTAMP;
+        }
+
+        if cur.percentage != prev.percentage {
+            mask |= MASK_PERCENTAGE;
+        }
+
+        if cur.flags != prev.flags {
+            mask |= MASK_FLAGS;
+        }
+
+        buf.write_u8(mask);
+        buf.write_varint(cur.timestamp.wrapping_sub(prev.timestamp));
+
+        for (icon, prev_icon) in [(&cur.player1, &prev.player1), (&cur.player2, &prev.player2)] {
+            buf.write_varint(icon.x.wrapping_sub(prev_icon.x));
+            buf.write_varint(icon.y.wrapping_sub(prev_icon.y));
+            buf.write_varint(icon.rotation.wrapping_sub(prev_icon.rotation));
+        }
+
+        if mask & MASK_PLAYER1_STATE != 0 {
+            buf.write_value(&cur.player1.icon_type);
+            buf.write_u16(cur.player1.flags);
+        }
+
+        if mask & MASK_PLAYER2_STATE != 0 {
+            buf.write_value(&cur.player2.icon_type);
+            buf.write_u16(cur.player2.flags);
+        }
+
+        if let Some(spider) = &self.spider_teleport1 {
+            buf.write_value(spider);
+        }
+
+        if let Some(spider) = &self.spider_teleport2 {
+            buf.write_value(spider);
+        }
+
+        if mask & MASK_DEATH_TIMESTAMP != 0 {
+            buf.write_varint(cur.last_death_timestamp.wrapping_sub(prev.last_death_timestamp));
+        }
+
+        if mask & MASK_PERCENTAGE != 0 {
+            buf.write_varint(cur.percentage.wrapping_sub(prev.percentage));
+        }
+
+        if mask & MASK_FLAGS != 0 {
+            buf.write_u8(cur.flags);
+        }
+    }
+
+    /// Decode a frame. If the frame is a delta and `base` is `None`, `DecodeError::MissingDeltaBase` is returned.
+    pub fn decode(buf: &mut ByteReader, base: Option<&QuantizedPlayerData>) -> DecodeResult<Self> {
+        let mask = buf.read_u8()?;
+
+        let prev = if mask & MASK_DELTA != 0 {
+            *base.ok_or(DecodeError::MissingDeltaBase)?
+        } else {
+            QuantizedPlayerData::default()
+        };
+
+        let mut cur = prev;
+        cur.timestamp = prev.timestamp.wrapping_add(buf.read_varint()?);
+
+        for icon in [&mut cur.player1, &mut cur.player2] {
+            icon.x = icon.x.wrapping_add(buf.read_varint()?);
+            icon.y = icon.y.wrapping_add(buf.read_varint()?);
+            icon.rotation = icon.rotation.wrapping_add(buf.read_varint()?);
+        }
+
+        if mask & MASK_PLAYER1_STATE != 0 {
+            cur.player1.icon_type = buf.read_value()?;
+            cur.player1.flags = buf.read_u16()?;
+        }
+
+        if mask & MASK_PLAYER2_STATE != 0 {
+            cur.player2.icon_type = buf.read_value()?;
+            cur.player2.flags = buf.read_u16()?;
+        }
+
+        let spider_teleport1 = if mask & MASK_PLAYER1_SPIDER != 0 { Some(buf.read_value()?) } else { None };
+        let spider_teleport2 = if mask & MASK_PLAYER2_SPIDER != 0 { Some(buf.read_value()?) } else { None };
+
+        if mask & MASK_DEATH_TIMESTAMP != 0 {
+            cur.last_death_timestamp = prev.last_death_timestamp.wrapping_add(buf.read_varint()?);
+        }
+
+        if mask & MASK_PERCENTAGE != 0 {
+            cur.percentage = prev.percentage.wrapping_add(buf.read_varint()?);
+        }
+
+        if mask & MASK_FLAGS != 0 {
+            cur.flags = buf.read_u8()?;
+        }
+
+        Ok(Self {
+            quantized: cur,
+            spider_teleport1,
+            spider_teleport2,
+        })
+    }
+}
+
+#[inline]
+fn quantize(value: f32, scale: f32) -> i32 {
+    // float to int casts saturate, and NaN becomes 0
+    (f64::from(value) * f64::from(scale)).round() as i32
+}
+
+#[inline]
+fn dequantize(value: i32, scale: f32) -> f32 {
+    value as f32 / scale
+}
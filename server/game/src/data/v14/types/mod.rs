@@ -1 +1,4 @@
 pub use crate::data::v13::types::*;
+
+pub mod compact;
+pub use compact::*;
@@ -0,0 +1,9 @@
+pub use crate::data::v14::packets::*;
+
+use crate::data::*;
+
+// Only the header is decoded here. The rest of the datagram is one encrypted list of packets, each one prefixed with its
+// length as a u16 and starting with its own (unencrypted) header, see `handle_packet_bundle`.
+#[derive(Packet, Decodable)]
+#[packet(id = 10008, encrypted = true)]
+pub struct PacketBundlePacket;
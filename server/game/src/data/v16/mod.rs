@@ -0,0 +1,7 @@
+pub mod packets;
+pub mod types;
+
+pub use packets::*;
+pub use types::*;
+
+pub const VERSION: u16 = 16;
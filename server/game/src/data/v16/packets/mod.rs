@@ -0,0 +1,12 @@
+pub use crate::data::v15::packets::*;
+
+use crate::data::*;
+
+// Sent right after `LoggedInPacket`, through the crypto box. From then on, encrypted packets use the session cipher
+// with these keys instead, see `SessionCipher`.
+#[derive(Packet, Encodable, StaticSize)]
+#[packet(id = 20010, encrypted = true, tcp = true)]
+pub struct SessionKeysPacket {
+    pub send_key: [u8; 32], // used by the client for sending
+    pub recv_key: [u8; 32], // used by the client for receiving
+}
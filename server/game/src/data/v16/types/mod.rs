@@ -0,0 +1 @@
+pub use crate::data::v15::types::*;
@@ -0,0 +1,9 @@
+pub use crate::data::v16::packets::*;
+
+use crate::data::*;
+
+// Only the header is decoded here. It is followed by a `SequenceHeader` and then the actual datagram,
+// which is either a single packet or a bundle, see `handle_datagram`.
+#[derive(Packet, Decodable)]
+#[packet(id = 10009, encrypted = false)]
+pub struct SequencedDatagramPacket;
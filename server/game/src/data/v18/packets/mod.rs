@@ -0,0 +1,11 @@
+pub use crate::data::v17::packets::*;
+
+use crate::data::*;
+
+// Sent after `LoggedInPacket`, with the session cipher. Lets the client resume the session after losing the tcp
+// connection, without logging in again. Every resumption uses up the ticket and a new one is sent.
+#[derive(Packet, Encodable, StaticSize)]
+#[packet(id = 20011, encrypted = true, tcp = true)]
+pub struct SessionTicketPacket {
+    pub ticket: [u8; 16],
+}
@@ -0,0 +1 @@
+pub use crate::data::v17::types::*;
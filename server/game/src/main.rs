@@ -19,7 +19,7 @@ use tokio;
 
 use std::{
     error::Error,
-    net::{IpAddr, Ipv4Addr, SocketAddr},
+    net::{IpAddr, SocketAddr},
 };
 
 use bridge::{CentralBridge, CentralBridgeError};
@@ -85,12 +85,12 @@ fn parse_configuration() -> StartupConfiguration {
         Ok(x) => x,
         Err(_) => {
             // try to parse it as an ip addr and use a default port
-            match bind_address.parse::<Ipv4Addr>() {
-                Ok(x) => SocketAddr::new(IpAddr::V4(x), DEFAULT_GAME_SERVER_PORT),
+            match bind_address.parse::<IpAddr>() {
+                Ok(x) => SocketAddr::new(x, DEFAULT_GAME_SERVER_PORT),
                 Err(e) => {
                     error!("failed to parse the given IP address ({bind_address}): {e}");
-                    warn!("hint: you have to provide a valid IPv4 address with an optional port number");
-                    warn!("hint: for example \"0.0.0.0\" or \"0.0.0.0:{DEFAULT_GAME_SERVER_PORT}\"");
+                    warn!("hint: you have to provide a valid IPv4 or IPv6 address with an optional port number");
+                    warn!("hint: for example \"0.0.0.0\", \"0.0.0.0:{DEFAULT_GAME_SERVER_PORT}\" or \"[::]:{DEFAULT_GAME_SERVER_PORT}\"");
                     abort_misconfig();
                 }
             }
@@ -1,13 +1,13 @@
 use std::{
     collections::VecDeque,
-    net::{SocketAddr, SocketAddrV4},
+    net::SocketAddr,
     sync::{Arc, atomic::Ordering},
     time::Duration,
 };
 
 use globed_shared::{
     ServerUserEntry, SyncMutex,
-    anyhow::{self, anyhow, bail},
+    anyhow::{self, anyhow},
     crypto_box::{PublicKey, SecretKey, aead::OsRng},
     esp::ByteBufferExtWrite as _,
     logger::*,
@@ -24,7 +24,7 @@ use tokio::{
 use crate::tokio::sync::oneshot; // no way
 
 use crate::{
-    client::{ClientThreadState, PacketHandlingError},
+    client::{ClientThreadState, PacketHandlingError, RESUME_PROOF_SIZE, ResumeProof, ResumeTicket},
     managers::Room,
     tokio::{
         self,
@@ -34,7 +34,10 @@ use crate::{
 
 use crate::{
     bridge::{self, CentralBridge},
-    client::{ClientThread, ServerThreadMessage, UnauthorizedThreadOutcome, thread::ClientThreadOutcome, unauthorized::UnauthorizedThread},
+    client::{
+        ClientThread, ServerThreadMessage, UnauthorizedThreadOutcome, thread::ClientThreadOutcome, udp_sequence::SequenceHeader,
+        unauthorized::UnauthorizedThread,
+    },
     data::*,
     state::ServerState,
 };
@@ -45,6 +48,7 @@ const LARGE_BUFFER_SIZE: usize = 2usize.pow(19); // 2^19, 0.5mb
 
 const MARKER_CONN_INITIAL: u8 = 0xe0;
 const MARKER_CONN_RECOVERY: u8 = 0xe1;
+const MARKER_CONN_RESUMPTION: u8 = 0xe2;
 
 enum EitherClientThread {
     Authorized(Arc<ClientThread>),
@@ -57,7 +61,7 @@ pub struct GameServer {
     pub tcp_socket: TcpListener,
     pub udp_socket: UdpSocket,
     /// map udp peer : thread
-    pub clients: SyncMutex<FxHashMap<SocketAddrV4, Arc<ClientThread>>>,
+    pub clients: SyncMutex<FxHashMap<SocketAddr, Arc<ClientThread>>>,
     pub unauthorized_clients: SyncMutex<VecDeque<Arc<UnauthorizedThread>>>,
     pub unclaimed_threads: SyncMutex<VecDeque<Arc<ClientThread>>>,
     pub secret_key: SecretKey,
@@ -173,11 +177,6 @@ impl GameServer {
     async fn accept_connection(&'static self) -> anyhow::Result<()> {
         let (socket, peer) = self.tcp_socket.accept().await?;
 
-        let peer = match peer {
-            SocketAddr::V4(x) => x,
-            SocketAddr::V6(_) => bail!("rejecting request from ipv6 host"),
-        };
-
         debug!("accepting tcp connection from {peer}");
 
         tokio::spawn(self.client_loop(socket, peer));
@@ -186,12 +185,11 @@ impl GameServer {
     }
 
     #[allow(clippy::manual_let_else, clippy::too_many_lines)]
-    async fn client_loop(&'static self, mut socket: TcpStream, peer: SocketAddrV4) {
+    async fn client_loop(&'static self, mut socket: TcpStream, peer: SocketAddr) {
         // wait for incoming data, client should tell us whether it's an initial login or a recovery.
-        let result: crate::client::Result<bool> = async {
+        let result: crate::client::Result<u8> = async {
             match socket.read_u8().await? {
-                MARKER_CONN_INITIAL => Ok(false),
-                MARKER_CONN_RECOVERY => Ok(true),
+                marker @ (MARKER_CONN_INITIAL | MARKER_CONN_RECOVERY | MARKER_CONN_RESUMPTION) => Ok(marker),
                 _ => Err(PacketHandlingError::InvalidStreamMarker),
             }
         }
@@ -200,7 +198,12 @@ impl GameServer {
         let mut either_thread: EitherClientThread;
 
         match result {
-            Ok(true) => {
+            Ok(MARKER_CONN_RESUMPTION) => {
+                self.resume_session(socket, peer).await;
+                return;
+            }
+
+            Ok(MARKER_CONN_RECOVERY) => {
                 // if we are recovering a connection, next read account ID and secret key
 
                 let result: crate::client::Result<(i32, u32)> = async {
@@ -231,15 +234,7 @@ impl GameServer {
                             #[cfg(debug_assertions)] // too many false positives
                             warn!("peer ({peer}) tried to recover an invalid thread (account id: {account_id}, secret key: {secret_key})");
 
-                            // send a ClaimThreadFailedPacket
-                            let mut buf_array = [0u8; size_of_types!(u32, PacketHeader)];
-                            let mut buf = FastByteBuffer::new(&mut buf_array);
-                            buf.write_u32(3); // tcp packet length
-                            buf.write_packet_header::<LoginRecoveryFailedPacket>();
-
-                            let send_bytes = buf.as_bytes();
-
-                            let _ = socket.write_all(send_bytes).await;
+                            Self::send_recovery_failed(&mut socket).await;
                             return;
                         };
 
@@ -251,7 +246,7 @@ impl GameServer {
                         }
 
                         // recover the thread
-                        thread.recover(socket, peer);
+                        thread.recover(socket, peer, None);
 
                         // our job is done here.
                         // we have given up the ownership of `socket` to that thread.
@@ -267,7 +262,7 @@ impl GameServer {
                 }
             }
 
-            Ok(false) => {
+            Ok(_) => {
                 // initial login, just try to create an unauthorized thread
 
                 let thread = Arc::new(UnauthorizedThread::new(socket, peer, self));
@@ -398,14 +393,76 @@ impl GameServer {
         self.post_disconnect_cleanup(either_thread).await;
     }
 
-    async fn recv_and_handle_udp(&self, buf: &mut [u8]) -> anyhow::Result<()> {
-        let (len, peer) = self.udp_socket.recv_from(buf).await?;
+    /// resume a disconnected session with a ticket from `SessionTicketPacket` (protocol v18)
+    async fn resume_session(&self, mut socket: TcpStream, peer: SocketAddr) {
+        // account ID, the ticket and the proof that the client still has the session keys
+        let result: crate::client::Result<(i32, ResumeTicket, ResumeProof)> = async {
+            let mut buf = [0u8; size_of_types!(i32) + size_of::<ResumeTicket>() + RESUME_PROOF_SIZE];
+            socket.read_exact(&mut buf).await?;
+
+            let mut br = ByteReader::from_bytes(&buf);
+            let account_id = br.read_i32()?;
 
-        let peer = match peer {
-            SocketAddr::V4(x) => x,
-            SocketAddr::V6(_) => bail!("rejecting request from ipv6 host"),
+            let ticket_end = size_of_types!(i32) + size_of::<ResumeTicket>();
+
+            let mut ticket = ResumeTicket::default();
+            ticket.copy_from_slice(&buf[size_of_types!(i32)..ticket_end]);
+
+            let mut proof = [0u8; RESUME_PROOF_SIZE];
+            proof.copy_from_slice(&buf[ticket_end..]);
+
+            Ok((account_id, ticket, proof))
+        }
+        .await;
+
+        let (account_id, ticket, proof) = match result {
+            Ok(x) => x,
+            Err(e) => {
+                warn!("session resumption error: {e}");
+                return;
+            }
         };
 
+        let thread = self
+            .unauthorized_clients
+            .lock()
+            .iter()
+            .find(|thr| thr.account_id.load(Ordering::Relaxed) == account_id && thr.matches_resume_ticket(&ticket))
+            .cloned();
+
+        let Some(thread) = thread else {
+            #[cfg(debug_assertions)]
+            warn!("peer ({peer}) tried to resume an invalid session (account id: {account_id})");
+
+            // the client falls back to logging in again
+            Self::send_recovery_failed(&mut socket).await;
+            return;
+        };
+
+        let cstate = thread.connection_state.load();
+        if cstate != ClientThreadState::Disconnected {
+            warn!("peer ({peer}) resuming thread with wrong connection state: {cstate:?}");
+            return;
+        }
+
+        // only the thread itself may use the session cipher, so it checks the proof
+        thread.recover(socket, peer, Some(proof));
+    }
+
+    pub async fn send_recovery_failed(socket: &mut TcpStream) {
+        let mut buf_array = [0u8; size_of_types!(u32, PacketHeader)];
+        let mut buf = FastByteBuffer::new(&mut buf_array);
+        buf.write_u32(3); // tcp packet length
+        buf.write_packet_header::<LoginRecoveryFailedPacket>();
+
+        let send_bytes = buf.as_bytes();
+
+        let _ = socket.write_all(send_bytes).await;
+    }
+
+    async fn recv_and_handle_udp(&self, buf: &mut [u8]) -> anyhow::Result<()> {
+        let (len, peer) = self.udp_socket.recv_from(buf).await?;
+
         // if it's a ping packet, we can handle it here. otherwise we send it to the appropriate thread.
         if !self.try_udp_handle(&buf[..len], peer).await? {
             let thread = { self.clients.lock().get(&peer).cloned() };
@@ -428,7 +485,7 @@ impl GameServer {
 
     /* various calls for other threads */
 
-    pub fn claim_thread(&self, udp_addr: SocketAddrV4, secret_key: u32) -> bool {
+    pub fn claim_thread(&self, udp_addr: SocketAddr, secret_key: u32) -> bool {
         let thread = self.unauthorized_clients.lock().iter().find(|x| x.secret_key == secret_key).cloned();
 
         if let Some(thread) = thread {
@@ -777,9 +834,19 @@ impl GameServer {
     }
 
     /// Try to handle a packet that is not addressed to a specific thread, but to the game server.
-    async fn try_udp_handle(&self, data: &[u8], peer: SocketAddrV4) -> anyhow::Result<bool> {
+    async fn try_udp_handle(&self, data: &[u8], peer: SocketAddr) -> anyhow::Result<bool> {
         let mut byte_reader = ByteReader::from_bytes(data);
-        let header = byte_reader.read_packet_header().map_err(|e| anyhow!("{e}"))?;
+        let mut header = byte_reader.read_packet_header().map_err(|e| anyhow!("{e}"))?;
+
+        // look inside sequenced datagrams, the client wraps everything once sequencing is on (including claim thread on recovery)
+        if header.packet_id == SequencedDatagramPacket::PACKET_ID {
+            let inner = data
+                .get(PacketHeader::SIZE + SequenceHeader::SIZE..)
+                .ok_or_else(|| anyhow!("sequenced datagram is too short"))?;
+
+            byte_reader = ByteReader::from_bytes(inner);
+            header = byte_reader.read_packet_header().map_err(|e| anyhow!("{e}"))?;
+        }
 
         match header.packet_id {
             PingPacket::PACKET_ID => {
@@ -108,6 +108,12 @@ public:
         return Ok(plaintext_size);
     }
 
+    // Like `decryptInPlace`, but skips moving the plaintext back to the start of the buffer.
+    // On success, the plaintext begins at `data + nonceLength()`. Returns the length of the plaintext data.
+    Result<size_t> decryptInPlaceUnaligned(byte* data, size_t size) {
+        return static_cast<Derived*>(this)->decryptInto(data, data + nonceLength(), size);
+    }
+
     // Decrypt bytes from bytevector `src` and return a bytevector with the plaintext data.
     Result<bytevector> decrypt(const bytevector& src) {
         return decrypt(src.data(), src.size());
@@ -0,0 +1,124 @@
+#include "session_cipher.hpp"
+
+#include <cstring> // std::memmove
+#include <sodium.h>
+
+#include <util/crypto.hpp>
+#include <defs/assert.hpp>
+
+using namespace util::data;
+
+constexpr size_t NONCE_LEN = crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+// how far behind the newest received message a message can arrive and still be accepted
+constexpr uint64_t REPLAY_WINDOW = 64;
+
+static_assert(SessionCipher::KEY_LEN == crypto_secretbox_xchacha20poly1305_KEYBYTES);
+static_assert(SessionCipher::MAC_LEN == crypto_secretbox_xchacha20poly1305_MACBYTES);
+
+static void makeNonce(byte* nonce, CipherStream stream, uint64_t counter) {
+    std::memset(nonce, 0, NONCE_LEN);
+    nonce[0] = static_cast<byte>(stream);
+
+    for (size_t i = 0; i < 8; i++) {
+        nonce[NONCE_LEN - 1 - i] = static_cast<byte>(counter >> (i * 8));
+    }
+}
+
+SessionCipher::SessionCipher(const bytearray<KEY_LEN>& sendKey, const bytearray<KEY_LEN>& recvKey) : sendKey(sendKey), recvKey(recvKey) {}
+
+SessionCipher::~SessionCipher() {
+    sodium_memzero(sendKey.data(), sendKey.size());
+    sodium_memzero(recvKey.data(), recvKey.size());
+}
+
+Result<size_t> SessionCipher::encryptInPlace(CipherStream stream, byte* data, size_t size) {
+    uint64_t counter = ++sendCounters[static_cast<size_t>(stream)];
+
+    byte nonce[NONCE_LEN];
+    makeNonce(nonce, stream, counter);
+
+    byte* mac = data + COUNTER_LEN;
+    byte* ciphertext = data + PREFIX_LEN;
+
+    // make room for the prefix first, so the plaintext isn't overwritten by it
+    std::memmove(ciphertext, data, size);
+
+    CRYPTO_ERR_CHECK_SAFE(crypto_secretbox_xchacha20poly1305_detached(ciphertext, mac, ciphertext, size, nonce, sendKey.data()), "crypto_secretbox_xchacha20poly1305_detached failed")
+
+    // prepend the truncated counter
+    uint32_t truncated = static_cast<uint32_t>(counter);
+    data[0] = static_cast<byte>(truncated >> 24);
+    data[1] = static_cast<byte>(truncated >> 16);
+    data[2] = static_cast<byte>(truncated >> 8);
+    data[3] = static_cast<byte>(truncated);
+
+    return Ok(size + PREFIX_LEN);
+}
+
+Result<size_t> SessionCipher::decryptInPlaceUnaligned(CipherStream stream, byte* data, size_t size) {
+    CRYPTO_REQUIRE_SAFE(size >= PREFIX_LEN, "message is too short")
+
+    size_t plaintextLength = size - PREFIX_LEN;
+
+    uint32_t truncated = (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+
+    auto& window = windows[static_cast<size_t>(stream)];
+    uint64_t counter = window.expand(truncated);
+
+    CRYPTO_REQUIRE_SAFE(window.canAccept(counter), "replayed or outdated message")
+
+    byte nonce[NONCE_LEN];
+    makeNonce(nonce, stream, counter);
+
+    const byte* mac = data + COUNTER_LEN;
+    byte* ciphertext = data + PREFIX_LEN;
+
+    // libsodium only writes the plaintext if the mac is valid, so a failed attempt leaves the message as it was
+    CRYPTO_ERR_CHECK_SAFE(crypto_secretbox_xchacha20poly1305_open_detached(ciphertext, ciphertext, mac, plaintextLength, nonce, recvKey.data()), "crypto_secretbox_xchacha20poly1305_open_detached failed")
+
+    // only authenticated messages may move the window
+    window.accept(counter);
+    confirmed = true;
+
+    return Ok(plaintextLength);
+}
+
+bool SessionCipher::isConfirmed() const {
+    return confirmed;
+}
+
+uint64_t SessionCipher::ReplayWindow::expand(uint32_t truncated) const {
+    // pick the full counter closest to the next expected one
+    constexpr uint64_t SPAN = uint64_t(1) << 32;
+    constexpr uint64_t HALF = SPAN / 2;
+
+    uint64_t expected = highest + 1;
+    uint64_t candidate = (expected & ~(SPAN - 1)) | truncated;
+
+    if (expected >= HALF && candidate <= expected - HALF && candidate <= UINT64_MAX - SPAN) {
+        return candidate + SPAN;
+    } else if (candidate > expected + HALF && candidate >= SPAN) {
+        return candidate - SPAN;
+    }
+
+    return candidate;
+}
+
+bool SessionCipher::ReplayWindow::canAccept(uint64_t counter) const {
+    if (counter == 0) return false;
+    if (counter > highest) return true;
+
+    uint64_t behind = highest - counter;
+    return behind < REPLAY_WINDOW && (seen & (uint64_t(1) << behind)) == 0;
+}
+
+void SessionCipher::ReplayWindow::accept(uint64_t counter) {
+    if (counter > highest) {
+        uint64_t shift = counter - highest;
+        seen = shift >= REPLAY_WINDOW ? 0 : (seen << shift);
+        seen |= 1;
+        highest = counter;
+    } else {
+        seen |= uint64_t(1) << (highest - counter);
+    }
+}
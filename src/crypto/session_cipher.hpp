@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+
+#include <defs/minimal_geode.hpp>
+#include <util/data.hpp>
+
+// Every stream has its own counter and replay window, so that reordering between TCP and UDP can't get messages rejected.
+enum class CipherStream : uint8_t {
+    Tcp = 0,
+    Udp = 1,
+};
+
+/*
+* SessionCipher - the cipher used for encrypted packets once the server sent `SessionKeysPacket` (protocol v16+)
+*
+* Algorithm - XChaCha20Poly1305, with a separate key for each direction
+* Nonce - stream id in the first byte and a 64-bit counter in the last 8 bytes, only the low 32 bits of the counter go on the wire
+* Tag implementation - prefix, an encrypted message is `counter (u32) | mac | ciphertext`
+*
+* Must match `SessionCipher` on the server.
+*/
+class SessionCipher {
+public:
+    constexpr static size_t KEY_LEN = 32;
+    constexpr static size_t COUNTER_LEN = 4;
+    constexpr static size_t MAC_LEN = 16;
+    constexpr static size_t PREFIX_LEN = COUNTER_LEN + MAC_LEN;
+
+    SessionCipher(const util::data::bytearray<KEY_LEN>& sendKey, const util::data::bytearray<KEY_LEN>& recvKey);
+    SessionCipher(const SessionCipher&) = delete;
+    SessionCipher& operator=(const SessionCipher&) = delete;
+    ~SessionCipher();
+
+    // Encrypt `size` bytes from `data` into itself. Note: the buffer must be at least `size + PREFIX_LEN` bytes big.
+    // Returns the length of the encrypted data.
+    Result<size_t> encryptInPlace(CipherStream stream, util::data::byte* data, size_t size);
+
+    // Decrypt `size` bytes from `data` into itself. On success, the plaintext begins at `data + PREFIX_LEN`.
+    // Returns the length of the plaintext data. On failure the message is left untouched.
+    Result<size_t> decryptInPlaceUnaligned(CipherStream stream, util::data::byte* data, size_t size);
+
+    // Whether anything was successfully decrypted with this cipher yet
+    bool isConfirmed() const;
+
+private:
+    struct ReplayWindow {
+        uint64_t highest = 0; // counters start at 1
+        uint64_t seen = 0;    // bit `n` is set if `highest - n` was received
+
+        uint64_t expand(uint32_t truncated) const;
+        bool canAccept(uint64_t counter) const;
+        void accept(uint64_t counter);
+    };
+
+    util::data::bytearray<KEY_LEN> sendKey;
+    util::data::bytearray<KEY_LEN> recvKey;
+    std::array<uint64_t, 2> sendCounters = {};
+    std::array<ReplayWindow, 2> windows;
+    bool confirmed = false;
+};
@@ -0,0 +1,89 @@
+#include "arena.hpp"
+
+#include <cstddef>
+
+#include <asp/sync.hpp>
+#include <data/packets/pool.hpp>
+
+using namespace util::data;
+
+using RecycledArenas = asp::Mutex<std::vector<std::unique_ptr<PacketArena>>>;
+
+static RecycledArenas& recycledArenas() {
+    // intentionally leaked, packets may still be destroyed during static destruction
+    static RecycledArenas* arenas = new RecycledArenas;
+    return *arenas;
+}
+
+PacketArena::PacketArena(size_t initialSize) : _block(initialSize > 0 ? new byte[initialSize] : nullptr), _blockSize(initialSize) {}
+
+std::unique_ptr<PacketArena> PacketArena::acquire() {
+    {
+        auto arenas = recycledArenas().lock();
+        if (!arenas->empty()) {
+            auto arena = std::move(arenas->back());
+            arenas->pop_back();
+            PacketPoolStats::get().arenasReused++;
+            return arena;
+        }
+    }
+
+    PacketPoolStats::get().arenaAllocations++;
+    return std::make_unique<PacketArena>();
+}
+
+void PacketArena::recycle(std::unique_ptr<PacketArena> arena) {
+    arena->reset();
+
+    auto arenas = recycledArenas().lock();
+    if (arenas->size() < MAX_RECYCLED) {
+        arenas->push_back(std::move(arena));
+    }
+}
+
+void PacketArena::reset() {
+    if (!_overflow.empty()) {
+        // grow the block so that everything fits without overflowing next time
+        _blockSize += _overflowSize;
+        _block.reset(new byte[_blockSize]);
+
+        _overflow.clear();
+        _overflowSize = 0;
+    }
+
+    _offset = 0;
+}
+
+size_t PacketArena::used() const {
+    return _offset + _overflowSize;
+}
+
+size_t PacketArena::capacity() const {
+    return _blockSize;
+}
+
+void* PacketArena::do_allocate(size_t bytes, size_t alignment) {
+    // the block is aligned to at least `alignof(std::max_align_t)`, so for anything else aligning the offset is enough
+    size_t start = (_offset + alignment - 1) & ~(alignment - 1);
+
+    if (alignment <= alignof(std::max_align_t) && start + bytes <= _blockSize) {
+        _offset = start + bytes;
+        return _block.get() + start;
+    }
+
+    // does not fit, give it a dedicated chunk
+    size_t chunkSize = bytes + alignment;
+    auto& chunk = _overflow.emplace_back(new byte[chunkSize]);
+    _overflowSize += chunkSize;
+
+    auto addr = reinterpret_cast<uintptr_t>(chunk.get());
+    return chunk.get() + (((addr + alignment - 1) & ~(alignment - 1)) - addr);
+}
+
+void PacketArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    // memory is only reclaimed in `reset`
+}
+
+bool PacketArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include <util/data.hpp>
+
+/*
+* PacketArena - bump allocator for the contents of decoded packets.
+*
+* Deallocation is a no-op, all the memory is reclaimed at once by `reset()`. Unlike `std::pmr::monotonic_buffer_resource`,
+* the memory is kept around after a reset (and merged into a single block if it overflowed), so an arena that is reused
+* for similar packets stops allocating entirely after the first few uses.
+*
+* Not thread safe, except for `acquire` and `recycle`.
+*/
+class PacketArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1024;
+
+    PacketArena(size_t initialSize = DEFAULT_BLOCK_SIZE);
+
+    PacketArena(const PacketArena&) = delete;
+    PacketArena& operator=(const PacketArena&) = delete;
+
+    // Upper limit of arenas kept around by `recycle`
+    static constexpr size_t MAX_RECYCLED = 32;
+
+    // Take a previously recycled arena, or create a new one if there are none.
+    static std::unique_ptr<PacketArena> acquire();
+
+    // Reset the arena and keep it around for `acquire`. Must only be called once nothing references its memory anymore.
+    static void recycle(std::unique_ptr<PacketArena> arena);
+
+    // Invalidate everything that was allocated from this arena. Must only be called once nothing references the memory anymore.
+    void reset();
+
+    // Amount of bytes allocated since the last reset, including alignment padding
+    size_t used() const;
+
+    // Amount of bytes this arena holds, excluding the overflow chunks
+    size_t capacity() const;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    std::unique_ptr<util::data::byte[]> _block;
+    size_t _blockSize = 0;
+    size_t _offset = 0;
+
+    // allocations that didn't fit into the block, they get merged into it on the next reset
+    std::vector<std::unique_ptr<util::data::byte[]>> _overflow;
+    size_t _overflowSize = 0;
+};
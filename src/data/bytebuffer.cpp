@@ -18,6 +18,7 @@ const char* ByteBuffer::strerror(DecodeError err) {
         case Error::InvalidEnumValue: return "Invalid enum value was read";
         case Error::DataTooLong: return "Received data is too long so packet decoding was halted";
         case Error::LengthPrefixTooLong: return "Datatype has an invalid length prefix, failed to decode packet";
+        case Error::MissingDeltaBase: return "Received delta encoded data, but the frame it is based on is not available";
     }
 
     return "Unknown error";
@@ -32,7 +33,34 @@ ByteBuffer::ByteBuffer(const byte* data, size_t length)
 ByteBuffer::ByteBuffer(bytevector&& data)
     : _data(std::move(data)) {}
 
+ByteBuffer ByteBuffer::borrowed(byte* data, size_t length) {
+    ByteBuffer buf;
+    buf._borrowed = data;
+    buf._borrowedSize = length;
+    buf._borrowedCapacity = length;
+    return buf;
+}
+
+ByteBuffer ByteBuffer::fixed(byte* storage, size_t capacity) {
+    ByteBuffer buf;
+    buf._borrowed = storage;
+    buf._borrowedSize = 0;
+    buf._borrowedCapacity = capacity;
+    return buf;
+}
+
 void ByteBuffer::rawWriteBytes(const byte* bytes, size_t length) {
+    if (_borrowed) {
+        // the caller is expected to have verified the size beforehand, this is only a safety net
+        GLOBED_HARD_ASSERT(_position + length <= _borrowedCapacity, "write past the end of a fixed ByteBuffer")
+
+        std::memcpy(_borrowed + _position, bytes, length);
+        _position += length;
+        _borrowedSize = std::max(_borrowedSize, _position);
+
+        return;
+    }
+
     // if we can't fit (i.e. writing at the end, just use insert)
     if (_position + length > _data.size()) {
         _data.insert(_data.begin() + _position, bytes, bytes + length);
@@ -49,7 +77,7 @@ void ByteBuffer::rawWriteBytes(const byte* bytes, size_t length) {
 }
 
 DecodeResult<> ByteBuffer::boundsCheck(size_t count) {
-    if (_position + count > _data.size()) {
+    if (_position + count > this->size()) {
         return Err(DecodeError::NotEnoughData);
     }
 
@@ -59,20 +87,43 @@ DecodeResult<> ByteBuffer::boundsCheck(size_t count) {
 /* Util methods */
 
 const bytevector& ByteBuffer::data() const {
+    GLOBED_REQUIRE(!_borrowed, "ByteBuffer::data called on a borrowed buffer")
     return _data;
 }
 
 bytevector& ByteBuffer::data() {
+    GLOBED_REQUIRE(!_borrowed, "ByteBuffer::data called on a borrowed buffer")
     return _data;
 }
 
+const byte* ByteBuffer::dataPtr() const {
+    return _borrowed ? _borrowed : _data.data();
+}
+
+byte* ByteBuffer::dataPtr() {
+    return _borrowed ? _borrowed : _data.data();
+}
+
+bool ByteBuffer::isBorrowed() const {
+    return _borrowed != nullptr;
+}
+
+void ByteBuffer::setMemoryResource(std::pmr::memory_resource* resource) {
+    _resource = resource;
+}
+
+std::pmr::memory_resource* ByteBuffer::memoryResource() const {
+    return _resource ? _resource : std::pmr::get_default_resource();
+}
+
 void ByteBuffer::clear() {
     _data.clear();
+    _borrowedSize = 0;
     _position = 0;
 }
 
 size_t ByteBuffer::size() const {
-    return _data.size();
+    return _borrowed ? _borrowedSize : _data.size();
 }
 
 size_t ByteBuffer::getPosition() const {
@@ -84,6 +135,12 @@ void ByteBuffer::setPosition(size_t pos) {
 }
 
 void ByteBuffer::resize(size_t newSize) {
+    if (_borrowed) {
+        GLOBED_REQUIRE(newSize <= _borrowedCapacity, "attempted to grow a borrowed ByteBuffer past its capacity")
+        _borrowedSize = newSize;
+        return;
+    }
+
     _data.resize(newSize);
 }
 
@@ -104,7 +161,7 @@ DecodeResult<> ByteBuffer::skip(size_t bytes) {
 
 DecodeResult<> ByteBuffer::readBytesInto(byte* buf, size_t bytes) {
     GLOBED_UNWRAP(this->boundsCheck(bytes));
-    std::memcpy(buf, _data.data() + _position, bytes);
+    std::memcpy(buf, this->dataPtr() + _position, bytes);
     _position += bytes;
 
     return Ok();
@@ -128,7 +185,22 @@ template<> DecodeResult<std::string> ByteBuffer::customDecode() {
 
     GLOBED_UNWRAP(this->boundsCheck(length));
 
-    std::string str(reinterpret_cast<const char*>(_data.data() + _position), length);
+    std::string str(reinterpret_cast<const char*>(this->dataPtr() + _position), length);
+    _position += length;
+
+    return Ok(std::move(str));
+}
+
+template<> void ByteBuffer::customEncode(const std::pmr::string& value) {
+    this->customEncode(std::string_view(value));
+}
+
+template<> DecodeResult<std::pmr::string> ByteBuffer::customDecode() {
+    GLOBED_UNWRAP_INTO(this->readLength(), size_t length);
+
+    GLOBED_UNWRAP(this->boundsCheck(length));
+
+    std::pmr::string str(reinterpret_cast<const char*>(this->dataPtr() + _position), length, this->memoryResource());
     _position += length;
 
     return Ok(std::move(str));
@@ -253,3 +325,39 @@ DecodeResult<size_t> ByteBuffer::readLengthCheck(size_t elemsize) {
 void ByteBuffer::writeLength(size_t value) {
     this->writePrimitive<length_t>(static_cast<length_t>(value));
 }
+
+DecodeResult<uint32_t> ByteBuffer::readVarUint() {
+    uint32_t value = 0;
+
+    // 7 bits per byte, so a 32-bit integer is at most 5 bytes long
+    for (size_t i = 0; i < 5; i++) {
+        GLOBED_UNWRAP_INTO(this->readU8(), uint8_t byte);
+        value |= static_cast<uint32_t>(byte & 0x7f) << (i * 7);
+
+        if ((byte & 0x80) == 0) {
+            return Ok(value);
+        }
+    }
+
+    return Err(DecodeError::DataTooLong);
+}
+
+DecodeResult<int32_t> ByteBuffer::readVarInt() {
+    GLOBED_UNWRAP_INTO(this->readVarUint(), uint32_t zigzag);
+    return Ok(static_cast<int32_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+}
+
+void ByteBuffer::writeVarUint(uint32_t value) {
+    while (value >= 0x80) {
+        this->writeU8(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+
+    this->writeU8(static_cast<uint8_t>(value));
+}
+
+void ByteBuffer::writeVarInt(int32_t value) {
+    // zigzag encoding, maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+    uint32_t uvalue = static_cast<uint32_t>(value);
+    this->writeVarUint((uvalue << 1) ^ (0u - (uvalue >> 31)));
+}
@@ -2,7 +2,12 @@
 #include <defs/assert.hpp>
 #include <defs/minimal_geode.hpp>
 
+#include <concepts>
 #include <type_traits>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <fmt/format.h>
 #include <asp/data/util.hpp>
 #include <asp/misc/traits.hpp>
@@ -11,9 +16,25 @@
 #include "types/basic/either.hpp"
 #include "bitbuffer.hpp"
 #include "bitfield.hpp"
+#include "enum_validator.hpp"
 #include <util/data.hpp>
 #include <util/misc.hpp>
 
+// Can be specialized to provide an upper bound on the encoded size of a type that is encoded with `customEncode`.
+// Types without a specialization are treated as unbounded. Classes can also declare a `static constexpr size_t MAX_ENCODED_SIZE`
+// member instead, which is what packets must do: their `getMaxEncodedSize` instantiates `maxEncodedSize` inside the class,
+// so a specialization after the class would come too late.
+template <typename T>
+struct ByteBufferMaxSize {};
+
+// Size and alignment of the data a polymorphic type holds before its described members.
+// Used to verify that all fields are described, can be specialized for polymorphic bases that have data members.
+template <typename T>
+struct ByteBufferPolymorphicBase {
+    static constexpr size_t size = sizeof(void*);
+    static constexpr size_t alignment = alignof(void*);
+};
+
 class ByteBuffer {
     using length_t = uint16_t;
 
@@ -24,7 +45,8 @@ public:
         NotEnoughData,
         InvalidEnumValue,
         DataTooLong,
-        LengthPrefixTooLong
+        LengthPrefixTooLong,
+        MissingDeltaBase,
     };
 
     BOOST_DESCRIBE_NESTED_ENUM(DecodeError, Ok, NotEnoughData, InvalidEnumValue);
@@ -44,6 +66,76 @@ public:
     // Take ownership of the given `bytevector` and construct a `ByteBuffer` from the data
     ByteBuffer(util::data::bytevector&& data);
 
+    // Construct a non-owning `ByteBuffer` that reads directly from `data`, without copying it.
+    // The memory must outlive the returned buffer. Borrowed buffers never allocate and cannot grow past `length` bytes.
+    static ByteBuffer borrowed(util::data::byte* data, size_t length);
+
+    // Construct an empty non-owning `ByteBuffer` that writes into `storage` without ever allocating.
+    // Writing more than `capacity` bytes is a hard error, use `maxEncodedSize` to check that the data fits beforehand.
+    static ByteBuffer fixed(util::data::byte* storage, size_t capacity);
+
+    // Returned by `maxEncodedSize` for types that have no upper bound on their encoded size (strings, vectors, etc.)
+    static constexpr size_t UNBOUNDED_SIZE = std::numeric_limits<size_t>::max();
+
+    // Calculate the upper bound of the encoded size of `T` at compile time, or `UNBOUNDED_SIZE` if there is none.
+    template <typename T>
+    constexpr static size_t maxEncodedSize() {
+        if constexpr (util::data::IsPrimitive<T>) {
+            return sizeof(T);
+        } else if constexpr (std::is_enum_v<T>) {
+            return sizeof(std::underlying_type_t<T>);
+        } else if constexpr (std::is_empty_v<T>) {
+            return 0;
+        } else if constexpr (boost::describe::has_describe_members<T>::value) {
+            return reflectionMaxSize<T>();
+        } else if constexpr (asp::is_std_pair<T>::value) {
+            return addSizes(maxEncodedSize<typename T::first_type>(), maxEncodedSize<typename T::second_type>());
+        } else if constexpr (asp::is_std_optional<T>::value) {
+            return addSizes(sizeof(bool), maxEncodedSize<typename T::value_type>());
+        } else if constexpr (util::misc::is_either<T>::value) {
+            return addSizes(sizeof(bool), std::max(maxEncodedSize<typename T::first_type>(), maxEncodedSize<typename T::second_type>()));
+        } else if constexpr (requires { { T::MAX_ENCODED_SIZE } -> std::convertible_to<size_t>; }) {
+            return T::MAX_ENCODED_SIZE;
+        } else if constexpr (requires { ByteBufferMaxSize<T>::value; }) {
+            return ByteBufferMaxSize<T>::value;
+        } else {
+            // vectors, maps, strings and custom types without a known bound
+            return UNBOUNDED_SIZE;
+        }
+    }
+
+    // Saturating addition of two sizes returned by `maxEncodedSize`
+    constexpr static size_t addSizes(size_t a, size_t b) {
+        return (a > UNBOUNDED_SIZE - b) ? UNBOUNDED_SIZE : a + b;
+    }
+
+    // Returns true if decoding `T` allocates from the memory resource of the buffer (see `setMemoryResource`)
+    template <typename T>
+    constexpr static bool usesMemoryResource() {
+        if constexpr (util::data::IsPmrAllocated<T>) {
+            return true;
+        } else if constexpr (util::misc::is_vector<T>::value || asp::is_std_optional<T>::value) {
+            return usesMemoryResource<typename T::value_type>();
+        } else if constexpr (asp::is_std_pair<T>::value || util::misc::is_either<T>::value) {
+            return usesMemoryResource<typename T::first_type>() || usesMemoryResource<typename T::second_type>();
+        } else if constexpr (util::misc::is_map<T>::value) {
+            return usesMemoryResource<typename T::key_type>() || usesMemoryResource<typename T::mapped_type>();
+        } else if constexpr (boost::describe::has_describe_members<T>::value) {
+            bool uses = false;
+
+            boost::mp11::mp_for_each<boost::describe::describe_members<T, boost::describe::mod_public>>([&](auto descriptor) {
+                using MPT = decltype(descriptor.pointer);
+                using FT = typename asp::member_ptr_to_underlying<MPT>::type;
+
+                uses = uses || usesMemoryResource<FT>();
+            });
+
+            return uses;
+        } else {
+            return false;
+        }
+    }
+
     ByteBuffer(const ByteBuffer& other) = default;
     ByteBuffer& operator=(const ByteBuffer& other) = default;
 
@@ -70,6 +162,20 @@ public:
         }
     }
 
+    // Read a value from this bytebuffer into an existing object.
+    // Prefer this over assigning the result of `readValue` when decoding `std::pmr` containers, as assignment
+    // would copy them into the memory resource of the destination, while this keeps the one they were decoded with.
+    template <typename T>
+    DecodeResult<> readValueInto(T& out) {
+        if constexpr (boost::describe::has_describe_members<T>::value) {
+            return this->reflectionDecodeInto<T>(out);
+        } else {
+            GLOBED_UNWRAP_INTO(this->readValue<T>(), auto value);
+            assignDecoded(out, std::move(value));
+            return Ok();
+        }
+    }
+
     // Write a value to this bytebuffer
     template <typename T>
     void writeValue(const T& value) {
@@ -97,12 +203,28 @@ public:
 
     /* Various helper methods */
 
-    // Get the underlying data buffer of this `ByteBuffer`
+    // Get the underlying data buffer of this `ByteBuffer`. Must not be called on a borrowed buffer.
     const util::data::bytevector& data() const;
 
-    // Get the underlying data buffer of this `ByteBuffer`
+    // Get the underlying data buffer of this `ByteBuffer`. Must not be called on a borrowed buffer.
     util::data::bytevector& data();
 
+    // Get a pointer to the start of the data, works for both owned and borrowed buffers
+    const util::data::byte* dataPtr() const;
+
+    // Get a pointer to the start of the data, works for both owned and borrowed buffers
+    util::data::byte* dataPtr();
+
+    // Returns true if this buffer does not own its data (see `ByteBuffer::borrowed`)
+    bool isBorrowed() const;
+
+    // Set the memory resource that decoded `std::pmr` containers and strings allocate from, `nullptr` means the default one.
+    // The resource must outlive everything that gets decoded while it is set.
+    void setMemoryResource(std::pmr::memory_resource* resource);
+
+    // Get the memory resource that decoded `std::pmr` containers and strings allocate from
+    std::pmr::memory_resource* memoryResource() const;
+
     // Clear all the data in this buffer
     void clear();
 
@@ -115,7 +237,7 @@ public:
     // Set the position of this buffer
     void setPosition(size_t pos);
 
-    // Resize the internal buffer to `newSize` bytes
+    // Resize the internal buffer to `newSize` bytes. Borrowed buffers cannot grow past their capacity.
     void resize(size_t newSize);
 
     // Equivalent to `resize(size() + bytes)`
@@ -148,6 +270,11 @@ public:
     // read a length `x`, return an error if unable to read at least `x` bytes from the buffer afterwards
     DecodeResult<size_t> readLengthCheck(size_t elemsize = 1);
 
+    // read a variable-length (LEB128) integer, 1 to 5 bytes long
+    DecodeResult<uint32_t> readVarUint();
+    // read a zigzag encoded variable-length integer, see `writeVarInt`
+    DecodeResult<int32_t> readVarInt();
+
     void writeBool(bool value);
     void writeU8(uint8_t value);
     void writeU16(uint16_t value);
@@ -161,6 +288,11 @@ public:
     void writeF64(double value);
     void writeLength(size_t value);
 
+    // write a variable-length (LEB128) integer, values below 128 take up a single byte
+    void writeVarUint(uint32_t value);
+    // write a zigzag encoded variable-length integer, small negative values are as compact as small positive ones
+    void writeVarInt(int32_t value);
+
     /* Bits */
     template <size_t N>
     void writeBits(const BitBuffer<N>& bits) {
@@ -183,7 +315,7 @@ protected:
         GLOBED_UNWRAP(this->boundsCheck(sizeof(T)));
 
         T value;
-        std::memcpy(&value, _data.data() + _position, sizeof(T));
+        std::memcpy(&value, this->dataPtr() + _position, sizeof(T));
         _position += sizeof(T);
 
         return Ok(value);
@@ -233,19 +365,7 @@ protected:
         GLOBED_UNWRAP_INTO(this->readPrimitive<P>(), P underlying);
 
         // validate the enum - if there's no descriptor matching the decoded value, raise an error
-
-        bool foundMatch = false;
-
-        boost::mp11::mp_for_each<boost::describe::describe_enumerators<E>>([&](auto descriptor) {
-            E val = descriptor.value;
-            P valUnderlying = static_cast<P>(val);
-
-            if (valUnderlying == underlying) {
-                foundMatch = true;
-            }
-        });
-
-        if (!foundMatch) {
+        if (!EnumValidator<E>::isValid(underlying)) {
             return Err(DecodeError::InvalidEnumValue);
         }
 
@@ -265,27 +385,35 @@ protected:
     }
 
     // Read a value using boost reflection
+    template <typename T>
+    requires std::is_default_constructible_v<T>
+    DecodeResult<T> reflectionDecode() {
+        static_assert(std::is_class_v<T>, "attempted to call reflectionDecode on a non-class type");
+
+        // create a default initialized instance
+        T value;
+        GLOBED_UNWRAP(this->reflectionDecodeInto<T>(value));
+
+        return Ok(std::move(value));
+    }
+
+    // Read a value using boost reflection, decoding the members in place
     template <
         typename T,
         class Md = boost::describe::describe_members<T, boost::describe::mod_public>,
         class Bd = boost::describe::describe_bases<T, boost::describe::mod_any_access>
     >
-    requires std::is_default_constructible_v<T>
-    DecodeResult<T> reflectionDecode() {
-        static_assert(std::is_class_v<T>, "attempted to call reflectionDecode on a non-class type");
-
+    DecodeResult<> reflectionDecodeInto(T& value) {
         // if it's a bitfield, decode it as such
         if constexpr (!boost::mp11::mp_empty<Bd>::value) {
             if constexpr (std::is_same_v<typename boost::mp11::mp_first<Bd>::type, BitfieldBase>) {
-                return reflectionDecodeBitfield<T>();
+                GLOBED_UNWRAP_INTO(this->reflectionDecodeBitfield<T>(), value);
+                return Ok();
             }
         } else {
             checkMissingFields<T>();
         }
 
-        // create a default initialized instance
-        T value;
-
         bool failed = false;
         DecodeError failError;
 
@@ -301,7 +429,7 @@ protected:
                 failed = true;
                 failError = result.unwrapErr();
             } else {
-                value.*descriptor.pointer = std::move(result.unwrap());
+                assignDecoded(value.*descriptor.pointer, std::move(result.unwrap()));
             }
         });
 
@@ -309,7 +437,19 @@ protected:
             return Err(std::move(failError));
         }
 
-        return Ok(std::move(value));
+        return Ok();
+    }
+
+    // Move a freshly decoded value into `dest`. Types holding `std::pmr` containers are reconstructed in place,
+    // because move assignment does not propagate the allocator and would copy everything into the one of `dest`.
+    template <typename T>
+    static void assignDecoded(T& dest, T&& value) {
+        if constexpr (usesMemoryResource<T>() && !std::is_polymorphic_v<T>) {
+            std::destroy_at(&dest);
+            std::construct_at(&dest, std::move(value));
+        } else {
+            dest = std::move(value);
+        }
     }
 
     // Write a value using boost reflection
@@ -386,14 +526,14 @@ protected:
 
     template <typename T>
     DecodeResult<T> preCustomDecode() {
-        if constexpr (asp::is_std_vector<T>::value) {
-            return this->pcDecodeVector<typename T::value_type>();
+        if constexpr (util::misc::is_vector<T>::value) {
+            return this->pcDecodeVector<T>();
         } else if constexpr (asp::is_std_pair<T>::value) {
             return this->pcDecodePair<typename T::first_type, typename T::second_type>();
         } else if constexpr (asp::is_std_optional<T>::value) {
             return this->pcDecodeOptional<typename T::value_type>();
         } else if constexpr (util::misc::is_map<T>::value) {
-            return this->pcDecodeMap<typename T::key_type, typename T::mapped_type>();
+            return this->pcDecodeMap<T>();
         } else if constexpr (util::misc::is_either<T>::value) {
             return this->pcDecodeEither<typename T::first_type, typename T::second_type>();
         } else {
@@ -403,8 +543,8 @@ protected:
 
     template <typename T>
     void preCustomEncode(const T& value) {
-        if constexpr (asp::is_std_vector<T>::value) {
-            this->pcEncodeVector<typename T::value_type>(value);
+        if constexpr (util::misc::is_vector<T>::value) {
+            this->pcEncodeVector(value);
         } else if constexpr (asp::is_std_pair<T>::value) {
             this->pcEncodePair<typename T::first_type, typename T::second_type>(value);
         } else if constexpr (asp::is_std_optional<T>::value) {
@@ -412,21 +552,43 @@ protected:
         } else if constexpr (util::misc::is_either<T>::value) {
             this->pcEncodeEither(value);
         } else if constexpr (util::misc::is_map<T>::value) {
-            this->pcEncodeMap<typename T::key_type, typename T::mapped_type>(value);
+            this->pcEncodeMap(value);
         } else if constexpr (std::is_same_v<T, ByteBuffer>) {
-            this->rawWriteBytes(value.data().data(), value.size());
+            this->rawWriteBytes(value.dataPtr(), value.size());
         } else {
             this->customEncode(value);
         }
     }
 
+    // Create an empty container, using the memory resource of this buffer if it's a `std::pmr` container
+    template <typename C>
+    C makeContainer() const {
+        if constexpr (util::data::IsPmrAllocated<C>) {
+            return C(this->memoryResource());
+        } else {
+            return C{};
+        }
+    }
+
     // Vector
 
-    template<typename T>
-    DecodeResult<std::vector<T>> pcDecodeVector() {
+    template <typename V, typename T = typename V::value_type>
+    DecodeResult<V> pcDecodeVector() {
+        if constexpr (util::data::IsBulkPrimitive<T>) {
+            // the wire layout is identical to the memory layout, so read everything at once
+            GLOBED_UNWRAP_INTO(this->readLengthCheck(sizeof(T)), auto length);
+
+            V out = this->makeContainer<V>();
+            out.resize(length);
+            GLOBED_UNWRAP(this->readBytesInto(reinterpret_cast<util::data::byte*>(out.data()), length * sizeof(T)));
+            util::data::maybeByteswapBytes<sizeof(T)>(reinterpret_cast<util::data::byte*>(out.data()), length);
+
+            return Ok(std::move(out));
+        }
+
         GLOBED_UNWRAP_INTO(this->readLength(), auto length);
 
-        std::vector<T> out;
+        V out = this->makeContainer<V>();
 
         if (sizeof(T) * length < (2 << 15)) {
             out.reserve(length);
@@ -440,10 +602,19 @@ protected:
         return Ok(std::move(out));
     }
 
-    template<typename T>
-    void pcEncodeVector(const std::vector<T>& vec) {
+    template <typename T, typename A>
+    void pcEncodeVector(const std::vector<T, A>& vec) {
         this->writeLength(vec.size());
 
+        if constexpr (util::data::IsBulkPrimitive<T>) {
+            // copy everything at once, then fix up the endianness in the destination
+            size_t start = _position;
+            this->rawWriteBytes(reinterpret_cast<const util::data::byte*>(vec.data()), vec.size() * sizeof(T));
+            util::data::maybeByteswapBytes<sizeof(T)>(this->dataPtr() + start, vec.size());
+
+            return;
+        }
+
         for (const auto& elem : vec) {
             this->writeValue<T>(elem);
         }
@@ -451,11 +622,11 @@ protected:
 
     // Map
 
-    template <typename T, typename Y>
-    DecodeResult<std::map<T, Y>> pcDecodeMap() {
+    template <typename M, typename T = typename M::key_type, typename Y = typename M::mapped_type>
+    DecodeResult<M> pcDecodeMap() {
         GLOBED_UNWRAP_INTO(this->readLength(), auto length);
 
-        std::map<T, Y> out;
+        M out = this->makeContainer<M>();
 
         for (size_t i = 0; i < length; i++) {
             GLOBED_UNWRAP_INTO(this->readValue<T>(), T first);
@@ -467,8 +638,8 @@ protected:
         return Ok(std::move(out));
     }
 
-    template <typename T, typename Y>
-    void pcEncodeMap(const std::map<T, Y>& map) {
+    template <typename T, typename Y, typename C, typename A>
+    void pcEncodeMap(const std::map<T, Y, C, A>& map) {
         this->writeLength(map.size());
 
         for (const auto& [first, second] : map) {
@@ -553,8 +724,8 @@ protected:
 
         // this is bad bad bad, but we assume there can only be 1 vtable.
         if constexpr (std::is_polymorphic_v<T>) {
-            structAlignment = alignof(void*);
-            total += sizeof(void*);
+            structAlignment = ByteBufferPolymorphicBase<T>::alignment;
+            total += ByteBufferPolymorphicBase<T>::size;
         }
 
         boost::mp11::mp_for_each<Md>([&](auto descriptor) {
@@ -582,6 +753,32 @@ protected:
         return total;
     }
 
+    template <
+        typename T,
+        class Md = boost::describe::describe_members<T, boost::describe::mod_public>,
+        class Bd = boost::describe::describe_bases<T, boost::describe::mod_any_access>
+    >
+    constexpr static size_t reflectionMaxSize() {
+        // bitfields are encoded as a single `BitBuffer`
+        if constexpr (!boost::mp11::mp_empty<Bd>::value) {
+            if constexpr (std::is_same_v<typename boost::mp11::mp_first<Bd>::type, BitfieldBase>) {
+                constexpr size_t bitcount = util::data::bitsToBytes(sizeof(T)) * 8;
+                return sizeof(BitBufferUnderlyingType<bitcount>);
+            }
+        }
+
+        size_t total = 0;
+
+        boost::mp11::mp_for_each<Md>([&](auto descriptor) {
+            using MPT = decltype(descriptor.pointer);
+            using FT = typename asp::member_ptr_to_underlying<MPT>::type;
+
+            total = addSizes(total, maxEncodedSize<FT>());
+        });
+
+        return total;
+    }
+
     template <typename T>
     constexpr static void checkMissingFields() {
         static_assert(calculateStructSize<T>() == sizeof(T), "size of the type does not match the sizes of all fields, make sure fields are listed in the correct order and there are no missing fields");
@@ -591,8 +788,23 @@ private:
     // Data members
     util::data::bytevector _data;
     size_t _position = 0;
+
+    // if not null, `_data` is unused and the buffer uses this external memory instead
+    util::data::byte* _borrowed = nullptr;
+    size_t _borrowedSize = 0;
+    size_t _borrowedCapacity = 0;
+
+    std::pmr::memory_resource* _resource = nullptr;
 };
 
+/* Upper bounds for the common `customEncode` specializations */
+
+template <> struct ByteBufferMaxSize<cocos2d::CCPoint> { static constexpr size_t value = sizeof(float) * 2; };
+template <> struct ByteBufferMaxSize<cocos2d::CCSize> { static constexpr size_t value = sizeof(float) * 2; };
+template <> struct ByteBufferMaxSize<cocos2d::ccColor3B> { static constexpr size_t value = 3; };
+template <> struct ByteBufferMaxSize<cocos2d::ccColor4B> { static constexpr size_t value = 4; };
+template <size_t N> struct ByteBufferMaxSize<util::data::bytearray<N>> { static constexpr size_t value = N; };
+
 // Custom error formatter
 template <>
 struct fmt::formatter<ByteBuffer::DecodeError> {
@@ -0,0 +1,99 @@
+#pragma once
+#include <boost/describe.hpp>
+
+#include <array>
+#include <type_traits>
+
+/*
+* EnumValidator - checks whether a raw value corresponds to an enumerator of a described enum.
+* All the lookup data is generated at compile time:
+*  - contiguous enums use a range check
+*  - sparse enums with a small range use a bitmap
+*  - anything else falls back to a binary search over the sorted values
+* The first two are constant time, the binary search is logarithmic in the amount of enumerators.
+*/
+template <typename E> requires std::is_enum_v<E>
+class EnumValidator {
+    using P = std::underlying_type_t<E>;
+    using Enumerators = boost::describe::describe_enumerators<E>;
+
+    static constexpr size_t COUNT = boost::mp11::mp_size<Enumerators>::value;
+
+    // sparse enums spanning more values than this use a binary search instead of a bitmap
+    static constexpr uint64_t MAX_BITMAP_SIZE = 1024;
+
+    static constexpr std::array<P, COUNT> sortedValues() {
+        std::array<P, COUNT> out{};
+        size_t count = 0;
+
+        boost::mp11::mp_for_each<Enumerators>([&](auto descriptor) {
+            out[count++] = static_cast<P>(descriptor.value);
+        });
+
+        // insertion sort, std::sort is not constexpr on every platform we support
+        for (size_t i = 1; i < COUNT; i++) {
+            for (size_t j = i; j > 0 && out[j - 1] > out[j]; j--) {
+                P tmp = out[j];
+                out[j] = out[j - 1];
+                out[j - 1] = tmp;
+            }
+        }
+
+        return out;
+    }
+
+    static constexpr std::array<P, COUNT> VALUES = sortedValues();
+
+    static constexpr size_t uniqueCount() {
+        size_t unique = COUNT > 0 ? 1 : 0;
+        for (size_t i = 1; i < COUNT; i++) {
+            if (VALUES[i] != VALUES[i - 1]) unique++;
+        }
+
+        return unique;
+    }
+
+    static constexpr P MIN = COUNT > 0 ? VALUES[0] : P{};
+    static constexpr P MAX = COUNT > 0 ? VALUES[COUNT - 1] : P{};
+
+    // conversion to unsigned is modular, so this is correct for signed types as well
+    static constexpr uint64_t SPAN = static_cast<uint64_t>(MAX) - static_cast<uint64_t>(MIN);
+
+    static constexpr bool CONTIGUOUS = COUNT > 0 && SPAN + 1 == uniqueCount();
+    static constexpr size_t BITMAP_SIZE = (COUNT == 0 || CONTIGUOUS || SPAN >= MAX_BITMAP_SIZE) ? 0 : static_cast<size_t>(SPAN + 1);
+
+    static constexpr std::array<bool, BITMAP_SIZE> makeBitmap() {
+        std::array<bool, BITMAP_SIZE> out{};
+        for (size_t i = 0; i < COUNT; i++) {
+            out[static_cast<uint64_t>(VALUES[i]) - static_cast<uint64_t>(MIN)] = true;
+        }
+
+        return out;
+    }
+
+    static constexpr std::array<bool, BITMAP_SIZE> BITMAP = makeBitmap();
+
+public:
+    static constexpr bool isValid(P value) {
+        if constexpr (COUNT == 0) {
+            return false;
+        } else if constexpr (CONTIGUOUS) {
+            return static_cast<uint64_t>(value) - static_cast<uint64_t>(MIN) <= SPAN;
+        } else if constexpr (BITMAP_SIZE > 0) {
+            uint64_t idx = static_cast<uint64_t>(value) - static_cast<uint64_t>(MIN);
+            return idx < BITMAP_SIZE && BITMAP[idx];
+        } else {
+            size_t lo = 0, hi = COUNT;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (VALUES[mid] < value) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+
+            return lo < COUNT && VALUES[lo] == value;
+        }
+    }
+};
@@ -113,6 +113,26 @@ class KeepaliveTCPPacket : public Packet {
 
 GLOBED_SERIALIZABLE_STRUCT(KeepaliveTCPPacket, ());
 
+// 10008 - PacketBundlePacket
+// Never encoded directly, `GameSocket` writes the list of bundled packets after the header (protocol v15+)
+class PacketBundlePacket : public Packet {
+    GLOBED_PACKET(10008, PacketBundlePacket, true, false)
+
+    PacketBundlePacket() {}
+};
+
+GLOBED_SERIALIZABLE_STRUCT(PacketBundlePacket, ());
+
+// 10009 - SequencedDatagramPacket
+// Never encoded directly, `GameSocket` writes the sequence header and then the actual datagram after the header (protocol v17+)
+class SequencedDatagramPacket : public Packet {
+    GLOBED_PACKET(10009, SequencedDatagramPacket, false, false)
+
+    SequencedDatagramPacket() {}
+};
+
+GLOBED_SERIALIZABLE_STRUCT(SequencedDatagramPacket, ());
+
 // 10200 - ConnectionTestPacket
 class ConnectionTestPacket : public Packet {
     GLOBED_PACKET(10200, ConnectionTestPacket, false, false)
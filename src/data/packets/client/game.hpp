@@ -37,6 +37,13 @@ GLOBED_SERIALIZABLE_STRUCT(LevelLeavePacket, ());
 class PlayerDataPacket : public Packet {
     GLOBED_PACKET(12003, PlayerDataPacket, false, false)
 
+    static constexpr size_t MAX_COUNTER_CHANGES = 255;
+    static constexpr size_t MAX_ENCODED_SIZE =
+        ByteBuffer::maxEncodedSize<PlayerData>()
+        + ByteBuffer::maxEncodedSize<std::optional<PlayerMetadata>>()
+        + sizeof(uint8_t)
+        + ByteBuffer::maxEncodedSize<GlobedCounterChange>() * MAX_COUNTER_CHANGES;
+
     PlayerDataPacket() {}
     PlayerDataPacket(const PlayerData& data, const std::optional<PlayerMetadata>& meta, std::vector<GlobedCounterChange>&& counterChanges) : data(data), meta(meta), counterChanges(std::move(counterChanges)) {}
 
@@ -55,10 +62,56 @@ inline void ByteBuffer::customEncode<PlayerDataPacket>(const PlayerDataPacket& p
     this->writeValue(packet.data);
     this->writeValue(packet.meta);
 
-    this->writeU8(packet.counterChanges.size());
+    // the count is a single byte, anything past that would not be decodable by the server anyway
+    size_t changes = std::min<size_t>(packet.counterChanges.size(), PlayerDataPacket::MAX_COUNTER_CHANGES);
+    this->writeU8(changes);
+
+    for (size_t i = 0; i < changes; i++) {
+        this->writeValue(packet.counterChanges[i]);
+    }
+}
+
+// 12005 - PlayerDataCompactPacket
+// Compact version of `PlayerDataPacket`, used since protocol v14. Created by `PlayerDataCodec` rather than directly.
+class PlayerDataCompactPacket : public Packet {
+    GLOBED_PACKET(12005, PlayerDataCompactPacket, false, false)
+
+    static constexpr size_t MAX_ENCODED_SIZE =
+        sizeof(uint8_t) * 3
+        + CompactPlayerData::MAX_ENCODED_SIZE
+        + ByteBuffer::maxEncodedSize<std::optional<PlayerMetadata>>()
+        + sizeof(uint8_t)
+        + ByteBuffer::maxEncodedSize<GlobedCounterChange>() * PlayerDataPacket::MAX_COUNTER_CHANGES;
+
+    PlayerDataCompactPacket() {}
+
+    uint8_t frame;                          // id of this frame, never 0
+    uint8_t baseFrame;                      // id of the frame `data` is delta encoded against, 0 for keyframes
+    uint8_t levelDataAck;                   // id of the last `LevelDataCompactPacket` we received, 0 if none
+    std::optional<QuantizedPlayerData> base;
+    CompactPlayerData data;
+    std::optional<PlayerMetadata> meta;
+    std::vector<GlobedCounterChange> counterChanges;
+};
+
+template <>
+inline ByteBuffer::DecodeResult<PlayerDataCompactPacket> ByteBuffer::customDecode<PlayerDataCompactPacket>() {
+    throw std::runtime_error("unreachable tbh");
+}
+
+template <>
+inline void ByteBuffer::customEncode<PlayerDataCompactPacket>(const PlayerDataCompactPacket& packet) {
+    this->writeU8(packet.frame);
+    this->writeU8(packet.base ? packet.baseFrame : 0);
+    this->writeU8(packet.levelDataAck);
+    packet.data.encode(*this, packet.base ? &*packet.base : nullptr);
+    this->writeValue(packet.meta);
+
+    size_t changes = std::min<size_t>(packet.counterChanges.size(), PlayerDataPacket::MAX_COUNTER_CHANGES);
+    this->writeU8(changes);
 
-    for (const auto& change : packet.counterChanges) {
-        this->writeValue(change);
+    for (size_t i = 0; i < changes; i++) {
+        this->writeValue(packet.counterChanges[i]);
     }
 }
 
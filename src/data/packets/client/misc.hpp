@@ -27,6 +27,10 @@ public:
         return "RawPacket";
     }
 
+    size_t getMaxEncodedSize() const override {
+        return buffer.size();
+    }
+
     void encode(ByteBuffer& buf) const override {
         buf.writeValue<ByteBuffer>(buffer);
     }
@@ -36,12 +40,12 @@ public:
     }
 
     static std::shared_ptr<Packet> create(packetid_t id, bool encrypted, bool tcp, ByteBuffer&& buffer) {
-        return std::make_shared<RawPacket>(id, encrypted, tcp, std::move(buffer));
+        return makePooled<RawPacket>(id, encrypted, tcp, std::move(buffer));
     }
 
     template <typename T>
     static std::shared_ptr<Packet> create(ByteBuffer&& buffer) {
-        return std::make_shared<RawPacket>(T::PACKET_ID, T::ENCRYPTED, T::SHOULD_USE_TCP, std::move(buffer));
+        return makePooled<RawPacket>(T::PACKET_ID, T::ENCRYPTED, T::SHOULD_USE_TCP, std::move(buffer));
     }
 
     packetid_t id;
@@ -1,6 +1,6 @@
 #include "all.hpp" // include all packets
 
-#define PACKET(pt) case pt::PACKET_ID: return std::make_shared<pt>()
+#define PACKET(pt) case pt::PACKET_ID: return makePooled<pt>()
 
 std::shared_ptr<Packet> matchPacket(packetid_t packetId) {
     switch (packetId) {
@@ -16,6 +16,8 @@ std::shared_ptr<Packet> matchPacket(packetid_t packetId) {
         PACKET(KeepaliveTCPResponsePacket);
         PACKET(ClaimThreadFailedPacket);
         PACKET(LoginRecoveryFailecPacket);
+        PACKET(SessionKeysPacket);
+        PACKET(SessionTicketPacket);
 
         PACKET(ServerNoticePacket);
         PACKET(ServerBannedPacket);
@@ -34,6 +36,7 @@ std::shared_ptr<Packet> matchPacket(packetid_t packetId) {
 
         PACKET(PlayerProfilesPacket);
         PACKET(LevelDataPacket);
+        PACKET(LevelDataCompactPacket);
         PACKET(LevelPlayerMetadataPacket);
         PACKET(VoiceBroadcastPacket);
         PACKET(ChatMessageBroadcastPacket);
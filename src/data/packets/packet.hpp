@@ -3,6 +3,10 @@
 #include <defs/minimal_geode.hpp>
 #include <defs/assert.hpp>
 #include <data/bytebuffer.hpp>
+#include <data/arena.hpp>
+#include <data/packets/pool.hpp>
+
+#include <memory>
 
 using packetid_t = uint16_t;
 
@@ -16,22 +20,43 @@ using packetid_t = uint16_t;
     bool getUseTcp() const override { return this->SHOULD_USE_TCP; } \
     bool getEncrypted() const override { return this->ENCRYPTED; } \
     const char* getPacketName() const override { return this->PACKET_NAME; } \
+    size_t getMaxEncodedSize() const override { \
+        using InstTy = typename std::remove_reference_t<decltype(*this)>; \
+        return ByteBuffer::maxEncodedSize<std::remove_cv_t<InstTy>>(); \
+    } \
     void encode(ByteBuffer& buf) const override { \
         using InstTy = typename std::remove_reference_t<decltype(*this)>; \
         using NonCvTy = typename std::remove_cv_t<InstTy>; \
         buf.writeValue<NonCvTy>(*this); \
     } \
     ByteBuffer::DecodeResult<> decode(ByteBuffer& buf) override { \
-        GLOBED_UNWRAP_INTO(buf.readValue<std::remove_reference_t<decltype(*this)>>(), *this); \
-        return Ok(); \
+        using InstTy = typename std::remove_reference_t<decltype(*this)>; \
+        if constexpr (ByteBuffer::usesMemoryResource<InstTy>()) { \
+            auto* prevResource = buf.memoryResource(); \
+            buf.setMemoryResource(&this->arena()); \
+            auto result = buf.readValueInto<InstTy>(*this); \
+            buf.setMemoryResource(prevResource); \
+            return result; \
+        } else { \
+            return buf.readValueInto<InstTy>(*this); \
+        } \
     } \
     template <typename... Args> \
     static std::shared_ptr<Packet> create(Args&&... args) { \
-        return std::make_shared<name>(std::forward<Args>(args)...); \
+        return makePooled<name>(std::forward<Args>(args)...); \
     }
 class Packet {
 public:
-    virtual ~Packet() {}
+    Packet() {}
+
+    // the arena belongs to a specific instance, so it is never copied
+    Packet(const Packet&) {}
+    Packet& operator=(const Packet&) { return *this; }
+
+    // by now the members of the derived packet are destroyed, so the arena can be reused by another packet
+    virtual ~Packet() {
+        if (_arena) PacketArena::recycle(std::move(_arena));
+    }
     // Encodes the packet into a bytebuffer
     virtual void encode(ByteBuffer& buf) const = 0;
 
@@ -43,6 +68,25 @@ public:
     virtual bool getEncrypted() const = 0;
     virtual const char* getPacketName() const = 0;
 
+    // Upper bound of the encoded size of this packet (without the header), or `ByteBuffer::UNBOUNDED_SIZE`
+    virtual size_t getMaxEncodedSize() const {
+        return ByteBuffer::UNBOUNDED_SIZE;
+    }
+
+    // Arena that the `std::pmr` containers of this packet are decoded into. Acquired on first use.
+    PacketArena& arena() {
+        if (!_arena) {
+            _arena = PacketArena::acquire();
+        }
+
+        return *_arena;
+    }
+
+    // Reclaim the memory of the arena. Must only be called once the contents of the packet have been cleared.
+    void resetArena() {
+        if (_arena) _arena->reset();
+    }
+
     template <typename T>
     requires std::is_base_of_v<Packet, T>
     bool isInstanceOf() {
@@ -59,6 +103,16 @@ public:
 
         return static_cast<T*>(this);
     }
+
+private:
+    std::unique_ptr<PacketArena> _arena;
+};
+
+template <typename T>
+requires std::is_base_of_v<Packet, T>
+struct ByteBufferPolymorphicBase<T> {
+    static constexpr size_t size = sizeof(Packet);
+    static constexpr size_t alignment = alignof(Packet);
 };
 
 struct PacketHeader {
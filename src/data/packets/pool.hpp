@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <asp/sync.hpp>
+
+/*
+* Pooled allocation of packets.
+*
+* `makePooled<T>()` is a drop-in replacement for `std::make_shared<T>()`. The packet and its shared_ptr control block
+* live in a single block taken from a free list of blocks of the same size, and the block goes back to the free list
+* as soon as the last `shared_ptr` is released (usually after the last listener ran), so nothing changes for the callers.
+*
+* The free lists are shared between all threads, since packets are usually created on one thread and released on another.
+*/
+
+// Allocation counters of all the packet pools combined, useful to see how much the pools actually save.
+struct PacketPoolStats {
+    // blocks that had to be allocated from the heap
+    std::atomic_size_t allocations = 0;
+    // blocks that were taken from a free list instead
+    std::atomic_size_t reused = 0;
+    // blocks that were put back into a free list
+    std::atomic_size_t returned = 0;
+    // blocks that were freed because their free list was full
+    std::atomic_size_t freed = 0;
+    // packet arenas that had to be created, see `PacketArena::acquire`
+    std::atomic_size_t arenaAllocations = 0;
+    // packet arenas that were recycled instead
+    std::atomic_size_t arenasReused = 0;
+
+    static PacketPoolStats& get() {
+        static PacketPoolStats instance;
+        return instance;
+    }
+
+    void reset() {
+        allocations = 0;
+        reused = 0;
+        returned = 0;
+        freed = 0;
+        arenaAllocations = 0;
+        arenasReused = 0;
+    }
+};
+
+template <size_t Size, size_t Align>
+class PacketBlockPool {
+public:
+    // Upper limit of blocks kept around, anything above is given back to the system.
+    static constexpr size_t MAX_FREE_BLOCKS = 64;
+
+    static PacketBlockPool& get() {
+        // intentionally leaked, packets may still be released during static destruction
+        static PacketBlockPool* instance = new PacketBlockPool;
+        return *instance;
+    }
+
+    void* allocate() {
+        {
+            auto blocks = _free.lock();
+            if (!blocks->empty()) {
+                void* block = blocks->back();
+                blocks->pop_back();
+                PacketPoolStats::get().reused++;
+                return block;
+            }
+        }
+
+        PacketPoolStats::get().allocations++;
+        return ::operator new(Size, std::align_val_t{Align});
+    }
+
+    void deallocate(void* block) {
+        {
+            auto blocks = _free.lock();
+            if (blocks->size() < MAX_FREE_BLOCKS) {
+                blocks->push_back(block);
+                PacketPoolStats::get().returned++;
+                return;
+            }
+        }
+
+        PacketPoolStats::get().freed++;
+        ::operator delete(block, std::align_val_t{Align});
+    }
+
+private:
+    asp::Mutex<std::vector<void*>> _free;
+
+    PacketBlockPool() {
+        _free.lock()->reserve(MAX_FREE_BLOCKS);
+    }
+};
+
+// Allocator that takes single objects from a `PacketBlockPool`, used with `std::allocate_shared`.
+template <typename T>
+struct PacketPoolAllocator {
+    using value_type = T;
+
+    PacketPoolAllocator() noexcept = default;
+
+    template <typename U>
+    PacketPoolAllocator(const PacketPoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+        }
+
+        return static_cast<T*>(PacketBlockPool<sizeof(T), alignof(T)>::get().allocate());
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (n != 1) {
+            ::operator delete(p, std::align_val_t{alignof(T)});
+            return;
+        }
+
+        PacketBlockPool<sizeof(T), alignof(T)>::get().deallocate(p);
+    }
+
+    template <typename U>
+    bool operator==(const PacketPoolAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+    return std::allocate_shared<T>(PacketPoolAllocator<T>{}, std::forward<Args>(args)...);
+}
@@ -3,6 +3,7 @@
 #include <data/types/crypto.hpp>
 #include <data/types/gd.hpp>
 #include <data/types/user.hpp>
+#include <crypto/session_cipher.hpp>
 
 // 20000 - PingResponsePacket
 class PingResponsePacket : public Packet {
@@ -103,6 +104,26 @@ class LoginRecoveryFailecPacket : public Packet {
 };
 GLOBED_SERIALIZABLE_STRUCT(LoginRecoveryFailecPacket, ());
 
+// 20010 - SessionKeysPacket
+class SessionKeysPacket : public Packet {
+    GLOBED_PACKET(20010, SessionKeysPacket, true, true)
+
+    SessionKeysPacket() {}
+
+    util::data::bytearray<SessionCipher::KEY_LEN> sendKey, recvKey;
+};
+GLOBED_SERIALIZABLE_STRUCT(SessionKeysPacket, (sendKey, recvKey));
+
+// 20011 - SessionTicketPacket
+class SessionTicketPacket : public Packet {
+    GLOBED_PACKET(20011, SessionTicketPacket, true, true)
+
+    SessionTicketPacket() {}
+
+    util::data::bytearray<16> ticket;
+};
+GLOBED_SERIALIZABLE_STRUCT(SessionTicketPacket, (ticket));
+
 // 20100 - ServerNoticePacket
 class ServerNoticePacket : public Packet {
     GLOBED_PACKET(20100, ServerNoticePacket, false, false)
@@ -8,7 +8,7 @@ class PlayerProfilesPacket : public Packet {
 
     PlayerProfilesPacket() {}
 
-    std::vector<PlayerAccountData> players;
+    std::pmr::vector<PlayerAccountData> players;
 };
 
 GLOBED_SERIALIZABLE_STRUCT(PlayerProfilesPacket, (players));
@@ -19,7 +19,7 @@ class LevelDataPacket : public Packet {
 
     LevelDataPacket() {}
 
-    std::vector<AssociatedPlayerData> players;
+    std::pmr::vector<AssociatedPlayerData> players;
     std::optional<std::map<uint16_t, int>> customItems;
 };
 
@@ -36,6 +36,39 @@ class LevelPlayerMetadataPacket : public Packet {
 
 GLOBED_SERIALIZABLE_STRUCT(LevelPlayerMetadataPacket, (players));
 
+// 22003 - LevelDataCompactPacket
+// Compact version of `LevelDataPacket`, used since protocol v14. Player entries can't be decoded without the frames
+// received previously, so only the header is decoded here and `PlayerDataCodec` expands the rest into a `LevelDataPacket`.
+class LevelDataCompactPacket : public Packet {
+    GLOBED_PACKET(22003, LevelDataCompactPacket, false, false)
+
+    LevelDataCompactPacket() {}
+
+    uint8_t frame;          // id of this frame, never 0
+    uint8_t baseFrame;      // id of the frame the entries are delta encoded against, 0 if all of them are keyframes
+    uint8_t playerDataAck;  // id of the last `PlayerDataCompactPacket` the server received from us, 0 if none
+    util::data::bytevector payload;
+};
+
+template <>
+inline ByteBuffer::DecodeResult<LevelDataCompactPacket> ByteBuffer::customDecode<LevelDataCompactPacket>() {
+    LevelDataCompactPacket packet;
+
+    GLOBED_UNWRAP_INTO(this->readU8(), packet.frame);
+    GLOBED_UNWRAP_INTO(this->readU8(), packet.baseFrame);
+    GLOBED_UNWRAP_INTO(this->readU8(), packet.playerDataAck);
+
+    packet.payload.resize(this->size() - this->getPosition());
+    GLOBED_UNWRAP(this->readBytesInto(packet.payload.data(), packet.payload.size()));
+
+    return Ok(std::move(packet));
+}
+
+template <>
+inline void ByteBuffer::customEncode<LevelDataCompactPacket>(const LevelDataCompactPacket& packet) {
+    throw std::runtime_error("unreachable tbh");
+}
+
 #ifdef GLOBED_VOICE_SUPPORT
 # include <audio/frame.hpp>
 #endif
@@ -2,6 +2,9 @@
 
 #include <data/bitbuffer.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace cocos2d;
 
 template<>
@@ -128,3 +131,244 @@ template<> ByteBuffer::DecodeResult<PlayerData> ByteBuffer::customDecode() {
 
     return Ok(data);
 }
+
+/* Compact encoding */
+
+namespace {
+    // Bits of the mask byte that starts every compact frame
+    namespace CompactMask {
+        constexpr uint8_t Delta = 1 << 0;
+        constexpr uint8_t Player1State = 1 << 1;
+        constexpr uint8_t Player2State = 1 << 2;
+        constexpr uint8_t Player1Spider = 1 << 3;
+        constexpr uint8_t Player2Spider = 1 << 4;
+        constexpr uint8_t DeathTimestamp = 1 << 5;
+        constexpr uint8_t Percentage = 1 << 6;
+        constexpr uint8_t Flags = 1 << 7;
+    }
+
+    int32_t quantize(float value, float scale) {
+        double scaled = std::round(static_cast<double>(value) * scale);
+        if (std::isnan(scaled)) return 0;
+
+        return static_cast<int32_t>(std::clamp<double>(scaled, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
+    }
+
+    float dequantize(int32_t value, float scale) {
+        return static_cast<float>(value) / scale;
+    }
+
+    // deltas wrap around instead of overflowing, the decoder does the same so the result is always exact
+    int32_t wrappingSub(int32_t a, int32_t b) {
+        return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+    }
+
+    int32_t wrappingAdd(int32_t a, int32_t b) {
+        return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+    }
+
+    QuantizedPlayerData::Icon quantizeIcon(const SpecificIconData& data) {
+        BitBuffer<16> bits;
+        bits.writeBits(
+            data.isVisible,
+            data.isLookingLeft,
+            data.isUpsideDown,
+            data.isDashing,
+            data.isMini,
+            data.isGrounded,
+            data.isStationary,
+            data.isFalling,
+            data.didJustJump,
+            data.isRotating,
+            data.isSideways
+        );
+
+        return QuantizedPlayerData::Icon {
+            .x = quantize(data.position.x, QuantizedPlayerData::POSITION_SCALE),
+            .y = quantize(data.position.y, QuantizedPlayerData::POSITION_SCALE),
+            .rotation = quantize(data.rotation, QuantizedPlayerData::ROTATION_SCALE),
+            .iconType = data.iconType,
+            .flags = bits.contents(),
+        };
+    }
+
+    SpecificIconData dequantizeIcon(const QuantizedPlayerData::Icon& icon, const std::optional<SpiderTeleportData>& spiderTeleport) {
+        SpecificIconData data;
+        data.position = CCPoint{
+            dequantize(icon.x, QuantizedPlayerData::POSITION_SCALE),
+            dequantize(icon.y, QuantizedPlayerData::POSITION_SCALE)
+        };
+        data.rotation = dequantize(icon.rotation, QuantizedPlayerData::ROTATION_SCALE);
+        data.iconType = icon.iconType;
+
+        BitBuffer<16> bits(icon.flags);
+        bits.readBitsInto(
+            data.isVisible,
+            data.isLookingLeft,
+            data.isUpsideDown,
+            data.isDashing,
+            data.isMini,
+            data.isGrounded,
+            data.isStationary,
+            data.isFalling,
+            data.didJustJump,
+            data.isRotating,
+            data.isSideways
+        );
+
+        data.spiderTeleportData = spiderTeleport;
+
+        return data;
+    }
+
+    bool iconStateChanged(const QuantizedPlayerData::Icon& a, const QuantizedPlayerData::Icon& b) {
+        return a.iconType != b.iconType || a.flags != b.flags;
+    }
+}
+
+CompactPlayerData CompactPlayerData::fromPlayerData(const PlayerData& data) {
+    BitBuffer<8> bits;
+    bits.writeBits(data.isDead, data.isPaused, data.isPracticing, data.isDualMode, data.isInEditor, data.isEditorBuilding, data.isLastDeathReal);
+
+    CompactPlayerData out;
+    out.quantized = QuantizedPlayerData {
+        .timestamp = quantize(data.timestamp, QuantizedPlayerData::TIME_SCALE),
+        .player1 = quantizeIcon(data.player1),
+        .player2 = quantizeIcon(data.player2),
+        .lastDeathTimestamp = quantize(data.lastDeathTimestamp, QuantizedPlayerData::TIME_SCALE),
+        .percentage = quantize(data.currentPercentage, QuantizedPlayerData::PERCENTAGE_SCALE),
+        .flags = bits.contents(),
+    };
+    out.spiderTeleport1 = data.player1.spiderTeleportData;
+    out.spiderTeleport2 = data.player2.spiderTeleportData;
+
+    return out;
+}
+
+PlayerData CompactPlayerData::toPlayerData() const {
+    PlayerData data;
+    data.timestamp = dequantize(quantized.timestamp, QuantizedPlayerData::TIME_SCALE);
+    data.player1 = dequantizeIcon(quantized.player1, spiderTeleport1);
+    data.player2 = dequantizeIcon(quantized.player2, spiderTeleport2);
+    data.lastDeathTimestamp = dequantize(quantized.lastDeathTimestamp, QuantizedPlayerData::TIME_SCALE);
+    data.currentPercentage = dequantize(quantized.percentage, QuantizedPlayerData::PERCENTAGE_SCALE);
+
+    BitBuffer<8> bits(quantized.flags);
+    bits.readBitsInto(data.isDead, data.isPaused, data.isPracticing, data.isDualMode, data.isInEditor, data.isEditorBuilding, data.isLastDeathReal);
+
+    return data;
+}
+
+void CompactPlayerData::encode(ByteBuffer& buf, const QuantizedPlayerData* base) const {
+    // a keyframe is simply a delta against an all-zero frame
+    static const QuantizedPlayerData zero{};
+    const auto& prev = base ? *base : zero;
+    const auto& cur = quantized;
+
+    uint8_t mask = 0;
+    if (base) mask |= CompactMask::Delta;
+    if (iconStateChanged(cur.player1, prev.player1)) mask |= CompactMask::Player1State;
+    if (iconStateChanged(cur.player2, prev.player2)) mask |= CompactMask::Player2State;
+    if (spiderTeleport1) mask |= CompactMask::Player1Spider;
+    if (spiderTeleport2) mask |= CompactMask::Player2Spider;
+    if (cur.lastDeathTimestamp != prev.lastDeathTimestamp) mask |= CompactMask::DeathTimestamp;
+    if (cur.percentage != prev.percentage) mask |= CompactMask::Percentage;
+    if (cur.flags != prev.flags) mask |= CompactMask::Flags;
+
+    buf.writeU8(mask);
+    buf.writeVarInt(wrappingSub(cur.timestamp, prev.timestamp));
+
+    for (auto [icon, prevIcon] : {std::pair{&cur.player1, &prev.player1}, std::pair{&cur.player2, &prev.player2}}) {
+        buf.writeVarInt(wrappingSub(icon->x, prevIcon->x));
+        buf.writeVarInt(wrappingSub(icon->y, prevIcon->y));
+        buf.writeVarInt(wrappingSub(icon->rotation, prevIcon->rotation));
+    }
+
+    if (mask & CompactMask::Player1State) {
+        buf.writeValue(cur.player1.iconType);
+        buf.writeU16(cur.player1.flags);
+    }
+
+    if (mask & CompactMask::Player2State) {
+        buf.writeValue(cur.player2.iconType);
+        buf.writeU16(cur.player2.flags);
+    }
+
+    if (spiderTeleport1) buf.writeValue(*spiderTeleport1);
+    if (spiderTeleport2) buf.writeValue(*spiderTeleport2);
+
+    if (mask & CompactMask::DeathTimestamp) {
+        buf.writeVarInt(wrappingSub(cur.lastDeathTimestamp, prev.lastDeathTimestamp));
+    }
+
+    if (mask & CompactMask::Percentage) {
+        buf.writeVarInt(wrappingSub(cur.percentage, prev.percentage));
+    }
+
+    if (mask & CompactMask::Flags) {
+        buf.writeU8(cur.flags);
+    }
+}
+
+ByteBuffer::DecodeResult<CompactPlayerData> CompactPlayerData::decode(ByteBuffer& buf, const QuantizedPlayerData* base) {
+    static const QuantizedPlayerData zero{};
+
+    GLOBED_UNWRAP_INTO(buf.readU8(), uint8_t mask);
+
+    if ((mask & CompactMask::Delta) && !base) {
+        return Err(ByteBuffer::DecodeError::MissingDeltaBase);
+    }
+
+    const auto& prev = (mask & CompactMask::Delta) ? *base : zero;
+
+    CompactPlayerData out;
+    auto& cur = out.quantized;
+    cur = prev;
+
+    GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t timestampDelta);
+    cur.timestamp = wrappingAdd(prev.timestamp, timestampDelta);
+
+    for (auto* icon : {&cur.player1, &cur.player2}) {
+        GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t dx);
+        GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t dy);
+        GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t drot);
+
+        icon->x = wrappingAdd(icon->x, dx);
+        icon->y = wrappingAdd(icon->y, dy);
+        icon->rotation = wrappingAdd(icon->rotation, drot);
+    }
+
+    if (mask & CompactMask::Player1State) {
+        GLOBED_UNWRAP_INTO(buf.readValue<PlayerIconType>(), cur.player1.iconType);
+        GLOBED_UNWRAP_INTO(buf.readU16(), cur.player1.flags);
+    }
+
+    if (mask & CompactMask::Player2State) {
+        GLOBED_UNWRAP_INTO(buf.readValue<PlayerIconType>(), cur.player2.iconType);
+        GLOBED_UNWRAP_INTO(buf.readU16(), cur.player2.flags);
+    }
+
+    if (mask & CompactMask::Player1Spider) {
+        GLOBED_UNWRAP_INTO(buf.readValue<SpiderTeleportData>(), out.spiderTeleport1);
+    }
+
+    if (mask & CompactMask::Player2Spider) {
+        GLOBED_UNWRAP_INTO(buf.readValue<SpiderTeleportData>(), out.spiderTeleport2);
+    }
+
+    if (mask & CompactMask::DeathTimestamp) {
+        GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t delta);
+        cur.lastDeathTimestamp = wrappingAdd(prev.lastDeathTimestamp, delta);
+    }
+
+    if (mask & CompactMask::Percentage) {
+        GLOBED_UNWRAP_INTO(buf.readVarInt(), int32_t delta);
+        cur.percentage = wrappingAdd(prev.percentage, delta);
+    }
+
+    if (mask & CompactMask::Flags) {
+        GLOBED_UNWRAP_INTO(buf.readU8(), cur.flags);
+    }
+
+    return Ok(std::move(out));
+}
@@ -35,6 +35,10 @@ struct GlobedCounterChange {
 
 GLOBED_SERIALIZABLE_ENUM(GlobedCounterChange::Type, Set, Add, Multiply, Divide);
 
+template <> struct ByteBufferMaxSize<GlobedCounterChange> {
+    static constexpr size_t value = sizeof(uint16_t) + sizeof(GlobedCounterChange::Type) + sizeof(int);
+};
+
 struct SpecificIconData {
     void copyFlagsFrom(const SpecificIconData& other);
 
@@ -57,6 +61,15 @@ struct SpecificIconData {
     std::optional<SpiderTeleportData> spiderTeleportData;
 };
 
+template <> struct ByteBufferMaxSize<SpecificIconData> {
+    static constexpr size_t value =
+        ByteBuffer::maxEncodedSize<cocos2d::CCPoint>()
+        + sizeof(float)
+        + sizeof(PlayerIconType)
+        + sizeof(BitBufferUnderlyingType<16>)
+        + ByteBuffer::maxEncodedSize<std::optional<SpiderTeleportData>>();
+};
+
 struct PlayerData {
     float timestamp;
 
@@ -76,6 +89,65 @@ struct PlayerData {
     bool isLastDeathReal; // for deathlink, to prevent death chains
 };
 
+template <> struct ByteBufferMaxSize<PlayerData> {
+    static constexpr size_t value =
+        sizeof(float) * 4
+        + ByteBuffer::maxEncodedSize<SpecificIconData>() * 2
+        + sizeof(BitBufferUnderlyingType<8>);
+};
+
+/*
+* Fixed-point representation of `PlayerData`, used as the base for delta encoding in the compact wire format (protocol v14).
+* Both peers remember exactly what went over the wire, so deltas never accumulate rounding errors.
+*/
+struct QuantizedPlayerData {
+    static constexpr float POSITION_SCALE = 64.f;    // 1/64 of a unit
+    static constexpr float ROTATION_SCALE = 16.f;    // 1/16 of a degree
+    static constexpr float TIME_SCALE = 1000.f;      // milliseconds
+    static constexpr float PERCENTAGE_SCALE = 100.f; // 1/100 of a percent
+
+    struct Icon {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t rotation = 0;
+        PlayerIconType iconType = PlayerIconType::Unknown;
+        uint16_t flags = 0; // same layout as the bitfield in `SpecificIconData` encoding
+
+        bool operator==(const Icon&) const = default;
+    };
+
+    int32_t timestamp = 0;
+    Icon player1;
+    Icon player2;
+    int32_t lastDeathTimestamp = 0;
+    int32_t percentage = 0;
+    uint8_t flags = 0; // same layout as the bitfield in `PlayerData` encoding
+
+    bool operator==(const QuantizedPlayerData&) const = default;
+};
+
+/*
+* PlayerData in the compact wire format. Every frame is a delta against a previous frame that the other side has acknowledged,
+* or against an all-zero frame if it's a keyframe. Unchanged flags and rarely changing fields are omitted entirely.
+*/
+struct CompactPlayerData {
+    // mask + 9 varint deltas + 2 icon states + 2 spider teleports + flags
+    static constexpr size_t MAX_ENCODED_SIZE = 1 + 9 * 5 + 2 * 3 + 2 * 16 + 1;
+
+    QuantizedPlayerData quantized;
+    std::optional<SpiderTeleportData> spiderTeleport1;
+    std::optional<SpiderTeleportData> spiderTeleport2;
+
+    static CompactPlayerData fromPlayerData(const PlayerData& data);
+    PlayerData toPlayerData() const;
+
+    // Encode as a delta against `base`, or as a keyframe if `base` is nullptr
+    void encode(ByteBuffer& buf, const QuantizedPlayerData* base) const;
+
+    // Decode a frame. If the frame is a delta and `base` is nullptr, `MissingDeltaBase` is returned.
+    static ByteBuffer::DecodeResult<CompactPlayerData> decode(ByteBuffer& buf, const QuantizedPlayerData* base);
+};
+
 struct PlayerMetadata {
     uint32_t localBest;
     int32_t attempts;
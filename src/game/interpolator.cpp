@@ -44,7 +44,9 @@ void PlayerInterpolator::updatePlayer(int playerId, const PlayerData& data, floa
     player.frameFlags.pendingP1Jump = data.player1.didJustJump;
     player.frameFlags.pendingP2Jump = data.player1.didJustJump;
 
+#ifdef GLOBED_DEBUG_INTERPOLATION
     LerpLogger::get().logRealFrame(playerId, this->getLocalTs(), data.timestamp, data.player1);
+#endif
 
     if (settings.realtime) {
         player.interpolatedState = data;
@@ -103,14 +105,18 @@ void PlayerInterpolator::tick(float dt) {
 
         float frameDelta = player.newerFrame.timestamp - player.olderFrame.timestamp;
         if (frameDelta == 0.f) {
+#ifdef GLOBED_DEBUG_INTERPOLATION
             LerpLogger::get().logLerpSkip(playerId, this->getLocalTs(), player.timeCounter, player.interpolatedState.player1);
+#endif
             continue;
         }
 
         float lerpRatio = (player.timeCounter - player.olderFrame.timestamp) / frameDelta;
         lerpPlayer(player.olderFrame.visual, player.newerFrame.visual, player.interpolatedState, lerpRatio);
 
+#ifdef GLOBED_DEBUG_INTERPOLATION
         LerpLogger::get().logLerpOperation(playerId, this->getLocalTs(), player.timeCounter, player.interpolatedState.player1);
+#endif
 
         player.timeCounter += dt;
     }
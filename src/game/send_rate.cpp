@@ -0,0 +1,79 @@
+#include "send_rate.hpp"
+
+#include <algorithm>
+
+// packets per second. with other players on the level, never go low enough for them to be considered gone
+constexpr float IDLE_RATE = 1.f;
+constexpr float MIN_RATE_WITH_PLAYERS = 2.f;
+
+// how fast the rate may come down, in fractions of the maximum rate per second
+constexpr float DECAY_PER_SEC = 0.5f;
+
+// weight of a new loss sample
+constexpr float LOSS_SMOOTHING = 0.25f;
+
+SendRateController::SendRateController(uint32_t maxTps) : maxRate(static_cast<float>(std::max<uint32_t>(maxTps, 1))), rate(maxRate) {}
+
+void SendRateController::updateLink(int rttMs, uint32_t sent, uint32_t answered) {
+    rtt = rttMs;
+
+    if (sent > 0) {
+        float sample = 1.f - std::min(static_cast<float>(answered) / static_cast<float>(sent), 1.f);
+        loss += (sample - loss) * LOSS_SMOOTHING;
+    }
+}
+
+void SendRateController::updateLink(int rttMs, float measuredLoss) {
+    rtt = rttMs;
+    loss = std::clamp(measuredLoss, 0.f, 1.f);
+}
+
+bool SendRateController::shouldSend(const Activity& activity) {
+    float target = this->targetRate(activity);
+    float tickLength = 1.f / maxRate;
+
+    if (target >= rate) {
+        rate = target;
+    } else {
+        rate = std::max(target, rate - maxRate * DECAY_PER_SEC * tickLength);
+    }
+
+    // every tick is worth `rate * tickLength` packets, a packet goes out once there is a full one
+    credit = std::min(credit + rate * tickLength, 1.f);
+
+    // a little leeway, so that rounding never makes the full rate skip a tick
+    if (credit >= 0.999f) {
+        credit = std::max(credit - 1.f, 0.f);
+        return true;
+    }
+
+    return false;
+}
+
+float SendRateController::targetRate(const Activity& activity) const {
+    if (!activity.hasPlayers) {
+        return IDLE_RATE;
+    }
+
+    // the server answers every packet with the data of everyone else, so sending less would make them stutter.
+    // with others on the level, the rate only comes down when the link can't keep up
+    float fraction = this->linkFactor();
+
+    return std::clamp(fraction * maxRate, std::min(MIN_RATE_WITH_PLAYERS, maxRate), maxRate);
+}
+
+float SendRateController::linkFactor() const {
+    // sending more over a congested link only makes the queues longer
+    float rttFactor = rtt > 500 ? 0.5f : (rtt > 300 ? 0.75f : 1.f);
+    float lossFactor = loss > 0.15f ? 0.5f : (loss > 0.05f ? 0.75f : 1.f);
+
+    return std::min(rttFactor, lossFactor);
+}
+
+float SendRateController::getRate() const {
+    return rate;
+}
+
+float SendRateController::getLoss() const {
+    return loss;
+}
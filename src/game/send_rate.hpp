@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+* SendRateController - decides how many times per second player data is sent, anywhere between once a second and the server tps.
+*
+* `selSendPlayerData` keeps running at the full rate and asks `shouldSend` on every tick. Alone on a level, only one packet
+* a second is sent. With others on the level, the rate only backs off (gradually) when the round trip time or the loss
+* get too high, and goes back up right away once the link recovers.
+*
+* The server answers every player data packet with the data of everyone else on the level, so this also decides how often
+* the other players get updated. That is why what the local player is doing never lowers the rate, as long as receiving
+* isn't decoupled from sending that would make everyone else stutter.
+*/
+class SendRateController {
+public:
+    struct Activity {
+        bool hasPlayers = false;
+    };
+
+    SendRateController(uint32_t maxTps);
+
+    // Update the link quality, should be called periodically.
+    // `sent` and `answered` are the amount of player data packets sent and the amount of responses received since the last call.
+    void updateLink(int rttMs, uint32_t sent, uint32_t answered);
+
+    // Same as above, but with a loss ratio that was measured directly (see `UdpSequencer`), which is used as is.
+    void updateLink(int rttMs, float measuredLoss);
+
+    // Called on every tick of the send selector (`maxTps` times per second), returns whether a packet should be sent now
+    bool shouldSend(const Activity& activity);
+
+    // The current rate, in packets per second
+    float getRate() const;
+
+    // Estimated loss ratio of player data, between 0 and 1
+    float getLoss() const;
+
+private:
+    float maxRate;
+    float rate;
+    float credit = 0.f;
+    float loss = 0.f;
+    int rtt = 0;
+
+    float targetRate(const Activity& activity) const;
+    float linkFactor() const;
+};
@@ -23,6 +23,8 @@
 #include <game/camera_state.hpp>
 #include <hooks/game_manager.hpp>
 #include <hooks/triggers/gjeffectmanager.hpp>
+#include <net/level_data_snapshot.hpp>
+#include <net/udp_sequencer.hpp>
 #include <util/math.hpp>
 #include <util/debug.hpp>
 #include <util/cocos.hpp>
@@ -300,18 +302,9 @@ void GlobedGJBGL::setupPacketListeners() {
     });
 
     nm.addListener<LevelDataPacket>(this, [this](std::shared_ptr<LevelDataPacket> packet){
-        auto& fields = this->getFields();
-
-        fields.lastServerUpdate = fields.timeCounter;
-        bool firstPacket = util::misc::swapFlag(fields.firstReceivedData);
-
-        for (const auto& player : packet->players) {
-            if (!fields.players.contains(player.accountId)) {
-                // new player joined
-                this->handlePlayerJoin(player.accountId);
-            }
-
-            fields.interpolator->updatePlayer(player.accountId, player.data, fields.lastServerUpdate);
+        // with direct updates the players were already published to the snapshot, and are applied in selUpdate
+        if (!LevelDataSnapshot::get().isActive()) {
+            this->applyPlayerData(packet->players);
         }
 
 #ifdef GLOBED_GP_CHANGES
@@ -323,14 +316,12 @@ void GlobedGJBGL::setupPacketListeners() {
                 );
             }
         }
-
-        if (firstPacket) {
-            fields.lastJoinedPlayer = GJAccountManager::get()->m_accountID;
-            this->updateCountersForCustomItem(globed::ITEM_LAST_JOINED);
-        }
 #endif
     });
 
+    // level data that doesn't need the main thread is picked up in selUpdate instead, if enabled
+    LevelDataSnapshot::get().setActive(GlobedSettings::get().globed.directPlayerUpdates);
+
     nm.addListener<LevelPlayerMetadataPacket>(this, [this](std::shared_ptr<LevelPlayerMetadataPacket> packet) {
         for (const auto& player : packet->players) {
             this->m_fields->playerStore->insertOrUpdate(player.accountId, player.data.attempts, player.data.localBest);
@@ -460,6 +451,11 @@ void GlobedGJBGL::setupMisc() {
         fields.configuredTps = nm.getServerTps();
     }
 
+    if (settings.globed.adaptiveSendRate) {
+        fields.sendRate = std::make_unique<SendRateController>(fields.configuredTps);
+        fields.lastReceivedLevelData = nm.getReceivedLevelData();
+    }
+
     // interpolator
     fields.interpolator = std::make_unique<PlayerInterpolator>(InterpolatorSettings {
         .realtime = false,
@@ -597,10 +593,12 @@ void GlobedGJBGL::selSendPlayerData(float) {
     if (!self->accountForSpeedhack(0, 1.0f / fields.configuredTps, 0.8f)) return;
 
     fields.totalSentPackets++;
-    // additionally, if there are no players on the level, we drop down to 1 time per second as an optimization
-    // or if we are quitting the level
 
-    if ((fields.players.empty() && fields.totalSentPackets % 30 != 15 && fields.pendingCounterChanges.empty()) || fields.quitting) return;
+    if (fields.quitting) return;
+
+    // counter changes can't wait for the next scheduled packet
+    bool shouldSend = self->shouldSendPlayerData();
+    if (!shouldSend && fields.pendingCounterChanges.empty()) return;
 
     auto data = self->gatherPlayerData();
     std::optional<PlayerMetadata> meta;
@@ -608,6 +606,8 @@ void GlobedGJBGL::selSendPlayerData(float) {
         meta = self->gatherPlayerMetadata();
     }
 
+    fields.sentSinceLinkUpdate++;
+
     NetworkManager::get().send(PlayerDataPacket::create(data, meta, std::move(fields.pendingCounterChanges)));
 }
 
@@ -633,7 +633,28 @@ void GlobedGJBGL::selPeriodicalUpdate(float dt) {
     // if (!self->isCurrentPlayLayer()) return;
 
     // update the overlay
-    fields.overlay->updatePing(GameServerManager::get().getActivePing());
+    int ping = GameServerManager::get().getActivePing();
+    auto linkStats = NetworkManager::get().getLinkStats();
+    fields.overlay->updatePing(ping);
+    fields.overlay->updateLinkStats(linkStats);
+
+    // let the send rate controller know how the connection is doing
+    if (fields.sendRate) {
+        uint32_t received = NetworkManager::get().getReceivedLevelData();
+        uint32_t answered = received - fields.lastReceivedLevelData;
+        fields.lastReceivedLevelData = received;
+
+        // the server only answers player data if there is someone else on the level
+        uint32_t sent = fields.players.empty() ? 0 : fields.sentSinceLinkUpdate;
+        fields.sentSinceLinkUpdate = 0;
+
+        if (linkStats.active) {
+            // measured from sequence numbers. player data gets answered, so loss in either direction counts
+            fields.sendRate->updateLink(ping, std::max(linkStats.upstreamLoss, linkStats.downstreamLoss));
+        } else {
+            fields.sendRate->updateLink(ping, sent, answered);
+        }
+    }
 
     auto& pcm = ProfileCacheManager::get();
 
@@ -733,6 +754,10 @@ void GlobedGJBGL::selUpdate(float timescaledDt) {
 
     fields.timeCounter += dt;
 
+    if (auto snapshot = LevelDataSnapshot::get().takeLatest()) {
+        self->applyPlayerData(snapshot->players);
+    }
+
     fields.interpolator->tick(dt);
 
     if (auto pl = PlayLayer::get()) {
@@ -937,6 +962,21 @@ PlayerData GlobedGJBGL::gatherPlayerData() {
     };
 }
 
+bool GlobedGJBGL::shouldSendPlayerData() {
+    auto& fields = this->getFields();
+
+    if (!fields.sendRate) {
+        // fixed rate, except when there are no players on the level, then we drop down to 1 time per second as an optimization
+        return !fields.players.empty() || fields.totalSentPackets % 30 == 15;
+    }
+
+    SendRateController::Activity activity {
+        .hasPlayers = !fields.players.empty(),
+    };
+
+    return fields.sendRate->shouldSend(activity);
+}
+
 PlayerMetadata GlobedGJBGL::gatherPlayerMetadata() {
     uint32_t localBest;
     if (m_level->isPlatformer()) {
@@ -1011,6 +1051,29 @@ void GlobedGJBGL::notifyDeath() {
     fields.isLastDeathReal = !fields.isFakingDeath;
 }
 
+void GlobedGJBGL::applyPlayerData(std::span<const AssociatedPlayerData> players) {
+    auto& fields = this->getFields();
+
+    fields.lastServerUpdate = fields.timeCounter;
+    bool firstPacket = util::misc::swapFlag(fields.firstReceivedData);
+
+    for (const auto& player : players) {
+        if (!fields.players.contains(player.accountId)) {
+            // new player joined
+            this->handlePlayerJoin(player.accountId);
+        }
+
+        fields.interpolator->updatePlayer(player.accountId, player.data, fields.lastServerUpdate);
+    }
+
+#ifdef GLOBED_GP_CHANGES
+    if (firstPacket) {
+        fields.lastJoinedPlayer = GJAccountManager::get()->m_accountID;
+        this->updateCountersForCustomItem(globed::ITEM_LAST_JOINED);
+    }
+#endif
+}
+
 void GlobedGJBGL::handlePlayerJoin(int playerId) {
     auto& settings = GlobedSettings::get();
     auto& fields = this->getFields();
@@ -1155,6 +1218,8 @@ void GlobedGJBGL::onQuitActions() {
 
     m_fields->quitting = true;
 
+    LevelDataSnapshot::get().setActive(false);
+
     if (m_fields->globedReady) {
         if (nm.established()) {
             // send LevelLeavePacket
@@ -1,11 +1,15 @@
 #pragma once
 #include <defs/geode.hpp>
 
+#include <span>
+
 #include <Geode/modify/GJBaseGameLayer.hpp>
 
+#include <data/types/gd.hpp>
 #include <data/types/room.hpp>
 #include <game/interpolator.hpp>
 #include <game/player_store.hpp>
+#include <game/send_rate.hpp>
 #include <game/module/base.hpp>
 #include <managers/hook.hpp>
 #include <net/manager.hpp>
@@ -37,6 +41,11 @@ struct GLOBED_DLL GlobedGJBGL : geode::Modify<GlobedGJBGL, GJBaseGameLayer> {
         std::unique_ptr<PlayerStore> playerStore;
         RoomSettings roomSettings;
 
+        // adaptive send rate, null if it's disabled
+        std::unique_ptr<SendRateController> sendRate;
+        uint32_t sentSinceLinkUpdate = 0;
+        uint32_t lastReceivedLevelData = 0;
+
         std::vector<std::unique_ptr<BaseGameplayModule>> modules;
 
         bool isManuallyResettingLevel = false;
@@ -127,7 +136,7 @@ struct GLOBED_DLL GlobedGJBGL : geode::Modify<GlobedGJBGL, GJBaseGameLayer> {
 
     /* selectors */
 
-    // selSendPlayerData - runs tps (default 30) times per second
+    // selSendPlayerData - runs tps (default 30) times per second, but only sends as often as `shouldSendPlayerData` allows
     void selSendPlayerData(float);
 
     // selSendPlayerMetadata - runs every 5 seconds
@@ -148,12 +157,18 @@ struct GLOBED_DLL GlobedGJBGL : geode::Modify<GlobedGJBGL, GJBaseGameLayer> {
     PlayerData gatherPlayerData();
     PlayerMetadata gatherPlayerMetadata();
 
+    // Called on every tick of `selSendPlayerData`, asks the send rate controller whether it's time to send
+    bool shouldSendPlayerData();
+
     static cocos2d::CCPoint getCameraDirectionVector();
     static float getCameraDirectionAngle();
 
     bool shouldLetMessageThrough(int playerId);
     void updateProximityVolume(int playerId);
 
+    // Apply the players from a level data packet (or a snapshot of one)
+    void applyPlayerData(std::span<const AssociatedPlayerData> players);
+
     void handlePlayerJoin(int playerId);
     void handlePlayerLeave(int playerId);
 
@@ -1,5 +1,7 @@
 #include "game_server.hpp"
 
+#include <algorithm>
+
 #include <util/net.hpp>
 #include <util/rng.hpp>
 #include <util/collections.hpp>
@@ -9,6 +11,14 @@
 using namespace geode::prelude;
 using namespace asp::time;
 
+// another server only takes over as the best one if it's faster by at least this much, so the list doesn't keep jumping around
+constexpr int BEST_SERVER_MARGIN_MS = 10;
+
+// an unstable connection hurts more than a slightly longer one
+static int rankScore(const GameServer& server) {
+    return server.ping + server.jitter * 2;
+}
+
 GameServerManager::GameServerManager() {
     this->updateCache(Mod::get()->getSavedValue<std::string>(SERVER_RESPONSE_CACHE_KEY));
 }
@@ -23,6 +33,7 @@ Result<bool> GameServerManager::addOrUpdateServer(std::string_view serverId_, st
     auto serverId = std::string(serverId_);
 
     int ping = -1;
+    int jitter = 0;
     uint16_t playerCount = 0;
 
     auto data = _data.lock();
@@ -30,6 +41,7 @@ Result<bool> GameServerManager::addOrUpdateServer(std::string_view serverId_, st
         auto& server = data->servers.at(serverId).server;
 
         ping = server.ping;
+        jitter = server.jitter;
         playerCount = server.playerCount;
 
         // check if the server changed
@@ -49,6 +61,7 @@ Result<bool> GameServerManager::addOrUpdateServer(std::string_view serverId_, st
         .region = std::string(region),
         .address = std::string(address),
         .ping = ping,
+        .jitter = jitter,
         .playerCount = playerCount,
     };
 
@@ -62,7 +75,9 @@ Result<bool> GameServerManager::addOrUpdateServer(std::string_view serverId_, st
 }
 
 void GameServerManager::clear() {
-    _data.lock()->servers.clear();
+    auto data = _data.lock();
+    data->servers.clear();
+    data->best.clear();
 }
 
 size_t GameServerManager::count() {
@@ -131,6 +146,32 @@ std::unordered_map<std::string, GameServer> GameServerManager::getAllServers() {
     return out;
 }
 
+std::vector<GameServer> GameServerManager::getRankedServers() {
+    auto data = _data.lock();
+
+    std::vector<GameServer> out;
+    out.reserve(data->servers.size());
+
+    for (const auto& [_, gsd] : data->servers) {
+        out.push_back(gsd.server);
+    }
+
+    // the best server always comes first, even if another one is slightly faster right now
+    std::sort(out.begin(), out.end(), [&best = data->best](const GameServer& a, const GameServer& b) {
+        if ((a.id == best) != (b.id == best)) return a.id == best;
+        if ((a.ping == -1) != (b.ping == -1)) return b.ping == -1;
+        if (a.ping != -1 && rankScore(a) != rankScore(b)) return rankScore(a) < rankScore(b);
+
+        return a.name < b.name;
+    });
+
+    return out;
+}
+
+std::string GameServerManager::getBestId() {
+    return _data.lock()->best;
+}
+
 int GameServerManager::getActivePing() {
     auto server = this->getActiveServer();
     GLOBED_REQUIRE(server.has_value(), "tried to request ping of the active server when not connected to any")
@@ -253,6 +294,53 @@ void GameServerManager::finishPing(uint32_t pingId, uint32_t playerCount) {
     }
 }
 
+void GameServerManager::updatePing(std::string_view serverId, const PingStats& stats) {
+    auto data = _data.lock();
+
+    auto it = data->servers.find(std::string(serverId));
+    if (it == data->servers.end()) return;
+
+    auto& server = it->second.server;
+    server.ping = stats.median;
+    server.jitter = stats.jitter;
+
+    if (stats.received > 0) {
+        server.playerCount = stats.playerCount;
+    }
+
+    this->updateBest(*data);
+}
+
+void GameServerManager::updateBest(InnerData& data) {
+    const GameServer* current = nullptr;
+    const GameServer* fastest = nullptr;
+
+    for (const auto& [id, gsd] : data.servers) {
+        if (gsd.server.ping == -1) continue;
+
+        if (id == data.best) {
+            current = &gsd.server;
+        }
+
+        if (!fastest || rankScore(gsd.server) < rankScore(*fastest)) {
+            fastest = &gsd.server;
+        }
+    }
+
+    std::string best = data.best;
+
+    if (!fastest) {
+        best.clear();
+    } else if (!current || rankScore(*fastest) + BEST_SERVER_MARGIN_MS < rankScore(*current)) {
+        best = fastest->id;
+    }
+
+    if (best != data.best) {
+        data.best = std::move(best);
+        rankingChanged = true;
+    }
+}
+
 void GameServerManager::startKeepalive() {
     std::string active = _data.lock()->active;
 
@@ -9,6 +9,8 @@
 
 #include <asp/time/SystemTime.hpp>
 
+#include <net/ping_stats.hpp>
+
 struct GameServer {
     std::string id;
     std::string name;
@@ -16,6 +18,7 @@ struct GameServer {
     std::string address;
 
     int ping;
+    int jitter;
     uint32_t playerCount;
 };
 
@@ -32,6 +35,8 @@ public:
     constexpr static const char* SERVER_RESPONSE_CACHE_KEY = "_last-cached-servers-response";
 
     asp::AtomicBool pendingChanges;
+    // set whenever a different server becomes the best one, the server list should be sorted again
+    asp::AtomicBool rankingChanged;
 
     // Returns true if a new server has been added, otherwise false.
     Result<> addServer(std::string_view serverId, std::string_view name, std::string_view address, std::string_view region);
@@ -51,6 +56,11 @@ public:
     std::optional<GameServer> getServer(std::string_view id);
     std::unordered_map<std::string, GameServer> getAllServers();
 
+    // All servers from the best to the worst, the ones that never answered a ping come last
+    std::vector<GameServer> getRankedServers();
+    // The server with the lowest latency, empty if none of them answered a ping yet
+    std::string getBestId();
+
     // return ping on the active server
     int getActivePing();
 
@@ -70,6 +80,9 @@ public:
     uint32_t startPing(std::string_view serverId);
     void finishPing(uint32_t pingId, uint32_t playerCount);
 
+    // Store the result of a ping round from `ServerPinger`
+    void updatePing(std::string_view serverId, const PingStats& stats);
+
     void startKeepalive();
     void finishKeepalive(uint32_t playerCount);
 
@@ -84,8 +97,11 @@ protected:
         std::unordered_map<std::string, GameServerData> servers;
         std::string active; // current game server ID
         uint32_t activePingId;
+        std::string best;
         std::string cachedServerResponse;
     };
 
     asp::Mutex<InnerData> _data;
+
+    void updateBest(InnerData& data);
 };
\ No newline at end of file
@@ -90,6 +90,7 @@ void GlobedSettings::reload() {
     lf("globed-tracing", _launchArgs.tracing);
     lf("globed-no-ssl-verification", _launchArgs.noSslVerification);
     lf("globed-fake-server-data", _launchArgs.fakeData);
+    _launchArgs.netImpairment = Loader::get()->getLaunchArgument("globed-net-impairment").value_or("");
 
     // some of those options will do nothing unless the mod is built in debug mode
 #ifndef GLOBED_DEBUG
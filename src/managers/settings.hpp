@@ -154,6 +154,8 @@ public:
         Setting<bool, true> useDiscordRPC;
         Setting<bool, true> changelogPopups;
         Setting<bool, false> editorChanges;
+        Setting<bool, false> directPlayerUpdates;
+        Setting<bool, false> adaptiveSendRate;
 
         // hidden settings! no settings ui for them
 
@@ -245,6 +247,7 @@ private:
         bool tracing = false;
         bool noSslVerification = false;
         bool fakeData = false;
+        std::string netImpairment; // see `ImpairmentConfig::parse`
     } _launchArgs;
 public:
 
@@ -309,7 +312,7 @@ public:
 /* Enable reflection */
 
 GLOBED_SERIALIZABLE_STRUCT(GlobedSettings::Globed, (
-    autoconnect, tpsCap, preloadAssets, deferPreloadAssets, invitesFrom, editorSupport, increaseLevelList, fragmentationLimit, compressedPlayerCount, useDiscordRPC, editorChanges, changelogPopups, pinnedLevelCollapsed,
+    autoconnect, tpsCap, preloadAssets, deferPreloadAssets, invitesFrom, editorSupport, increaseLevelList, fragmentationLimit, compressedPlayerCount, useDiscordRPC, editorChanges, changelogPopups, directPlayerUpdates, adaptiveSendRate, pinnedLevelCollapsed,
     isInvisible, noInvites, hideInGame, hideRoles
 ));
 
@@ -4,11 +4,152 @@
 # include <WS2tcpip.h>
 #else
 # include <netinet/in.h>
+# include <arpa/inet.h>
 #endif
 
+#include "dns_resolver.hpp"
 #include <util/format.hpp>
 #include <util/net.hpp>
 
+using namespace geode::prelude;
+
+/* SocketAddress */
+
+SocketAddress::SocketAddress() {
+    std::memset(&_addr, 0, sizeof(_addr));
+    _addr.v4.sin_family = AF_UNSPEC;
+}
+
+SocketAddress::SocketAddress(const sockaddr_in& addr) : SocketAddress() {
+    _addr.v4 = addr;
+}
+
+SocketAddress::SocketAddress(const sockaddr_in6& addr) : SocketAddress() {
+    _addr.v6 = addr;
+}
+
+SocketAddress SocketAddress::fromSockaddr(const sockaddr* addr, size_t length) {
+    if (addr->sa_family == AF_INET && length >= sizeof(sockaddr_in)) {
+        return SocketAddress(*reinterpret_cast<const sockaddr_in*>(addr));
+    } else if (addr->sa_family == AF_INET6 && length >= sizeof(sockaddr_in6)) {
+        return SocketAddress(*reinterpret_cast<const sockaddr_in6*>(addr));
+    }
+
+    return SocketAddress();
+}
+
+std::optional<SocketAddress> SocketAddress::parseIp(const std::string& ip, uint16_t port) {
+    sockaddr_in v4 = {};
+    if (inet_pton(AF_INET, ip.c_str(), &v4.sin_addr) > 0) {
+        v4.sin_family = AF_INET;
+        v4.sin_port = util::net::hostToNetworkPort(port);
+        return SocketAddress(v4);
+    }
+
+    sockaddr_in6 v6 = {};
+    if (inet_pton(AF_INET6, ip.c_str(), &v6.sin6_addr) > 0) {
+        v6.sin6_family = AF_INET6;
+        v6.sin6_port = util::net::hostToNetworkPort(port);
+        return SocketAddress(v6);
+    }
+
+    return std::nullopt;
+}
+
+int SocketAddress::family() const {
+    return _addr.v4.sin_family;
+}
+
+bool SocketAddress::isV4() const {
+    return this->family() == AF_INET;
+}
+
+bool SocketAddress::isV6() const {
+    return this->family() == AF_INET6;
+}
+
+uint16_t SocketAddress::port() const {
+    // byteswapping is its own inverse
+    return util::net::hostToNetworkPort(this->isV6() ? _addr.v6.sin6_port : _addr.v4.sin_port);
+}
+
+void SocketAddress::setPort(uint16_t port) {
+    if (this->isV6()) {
+        _addr.v6.sin6_port = util::net::hostToNetworkPort(port);
+    } else {
+        _addr.v4.sin_port = util::net::hostToNetworkPort(port);
+    }
+}
+
+const sockaddr* SocketAddress::sockaddrPtr() const {
+    return reinterpret_cast<const sockaddr*>(&_addr);
+}
+
+sockaddr* SocketAddress::sockaddrPtr() {
+    return reinterpret_cast<sockaddr*>(&_addr);
+}
+
+int SocketAddress::sockaddrLength() const {
+    return this->isV6() ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+}
+
+SocketAddress SocketAddress::toMappedV6() const {
+    if (!this->isV4()) {
+        return *this;
+    }
+
+    sockaddr_in6 out = {};
+    out.sin6_family = AF_INET6;
+    out.sin6_port = _addr.v4.sin_port;
+
+    auto* bytes = reinterpret_cast<uint8_t*>(&out.sin6_addr);
+    bytes[10] = 0xff;
+    bytes[11] = 0xff;
+    std::memcpy(bytes + 12, &_addr.v4.sin_addr, 4);
+
+    return SocketAddress(out);
+}
+
+std::string SocketAddress::toString() const {
+    if (this->isV6()) {
+        return fmt::format("[{}]:{}", this->ipString(), this->port());
+    }
+
+    return fmt::format("{}:{}", this->ipString(), this->port());
+}
+
+std::string SocketAddress::ipString() const {
+    char buf[INET6_ADDRSTRLEN] = {};
+
+    const char* result;
+    if (this->isV6()) {
+        result = inet_ntop(AF_INET6, &_addr.v6.sin6_addr, buf, sizeof(buf));
+    } else if (this->isV4()) {
+        result = inet_ntop(AF_INET, &_addr.v4.sin_addr, buf, sizeof(buf));
+    } else {
+        return "<unspecified>";
+    }
+
+    return result ? std::string(result) : std::string("<invalid>");
+}
+
+bool SocketAddress::operator==(const SocketAddress& other) const {
+    if (this->family() != other.family()) {
+        return false;
+    }
+
+    if (this->isV6()) {
+        return _addr.v6.sin6_port == other._addr.v6.sin6_port
+            && std::memcmp(&_addr.v6.sin6_addr, &other._addr.v6.sin6_addr, sizeof(_addr.v6.sin6_addr)) == 0;
+    } else if (this->isV4()) {
+        return util::net::sameSockaddr(_addr.v4, other._addr.v4);
+    }
+
+    return true;
+}
+
+/* NetworkAddress */
+
 NetworkAddress::NetworkAddress() {
     this->set("", DEFAULT_PORT);
 }
@@ -22,8 +163,26 @@ NetworkAddress::NetworkAddress(std::string_view host, uint16_t port) {
 }
 
 void NetworkAddress::set(std::string_view address) {
-    auto colon = address.find(':');
-    if (colon == std::string::npos) {
+    // [v6]:port or [v6]
+    if (address.starts_with('[')) {
+        auto closing = address.find(']');
+        if (closing != std::string::npos) {
+            auto rest = address.substr(closing + 1);
+            uint16_t port = DEFAULT_PORT;
+
+            if (rest.starts_with(':')) {
+                port = util::format::parse<uint16_t>(rest.substr(1)).value_or(DEFAULT_PORT);
+            }
+
+            this->set(address.substr(1, closing - 1), port);
+            return;
+        }
+    }
+
+    auto colon = address.rfind(':');
+
+    // more than one colon without brackets can only be a bare IPv6 address
+    if (colon == std::string::npos || address.find(':') != colon) {
         this->set(address, DEFAULT_PORT);
     } else {
         uint16_t port = util::format::parse<uint16_t>(address.substr(colon + 1)).value_or(DEFAULT_PORT);
@@ -36,51 +195,89 @@ void NetworkAddress::set(std::string_view host, uint16_t port) {
     this->port = port;
 }
 
+const std::string& NetworkAddress::getHost() const {
+    return host;
+}
+
+uint16_t NetworkAddress::getPort() const {
+    return port;
+}
+
 std::string NetworkAddress::toString() const {
+    if (host.find(':') != std::string::npos) {
+        return "[" + host + "]:" + std::to_string(port);
+    }
+
     return host + ":" + std::to_string(port);
 }
 
-Result<sockaddr_in> NetworkAddress::resolve() const {
+Result<std::vector<SocketAddress>> NetworkAddress::resolveAll() const {
     if (host.empty()) {
         return Err("empty IP address or domain name, cannot resolve");
     }
 
-    // if it's cached then just use our cache
-    if (dnsCache.contains(host)) {
-        sockaddr_in out;
-        out.sin_family = AF_INET;
-        out.sin_port = util::net::hostToNetworkPort(port);
-        out.sin_addr = dnsCache.at(host);
-        return Ok(out);
+    if (auto ip = SocketAddress::parseIp(host, port)) {
+        return Ok(std::vector{*ip});
+    }
+
+    GLOBED_UNWRAP_INTO(DnsResolver::get().resolve(host), auto addresses);
+
+    for (auto& addr : addresses) {
+        addr.setPort(port);
     }
 
-    // for some reason this must be heap allocated or windows complains
-    auto addr = std::make_unique<sockaddr_in>();
-    addr->sin_family = AF_INET;
+    return Ok(std::move(addresses));
+}
+
+Result<SocketAddress> NetworkAddress::resolve() const {
+    GLOBED_UNWRAP_INTO(this->resolveAll(), auto addresses);
 
-    auto ipResult = util::net::stringToInAddr(host.c_str(), addr->sin_addr);
+    return Ok(addresses.front());
+}
+
+std::optional<Result<std::vector<SocketAddress>>> NetworkAddress::tryResolveAll(std::function<void()> onDone) const {
+    using Out = Result<std::vector<SocketAddress>>;
+
+    if (host.empty()) {
+        return Out(Err("empty IP address or domain name, cannot resolve"));
+    }
 
-    // if this is not a valid IP address, try getaddrinfo
-    if (!ipResult) {
-        GLOBED_UNWRAP(util::net::getaddrinfo(host, *addr));
+    if (auto ip = SocketAddress::parseIp(host, port)) {
+        return Out(Ok(std::vector{*ip}));
     }
 
-    // add to cache
-    dnsCache.emplace(std::make_pair(host, addr->sin_addr));
+    auto result = DnsResolver::get().tryResolve(host, std::move(onDone));
+    if (!result) {
+        return std::nullopt;
+    }
 
-    sockaddr_in copy;
-    std::memcpy(&copy, addr.get(), sizeof(sockaddr_in));
-    copy.sin_family = AF_INET;
-    copy.sin_port = util::net::hostToNetworkPort(port);
-    return Ok(copy);
+    if (result->isErr()) {
+        return Out(Err(std::move(*result).unwrapErr()));
+    }
+
+    auto addresses = std::move(*result).unwrap();
+    for (auto& addr : addresses) {
+        addr.setPort(port);
+    }
+
+    return Out(Ok(std::move(addresses)));
+}
+
+std::optional<Result<SocketAddress>> NetworkAddress::tryResolve(std::function<void()> onDone) const {
+    auto result = this->tryResolveAll(std::move(onDone));
+    if (!result) {
+        return std::nullopt;
+    }
+
+    if (result->isErr()) {
+        return Result<SocketAddress>(Err(std::move(*result).unwrapErr()));
+    }
+
+    return Result<SocketAddress>(Ok(result->unwrap().front()));
 }
 
 Result<std::string> NetworkAddress::resolveToString() const {
-    // resolve to a sockaddr_in first
     GLOBED_UNWRAP_INTO(this->resolve(), auto addr);
 
-    // convert to string
-    GLOBED_UNWRAP_INTO(util::net::inAddrToString(addr.sin_addr), auto ipstr);
-
-    return Ok(std::move(ipstr + ":" + std::to_string(port)));
+    return Ok(addr.toString());
 }
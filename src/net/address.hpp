@@ -1,27 +1,75 @@
 #pragma once
 #include <defs/minimal_geode.hpp>
 
+#include <functional>
+#include <optional>
 #include <string_view>
 #include <string>
+#include <vector>
 
-// for sockaddr_in
+// for sockaddr_in and sockaddr_in6
 #ifdef GEODE_IS_WINDOWS
 # include <WinSock2.h>
+# include <WS2tcpip.h>
 #else
 # include <netinet/in.h>
 #endif
 
+// A resolved IPv4 or IPv6 address and a port
+class SocketAddress {
+public:
+    // Constructs an unspecified address (`family() == AF_UNSPEC`)
+    SocketAddress();
 
-// Represents an IPv4 address and a port
-class NetworkAddress {
-    static inline std::unordered_map<std::string, in_addr> dnsCache;
+    SocketAddress(const sockaddr_in& addr);
+    SocketAddress(const sockaddr_in6& addr);
+
+    // Copies the address out of a `sockaddr` of the given length, returns an unspecified address if the family is not supported
+    static SocketAddress fromSockaddr(const sockaddr* addr, size_t length);
+
+    // Parses an IPv4 or IPv6 address (without brackets or a port), returns `std::nullopt` if `ip` is not an IP address
+    static std::optional<SocketAddress> parseIp(const std::string& ip, uint16_t port);
+
+    int family() const;
+    bool isV4() const;
+    bool isV6() const;
+
+    uint16_t port() const;
+    void setPort(uint16_t port);
+
+    const sockaddr* sockaddrPtr() const;
+    sockaddr* sockaddrPtr();
+
+    // Size of the `sockaddr` that `sockaddrPtr` points to
+    int sockaddrLength() const;
+
+    // Returns the same address as an IPv4-mapped IPv6 address (`::ffff:a.b.c.d`), for use with dual-stack sockets.
+    // IPv6 addresses are returned unchanged.
+    SocketAddress toMappedV6() const;
+
+    // Returns the address in format `ip:port` or `[ip]:port` for IPv6
+    std::string toString() const;
 
+    // Returns only the IP, without the port
+    std::string ipString() const;
+
+    bool operator==(const SocketAddress& other) const;
+
+private:
+    union {
+        sockaddr_in v4;
+        sockaddr_in6 v6;
+    } _addr;
+};
+
+// Represents a host (IP address or a domain name) and a port
+class NetworkAddress {
 public:
     static constexpr uint16_t DEFAULT_PORT = 4202;
 
     NetworkAddress();
 
-    // Parses the given string in format `host:port`
+    // Parses the given string in format `host:port`, IPv6 addresses must be in brackets if a port is given (`[::1]:4202`)
     NetworkAddress(std::string_view address);
 
     // Constructs a `NetworkAddress` from the given host and port
@@ -33,12 +81,26 @@ public:
     void set(std::string_view address);
     void set(std::string_view host, uint16_t port);
 
+    const std::string& getHost() const;
+    uint16_t getPort() const;
+
     // Returns the input in format `host:port`. If the host is a domain name, it is not resolved to an IP address.
     std::string toString() const;
 
-    // Returns a `sockaddr_in` struct corresponding to this `NetworkAddress`.
-    // Note that this might block for DNS lookup if contained host was not an IP address.
-    geode::Result<sockaddr_in> resolve() const;
+    // Returns all the addresses of the host, in the order connections should be attempted in.
+    // Note that this might block for DNS lookup if contained host was not an IP address, and the answer isn't cached.
+    geode::Result<std::vector<SocketAddress>> resolveAll() const;
+
+    // Returns the first address of the host (see `resolveAll`).
+    // Note that this might block for DNS lookup if contained host was not an IP address, and the answer isn't cached.
+    geode::Result<SocketAddress> resolve() const;
+
+    // Like `resolveAll`, but never blocks. If the answer isn't cached yet, a lookup is started in the background and
+    // `std::nullopt` is returned, `onDone` is then invoked on a resolver thread once the lookup finishes.
+    std::optional<geode::Result<std::vector<SocketAddress>>> tryResolveAll(std::function<void()> onDone = {}) const;
+
+    // Like `resolve`, but never blocks (see `tryResolveAll`).
+    std::optional<geode::Result<SocketAddress>> tryResolve(std::function<void()> onDone = {}) const;
 
     // Combination of `resolve` and `toString`, returns the input in format `host:port` but does do DNS resolution.
     // Note that this might block for DNS lookup if contained host was not an IP address.
@@ -47,4 +109,4 @@ public:
 private:
     std::string host;
     uint16_t port;
-};
\ No newline at end of file
+};
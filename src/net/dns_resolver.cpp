@@ -0,0 +1,206 @@
+#include "dns_resolver.hpp"
+
+#include <util/net.hpp>
+
+#ifdef GEODE_IS_WINDOWS
+# include <WS2tcpip.h>
+#else
+# include <sys/socket.h>
+# include <sys/types.h>
+# include <netdb.h>
+#endif
+
+#include <future>
+
+using namespace geode::prelude;
+using namespace asp::time;
+
+DnsResolver::DnsResolver() : _pool(WORKER_COUNT) {}
+
+Result<DnsResolver::Addresses> DnsResolver::resolve(const std::string& host) {
+    auto done = std::make_shared<std::promise<void>>();
+    auto future = done->get_future();
+
+    if (this->startLookup(host, [done] { done->set_value(); })) {
+        future.wait();
+    }
+
+    auto cache = _cache.lock();
+    auto& entry = (*cache)[host];
+
+    if (!entry.error.empty()) {
+        return Err(entry.error);
+    }
+
+    return Ok(entry.addresses);
+}
+
+std::optional<Result<DnsResolver::Addresses>> DnsResolver::tryResolve(const std::string& host, Callback onDone) {
+    auto cache = _cache.lock();
+    auto it = cache->find(host);
+
+    if (it != cache->end() && it->second.hasAnswer) {
+        auto& entry = it->second;
+        bool fresh = Instant::now() < entry.expiresAt;
+
+        if (fresh && !entry.error.empty()) {
+            return Result<Addresses>(Err(entry.error));
+        }
+
+        // a stale answer is still better than making the caller wait, it's refreshed in the background
+        if (!entry.addresses.empty()) {
+            Addresses addresses = entry.addresses;
+            cache.unlock();
+
+            if (!fresh) {
+                this->startLookup(host, {});
+            }
+
+            return Result<Addresses>(Ok(std::move(addresses)));
+        }
+    }
+
+    cache.unlock();
+
+    // no answer, or an expired failure
+    if (!this->startLookup(host, std::move(onDone))) {
+        // someone else finished a lookup in the meantime
+        return this->tryResolve(host);
+    }
+
+    return std::nullopt;
+}
+
+void DnsResolver::prefetch(const std::vector<std::string>& hosts, Callback onDone) {
+    // the last lookup to finish invokes the callback
+    auto remaining = std::make_shared<std::atomic_size_t>(hosts.size() + 1);
+    auto finishOne = [remaining, onDone = std::move(onDone)] {
+        if (remaining->fetch_sub(1) == 1 && onDone) {
+            onDone();
+        }
+    };
+
+    for (auto& host : hosts) {
+        if (!this->startLookup(host, finishOne)) {
+            finishOne();
+        }
+    }
+
+    finishOne();
+}
+
+void DnsResolver::clear() {
+    auto cache = _cache.lock();
+
+    // lookups that are still running have to stay, someone is waiting on them
+    std::erase_if(*cache, [](const auto& pair) { return !pair.second.inFlight; });
+}
+
+bool DnsResolver::startLookup(const std::string& host, Callback onDone) {
+    auto cache = _cache.lock();
+    auto& entry = (*cache)[host];
+
+    if (!entry.inFlight && entry.hasAnswer && Instant::now() < entry.expiresAt) {
+        return false;
+    }
+
+    if (onDone) {
+        entry.waiters.push_back(std::move(onDone));
+    }
+
+    if (entry.inFlight) {
+        return true;
+    }
+
+    entry.inFlight = true;
+    cache.unlock();
+
+    _pool.pushTask([this, host] {
+        this->runLookup(host);
+    });
+
+    return true;
+}
+
+void DnsResolver::runLookup(const std::string& host) {
+    auto result = lookup(host);
+
+    std::vector<Callback> waiters;
+
+    {
+        auto cache = _cache.lock();
+        auto& entry = (*cache)[host];
+
+        if (result) {
+            entry.addresses = std::move(result).unwrap();
+            entry.error.clear();
+            entry.expiresAt = Instant::now() + POSITIVE_TTL;
+        } else {
+            auto error = std::move(result).unwrapErr();
+            log::warn("Failed to resolve {}: {}", host, error);
+
+            entry.addresses.clear();
+            entry.error = std::move(error);
+            entry.expiresAt = Instant::now() + NEGATIVE_TTL;
+        }
+
+        entry.hasAnswer = true;
+        entry.inFlight = false;
+        waiters = std::move(entry.waiters);
+        entry.waiters.clear();
+    }
+
+    for (auto& callback : waiters) {
+        callback();
+    }
+}
+
+Result<DnsResolver::Addresses> DnsResolver::lookup(const std::string& host) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM; // otherwise every address is returned once per socket type
+    hints.ai_flags = AI_ADDRCONFIG;  // skip AAAA records if we have no IPv6 connectivity, and vice versa
+
+    struct addrinfo* result;
+
+    int code = ::getaddrinfo(host.c_str(), nullptr, &hints, &result);
+    if (code != 0) {
+        return Err(util::net::lastErrorString(code, true));
+    }
+
+    Addresses v4, v6;
+
+    // getaddrinfo already sorts the addresses by preference (RFC 6724)
+    int firstFamily = result->ai_family;
+
+    for (auto* ai = result; ai; ai = ai->ai_next) {
+        auto addr = SocketAddress::fromSockaddr(ai->ai_addr, ai->ai_addrlen);
+        auto& list = addr.isV6() ? v6 : v4;
+
+        if (addr.family() == AF_UNSPEC || std::find(list.begin(), list.end(), addr) != list.end()) {
+            continue;
+        }
+
+        list.push_back(addr);
+    }
+
+    ::freeaddrinfo(result);
+
+    if (v4.empty() && v6.empty()) {
+        return Err("no usable addresses found");
+    }
+
+    // interleave the two families, so that if one of them is broken the next attempt is with the other one (RFC 8305)
+    auto& first = firstFamily == AF_INET6 ? v6 : v4;
+    auto& second = firstFamily == AF_INET6 ? v4 : v6;
+
+    Addresses out;
+    out.reserve(v4.size() + v6.size());
+
+    for (size_t i = 0; i < std::max(first.size(), second.size()); i++) {
+        if (i < first.size()) out.push_back(first[i]);
+        if (i < second.size()) out.push_back(second[i]);
+    }
+
+    return Ok(std::move(out));
+}
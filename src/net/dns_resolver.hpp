@@ -0,0 +1,75 @@
+#pragma once
+
+#include "address.hpp"
+
+#include <asp/sync.hpp>
+#include <asp/thread.hpp>
+#include <asp/time/Duration.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <unordered_map>
+
+#include <util/singleton.hpp>
+
+/*
+* DnsResolver - resolves domain names on a pool of worker threads, and caches the answers.
+*
+* `getaddrinfo` doesn't tell us the TTL of the records, so answers are kept for a fixed time instead. After that,
+* `tryResolve` keeps handing out the old answer while a fresh one is looked up in the background,
+* so a slow DNS server never stalls whoever is asking.
+* Lookups are done for both A and AAAA records, and concurrent requests for the same name are merged into one lookup.
+*
+* Thread safe.
+*/
+class DnsResolver : public SingletonBase<DnsResolver> {
+protected:
+    friend class SingletonBase;
+    DnsResolver();
+
+public:
+    using Addresses = std::vector<SocketAddress>;
+    using Callback = std::function<void()>;
+
+    static constexpr size_t WORKER_COUNT = 4;
+    // How long a successful answer is considered fresh
+    static constexpr asp::time::Duration POSITIVE_TTL = asp::time::Duration::fromSecs(300);
+    // How long a failed lookup is remembered, so that unreachable hosts aren't retried over and over
+    static constexpr asp::time::Duration NEGATIVE_TTL = asp::time::Duration::fromSecs(30);
+
+    // Blocking lookup, returns right away if there is a fresh answer in the cache.
+    // The addresses have port 0 and are ordered the way connections should be attempted in.
+    geode::Result<Addresses> resolve(const std::string& host);
+
+    // Non-blocking lookup. If there is no answer in the cache (or it's stale), a lookup is started in the background.
+    // Returns `std::nullopt` only if there is no answer at all yet, in that case `onDone` is invoked on a worker thread
+    // once the lookup finishes.
+    std::optional<geode::Result<Addresses>> tryResolve(const std::string& host, Callback onDone = {});
+
+    // Look up all of the hosts concurrently (except the ones with a fresh answer), `onDone` is invoked once all of them finished.
+    void prefetch(const std::vector<std::string>& hosts, Callback onDone);
+
+    // Forget all the cached answers
+    void clear();
+
+private:
+    struct Entry {
+        Addresses addresses;
+        std::string error;        // empty if the lookup succeeded
+        asp::time::Instant expiresAt = asp::time::Instant::now();
+        bool hasAnswer = false;
+        bool inFlight = false;
+        std::vector<Callback> waiters;
+    };
+
+    asp::Mutex<std::unordered_map<std::string, Entry>> _cache;
+    asp::ThreadPool _pool;
+
+    // Start a lookup for `host` unless one is already running, `onDone` is invoked once it finishes. Returns false
+    // if there already is a fresh answer, in which case `onDone` is not invoked.
+    bool startLookup(const std::string& host, Callback onDone);
+
+    void runLookup(const std::string& host);
+
+    // The actual `getaddrinfo` call
+    static geode::Result<Addresses> lookup(const std::string& host);
+};
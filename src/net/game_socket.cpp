@@ -1,7 +1,11 @@
 #include "game_socket.hpp"
+#include "session_capture.hpp"
+#include "telemetry.hpp"
 
 #include <data/bytebuffer.hpp>
 #include <data/packets/match.hpp>
+#include <data/packets/client/connection.hpp>
+#include <data/packets/server/connection.hpp>
 #include <util/debug.hpp>
 #include <util/net.hpp>
 #include <util/format.hpp>
@@ -16,13 +20,20 @@
 
 constexpr size_t DATA_BUF_SIZE = 2 << 18;
 
+// the UDP receive buffer is split into this many slots, one per datagram
+constexpr size_t UDP_BATCH_SIZE = 8;
+constexpr size_t UDP_SLOT_SIZE = DATA_BUF_SIZE / UDP_BATCH_SIZE;
+
+// packets that are guaranteed to fit in this many bytes are encoded into a stack buffer
+constexpr size_t FIXED_ENCODE_BUF_SIZE = 2048;
+
 using namespace util::data;
 using namespace util::debug;
 using namespace asp::time;
 using PollResult = GameSocket::PollResult;
 using ReceivedPacket = GameSocket::ReceivedPacket;
 
-GameSocket::GameSocket() {
+GameSocket::GameSocket() : tcpReader(DATA_BUF_SIZE) {
     dataBuffer = new byte[DATA_BUF_SIZE];
 }
 
@@ -30,72 +41,133 @@ GameSocket::~GameSocket() {
     delete[] dataBuffer;
 }
 
-Result<> GameSocket::connect(const NetworkAddress& address, bool isRecovering) {
-#ifdef GLOBED_DEBUG
-    auto r = address.resolveToString();
-    std::string resolved = "<unresolved>";
-    if (r) {
-        resolved = r.unwrap();
-    } else {
-        resolved = fmt::format("<unresolved>: {}", r.unwrapErr());
-    }
+Result<> GameSocket::startConnect(const std::vector<SocketAddress>& addresses, ConnectKind kind) {
+    tcpReader.clear();
+    connectKind = kind;
 
-    log::debug("Connecting to {} (resolved to {})", address.toString(), resolved);
-#endif
+    return tcpSocket.startConnect(addresses);
+}
+
+Result<bool> GameSocket::continueConnect() {
+    GLOBED_UNWRAP_INTO(tcpSocket.continueConnect(), bool done);
+    if (!done) return Ok(false);
 
-    GLOBED_UNWRAP(tcpSocket.connect(address))
-    GLOBED_UNWRAP(udpSocket.connect(address))
+    // the host might have multiple addresses, use the one that the tcp connection went to
+    GLOBED_UNWRAP(udpSocket.connect(tcpSocket.peerAddress()))
+
+    log::debug("Connected to {}", tcpSocket.peerAddress().toString());
+
+    // send a magic byte telling the server whether we are logging in, recovering or resuming
+    uint8_t byte = MARKER_CONN_INITIAL;
+    if (connectKind == ConnectKind::Recovery) {
+        byte = MARKER_CONN_RECOVERY;
+    } else if (connectKind == ConnectKind::Resumption) {
+        byte = MARKER_CONN_RESUMPTION;
+    }
 
-    // send a magic byte telling the server whether we are recovering or not
-    uint8_t byte = isRecovering ? MARKER_CONN_RECOVERY : MARKER_CONN_INITIAL;
     GLOBED_UNWRAP(tcpSocket.send(reinterpret_cast<const char*>(&byte), 1));
 
-    return Ok();
+    return Ok(true);
+}
+
+bool GameSocket::isConnecting() const {
+    return tcpSocket.isConnecting();
+}
+
+std::optional<Duration> GameSocket::untilConnectStep() const {
+    return tcpSocket.untilConnectStep();
 }
 
 void GameSocket::disconnect() {
+    auto& frameStats = udpBuffer.stats();
+    log::debug("UDP reassembly: {} packets completed, {} evicted, {} duplicate frames", frameStats.completed, frameStats.evictions, frameStats.duplicates);
+
     tcpSocket.disconnect();
     udpSocket.disconnect();
+    tcpReader.clear();
     udpBuffer.clear();
+    udpQueue.clear();
+
+    bundle.entries.clear();
+    bundle.first.reset();
+    bundling = false;
+
+    udpSequencer.reset();
+
+    if (impairment) {
+        impairment->clear();
+    }
+}
+
+void GameSocket::disconnectTcp() {
+    tcpSocket.disconnect();
+    tcpReader.clear();
 }
 
 bool GameSocket::isConnected() {
     return tcpSocket.connected;
 }
 
-Result<std::shared_ptr<Packet>> GameSocket::recvPacketTCP() {
-    ByteBuffer bb;
-    bb.grow(4);
+Result<std::optional<std::shared_ptr<Packet>>> GameSocket::recvPacketTCP() {
+    // only touch the socket if there isn't a full packet buffered from the last read already
+    if (!tcpReader.hasFrame()) {
+        GLOBED_UNWRAP(tcpReader.fill(tcpSocket));
+    }
 
-    // receive the packet length
-    GLOBED_UNWRAP(tcpSocket.recvExact(reinterpret_cast<char*>(bb.data().data()), 4));
+    GLOBED_UNWRAP_INTO(tcpReader.nextFrame(), auto frame);
+    if (!frame) {
+        return Ok(std::nullopt);
+    }
 
-    auto packetSize = bb.readU32().unwrapOr(0); // must always be 4 bytes so cant error
-    GLOBED_REQUIRE_SAFE(packetSize < DATA_BUF_SIZE, "packet is too big, rejecting")
+    // decode straight out of the receive buffer, without copying it
+    auto buf = ByteBuffer::borrowed(frame->first, frame->second);
 
-    GLOBED_UNWRAP(tcpSocket.recvExact(reinterpret_cast<char*>(dataBuffer), packetSize));
+    GLOBED_UNWRAP_INTO(this->decodePacket(buf), auto packet);
+    return Ok(std::move(packet));
+}
 
-    ByteBuffer buf(dataBuffer, packetSize);
+Result<size_t> GameSocket::recvPacketsUDP() {
+    RecvResult results[UDP_BATCH_SIZE];
+    GLOBED_UNWRAP_INTO(udpSocket.receiveBatch(reinterpret_cast<char*>(dataBuffer), UDP_SLOT_SIZE, results, UDP_BATCH_SIZE), size_t received);
 
-    return this->decodePacket(buf);
-}
+    size_t prevQueued = udpQueue.size();
+    std::optional<std::string> firstError;
 
-Result<std::optional<ReceivedPacket>> GameSocket::recvPacketUDP() {
-    auto recvResult = udpSocket.receive(reinterpret_cast<char*>(dataBuffer), DATA_BUF_SIZE);
+    // handle every datagram even if one of them is invalid, so that the valid ones aren't lost
+    for (size_t i = 0; i < received; i++) {
+        byte* data = dataBuffer + i * UDP_SLOT_SIZE;
+        size_t size = (size_t)results[i].result;
 
-    ReceivedPacket out;
-    out.fromConnected = recvResult.fromServer;
+        // it comes out of `releaseImpaired` once it's due
+        if (impairment && results[i].fromServer) {
+            impairment->submit(ImpairDirection::Inbound, data, size, true, this->impairmentNow());
+            continue;
+        }
 
-    if (recvResult.result < 0) {
-        return Err(fmt::format("udp recv failed ({}): {}", recvResult.result, util::net::lastErrorString()));
+        auto result = this->handleDatagram(data, size, results[i].fromServer);
+        if (!result && !firstError) {
+            firstError = std::move(result).unwrapErr();
+        }
     }
 
-    ByteBuffer buf(dataBuffer, (size_t)recvResult.result);
+    if (firstError) {
+        return Err(std::move(*firstError));
+    }
+
+    return Ok(udpQueue.size() - prevQueued);
+}
+
+Result<> GameSocket::handleDatagram(byte* data, size_t size, bool fromConnected) {
+    ReceivedPacket out;
+    out.fromConnected = fromConnected;
+
+    auto buf = ByteBuffer::borrowed(data, size);
 
     // if not from active server, dont't read the marker
     if (!out.fromConnected) {
-        GLOBED_UNWRAP_INTO(this->decodePacket(buf), out.packet);
-        return Ok(std::move(out));
+        GLOBED_UNWRAP_INTO(this->decodePacket(buf, false, CipherStream::Udp), out.packet);
+        udpQueue.push_back(std::move(out));
+        return Ok();
     }
 
     // check if it is a full packet or a frame,
@@ -104,103 +176,331 @@ Result<std::optional<ReceivedPacket>> GameSocket::recvPacketUDP() {
         return Err(fmt::to_string(marker.unwrapErr()));
     }
 
+    // a sequenced datagram is the sequence header followed by one of the others, marker included.
+    // the header is encrypted with the session cipher, so that a spoofed datagram can't feed fake acks into the link stats
+    if (*marker == MARKER_UDP_SEQUENCED) {
+        GLOBED_REQUIRE_SAFE(sessionCipher != nullptr, "received a sequenced datagram without a session cipher")
+
+        constexpr size_t encryptedSize = SessionCipher::PREFIX_LEN + SequenceHeader::SIZE;
+        size_t headerStart = buf.getPosition();
+
+        if (buf.skip(encryptedSize).isErr()) {
+            return Err("sequenced datagram is too short");
+        }
+
+        GLOBED_UNWRAP(sessionCipher->decryptInPlaceUnaligned(CipherStream::Udp, buf.dataPtr() + headerStart, encryptedSize));
+
+        auto headerBuf = ByteBuffer::borrowed(buf.dataPtr() + headerStart + SessionCipher::PREFIX_LEN, SequenceHeader::SIZE);
+        auto header = headerBuf.readValue<SequenceHeader>();
+        if (header.isErr()) {
+            return Err(fmt::to_string(header.unwrapErr()));
+        }
+
+        // only servers that negotiated sequencing over tcp get their headers looked at
+        if (udpSequencer.isActive()) {
+            udpSequencer.onReceived(*header);
+        }
+
+        NetworkTelemetry::get().recordIn(SequencedDatagramPacket::PACKET_ID, SequencedDatagramPacket::PACKET_NAME, sizeof(uint8_t) + encryptedSize);
+
+        marker = buf.readU8();
+        if (marker.isErr()) {
+            return Err(fmt::to_string(marker.unwrapErr()));
+        }
+    }
+
     if (*marker == MARKER_UDP_PACKET) {
-        GLOBED_UNWRAP_INTO(this->decodePacket(buf), out.packet);
+        GLOBED_UNWRAP_INTO(this->decodePacket(buf, false, CipherStream::Udp), out.packet);
     } else if (*marker == MARKER_UDP_FRAME) {
-        GLOBED_UNWRAP_INTO(udpBuffer.pushFrameFromBuffer(buf), auto maybeBuf);
-        if (!maybeBuf.empty()) {
-            ByteBuffer toDecode(std::move(maybeBuf));
-            GLOBED_UNWRAP_INTO(this->decodePacket(toDecode), out.packet);
-        } else {
-            return Ok(std::nullopt);
+        GLOBED_UNWRAP_INTO(udpBuffer.pushFrameFromBuffer(buf), auto completed);
+        if (!completed) {
+            return Ok();
         }
+
+        // decode straight out of the reassembly buffer
+        auto toDecode = ByteBuffer::borrowed(completed->first, completed->second);
+        GLOBED_UNWRAP_INTO(this->decodePacket(toDecode, false, CipherStream::Udp), out.packet);
+    } else if (*marker == MARKER_UDP_BUNDLE) {
+        return this->handleBundle(buf);
     } else {
         return Err("invalid marker at the start of a udp packet");
     }
 
-    return Ok(std::move(out));
+    udpQueue.push_back(std::move(out));
+    return Ok();
 }
 
-Result<ReceivedPacket> GameSocket::recvPacket(int timeoutMs) {
-    // negative value means poll indefinitely until either tcp or udp receives data
-    GLOBED_UNWRAP_INTO(this->poll(timeoutMs), auto pollResult);
+Result<> GameSocket::handleBundle(ByteBuffer& buffer) {
+    auto& telemetry = NetworkTelemetry::get();
+    auto decryptStart = Instant::now();
 
-    if (pollResult == PollResult::None) {
-        return Err("timed out");
-    }
+    size_t start = buffer.getPosition();
+    GLOBED_UNWRAP_INTO(this->decryptPayload(CipherStream::Udp, buffer.dataPtr() + start, buffer.size() - start), auto entries);
 
-    // prioritize TCP, if the result is Tcp or Both, we care about TCP.
-    if (pollResult != PollResult::Udp) {
-        auto res = this->recvPacketTCP();
+    // the entries are counted as their own packets, the bundle only gets the bytes it adds on top of them
+    telemetry.recordTime(PacketBundlePacket::PACKET_ID, PacketBundlePacket::PACKET_NAME, PacketStage::Decrypt, decryptStart.elapsed());
+    telemetry.recordIn(PacketBundlePacket::PACKET_ID, PacketBundlePacket::PACKET_NAME, buffer.size() - start - entries.size());
 
-        if (res) {
-            return Ok(ReceivedPacket {
-                .packet = std::move(std::move(res).unwrap()),
-                .fromConnected = true
-            });
-        } else {
-            return Err(fmt::format("recvPacketTCP failed: {}", res.unwrapErr()));
-        }
-    }
+    std::optional<std::string> firstError;
 
-    // else it's a udp packet
-    auto udpres = this->recvPacketUDP();
+    // same as with batches of datagrams, one bad packet shouldn't take the others down with it
+    while (entries.getPosition() < entries.size()) {
+        auto length = entries.readU16();
+        if (length.isErr()) {
+            return Err(fmt::to_string(length.unwrapErr()));
+        }
 
-    if (udpres && udpres.unwrap().has_value()) {
-        return Ok(std::move(**udpres));
-    } else if (!udpres) {
-        return Err(fmt::format("recvPacketUDP failed: {}", std::move(std::move(udpres).unwrapErr())));
-    }
+        size_t entryStart = entries.getPosition();
+        if (entries.skip(*length).isErr()) {
+            return Err("bundle entry is longer than the bundle itself");
+        }
 
-    // if it was a frame keep trying
-    for (;;) {
-        GLOBED_UNWRAP_INTO(udpSocket.poll(25), auto pollres);
-        if (!pollres) {
-            return Err("timed out");
+        if (*length < PacketHeader::SIZE) {
+            if (!firstError) firstError = "bundle entry is missing the packet header";
+            continue;
         }
 
-        auto udpres = this->recvPacketUDP();
-        if (udpres && udpres.unwrap().has_value()) {
-            return Ok(std::move(**udpres));
-        } else if (!udpres) {
-            return Err(fmt::format("recvPacketUDP failed: {}", std::move(std::move(udpres).unwrapErr())));
+        auto entry = ByteBuffer::borrowed(entries.dataPtr() + entryStart, *length);
+        auto packet = this->decodePacket(entry, true);
+
+        if (!packet) {
+            if (!firstError) firstError = std::move(packet).unwrapErr();
+            continue;
         }
+
+        udpQueue.push_back(ReceivedPacket {
+            .packet = std::move(*packet),
+            .fromConnected = true,
+        });
     }
-}
 
-Result<ReceivedPacket> GameSocket::recvPacket() {
-    return this->recvPacket(-1);
+    if (firstError) {
+        return Err(std::move(*firstError));
+    }
+
+    return Ok();
 }
 
 Result<> GameSocket::sendPacket(std::shared_ptr<Packet> packet) {
     GLOBED_REQUIRE_SAFE(this->isConnected(), "attempting to send a packet while disconnected")
 
+    // bounded packets are encoded on the stack, without any heap allocations
+    if (maxEncodedPacketSize(*packet) <= FIXED_ENCODE_BUF_SIZE) {
+        byte storage[FIXED_ENCODE_BUF_SIZE];
+        auto buf = ByteBuffer::fixed(storage, FIXED_ENCODE_BUF_SIZE);
+        return this->sendPacketWith(*packet, buf);
+    }
+
     ByteBuffer buf;
-    GLOBED_UNWRAP(this->encodePacket(*packet, buf))
+    return this->sendPacketWith(*packet, buf);
+}
 
-    if (dumpPackets) {
-        this->dumpPacket(packet->getPacketId(), buf, true);
+Result<> GameSocket::sendPacketBundled(std::shared_ptr<Packet> packet) {
+    // the bundle is always encrypted, so there is no point in bundling before the handshake
+    if (!bundling || packet->getUseTcp() || !cryptoBox) {
+        return this->sendPacket(std::move(packet));
     }
 
-    if (packet->getUseTcp()) {
-        GLOBED_UNWRAP(tcpSocket.sendAll(reinterpret_cast<const char*>(buf.data().data()), buf.size()));
-    } else {
-        GLOBED_UNWRAP(udpSocket.send(reinterpret_cast<const char*>(buf.data().data()), buf.size()));
+    GLOBED_REQUIRE_SAFE(this->isConnected(), "attempting to send a packet while disconnected")
+
+    return this->appendToBundle(std::move(packet));
+}
+
+Result<> GameSocket::appendToBundle(std::shared_ptr<Packet> packet) {
+    auto& buf = bundle.buffer;
+
+    if (bundle.entries.empty()) {
+        // room for the sequence header, see `sendDatagram`
+        buf.clear();
+        buf.grow(SEQUENCED_PREFIX_SIZE);
+        buf.setPosition(SEQUENCED_PREFIX_SIZE);
+
+        buf.writeValue<PacketHeader>(PacketHeader {
+            .id = PacketBundlePacket::PACKET_ID,
+            .encrypted = true,
+        });
+
+        bundle.startedAt = Instant::now();
+    }
+
+    // encode right into the bundle, prefixed with the length. the packet itself is never encrypted, the whole bundle is.
+    size_t entryStart = buf.getPosition();
+
+    auto encodeStart = Instant::now();
+
+    buf.writeU16(0);
+    buf.writeValue<PacketHeader>(PacketHeader {
+        .id = packet->getPacketId(),
+        .encrypted = false,
+    });
+    packet->encode(buf);
+
+    auto encodeTook = encodeStart.elapsed();
+
+    size_t entryEnd = buf.getPosition();
+    size_t entrySize = entryEnd - entryStart;
+
+    if (entryEnd + this->cipherOverhead() > BUNDLE_BUDGET) {
+        // take the packet back out and send everything that was there before it
+        buf.setPosition(entryStart);
+        buf.resize(entryStart);
+
+        GLOBED_UNWRAP(this->flushBundle());
+
+        if (SEQUENCED_PREFIX_SIZE + PacketHeader::SIZE + entrySize + this->cipherOverhead() > BUNDLE_BUDGET) {
+            // too big to ever be bundled
+            return this->sendPacket(std::move(packet));
+        }
+
+        // starts a new bundle, encoding it a second time is cheaper than keeping a copy of every packet around
+        return this->appendToBundle(std::move(packet));
+    }
+
+    buf.setPosition(entryStart);
+    buf.writeU16(entrySize - sizeof(uint16_t));
+    buf.setPosition(entryEnd);
+
+    bundle.entries.push_back(OutgoingBundle::Entry {
+        .id = packet->getPacketId(),
+        .name = packet->getPacketName(),
+        .start = entryStart,
+        .size = entrySize,
+        .encodeTook = encodeTook,
+    });
+
+    if (bundle.entries.size() == 1) {
+        bundle.first = std::move(packet);
+    }
+
+    return Ok();
+}
+
+Result<> GameSocket::flushBundle() {
+    if (bundle.entries.empty()) {
+        return Ok();
+    }
+
+    auto first = std::move(bundle.first);
+
+    // a bundle of one packet would only add overhead, `sendPacket` records it on its own
+    if (bundle.entries.size() == 1) {
+        bundle.entries.clear();
+        return this->sendPacket(std::move(first));
+    }
+
+    auto& buf = bundle.buffer;
+    auto& telemetry = NetworkTelemetry::get();
+    auto& capture = SessionCapture::get();
+
+    // captured before encryption, like in `encodePacket`
+    for (auto& entry : bundle.entries) {
+        size_t payloadStart = entry.start + sizeof(uint16_t) + PacketHeader::SIZE;
+
+        telemetry.recordTime(entry.id, entry.name, PacketStage::Encode, entry.encodeTook);
+        telemetry.recordOut(entry.id, entry.name, entry.size);
+        capture.record(CaptureDirection::Outbound, entry.id, buf.dataPtr() + payloadStart, entry.start + entry.size - payloadStart);
+    }
+
+    bundle.entries.clear();
+
+    size_t headerEnd = SEQUENCED_PREFIX_SIZE + PacketHeader::SIZE;
+    size_t rawSize = buf.size() - headerEnd;
+    size_t overhead = this->cipherOverhead();
+
+    auto encryptStart = Instant::now();
+
+    buf.grow(overhead);
+    GLOBED_UNWRAP(this->encryptPayload(CipherStream::Udp, buf.dataPtr() + headerEnd, rawSize));
+
+    telemetry.recordTime(PacketBundlePacket::PACKET_ID, PacketBundlePacket::PACKET_NAME, PacketStage::Encrypt, encryptStart.elapsed());
+    telemetry.recordOut(PacketBundlePacket::PACKET_ID, PacketBundlePacket::PACKET_NAME, PacketHeader::SIZE + overhead);
+
+    return this->sendDatagram(buf.dataPtr(), buf.size() - SEQUENCED_PREFIX_SIZE);
+}
+
+Result<> GameSocket::flushBundleIfDue() {
+    if (bundle.entries.empty() || bundle.startedAt.elapsed() < BUNDLE_DEADLINE) {
+        return Ok();
+    }
+
+    return this->flushBundle();
+}
+
+std::optional<Duration> GameSocket::untilBundleFlush() const {
+    if (bundle.entries.empty()) {
+        return std::nullopt;
+    }
+
+    auto elapsed = bundle.startedAt.elapsed();
+    return elapsed >= BUNDLE_DEADLINE ? Duration{} : BUNDLE_DEADLINE - elapsed;
+}
+
+void GameSocket::setBundling(bool enabled) {
+    bundling = enabled;
+}
+
+void GameSocket::setSequencing(bool enabled) {
+    // the server only encrypts sequence headers with the session cipher, so there is nothing to check them with otherwise
+    if (enabled && sessionCipher) {
+        udpSequencer.enable();
+    }
+}
+
+Result<> GameSocket::sendPacketWith(Packet& packet, ByteBuffer& buf) {
+    if (packet.getUseTcp()) {
+        GLOBED_UNWRAP(this->encodePacket(packet, buf))
+        GLOBED_UNWRAP(tcpSocket.sendAll(reinterpret_cast<const char*>(buf.dataPtr()), buf.size()));
+        return Ok();
+    }
+
+    // room for the sequence header, see `sendDatagram`
+    buf.grow(SEQUENCED_PREFIX_SIZE);
+    buf.setPosition(SEQUENCED_PREFIX_SIZE);
+
+    GLOBED_UNWRAP(this->encodePacket(packet, buf))
+
+    return this->sendDatagram(buf.dataPtr(), buf.size() - SEQUENCED_PREFIX_SIZE);
+}
+
+Result<> GameSocket::sendDatagram(byte* data, size_t size) {
+    if (!udpSequencer.isActive()) {
+        return this->sendRawDatagram(data + SEQUENCED_PREFIX_SIZE, size);
     }
 
+    auto header = udpSequencer.nextHeader();
+
+    auto prefix = ByteBuffer::fixed(data, SEQUENCED_PREFIX_SIZE);
+    prefix.writeValue<PacketHeader>(PacketHeader {
+        .id = SequencedDatagramPacket::PACKET_ID,
+        .encrypted = false,
+    });
+    prefix.writeValue<SequenceHeader>(header);
+
+    GLOBED_UNWRAP(this->sendRawDatagram(data, SEQUENCED_PREFIX_SIZE + size));
+
+    // only now the sequence number is used up, so that a failed send doesn't look like loss
+    udpSequencer.onSent(header);
+    NetworkTelemetry::get().recordOut(SequencedDatagramPacket::PACKET_ID, SequencedDatagramPacket::PACKET_NAME, SEQUENCED_PREFIX_SIZE);
+
     return Ok();
 }
 
-Result<> GameSocket::sendPacketTo(std::shared_ptr<Packet> packet, const NetworkAddress& address) {
+Result<> GameSocket::sendRawDatagram(const byte* data, size_t size) {
+    if (impairment) {
+        impairment->submit(ImpairDirection::Outbound, data, size, true, this->impairmentNow());
+        return Ok();
+    }
+
+    GLOBED_UNWRAP(udpSocket.send(reinterpret_cast<const char*>(data), size));
+    return Ok();
+}
+
+Result<> GameSocket::sendPacketTo(std::shared_ptr<Packet> packet, const SocketAddress& address) {
     GLOBED_REQUIRE_SAFE(!packet->getUseTcp(), "cannot send a TCP packet to a UDP connection")
 
     ByteBuffer buf;
     GLOBED_UNWRAP(this->encodePacket(*packet, buf))
 
-    if (dumpPackets) {
-        this->dumpPacket(packet->getPacketId(), buf, true);
-    }
-
     GLOBED_UNWRAP_INTO(udpSocket.sendTo(reinterpret_cast<const char*>(buf.data().data()), buf.size(), address), auto res)
 
     GLOBED_REQUIRE_SAFE(
@@ -219,39 +519,127 @@ Result<> GameSocket::sendRecoveryData(int accountId, uint32_t secretKey) {
     return tcpSocket.sendAll(reinterpret_cast<const char*>(bb.data().data()), bb.size());
 }
 
+Result<> GameSocket::sendResumptionData(int accountId) {
+    GLOBED_REQUIRE_SAFE(this->canResume(), "no session to resume")
+
+    byte storage[sizeof(int32_t) + RESUME_TICKET_LEN + SessionCipher::PREFIX_LEN + RESUME_TICKET_LEN];
+    auto buf = ByteBuffer::fixed(storage, sizeof(storage));
+
+    buf.writeI32(accountId);
+    buf.writeValue(*resumeTicket);
+
+    // the ticket once more, encrypted. the server only resumes if it can decrypt it with the keys of the session.
+    size_t proofStart = buf.getPosition();
+    buf.writeValue(*resumeTicket);
+    buf.grow(SessionCipher::PREFIX_LEN);
+    GLOBED_UNWRAP(sessionCipher->encryptInPlace(CipherStream::Tcp, buf.dataPtr() + proofStart, RESUME_TICKET_LEN));
+
+    return tcpSocket.sendAll(reinterpret_cast<const char*>(buf.dataPtr()), buf.size());
+}
+
+bool GameSocket::canResume() const {
+    return sessionCipher && resumeTicket;
+}
+
+void GameSocket::setResumeTicket(const bytearray<RESUME_TICKET_LEN>& ticket) {
+    resumeTicket = ticket;
+}
+
 void GameSocket::cleanupBox() {
     cryptoBox = std::unique_ptr<CryptoBox>(nullptr);
+    sessionCipher = std::unique_ptr<SessionCipher>(nullptr);
+    resumeTicket.reset();
 }
 
 void GameSocket::createBox() {
+    this->cleanupBox();
     cryptoBox = std::make_unique<CryptoBox>();
 }
 
-void GameSocket::togglePacketLogging(bool state) {
-    dumpPackets = state;
+LinkStats GameSocket::getLinkStats() const {
+    return udpSequencer.getStats();
 }
 
-Result<PollResult> GameSocket::poll(int timeoutMs) {
-    if (!tcpSocket.connected) {
-        GLOBED_UNWRAP_INTO(udpSocket.poll(timeoutMs), auto res);
-        return Ok(res ? PollResult::Udp : PollResult::None);
+void GameSocket::installSessionKeys(const bytearray<SessionCipher::KEY_LEN>& sendKey, const bytearray<SessionCipher::KEY_LEN>& recvKey) {
+    sessionCipher = std::make_unique<SessionCipher>(sendKey, recvKey);
+}
+
+size_t GameSocket::cipherOverhead() const {
+    return sessionCipher ? SessionCipher::PREFIX_LEN : CryptoBox::PREFIX_LEN;
+}
+
+Result<> GameSocket::encryptPayload(CipherStream stream, byte* data, size_t size) {
+    if (sessionCipher) {
+        GLOBED_UNWRAP(sessionCipher->encryptInPlace(stream, data, size));
+        return Ok();
     }
 
-    GLOBED_SOCKET_POLLFD fds[2];
+    GLOBED_REQUIRE_SAFE(cryptoBox.get() != nullptr, "attempted to encrypt a packet when no cryptobox is initialized")
+
+    cryptoBox->encryptInPlace(data, size);
+    return Ok();
+}
+
+Result<ByteBuffer> GameSocket::decryptPayload(CipherStream stream, byte* data, size_t size) {
+    if (sessionCipher) {
+        auto result = sessionCipher->decryptInPlaceUnaligned(stream, data, size);
+        if (result) {
+            return Ok(ByteBuffer::borrowed(data + SessionCipher::PREFIX_LEN, *result));
+        }
 
-    fds[0].fd = tcpSocket.socket_;
+        // until the server has sent anything with the session cipher, packets encrypted with the box may still be in flight
+        if (sessionCipher->isConfirmed()) {
+            return Err(std::move(result).unwrapErr());
+        }
+    }
+
+    GLOBED_REQUIRE_SAFE(cryptoBox.get() != nullptr, "attempted to decrypt a packet when no cryptobox is initialized")
+
+    // the plaintext ends up right after the nonce, so instead of moving it back we just point the view at it
+    GLOBED_UNWRAP_INTO(cryptoBox->decryptInPlaceUnaligned(data, size), size_t plainLength);
+    return Ok(ByteBuffer::borrowed(data + CryptoBox::nonceLength(), plainLength));
+}
+
+Result<PollResult> GameSocket::poll(int timeoutMs) {
+    GLOBED_SOCKET_POLLFD fds[2 + TcpSocket::MAX_PENDING_ATTEMPTS];
+
+    fds[0].fd = waker.handle();
     fds[0].events = POLLIN;
     fds[1].fd = udpSocket.socket_;
     fds[1].events = POLLIN;
 
-    int result = GLOBED_SOCKET_POLL(fds, 2, timeoutMs);
+    size_t count = 2;
+    bool tcpConnected = tcpSocket.connected;
+
+    if (tcpConnected) {
+        fds[count].fd = tcpSocket.socket_;
+        fds[count].events = POLLIN;
+        count++;
+    } else {
+        // connection attempts in progress wake us up once they connect or fail, then `continueConnect` picks them up
+        for (auto sock : tcpSocket.pendingAttempts()) {
+            fds[count].fd = sock;
+            fds[count].events = POLLOUT;
+            count++;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        fds[i].revents = 0;
+    }
+
+    int result = GLOBED_SOCKET_POLL(fds, count, timeoutMs);
 
     if (result == -1) {
         return Err(util::net::lastErrorString());
     }
 
-    bool tcp = fds[0].revents & POLLIN;
+    if (fds[0].revents & POLLIN) {
+        waker.drain();
+    }
+
     bool udp = fds[1].revents & POLLIN;
+    bool tcp = tcpConnected && (fds[2].revents & POLLIN);
 
     if (tcp && udp) {
         return Ok(PollResult::Both);
@@ -264,6 +652,150 @@ Result<PollResult> GameSocket::poll(int timeoutMs) {
     }
 }
 
+void GameSocket::wake() {
+    waker.wake();
+}
+
+void GameSocket::waitForWakeup(int timeoutMs) {
+    GLOBED_SOCKET_POLLFD fds[1];
+
+    fds[0].fd = waker.handle();
+    fds[0].events = POLLIN;
+
+    if (GLOBED_SOCKET_POLL(fds, 1, timeoutMs) > 0 && (fds[0].revents & POLLIN)) {
+        waker.drain();
+    }
+}
+
+Result<> GameSocket::recvReady(PollResult ready, std::vector<ReceivedPacket>& out) {
+    if (ready == PollResult::Tcp || ready == PollResult::Both) {
+        // one read, and then everything that came with it
+        do {
+            auto packet = this->recvPacketTCP();
+            if (!packet) {
+                return Err(fmt::format("recvPacketTCP failed: {}", std::move(packet).unwrapErr()));
+            }
+
+            if (!packet.unwrap().has_value()) break;
+
+            out.push_back(ReceivedPacket {
+                .packet = std::move(**packet),
+                .fromConnected = true,
+            });
+        } while (tcpReader.hasFrame());
+    }
+
+    Result<size_t> udpResult = Ok(0);
+    if (ready == PollResult::Udp || ready == PollResult::Both) {
+        udpResult = this->recvPacketsUDP();
+    }
+
+    // held back datagrams are due whenever they are due, not when the socket has data
+    auto impairedResult = this->releaseImpaired();
+
+    while (!udpQueue.empty()) {
+        out.push_back(std::move(udpQueue.front()));
+        udpQueue.pop_front();
+    }
+
+    if (!udpResult) {
+        return Err(fmt::format("recvPacketsUDP failed: {}", std::move(udpResult).unwrapErr()));
+    }
+
+    if (!impairedResult) {
+        return Err(fmt::format("releaseImpaired failed: {}", std::move(impairedResult).unwrapErr()));
+    }
+
+    return Ok();
+}
+
+void GameSocket::setImpairment(const std::optional<ImpairmentConfig>& config) {
+    if (impairment) {
+        auto& stats = impairment->stats();
+        log::debug(
+            "Impairment ({}): {} datagrams, {} dropped, {} duplicated, {} reordered",
+            impairment->config().toString(), stats.submitted, stats.dropped, stats.duplicated, stats.reordered
+        );
+    }
+
+    // anything still held back is lost, just like it would be when the connection changes
+    if (config && config->isActive()) {
+        impairment = std::make_unique<NetworkImpairment>(*config);
+        impairmentEpoch = Instant::now();
+    } else {
+        impairment.reset();
+    }
+}
+
+bool GameSocket::isImpaired() const {
+    return impairment != nullptr;
+}
+
+std::optional<Duration> GameSocket::untilImpairmentDue() const {
+    if (!impairment) return std::nullopt;
+
+    auto micros = impairment->untilNext(this->impairmentNow());
+    if (!micros) return std::nullopt;
+
+    return Duration::fromMicros(*micros);
+}
+
+uint64_t GameSocket::impairmentNow() const {
+    return impairmentEpoch.elapsed().micros();
+}
+
+Result<> GameSocket::releaseImpaired() {
+    if (!impairment) return Ok();
+
+    auto now = this->impairmentNow();
+    std::optional<std::string> firstError;
+
+    impairedDue.clear();
+    impairment->takeDue(ImpairDirection::Outbound, now, impairedDue);
+
+    for (auto& datagram : impairedDue) {
+        auto result = udpSocket.send(reinterpret_cast<const char*>(datagram.data.data()), datagram.data.size());
+        if (!result && !firstError) {
+            firstError = std::move(result).unwrapErr();
+        }
+    }
+
+    impairedDue.clear();
+    impairment->takeDue(ImpairDirection::Inbound, now, impairedDue);
+
+    for (auto& datagram : impairedDue) {
+        auto result = this->handleDatagram(datagram.data.data(), datagram.data.size(), datagram.fromServer);
+        if (!result && !firstError) {
+            firstError = std::move(result).unwrapErr();
+        }
+    }
+
+    impairedDue.clear();
+
+    if (firstError) {
+        return Err(std::move(*firstError));
+    }
+
+    return Ok();
+}
+
+size_t GameSocket::maxEncodedPacketSize(const Packet& packet) {
+    size_t size = ByteBuffer::addSizes(PacketHeader::SIZE, packet.getMaxEncodedSize());
+
+    if (packet.getUseTcp()) {
+        size = ByteBuffer::addSizes(size, sizeof(uint32_t));
+    } else {
+        size = ByteBuffer::addSizes(size, SEQUENCED_PREFIX_SIZE);
+    }
+
+    // the session cipher has a smaller prefix than the box, so this is an upper bound either way
+    if (packet.getEncrypted()) {
+        size = ByteBuffer::addSizes(size, CryptoBox::PREFIX_LEN);
+    }
+
+    return size;
+}
+
 Result<> GameSocket::encodePacket(Packet& packet, ByteBuffer& buffer) {
     PacketHeader header = {
         .id = packet.getPacketId(),
@@ -279,23 +811,37 @@ Result<> GameSocket::encodePacket(Packet& packet, ByteBuffer& buffer) {
         buffer.writeU32(0);
     }
 
+    auto& telemetry = NetworkTelemetry::get();
+    auto encodeStart = Instant::now();
+
     buffer.writeValue<PacketHeader>(header);
+    size_t payloadStart = buffer.getPosition();
     packet.encode(buffer);
 
+    telemetry.recordTime(packet, PacketStage::Encode, encodeStart.elapsed());
+
+    // captured before encryption
+    SessionCapture::get().record(CaptureDirection::Outbound, header.id, buffer.dataPtr() + payloadStart, buffer.getPosition() - payloadStart);
+
     if (packet.getEncrypted()) {
-        GLOBED_REQUIRE_SAFE(cryptoBox.get() != nullptr, "attempted to encrypt a packet when no cryptobox is initialized")
+        auto encryptStart = Instant::now();
 
-        // grow the vector by CryptoBox::PREFIX_LEN extra bytes to do in-place encryption
-        buffer.grow(CryptoBox::PREFIX_LEN);
+        // grow the vector by the prefix size to do in-place encryption
+        size_t overhead = this->cipherOverhead();
+        buffer.grow(overhead);
         uint32_t headerSize = PacketHeader::SIZE;
         if (tcp) {
             headerSize += sizeof(uint32_t);
         }
 
-        auto rawSize = buffer.size() - headerSize - startPos - CryptoBox::PREFIX_LEN;
-        cryptoBox->encryptInPlace(buffer.data().data() + startPos + headerSize, rawSize);
+        auto rawSize = buffer.size() - headerSize - startPos - overhead;
+        GLOBED_UNWRAP(this->encryptPayload(tcp ? CipherStream::Tcp : CipherStream::Udp, buffer.dataPtr() + startPos + headerSize, rawSize));
+
+        telemetry.recordTime(packet, PacketStage::Encrypt, encryptStart.elapsed());
     }
 
+    telemetry.recordOut(packet, buffer.size() - startPos);
+
     // write length
     if (tcp) {
         size_t lastPos = buffer.getPosition();
@@ -309,7 +855,7 @@ Result<> GameSocket::encodePacket(Packet& packet, ByteBuffer& buffer) {
     return Ok();
 }
 
-Result<std::shared_ptr<Packet>> GameSocket::decodePacket(ByteBuffer& buffer) {
+Result<std::shared_ptr<Packet>> GameSocket::decodePacket(ByteBuffer& buffer, bool insideBundle, CipherStream stream, bool record) {
     // read header
     auto header = buffer.readValue<PacketHeader>().unwrap(); // we know that the header must be present by now.
 
@@ -321,44 +867,46 @@ Result<std::shared_ptr<Packet>> GameSocket::decodePacket(ByteBuffer& buffer) {
 
     GLOBED_REQUIRE_SAFE(packet.get() != nullptr, std::string("invalid server-side packet: ") + std::to_string(header.id))
 
-    if (packet->getEncrypted() && !header.encrypted) {
+    auto& telemetry = NetworkTelemetry::get();
+    if (record) {
+        telemetry.recordIn(*packet, buffer.size());
+    }
+
+    if (packet->getEncrypted() && !header.encrypted && !insideBundle) {
         GLOBED_REQUIRE_SAFE(false, fmt::format("server sent a cleartext packet when expected an encrypted one ({})", header.id))
     }
 
+    // plaintext view of the message, without the header
+    auto message = ByteBuffer::borrowed(buffer.dataPtr() + messageStart, messageLength);
+
     if (header.encrypted) {
-        GLOBED_REQUIRE_SAFE(cryptoBox.get() != nullptr, "attempted to decrypt a packet when no cryptobox is initialized")
-        bytevector& bufvec = buffer.data();
+        auto decryptStart = Instant::now();
+
+        GLOBED_UNWRAP_INTO(this->decryptPayload(stream, message.dataPtr(), messageLength), message);
+
+        if (record) {
+            telemetry.recordTime(*packet, PacketStage::Decrypt, decryptStart.elapsed());
+        }
+    }
 
-        GLOBED_UNWRAP_INTO(cryptoBox->decryptInPlace(bufvec.data() + messageStart, messageLength), messageLength);
-        buffer.resize(messageStart + messageLength);
+    if (record) {
+        SessionCapture::get().record(CaptureDirection::Inbound, header.id, message.dataPtr(), message.size());
     }
 
-    if (dumpPackets) {
-        this->dumpPacket(header.id, buffer, false);
+    auto decodeStart = Instant::now();
+    auto result = packet->decode(message);
+    if (record) {
+        telemetry.recordTime(*packet, PacketStage::Decode, decodeStart.elapsed());
     }
 
-    auto result = packet->decode(buffer);
     if (result.isErr()) {
         return Err(fmt::format("Decoding packet ID {} failed: {}", header.id, ByteBuffer::strerror(result.unwrapErr())));
     }
 
+    // installed right away, the packets after this one may already be encrypted with the new keys
+    if (auto* keys = packet->tryDowncast<SessionKeysPacket>()) {
+        this->installSessionKeys(keys->sendKey, keys->recvKey);
+    }
+
     return Ok(std::move(packet));
 }
-
-void GameSocket::dumpPacket(packetid_t id, ByteBuffer& buffer, bool sending) {
-    log::debug("{} packet {}", sending ? "Sending" : "Receiving", id);
-
-    auto folder = Mod::get()->getSaveDir() / "packets";
-    (void) geode::utils::file::createDirectoryAll(folder);
-    util::misc::callOnce("networkmanager-log-to-file", [&] {
-        log::debug("Packet log folder: {}", folder);
-    });
-
-    auto datetime = util::format::formatDateTime(SystemTime::now());
-    auto filepath = folder / fmt::format("{}-{}.bin", id, datetime);
-
-    std::ofstream fs(filepath, std::ios::binary);
-
-    const auto& vec = buffer.data();
-    fs.write(reinterpret_cast<const char*>(vec.data()), vec.size());
-}
\ No newline at end of file
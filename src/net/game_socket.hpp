@@ -3,24 +3,73 @@
 #include "address.hpp"
 #include "udp_socket.hpp"
 #include "tcp_socket.hpp"
+#include "tcp_frame_reader.hpp"
 #include "udp_frame_buffer.hpp"
+#include "poll_waker.hpp"
+#include "udp_sequencer.hpp"
+#include "impairment.hpp"
 
 #include <data/packets/packet.hpp>
 #include <crypto/box.hpp>
+#include <crypto/session_cipher.hpp>
+#include <asp/time/Duration.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <deque>
+#include <vector>
 
 class GLOBED_DLL GameSocket {
     static constexpr uint8_t MARKER_CONN_INITIAL = 0xe0;
     static constexpr uint8_t MARKER_CONN_RECOVERY = 0xe1;
+    static constexpr uint8_t MARKER_CONN_RESUMPTION = 0xe2;
 
     static constexpr uint8_t MARKER_UDP_PACKET = 0xb1;
     static constexpr uint8_t MARKER_UDP_FRAME = 0xa7;
+    static constexpr uint8_t MARKER_UDP_BUNDLE = 0xb2;
+    static constexpr uint8_t MARKER_UDP_SEQUENCED = 0xb3;
 
 public:
+    // First protocol version that supports bundles
+    static constexpr uint16_t BUNDLE_MIN_PROTOCOL = 15;
+    // Bundles never grow past this many bytes, which is comfortably below the minimum MTU of IPv6
+    static constexpr size_t BUNDLE_BUDGET = 1200;
+    // How long the first packet of a bundle may wait for other packets to join it
+    static constexpr asp::time::Duration BUNDLE_DEADLINE = asp::time::Duration::fromMillis(2);
+    // First protocol version that sequences udp datagrams
+    static constexpr uint16_t SEQUENCING_MIN_PROTOCOL = 17;
+    // Bytes in front of every datagram once sequencing is on, the header of a `SequencedDatagramPacket` and the sequence header
+    static constexpr size_t SEQUENCED_PREFIX_SIZE = PacketHeader::SIZE + SequenceHeader::SIZE;
+
+    // Length of the ticket from `SessionTicketPacket` (protocol v18+)
+    static constexpr size_t RESUME_TICKET_LEN = 16;
+
+    enum class ConnectKind {
+        Initial,
+        Recovery,   // must be followed by `sendRecoveryData`
+        Resumption, // must be followed by `sendResumptionData`
+    };
+
     GameSocket();
     ~GameSocket();
 
-    Result<> connect(const NetworkAddress& address, bool isRecovering);
+    // Start connecting to the first of the addresses that accepts a TCP connection (see `TcpSocket::startConnect`).
+    // Nothing blocks, `continueConnect` has to be called until it returns true or an error.
+    Result<> startConnect(const std::vector<SocketAddress>& addresses, ConnectKind kind);
+
+    // Make progress on the connection, returns true once connected and the server was told what kind of connection this is.
+    // `poll` wakes up whenever one of the attempts connects or fails.
+    Result<bool> continueConnect();
+
+    // Whether a connection was started and hasn't succeeded or failed yet, `disconnect` or `disconnectTcp` abort it
+    bool isConnecting() const;
+
+    // Time until `continueConnect` has to be called even if `poll` didn't wake up, `std::nullopt` if not connecting
+    std::optional<asp::time::Duration> untilConnectStep() const;
     void disconnect();
+
+    // Only close the TCP connection. The UDP socket, encryption and sequence numbers are kept, so the session can be resumed.
+    void disconnectTcp();
+
     bool isConnected();
 
     struct ReceivedPacket {
@@ -28,54 +77,170 @@ public:
         bool fromConnected;
     };
 
-    // Try to receive a packet on the TCP socket
-    Result<std::shared_ptr<Packet>> recvPacketTCP();
-
-    // Try to receive a packet on the UDP socket
-    Result<std::optional<ReceivedPacket>> recvPacketUDP();
-
-    // Try to receive a packet
-    Result<ReceivedPacket> recvPacket();
+    // Try to receive a packet on the TCP socket. Returns `std::nullopt` if only a part of the next packet has arrived so far.
+    Result<std::optional<std::shared_ptr<Packet>>> recvPacketTCP();
 
-    // Try to receive a packet, returns "timed out" if timeout is reached.
-    Result<ReceivedPacket> recvPacket(int timeoutMs);
+    // Receive every datagram that is queued on the UDP socket (blocking until there is at least one),
+    // and queue the packets that they contain or complete. Returns the amount of packets queued.
+    Result<size_t> recvPacketsUDP();
 
     // Send a packet to the currently active connection. Throws if disconnected
     Result<> sendPacket(std::shared_ptr<Packet> packet);
 
+    // Like `sendPacket`, but if bundling is enabled, UDP packets are held back and sent together with other packets
+    // in a single datagram, once either the bundle is full or `BUNDLE_DEADLINE` has passed (see `flushBundleIfDue`).
+    Result<> sendPacketBundled(std::shared_ptr<Packet> packet);
+
+    // Send the pending bundle right away, if there is one
+    Result<> flushBundle();
+
+    // Send the pending bundle if its deadline has passed
+    Result<> flushBundleIfDue();
+
+    // Time left until the pending bundle has to be sent, or `std::nullopt` if there is none
+    std::optional<asp::time::Duration> untilBundleFlush() const;
+
+    // Enable or disable bundling, only servers speaking protocol v15 or newer understand bundles
+    void setBundling(bool enabled);
+
+    // Enable sequencing once the server negotiated protocol v17 or newer over tcp, requires the session cipher.
+    // Sequencing is turned off again by `disconnect`.
+    void setSequencing(bool enabled);
+
     // Send a UDP packet to a specific address
-    Result<> sendPacketTo(std::shared_ptr<Packet> packet, const NetworkAddress& address);
+    Result<> sendPacketTo(std::shared_ptr<Packet> packet, const SocketAddress& address);
 
     Result<> sendRecoveryData(int accountId, uint32_t secretKey);
 
+    // Resume the session with the ticket from the server, proving that we still have the session keys
+    Result<> sendResumptionData(int accountId);
+
+    // Whether there is a ticket and the session cipher to go with it
+    bool canResume() const;
+    void setResumeTicket(const util::data::bytearray<RESUME_TICKET_LEN>& ticket);
+
     void cleanupBox();
+
+    // Start a new session, dropping the keys and the ticket of the previous one
     void createBox();
 
-    void togglePacketLogging(bool enabled);
+    // Link quality measured from the sequence headers of the server (protocol v17+). Thread safe.
+    LinkStats getLinkStats() const;
+
+    // Run the datagrams of the active connection through a `NetworkImpairment`, or stop doing that with `std::nullopt`.
+    // TCP and pings to other servers are left alone.
+    void setImpairment(const std::optional<ImpairmentConfig>& config);
+    bool isImpaired() const;
+
+    // Time until the impairment layer has a datagram to send or deliver, `std::nullopt` if there is none
+    std::optional<asp::time::Duration> untilImpairmentDue() const;
+
+    // Switch to the session cipher for all encrypted packets sent from now on. Received packets encrypted with
+    // the crypto box are still accepted until the first one encrypted with the session cipher arrives.
+    void installSessionKeys(const util::data::bytearray<SessionCipher::KEY_LEN>& sendKey, const util::data::bytearray<SessionCipher::KEY_LEN>& recvKey);
 
     enum class PollResult {
         None, Tcp, Udp, Both
     };
 
+    // Wait until either socket has data, or until `wake` is called (then the result is `None`, unless there is data as well).
     Result<PollResult> poll(int timeoutMs);
 
+    // Interrupt a thread that is blocked in `poll` or `waitForWakeup`. Thread safe.
+    void wake();
+
+    // Like `poll`, but ignores the sockets and only waits for `wake` to be called.
+    void waitForWakeup(int timeoutMs);
+
+    // Receive every packet that is ready according to the result of `poll`, without blocking, as well as datagrams
+    // that the impairment layer has held back until now. Received packets are appended to `out`, even if an error is returned afterwards.
+    Result<> recvReady(PollResult ready, std::vector<ReceivedPacket>& out);
+
 private:
     friend class NetworkManager;
+    friend class SessionReplay;
 
     TcpSocket tcpSocket;
+    ConnectKind connectKind = ConnectKind::Initial;
+    TcpFrameReader tcpReader;
     UdpSocket udpSocket;
     UdpFrameBuffer udpBuffer;
+    std::deque<ReceivedPacket> udpQueue;
+    PollWaker waker;
+
+    // Outgoing bundle, encoded as a `PacketBundlePacket` header followed by a list of length-prefixed packets.
+    // The list is encrypted as a whole right before sending.
+    struct OutgoingBundle {
+        // where a packet is in `buffer`, it is only counted in the telemetry and the capture once the bundle is sent
+        struct Entry {
+            packetid_t id;
+            const char* name;
+            size_t start; // of the length prefix
+            size_t size;  // including the length prefix
+            asp::time::Duration encodeTook;
+        };
+
+        ByteBuffer buffer;
+        std::vector<Entry> entries;
+        std::shared_ptr<Packet> first; // sent on its own if nothing else joins it
+        asp::time::Instant startedAt = asp::time::Instant::now();
+    };
+
+    OutgoingBundle bundle;
+    bool bundling = false;
+
+    UdpSequencer udpSequencer;
 
     std::unique_ptr<CryptoBox> cryptoBox;
+    std::unique_ptr<SessionCipher> sessionCipher;
+    std::optional<util::data::bytearray<RESUME_TICKET_LEN>> resumeTicket;
     util::data::byte* dataBuffer;
 
-    bool dumpPackets = false;
+    std::unique_ptr<NetworkImpairment> impairment;
+    asp::time::Instant impairmentEpoch = asp::time::Instant::now();
+    std::vector<NetworkImpairment::Datagram> impairedDue;
+
+    // Microseconds since `impairmentEpoch`, the clock of the impairment layer
+    uint64_t impairmentNow() const;
+
+    // Send a finished datagram over the socket, or hand it to the impairment layer if there is one
+    Result<> sendRawDatagram(const util::data::byte* data, size_t size);
+
+    // Send and handle all datagrams that the impairment layer has held back until now
+    Result<> releaseImpaired();
+
+    // Bytes that encryption adds in front of the ciphertext
+    size_t cipherOverhead() const;
+
+    // Encrypt `size` bytes from `data` into itself, the buffer must have room for `cipherOverhead()` more bytes.
+    Result<> encryptPayload(CipherStream stream, util::data::byte* data, size_t size);
+
+    // Decrypt `size` bytes from `data` into itself, returns a view of the plaintext.
+    Result<ByteBuffer> decryptPayload(CipherStream stream, util::data::byte* data, size_t size);
+
+    // Encode a packet into `buf` and send it to the currently active connection
+    Result<> sendPacketWith(Packet& packet, ByteBuffer& buf);
+
+    // Send a datagram to the currently active connection. `data` must start with `SEQUENCED_PREFIX_SIZE` reserved bytes,
+    // which are filled in and sent along if sequencing is active, and skipped otherwise. `size` does not include them.
+    Result<> sendDatagram(util::data::byte* data, size_t size);
+
+    // Upper bound of the size of the packet on the wire, including the header, length and encryption prefix.
+    static size_t maxEncodedPacketSize(const Packet& packet);
 
     // Write a packet, packet header, and optionally length if the packet is TCP to the given buffer.
     Result<> encodePacket(Packet& packet, ByteBuffer& buffer);
 
-    // Decode a packet from a buffer
-    Result<std::shared_ptr<Packet>> decodePacket(ByteBuffer& buffer);
+    // Append a packet to the pending bundle, sending the bundle first if the packet doesn't fit in it anymore
+    Result<> appendToBundle(std::shared_ptr<Packet> packet);
+
+    // Handle a single received datagram, queueing the packet in it if there is one
+    Result<> handleDatagram(util::data::byte* data, size_t size, bool fromConnected);
+
+    // Decrypt a received bundle and queue every packet in it
+    Result<> handleBundle(ByteBuffer& buffer);
 
-    void dumpPacket(packetid_t id, ByteBuffer& buffer, bool sending);
+    // Decode a packet from a buffer. Packets inside of a bundle are protected by the encryption of the bundle, so they are never encrypted themselves.
+    // `stream` is the transport the packet arrived on. With `record` set to false, the packet is not recorded in the telemetry or the capture.
+    Result<std::shared_ptr<Packet>> decodePacket(ByteBuffer& buffer, bool insideBundle = false, CipherStream stream = CipherStream::Tcp, bool record = true);
 };
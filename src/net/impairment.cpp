@@ -0,0 +1,196 @@
+#include "impairment.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+
+using namespace util::data;
+
+bool ImpairmentConfig::isActive() const {
+    return latencyMs > 0 || jitterMs > 0 || loss > 0.f || duplicate > 0.f || reorder > 0.f;
+}
+
+Result<ImpairmentConfig> ImpairmentConfig::parse(std::string_view spec) {
+    ImpairmentConfig config;
+
+    auto parseInt = [](std::string_view key, std::string_view value, auto& dest) -> Result<> {
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), dest);
+        GLOBED_REQUIRE_SAFE(ec == std::errc{} && ptr == value.data() + value.size(), fmt::format("invalid value for {}: '{}'", key, value))
+        return Ok();
+    };
+
+    auto parseChance = [](std::string_view key, std::string_view value, float& dest) -> Result<> {
+        // std::from_chars for floats is missing in some of the standard libraries we build with
+        std::string str(value);
+        char* end = nullptr;
+        double parsed = std::strtod(str.c_str(), &end);
+
+        GLOBED_REQUIRE_SAFE(!str.empty() && end == str.c_str() + str.size(), fmt::format("invalid value for {}: '{}'", key, value))
+        GLOBED_REQUIRE_SAFE(parsed >= 0.0 && parsed <= 1.0, fmt::format("{} must be between 0 and 1, got {}", key, value))
+
+        dest = static_cast<float>(parsed);
+        return Ok();
+    };
+
+    while (!spec.empty()) {
+        size_t comma = spec.find(',');
+        auto pair = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        if (pair.empty()) continue;
+
+        size_t eq = pair.find('=');
+        GLOBED_REQUIRE_SAFE(eq != std::string_view::npos, fmt::format("expected key=value, got '{}'", pair))
+
+        auto key = pair.substr(0, eq);
+        auto value = pair.substr(eq + 1);
+
+        if (key == "seed") {
+            GLOBED_UNWRAP(parseInt(key, value, config.seed));
+        } else if (key == "latency") {
+            GLOBED_UNWRAP(parseInt(key, value, config.latencyMs));
+        } else if (key == "jitter") {
+            GLOBED_UNWRAP(parseInt(key, value, config.jitterMs));
+        } else if (key == "reorder-delay") {
+            GLOBED_UNWRAP(parseInt(key, value, config.reorderMs));
+        } else if (key == "loss") {
+            GLOBED_UNWRAP(parseChance(key, value, config.loss));
+        } else if (key == "dup") {
+            GLOBED_UNWRAP(parseChance(key, value, config.duplicate));
+        } else if (key == "reorder") {
+            GLOBED_UNWRAP(parseChance(key, value, config.reorder));
+        } else {
+            return Err(fmt::format("unknown key '{}'", key));
+        }
+    }
+
+    return Ok(config);
+}
+
+std::string ImpairmentConfig::toString() const {
+    return fmt::format(
+        "latency={},jitter={},loss={},dup={},reorder={},reorder-delay={},seed={}",
+        latencyMs, jitterMs, loss, duplicate, reorder, reorderMs, seed
+    );
+}
+
+NetworkImpairment::NetworkImpairment(const ImpairmentConfig& config) : _config(config) {
+    // different streams for both directions, so that how much is received doesn't change what happens to what we send
+    for (size_t i = 0; i < lanes.size(); i++) {
+        lanes[i].rng = config.seed ^ (0x9e3779b97f4a7c15ULL * (i + 1));
+    }
+}
+
+const ImpairmentConfig& NetworkImpairment::config() const {
+    return _config;
+}
+
+void NetworkImpairment::submit(ImpairDirection dir, const byte* data, size_t size, bool fromServer, uint64_t nowMicros) {
+    auto& lane = lanes[static_cast<size_t>(dir)];
+
+    // all of these are drawn every time, see the class comment
+    double lossRoll = nextRandom(lane);
+    double jitterRoll = nextRandom(lane);
+    double reorderRoll = nextRandom(lane);
+    double dupRoll = nextRandom(lane);
+    double dupJitterRoll = nextRandom(lane);
+
+    _stats.submitted++;
+
+    if (lossRoll < _config.loss) {
+        _stats.dropped++;
+        return;
+    }
+
+    auto delayFor = [&](double roll) {
+        return nowMicros + static_cast<uint64_t>(_config.latencyMs) * 1000 + static_cast<uint64_t>(roll * _config.jitterMs * 1000.0);
+    };
+
+    uint64_t due = delayFor(jitterRoll);
+
+    if (reorderRoll < _config.reorder) {
+        _stats.reordered++;
+        due += static_cast<uint64_t>(_config.reorderMs) * 1000;
+    } else {
+        due = std::max(due, lane.lastDue);
+        lane.lastDue = due;
+    }
+
+    this->enqueue(lane, due, data, size, fromServer);
+
+    if (dupRoll < _config.duplicate) {
+        _stats.duplicated++;
+
+        uint64_t dupDue = std::max(delayFor(dupJitterRoll), lane.lastDue);
+        lane.lastDue = dupDue;
+
+        this->enqueue(lane, dupDue, data, size, fromServer);
+    }
+}
+
+void NetworkImpairment::takeDue(ImpairDirection dir, uint64_t nowMicros, std::vector<Datagram>& out) {
+    auto& lane = lanes[static_cast<size_t>(dir)];
+
+    while (!lane.heap.empty() && lane.heap.front().datagram.due <= nowMicros) {
+        std::pop_heap(lane.heap.begin(), lane.heap.end(), &NetworkImpairment::dueLater);
+        out.push_back(std::move(lane.heap.back().datagram));
+        lane.heap.pop_back();
+    }
+}
+
+std::optional<uint64_t> NetworkImpairment::untilNext(uint64_t nowMicros) const {
+    std::optional<uint64_t> earliest;
+
+    for (auto& lane : lanes) {
+        if (lane.heap.empty()) continue;
+
+        uint64_t due = lane.heap.front().datagram.due;
+        if (!earliest || due < *earliest) {
+            earliest = due;
+        }
+    }
+
+    if (!earliest) return std::nullopt;
+
+    return *earliest > nowMicros ? *earliest - nowMicros : 0;
+}
+
+const NetworkImpairment::Stats& NetworkImpairment::stats() const {
+    return _stats;
+}
+
+void NetworkImpairment::clear() {
+    for (auto& lane : lanes) {
+        lane.heap.clear();
+        lane.lastDue = 0;
+    }
+}
+
+bool NetworkImpairment::dueLater(const Queued& a, const Queued& b) {
+    auto aDue = a.datagram.due, bDue = b.datagram.due;
+    return aDue != bDue ? aDue > bDue : a.order > b.order;
+}
+
+double NetworkImpairment::nextRandom(Lane& lane) {
+    // splitmix64
+    uint64_t z = (lane.rng += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    // the top 53 bits fill the mantissa of a double exactly
+    return static_cast<double>(z >> 11) * 0x1.0p-53;
+}
+
+void NetworkImpairment::enqueue(Lane& lane, uint64_t due, const byte* data, size_t size, bool fromServer) {
+    lane.heap.push_back(Queued {
+        .order = lane.nextOrder++,
+        .datagram = Datagram {
+            .data = bytevector(data, data + size),
+            .fromServer = fromServer,
+            .due = due,
+        },
+    });
+
+    std::push_heap(lane.heap.begin(), lane.heap.end(), &NetworkImpairment::dueLater);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <defs/minimal_geode.hpp>
+#include <util/data.hpp>
+
+// What the impairment layer does to datagrams, the same in both directions
+struct ImpairmentConfig {
+    uint64_t seed = 1;
+    uint32_t latencyMs = 0;   // added to every datagram
+    uint32_t jitterMs = 0;    // up to this much more, uniformly distributed. never reorders datagrams on its own
+    float loss = 0.f;         // chance of a datagram being dropped
+    float duplicate = 0.f;    // chance of a datagram arriving twice
+    float reorder = 0.f;      // chance of a datagram being held back by `reorderMs`, letting the ones after it overtake it
+    uint32_t reorderMs = 30;
+
+    // Whether this changes anything at all
+    bool isActive() const;
+
+    // Parse a comma separated list of `key=value` pairs, for example "latency=80,jitter=20,loss=0.02,dup=0.01,reorder=0.05,seed=7".
+    // Keys that are not given keep their default value.
+    static Result<ImpairmentConfig> parse(std::string_view spec);
+
+    std::string toString() const;
+};
+
+enum class ImpairDirection : uint8_t {
+    Inbound, Outbound
+};
+
+/*
+* NetworkImpairment - delays, drops, duplicates and reorders datagrams, for reproducing bad connections.
+*
+* It is deterministic: every direction has its own random stream derived from the seed, and every datagram takes
+* the same amount of numbers from it no matter what happens to it. The same datagrams submitted in the same order
+* always get the same fate, and changing one of the chances doesn't reshuffle the decisions made by the others.
+* Time is passed in by the caller, so it can be driven by a fake clock just as well as by the real one.
+*
+* Not thread safe, `GameSocket` only uses it from the network thread.
+*/
+class NetworkImpairment {
+public:
+    struct Datagram {
+        util::data::bytevector data;
+        bool fromServer;
+        uint64_t due; // when it arrives or goes out, on the clock passed to `submit`
+    };
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t dropped = 0;
+        uint64_t duplicated = 0;
+        uint64_t reordered = 0;
+    };
+
+    NetworkImpairment(const ImpairmentConfig& config);
+
+    const ImpairmentConfig& config() const;
+
+    // Queue a datagram that was sent or received at `nowMicros`. Unless it's dropped, it comes out of `takeDue` once it's due.
+    void submit(ImpairDirection dir, const util::data::byte* data, size_t size, bool fromServer, uint64_t nowMicros);
+
+    // Append every datagram that is due at `nowMicros` to `out`, earliest first
+    void takeDue(ImpairDirection dir, uint64_t nowMicros, std::vector<Datagram>& out);
+
+    // Microseconds until the next datagram of either direction is due, `std::nullopt` if nothing is queued
+    std::optional<uint64_t> untilNext(uint64_t nowMicros) const;
+
+    const Stats& stats() const;
+
+    // Drop everything that is queued
+    void clear();
+
+private:
+    struct Queued {
+        uint64_t order; // tie breaker, so that datagrams due at the same time keep the order they were submitted in
+        Datagram datagram;
+    };
+
+    struct Lane {
+        uint64_t rng;
+        uint64_t lastDue = 0; // of the newest datagram that wasn't reordered, nothing else may be due before it
+        uint64_t nextOrder = 0;
+        std::vector<Queued> heap;
+    };
+
+    ImpairmentConfig _config;
+    std::array<Lane, 2> lanes;
+    Stats _stats;
+
+    // Uniformly distributed in [0, 1), not using <random> distributions since they differ between standard libraries
+    static double nextRandom(Lane& lane);
+
+    // Comparator that turns the queue of a lane into a min-heap by due time
+    static bool dueLater(const Queued& a, const Queued& b);
+
+    void enqueue(Lane& lane, uint64_t due, const util::data::byte* data, size_t size, bool fromServer);
+};
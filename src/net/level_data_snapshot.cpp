@@ -0,0 +1,34 @@
+#include "level_data_snapshot.hpp"
+
+void LevelDataSnapshot::setActive(bool state) {
+    active = state;
+
+    // drop whatever is left over from the last level
+    this->takeLatest();
+}
+
+bool LevelDataSnapshot::isActive() const {
+    return active;
+}
+
+bool LevelDataSnapshot::tryPublish(const LevelDataPacket& packet) {
+    if (!active) return false;
+
+    auto& buf = buffers[back];
+    buf.players.assign(packet.players.begin(), packet.players.end());
+    buf.sequence = ++nextSequence;
+
+    back = middle.exchange(back | FRESH_BIT, std::memory_order::acq_rel) & INDEX_MASK;
+
+    return true;
+}
+
+const LevelDataSnapshot::Snapshot* LevelDataSnapshot::takeLatest() {
+    if (!(middle.load(std::memory_order::relaxed) & FRESH_BIT)) {
+        return nullptr;
+    }
+
+    front = middle.exchange(front, std::memory_order::acq_rel) & INDEX_MASK;
+
+    return &buffers[front];
+}
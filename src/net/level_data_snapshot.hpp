@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <asp/sync.hpp>
+
+#include <data/packets/server/game.hpp>
+#include <util/singleton.hpp>
+
+/*
+* LevelDataSnapshot - hands the players from the newest `LevelDataPacket` from the network thread straight to the
+* play layer, instead of going through the packet listeners and waiting for the next scheduler tick.
+*
+* Triple buffered: the network thread fills the back buffer and swaps it with the middle one, the main thread swaps
+* its front buffer with the middle one whenever there is a newer snapshot. Neither side ever waits on the other,
+* and only the newest snapshot is seen if several packets arrive within one frame.
+*
+* Opt-in, does nothing unless the play layer has activated it.
+*/
+class LevelDataSnapshot : public SingletonBase<LevelDataSnapshot> {
+protected:
+    friend class SingletonBase;
+    LevelDataSnapshot() = default;
+
+public:
+    struct Snapshot {
+        std::vector<AssociatedPlayerData> players;
+        uint64_t sequence = 0;
+    };
+
+    // Main thread. Start or stop accepting snapshots, anything that was not picked up yet is dropped.
+    void setActive(bool active);
+    bool isActive() const;
+
+    // Network thread. Returns false if not active, in which case the packet should be delivered the regular way.
+    bool tryPublish(const LevelDataPacket& packet);
+
+    // Main thread. Returns the newest snapshot, or nullptr if nothing new was published since the last call.
+    // The returned pointer stays valid until the next call.
+    const Snapshot* takeLatest();
+
+private:
+    // set on the middle index when it holds a snapshot the main thread hasn't seen yet
+    static constexpr uint8_t FRESH_BIT = 0b100;
+    static constexpr uint8_t INDEX_MASK = 0b011;
+
+    std::array<Snapshot, 3> buffers;
+    std::atomic<uint8_t> middle = 1;
+    uint8_t back = 0;  // only used by the network thread
+    uint8_t front = 2; // only used by the main thread
+    uint64_t nextSequence = 0; // only used by the network thread
+
+    asp::AtomicBool active = false;
+};
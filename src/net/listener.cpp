@@ -4,7 +4,12 @@
 
 using namespace geode::prelude;
 
-PacketListener::~PacketListener() {}
+PacketListener::~PacketListener() {
+    // listeners can be released during static destruction, after the manager is gone
+    if (NetworkManager::alive()) {
+        NetworkManager::get().unregisterPacketListener(packetId, this);
+    }
+}
 
 bool PacketListener::init(packetid_t packetId, CallbackFn&& fn, CCObject* owner, int priority, bool isFinal) {
     this->callback = std::move(fn);
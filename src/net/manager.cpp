@@ -1,8 +1,16 @@
 #include "manager.hpp"
 
 #include "address.hpp"
+#include "dns_resolver.hpp"
 #include "listener.hpp"
 #include "game_socket.hpp"
+#include "level_data_snapshot.hpp"
+#include "player_data_codec.hpp"
+#include "send_scheduler.hpp"
+#include "server_pinger.hpp"
+#include "session_capture.hpp"
+#include "telemetry.hpp"
+#include "timer_wheel.hpp"
 
 #include <Geode/ui/GeodeUI.hpp>
 #include <asp/sync.hpp>
@@ -27,14 +35,22 @@
 #include <util/net.hpp>
 #include <ui/notification/panel.hpp>
 
+#include <random>
+
 using namespace asp;
 using namespace asp::time;
 using namespace geode::prelude;
 using ConnectionState = NetworkManager::ConnectionState;
 
 static constexpr uint16_t MIN_PROTOCOL_VERSION = 13;
-static constexpr uint16_t MAX_PROTOCOL_VERSION = 13;
-static constexpr std::array SUPPORTED_PROTOCOLS = std::to_array<uint16_t>({13});
+static constexpr uint16_t MAX_PROTOCOL_VERSION = 18;
+static constexpr std::array SUPPORTED_PROTOCOLS = std::to_array<uint16_t>({13, 14, 15, 16, 17, 18});
+
+// reconnecting starts right away and then backs off exponentially, with jitter so that everyone who lost
+// their connection at the same time doesn't come back at the same time
+static constexpr uint64_t RECOVERY_BASE_DELAY_MS = 250;
+static constexpr uint64_t RECOVERY_MAX_DELAY_MS = 8000;
+static constexpr uint8_t RECOVERY_MAX_ATTEMPTS = 10;
 
 static bool isProtocolSupported(uint16_t proto) {
 #ifdef GLOBED_DEBUG
@@ -63,17 +79,6 @@ static std::string formatListenerKey(packetid_t id) {
     return util::cocos::spr(fmt::format("packet-listener-{}", id));
 }
 
-struct WeakRefDummy {
-    std::shared_ptr<WeakRefController> ctrl;
-};
-
-template <typename T>
-static void* addrFromWeakRef(const WeakRef<T>& ref) {
-    // Do not do this.
-    auto dummy = reinterpret_cast<const WeakRefDummy&>(ref);
-    return dummy.ctrl ? dummy.ctrl->get() : nullptr;
-}
-
 // Packet listener pool. Most of the functions must not be used on a different thread than main.
 class GLOBED_DLL PacketListenerPool : public CCObject {
 public:
@@ -87,6 +92,15 @@ public:
         return instance;
     }
 
+    // Like `get`, but returns nullptr once the pool was destroyed during static destruction
+    static PacketListenerPool* getIfAlive() {
+        return destroyed ? nullptr : &get();
+    }
+
+    ~PacketListenerPool() {
+        destroyed = true;
+    }
+
     // Must be called from the main thread. Delivers packets to all listeners that are tied to an object.
     void update(float dt) {
         // this is a bit irrelevant here but who gives a shit
@@ -104,91 +118,187 @@ public:
 
         if (packetQueue.empty()) return;
 
-        // clear any dead listeners
-        this->removeDeadListeners();
-
-        while (auto packet_ = packetQueue.tryPop()) {
-            auto& packet = packet_.value();
-            packetid_t id = packet->getPacketId();
-
-            bool invoked = false;
-            auto& lsm = listeners[id];
-
-            // reorder them based on priority
-            std::sort(lsm.begin(), lsm.end(), [](auto& l1, auto& l2) -> bool {
-                auto r1 = l1.lock();
-                auto r2 = l2.lock();
+        auto& telemetry = NetworkTelemetry::get();
 
-                if (!r1) return false;
-                if (!r2) return true;
+        while (auto queued = packetQueue.tryPop()) {
+            auto& packet = queued->packet;
 
-                return r1->priority < r2->priority;
-            });
-
-            for (auto& listener : lsm) {
-                if (auto l = listener.lock()) {
-                    l->invokeCallback(packet);
+            telemetry.recordTime(*packet, PacketStage::Dispatch, queued->queuedAt.elapsed());
 
-                    if (l->isFinal) {
-                        break;
-                    }
-                }
+            if (auto* table = this->findTable(packet->getPacketId())) {
+                this->dispatch(*table, packet);
             }
-        }
-    }
-
-    void removeDeadListeners() {
-        for (auto& [id, listeners] : listeners) {
-            for (int i = listeners.size() - 1; i >= 0; i--) {
-#ifdef GLOBED_DEBUG
-                auto addr = addrFromWeakRef(listeners[i]);
-#else
-                void* addr = nullptr;
-#endif
 
-                if (!listeners[i].valid()) {
-                    TRACE("Unregistering listener {} (id {})", addr, id);
-                    listeners.erase(listeners.begin() + i);
-                }
-            }
+            // listeners added by the callbacks should see the next packet already
+            this->flushPendingChanges();
         }
     }
 
     void registerListener(packetid_t id, PacketListener* listener) {
         TRACE("Registering listener {} (id {}) for {}", listener, id, listener->owner);
 
-        auto& ls = listeners[id];
+        if (dispatching) {
+            // can't touch the tables while they are being iterated over
+            pendingRegistrations.emplace_back(id, WeakRef(listener));
+            return;
+        }
 
-        this->removeDeadListeners();
+        this->insertListener(id, listener);
+    }
 
-        // verify it's not a duplicate
-        bool duped = false;
-        for (auto& l : ls) {
-            if (l.lock() == listener) {
-                duped = true;
+    // Called by the listener itself when it is destroyed.
+    void unregisterListener(packetid_t id, PacketListener* listener) {
+        auto* table = this->findTable(id);
+        if (!table) return;
+
+        for (auto& entry : table->entries) {
+            if (entry.listener == listener) {
+                TRACE("Unregistering listener {} (id {})", (void*)listener, id);
+                this->markDead(*table, entry);
                 break;
             }
         }
 
-        if (!duped) {
-            ls.push_back(WeakRef(listener));
-        } else {
-            log::warn("duped listener ({}, id {}, owner {}), not adding again", listener, id, listener->owner);
+        if (!dispatching) {
+            this->compact(*table);
         }
     }
 
     // Push a packet to the queue. Thread safe.
     void pushPacket(std::shared_ptr<Packet> packet) {
-        packetQueue.push(std::move(packet));
+        packetQueue.push(QueuedPacket {
+            .packet = std::move(packet),
+            .queuedAt = asp::time::Instant::now(),
+        });
     }
 
 private:
-    std::unordered_map<packetid_t, std::vector<WeakRef<PacketListener>>> listeners;
-    asp::Channel<std::shared_ptr<Packet>> packetQueue;
+    struct QueuedPacket {
+        std::shared_ptr<Packet> packet;
+        asp::time::Instant queuedAt;
+    };
+
+    struct Entry {
+        int priority;
+        // only used to identify the listener, `ref` must be locked before calling into it
+        PacketListener* listener;
+        WeakRef<PacketListener> ref;
+    };
+
+    // Listeners of a single packet, always sorted by priority. Dead entries have a null `listener` until they are compacted away.
+    struct DispatchTable {
+        std::vector<Entry> entries;
+        size_t dead = 0;
+    };
+
+    static constexpr size_t NO_TABLE = 0;
+
+    // packet id -> index into `tables`, `NO_TABLE` if nothing ever listened for the packet
+    std::array<uint16_t, std::numeric_limits<packetid_t>::max() + 1> tableIndex = {};
+    // the first table is a placeholder so that `NO_TABLE` can be 0
+    std::vector<DispatchTable> tables = std::vector<DispatchTable>(1);
+
+    static inline bool destroyed = false;
+
+    bool dispatching = false;
+    std::vector<std::pair<packetid_t, WeakRef<PacketListener>>> pendingRegistrations;
+
+    asp::Channel<QueuedPacket> packetQueue;
 
     PacketListenerPool() {
         CCScheduler::get()->scheduleSelector(schedule_selector(PacketListenerPool::update), this, 0.f, false);
     }
+
+    DispatchTable* findTable(packetid_t id) {
+        auto idx = tableIndex[id];
+        return idx == NO_TABLE ? nullptr : &tables[idx];
+    }
+
+    DispatchTable& tableFor(packetid_t id) {
+        auto& idx = tableIndex[id];
+        if (idx == NO_TABLE) {
+            idx = static_cast<uint16_t>(tables.size());
+            tables.emplace_back();
+        }
+
+        return tables[idx];
+    }
+
+    void dispatch(DispatchTable& table, const std::shared_ptr<Packet>& packet) {
+        // a callback may end up dispatching packets itself (e.g. a replay)
+        bool wasDispatching = std::exchange(dispatching, true);
+
+        // the vector is never resized while dispatching, entries of listeners that die in the meantime are only marked as dead
+        for (auto& entry : table.entries) {
+            if (!entry.listener) continue;
+
+            auto l = entry.ref.lock();
+            if (!l) {
+                this->markDead(table, entry);
+                continue;
+            }
+
+            l->invokeCallback(packet);
+
+            if (l->isFinal) {
+                break;
+            }
+        }
+
+        dispatching = wasDispatching;
+    }
+
+    void insertListener(packetid_t id, PacketListener* listener) {
+        auto& table = this->tableFor(id);
+
+        // verify it's not a duplicate
+        for (auto& entry : table.entries) {
+            if (entry.listener == listener) {
+                log::warn("duped listener ({}, id {}, owner {}), not adding again", listener, id, listener->owner);
+                return;
+            }
+        }
+
+        // lower priority runs earlier, listeners with the same priority run in the order they were added
+        auto pos = std::upper_bound(table.entries.begin(), table.entries.end(), listener->priority, [](int priority, const Entry& entry) {
+            return priority < entry.priority;
+        });
+
+        table.entries.insert(pos, Entry {
+            .priority = listener->priority,
+            .listener = listener,
+            .ref = WeakRef(listener),
+        });
+    }
+
+    void markDead(DispatchTable& table, Entry& entry) {
+        entry.listener = nullptr;
+        table.dead++;
+    }
+
+    void compact(DispatchTable& table) {
+        if (table.dead == 0) return;
+
+        std::erase_if(table.entries, [](const Entry& entry) { return entry.listener == nullptr; });
+        table.dead = 0;
+    }
+
+    void flushPendingChanges() {
+        if (dispatching) return;
+
+        for (auto& table : tables) {
+            this->compact(table);
+        }
+
+        if (pendingRegistrations.empty()) return;
+
+        for (auto& [id, ref] : std::exchange(pendingRegistrations, {})) {
+            // could have been destroyed already
+            if (auto l = ref.lock()) {
+                this->insertListener(id, l.data());
+            }
+        }
+    }
 };
 
 class GLOBED_DLL NetworkManager::Impl {
@@ -198,11 +308,20 @@ protected:
 
     static constexpr int BUILTIN_LISTENER_PRIORITY = 10000000;
 
-    struct TaskPingServers {};
-    struct TaskSendPacket {
-        std::shared_ptr<Packet> packet;
+    struct TaskPingServers {
+        // servers to ping, all of them if empty
+        std::vector<std::string> serverIds;
     };
     struct TaskPingActive {};
+    struct TaskSetImpairment {
+        std::optional<ImpairmentConfig> config;
+    };
+
+    struct PingTarget {
+        std::string serverId;
+        SocketAddress address;
+        uint32_t round;
+    };
 
     struct GlobalListener {
         packetid_t packetId;
@@ -210,16 +329,33 @@ protected:
         PacketListener::CallbackFn callback;
     };
 
-    using Task = std::variant<TaskPingServers, TaskSendPacket, TaskPingActive>;
+    using Task = std::variant<TaskPingServers, TaskPingActive, TaskSetImpairment>;
+
+    static constexpr size_t LISTENER_TABLE_SIZE = std::numeric_limits<packetid_t>::max() + 1;
+
+    // upper bound of how long the network thread sleeps, even if there is nothing to do
+    static constexpr int MAX_POLL_TIMEOUT_MS = 500;
 
     AtomicConnectionState state;
     GameSocket socket;
-    asp::Thread<NetworkManager::Impl*> threadRecv, threadMain;
+    asp::Thread<NetworkManager::Impl*> threadNet;
     asp::Channel<Task> taskQueue;
-
-    // Note that we intentionally don't use Ref here,
-    // as we use the destructor to know if the object owning the listener has been destroyed.
-    asp::Mutex<std::unordered_map<packetid_t, GlobalListener>> listeners;
+    SendScheduler sendQueue;
+
+    // only used by the network thread
+    TimerWheel timers;
+    std::optional<TimerWheel::TimerId> recoveryTimer;
+    std::minstd_rand backoffRng{std::random_device{}()};
+    ServerPinger pinger;
+    std::vector<GameSocket::ReceivedPacket> receivedPackets;
+
+    // Internal listeners, indexed by packet id. The receive path does a single atomic load per packet,
+    // registering a listener swaps in a new immutable `GlobalListener`.
+    std::unique_ptr<std::array<std::atomic<const GlobalListener*>, LISTENER_TABLE_SIZE>> listeners =
+        std::make_unique<std::array<std::atomic<const GlobalListener*>, LISTENER_TABLE_SIZE>>();
+    // Owns every listener that was ever in the table. Replaced listeners are not freed,
+    // as the network thread could still be running them.
+    asp::Mutex<std::vector<std::unique_ptr<GlobalListener>>> listenerStorage;
     asp::Mutex<std::unordered_map<packetid_t, asp::time::SystemTime>> suppressed;
 
     // these fields are only used by us and in a safe manner, so they don't need a mutex
@@ -242,6 +378,10 @@ protected:
     AtomicU32 secretKey;
     AtomicU32 serverTps;
     AtomicU16 serverProtocol;
+    std::atomic<uint32_t> receivedLevelData = 0;
+
+    asp::Mutex<PlayerDataCodec> playerDataCodec;
+    asp::Mutex<std::optional<ImpairmentConfig>> impairmentConfig;
 
     bool _secure;
 
@@ -251,17 +391,26 @@ protected:
 
         this->setupGlobalListeners();
 
-        // start up the threads
-
-        threadRecv.setLoopFunction(&NetworkManager::Impl::threadRecvFunc);
-        threadRecv.setStartFunction([] { geode::utils::thread::setName("Network Thread (in)"); });
-        threadRecv.start(this);
+        this->resetConnectionState();
+        this->setupTimers();
+
+        // e.g. --geode:globed-net-impairment=latency=80,jitter=20,loss=0.02
+        auto& impairmentSpec = GlobedSettings::get().launchArgs().netImpairment;
+        if (!impairmentSpec.empty()) {
+            auto config = ImpairmentConfig::parse(impairmentSpec);
+            if (config) {
+                log::info("Simulating network conditions: {}", config->toString());
+                this->setImpairment(*config);
+            } else {
+                log::warn("Ignoring invalid globed-net-impairment launch argument: {}", config.unwrapErr());
+            }
+        }
 
-        threadMain.setLoopFunction(&NetworkManager::Impl::threadMainFunc);
-        threadMain.setStartFunction([] { geode::utils::thread::setName("Network Thread (out)"); });
-        threadMain.start(this);
+        // start up the thread
 
-        this->resetConnectionState();
+        threadNet.setLoopFunction(&NetworkManager::Impl::threadNetFunc);
+        threadNet.setStartFunction([] { geode::utils::thread::setName("Network Thread"); });
+        threadNet.start(this);
 
         TRACE("[NetworkManager] initialized");
     }
@@ -272,12 +421,12 @@ protected:
         // remove all listeners
         this->removeAllListeners();
 
-        TRACE("[NetworkManager] waiting for threads to stop");
+        TRACE("[NetworkManager] waiting for the thread to stop");
 
-        threadRecv.stopAndWait();
-        threadMain.stopAndWait();
+        socket.wake();
+        threadNet.stopAndWait();
 
-        TRACE("[NetworkManager] threads stopped, disconnecting");
+        TRACE("[NetworkManager] thread stopped, disconnecting");
 
         if (state != ConnectionState::Disconnected) {
             log::debug("disconnecting from the server..");
@@ -308,6 +457,7 @@ protected:
         secretKey = 0;
         serverTps = 0;
         serverProtocol = 0;
+        playerDataCodec.lock()->reset();
         *lastReceivedPacket.lock() = {};
         lastSentKeepalive = {};
         lastTcpExchange = {};
@@ -349,6 +499,7 @@ protected:
         pcm.setOwnDataAuto();
 
         // actual connection is deferred - the network thread does DNS resolution and TCP connection.
+        socket.wake();
 
         return Ok();
     }
@@ -365,6 +516,9 @@ protected:
 
         socket.disconnect();
 
+        // whatever is still waiting was meant for this connection, not the next one
+        sendQueue.clear();
+
         // singletons could have been destructed before NetworkManager, so this could be UB. Additionally will break autoconnect.
         if (!noclear) {
             RoomManager::get().setGlobal();
@@ -380,6 +534,7 @@ protected:
 
     void cancelReconnect() {
         cancellingRecovery = true;
+        socket.wake();
     }
 
     void onConnectionError(std::string_view reason) {
@@ -387,17 +542,28 @@ protected:
     }
 
     void send(std::shared_ptr<Packet> packet) {
-        taskQueue.push(TaskSendPacket {
-            .packet = std::move(packet)
-        });
+        sendQueue.push(std::move(packet));
+        socket.wake();
     }
 
     void pingServers() {
         taskQueue.push(TaskPingServers {});
+        socket.wake();
+    }
+
+    void setImpairment(std::optional<ImpairmentConfig> config) {
+        *impairmentConfig.lock() = config;
+        taskQueue.push(TaskSetImpairment { std::move(config) });
+        socket.wake();
+    }
+
+    std::optional<ImpairmentConfig> getImpairment() {
+        return *impairmentConfig.lock();
     }
 
     void updateServerPing() {
         taskQueue.push(TaskPingActive {});
+        socket.wake();
     }
 
     ConnectionState getConnectionState() {
@@ -435,6 +601,9 @@ protected:
     }
 
     void unregisterPacketListener(packetid_t packet, PacketListener* listener, bool suppressUnhandled) {
+        if (auto* pool = PacketListenerPool::getIfAlive()) {
+            pool->unregisterListener(packet, listener);
+        }
     }
 
     void suppressUnhandledUntil(packetid_t id, asp::time::SystemTime point) {
@@ -442,7 +611,9 @@ protected:
     }
 
     void removeAllListeners() {
-        listeners.lock()->clear();
+        for (auto& slot : *listeners) {
+            slot.store(nullptr, std::memory_order::release);
+        }
     }
 
     // adds a global listener, with same fairness as all other listeners
@@ -458,25 +629,28 @@ protected:
         });
     }
 
-    // adds a global listener, which always runs NOT on the main thread and always before other listeners
-    void addInternalListener(packetid_t id, PacketCallback&& callback) {
-        GlobalListener listener {
+    // adds a global listener, which always runs NOT on the main thread and always before other listeners.
+    // if `isFinal` is true, the packet is not passed to any other listeners.
+    void addInternalListener(packetid_t id, PacketCallback&& callback, bool isFinal = false) {
+        auto listener = std::make_unique<GlobalListener>(GlobalListener {
             .packetId = id,
-            .isFinal = false,
+            .isFinal = isFinal,
             .callback = std::move(callback),
-        };
+        });
 
-        (*listeners.lock())[id] = std::move(listener);
+        auto storage = listenerStorage.lock();
+        (*listeners)[id].store(listener.get(), std::memory_order::release);
+        storage->push_back(std::move(listener));
 #ifdef GLOBED_DEBUG
         log::debug("Registered internal listener (id = {})", id);
 #endif
     }
 
     template <HasPacketID Pty>
-    void addInternalListener(PacketCallbackSpecific<Pty>&& callback) {
+    void addInternalListener(PacketCallbackSpecific<Pty>&& callback, bool isFinal = false) {
         this->addInternalListener(Pty::PACKET_ID, [cb = std::move(callback)](std::shared_ptr<Packet> packet) {
             cb(std::static_pointer_cast<Pty>(std::move(packet)));
-        });
+        }, isFinal);
     }
 
     // same as `addInternalListener` but runs the callback on the main thread
@@ -489,6 +663,24 @@ protected:
         });
     }
 
+    // With direct player updates enabled, player data skips the listeners and goes straight to the play layer.
+    // Packets with custom items still take the regular way, as those have to be applied on the main thread.
+    void deliverLevelData(std::shared_ptr<LevelDataPacket> packet) {
+        receivedLevelData.fetch_add(1, std::memory_order::relaxed);
+
+        if (LevelDataSnapshot::get().tryPublish(*packet)) {
+            // the players always go through the snapshot, so that a queued packet can never apply older positions
+            // after a newer snapshot was already applied. only the custom items still need the main thread.
+            if (!packet->customItems) {
+                return;
+            }
+
+            packet->players.clear();
+        }
+
+        PacketListenerPool::get().pushPacket(std::move(packet));
+    }
+
     /* global listeners */
 
     void setupGlobalListeners() {
@@ -512,6 +704,13 @@ protected:
             this->onLoggedIn(std::move(packet));
         });
 
+        // the keys are already installed by the socket as soon as the packet is decoded
+        addInternalListener<SessionKeysPacket>([](auto) {}, true);
+
+        addInternalListener<SessionTicketPacket>([this](auto packet) {
+            socket.setResumeTicket(packet->ticket);
+        }, true);
+
         addInternalListener<LoginFailedPacket>([this](auto packet) {
             ErrorQueues::get().error(fmt::format("<cr>Authentication failed!</c> The server rejected the login attempt.\n\nReason: <cy>{}</c>", packet->message));
             GlobedAccountManager::get().authToken.lock()->clear();
@@ -584,6 +783,23 @@ protected:
             pcm.setOwnSpecialData(packet->specialUserData);
         });
 
+        // Game packets
+
+        // compact level data is expanded here, listeners only ever see the regular LevelDataPacket
+        addInternalListener<LevelDataCompactPacket>([this](auto packet) {
+            auto result = playerDataCodec.lock()->expand(*packet);
+            if (!result) {
+                log::debug("failed to expand compact level data: {}", ByteBuffer::strerror(result.unwrapErr()));
+                return;
+            }
+
+            this->deliverLevelData(std::move(result.unwrap()));
+        }, true);
+
+        addInternalListener<LevelDataPacket>([this](auto packet) {
+            this->deliverLevelData(std::move(packet));
+        }, true);
+
         // Room packets
 
         addGlobalListener<RoomInvitePacket>([](auto packet) {
@@ -705,6 +921,9 @@ protected:
         serverTps = packet->tps;
         secretKey = packet->secretKey;
         serverProtocol = packet->serverProtocol;
+        playerDataCodec.lock()->reset();
+        socket.setBundling(serverProtocol >= GameSocket::BUNDLE_MIN_PROTOCOL);
+        socket.setSequencing(serverProtocol >= GameSocket::SEQUENCING_MIN_PROTOCOL);
 
         state = ConnectionState::Established;
 
@@ -775,7 +994,17 @@ protected:
     /* misc */
 
     void togglePacketLogging(bool enabled) {
-        socket.togglePacketLogging(enabled);
+        auto& capture = SessionCapture::get();
+
+        if (!enabled) {
+            capture.stop();
+            return;
+        }
+
+        auto result = capture.start();
+        if (!result) {
+            ErrorQueues::get().warn(fmt::format("Failed to start capturing packets: {}", result.unwrapErr()));
+        }
     }
 
     void setIgnoreProtocolMismatch(bool state) {
@@ -799,6 +1028,14 @@ protected:
         return established() ? serverProtocol.load() : 0;
     }
 
+    uint32_t getReceivedLevelData() {
+        return receivedLevelData.load(std::memory_order::relaxed);
+    }
+
+    LinkStats getLinkStats() {
+        return socket.getLinkStats();
+    }
+
     bool isStandalone() {
         return standalone;
     }
@@ -815,31 +1052,135 @@ protected:
 
     void resume() {
         suspended = false;
+        socket.wake();
     }
 
-    /* worker threads */
+    /* network thread */
+
+    // The network thread is a single reactor. It sleeps in `GameSocket::poll` until a socket has data, a timer is due,
+    // or another thread wakes it up (`send`, `connect`, ...), so nothing waits for a fixed polling interval.
+    void threadNetFunc(decltype(threadNet)::StopToken&) {
+        if (this->suspended) {
+            // leave the sockets alone until `resume` wakes us up
+            socket.waitForWakeup(MAX_POLL_TIMEOUT_MS);
+            return;
+        }
 
-    void threadRecvFunc(decltype(threadRecv)::StopToken&) {
-        if (this->suspended || state == ConnectionState::TcpConnecting) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // tasks go first, so that a packet queued with `send` is written right after the wakeup
+        this->processTasks();
+        this->flushBundle();
+        timers.advance();
+        this->updateConnection();
+
+        int timeoutMs = MAX_POLL_TIMEOUT_MS;
+        if (auto next = timers.untilNext()) {
+            timeoutMs = std::min<int>(timeoutMs, next->millis());
+        }
+
+        // round up, waking up early would only make us spin until the deadline
+        if (auto bundleDue = socket.untilBundleFlush()) {
+            timeoutMs = std::min<int>(timeoutMs, (bundleDue->micros() + 999) / 1000);
+        }
+
+        if (auto impairedDue = socket.untilImpairmentDue()) {
+            timeoutMs = std::min<int>(timeoutMs, (impairedDue->micros() + 999) / 1000);
+        }
+
+        // the next connection attempt is started from `updateConnection`, so we have to be awake for it
+        if (auto connectStep = socket.untilConnectStep()) {
+            timeoutMs = std::min<int>(timeoutMs, (connectStep->micros() + 999) / 1000);
+        }
+
+        auto ready = socket.poll(timeoutMs);
+        if (!ready) {
+            this->onConnectionError(ready.unwrapErr());
+
+            // don't spin if polling keeps failing
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             return;
         }
 
-        auto packet_ = socket.recvPacket(100);
-        if (packet_.isErr()) {
-            auto error = std::move(packet_.unwrapErr());
-            if (error != "timed out") {
-                this->onConnectionError(error);
+        // held back datagrams have to go out even if the sockets have nothing for us
+        if (*ready == GameSocket::PollResult::None && !socket.isImpaired()) {
+            return;
+        }
+
+        auto result = socket.recvReady(*ready, receivedPackets);
+
+        for (auto& received : receivedPackets) {
+            this->handleReceivedPacket(std::move(received.packet), received.fromConnected);
+        }
+
+        receivedPackets.clear();
+
+        if (!result) {
+            this->onConnectionError(result.unwrapErr());
+        }
+    }
+
+    void flushBundle() {
+        auto result = socket.flushBundleIfDue();
+        if (!result) {
+            log::debug("failed to send packet bundle: {}", result.unwrapErr());
+            this->onConnectionError(result.unwrapErr());
+        }
+    }
+
+    void processTasks() {
+        while (auto task_ = taskQueue.tryPop()) {
+            auto task = std::move(task_.value());
+
+            if (auto* ping = std::get_if<TaskPingServers>(&task)) {
+                this->handlePingTask(*ping);
+            } else if (std::holds_alternative<TaskPingActive>(task)) {
+                this->handlePingActive();
+            } else if (auto* impair = std::get_if<TaskSetImpairment>(&task)) {
+                socket.setImpairment(impair->config);
             }
+        }
 
-            return;
+        // outgoing packets, highest priority class first
+        while (auto entry = sendQueue.pop()) {
+            this->handleSendPacket(std::move(*entry));
         }
+    }
 
-        // this is awesome
-        auto packet__ = packet_.unwrap();
-        auto packet = std::move(packet__.packet);
-        bool fromServer = packet__.fromConnected;
+    void setupTimers() {
+        timers.scheduleRepeating(Duration::fromMillis(500), [this] {
+            if (this->established()) {
+                this->maybeSendKeepalive();
+            }
+        });
+
+        timers.scheduleRepeating(Duration::fromSecs(60), [this] {
+            auto metrics = sendQueue.metrics();
+
+            for (size_t i = 0; i < SendScheduler::CLASS_COUNT; i++) {
+                auto& m = metrics[i];
+                if (m.sent == 0 && m.coalesced == 0) continue;
+
+                log::debug(
+                    "send queue ({}) over the last minute: {} sent, {} coalesced, depth {} (max {}), latency avg {}us, max {}us",
+                    SendScheduler::className(static_cast<SendClass>(i)),
+                    m.sent, m.coalesced, m.depth, m.maxDepth,
+                    m.sent ? m.totalLatencyMicros / m.sent : 0, m.maxLatencyMicros
+                );
+            }
+
+            sendQueue.resetMetrics();
+        });
 
+        // lets us see which packets eat up the bandwidth, without having to open the stats popup
+        timers.scheduleRepeating(Duration::fromSecs(30), [this] {
+            if (this->established()) {
+                auto& telemetry = NetworkTelemetry::get();
+                telemetry.setLinkStats(socket.getLinkStats());
+                telemetry.writeSnapshot();
+            }
+        });
+    }
+
+    void handleReceivedPacket(std::shared_ptr<Packet>&& packet, bool fromServer) {
         packetid_t id = packet->getPacketId();
 
         if (id == PingResponsePacket::PACKET_ID) {
@@ -861,35 +1202,65 @@ protected:
         packetid_t packetId = packet->getPacketId();
 
         // go through internal listeners
-        auto ls = listeners.lock();
-        if (ls->contains(packetId)) {
-            auto listener = ls->at(packetId);
-            listener.callback(packet);
-            if (listener.isFinal) return;
+        if (auto* listener = (*listeners)[packetId].load(std::memory_order::acquire)) {
+            listener->callback(packet);
+            if (listener->isFinal) return;
         }
 
-        ls.unlock();
-
         // call other listeners
         PacketListenerPool::get().pushPacket(std::move(packet));
     }
 
     void handlePingResponse(std::shared_ptr<Packet>&& packet) {
         if (auto* pingr = packet->tryDowncast<PingResponsePacket>()) {
-            GameServerManager::get().finishPing(pingr->id, pingr->playerCount);
+            // anything that isn't ours is a keepalive to the active server
+            if (!pinger.owns(pingr->id)) {
+                GameServerManager::get().finishPing(pingr->id, pingr->playerCount);
+                return;
+            }
+
+            if (auto result = pinger.finishSample(pingr->id, pingr->playerCount)) {
+                GameServerManager::get().updatePing(result->first, result->second);
+            }
         }
     }
 
-    void threadMainFunc(decltype(threadMain)::StopToken&) {
-        if (this->suspended) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            return;
+    // Resolve the address of the server and connect to it without blocking, returns true once connected
+    Result<bool> stepConnect(GameSocket::ConnectKind kind) {
+        if (!socket.isConnecting()) {
+            auto addresses = this->resolveConnectedAddress();
+            if (!addresses) {
+                // still resolving
+                return Ok(false);
+            }
+
+            GLOBED_UNWRAP_INTO(std::move(*addresses), auto resolved);
+            GLOBED_UNWRAP(socket.startConnect(resolved, kind));
+        }
+
+        return socket.continueConnect();
+    }
+
+    // Drives the connection state machine, called on every iteration of the network thread
+    void updateConnection() {
+        // the connection was reset or cancelled from another thread while we were waiting to retry
+        if (recoveryTimer && !(state == ConnectionState::TcpConnecting && recovering)) {
+            timers.cancel(*recoveryTimer);
+            recoveryTimer.reset();
+        }
+
+        // same for a connection that is still in progress
+        if (socket.isConnecting() && (state != ConnectionState::TcpConnecting || cancellingRecovery)) {
+            socket.disconnectTcp();
         }
 
         // Initial tcp connection.
         if (state == ConnectionState::TcpConnecting && !recovering) {
-            // try to connect
-            auto result = socket.connect(connectedAddress, recovering);
+            auto result = this->stepConnect(GameSocket::ConnectKind::Initial);
+            if (result && !result.unwrap()) {
+                // still resolving or connecting
+                return;
+            }
 
             if (!result) {
                 this->disconnect(true);
@@ -915,10 +1286,39 @@ protected:
         }
         // Connection recovery loop itself
         else if (state == ConnectionState::TcpConnecting && recovering) {
-            log::debug("recovery attempt {}", recoverAttempt.load());
+            if (cancellingRecovery) {
+                log::debug("recovery attempts were cancelled.");
+
+                if (recoveryTimer) {
+                    timers.cancel(*recoveryTimer);
+                    recoveryTimer.reset();
+                }
+
+                recovering = false;
+                recoverAttempt = 0;
+                state = ConnectionState::Disconnected;
+                return;
+            }
+
+            // still waiting before the next attempt
+            if (recoveryTimer) {
+                return;
+            }
+
+            // resuming skips looking up the session by the secret key, and proves that we are the ones who had it
+            bool resuming = socket.isConnecting() ? socket.connectKind == GameSocket::ConnectKind::Resumption : socket.canResume();
+
+            if (!socket.isConnecting()) {
+                log::debug("recovery attempt {} ({})", recoverAttempt.load(), resuming ? "resumption" : "recovery");
+            }
 
             // initiate TCP connection
-            auto result = socket.connect(connectedAddress, recovering);
+            auto kind = resuming ? GameSocket::ConnectKind::Resumption : GameSocket::ConnectKind::Recovery;
+            auto result = this->stepConnect(kind);
+            if (result && !result.unwrap()) {
+                // still resolving or connecting
+                return;
+            }
 
             bool failed = false;
 
@@ -929,8 +1329,9 @@ protected:
                 state = ConnectionState::Authenticating;
 
                 // if we are recovering, next steps are slightly different
-                // first send our account ID and secret key (handled on the lowest level by the server)
-                auto result = socket.sendRecoveryData(GJAccountManager::get()->m_accountID, secretKey);
+                // first send our account ID and secret key or ticket (handled on the lowest level by the server)
+                int accountId = GJAccountManager::get()->m_accountID;
+                auto result = resuming ? socket.sendResumptionData(accountId) : socket.sendRecoveryData(accountId, secretKey);
 
                 if (!result) {
                     failed = true;
@@ -944,30 +1345,20 @@ protected:
                 auto attemptNumber = recoverAttempt.load() + 1;
                 recoverAttempt = attemptNumber;
 
-                if (attemptNumber > 3) {
+                if (attemptNumber >= RECOVERY_MAX_ATTEMPTS) {
                     // give up
                     this->failedRecovery();
                     return;
                 }
 
-                auto sleepPeriod = std::chrono::seconds(10) * attemptNumber;
+                auto backoff = this->recoveryBackoff(attemptNumber);
 
-                log::debug("tcp connect failed, sleeping for {} before trying again", Duration::fromSecs(sleepPeriod.count()).toString());
+                log::debug("tcp connect failed, waiting for {} before trying again", backoff.toString());
 
-                // wait for a bit before trying again
-
-                // we sleep 50 times because we want to check if the user cancelled the recovery
-                for (size_t i = 0; i < 50; i++) {
-                    std::this_thread::sleep_for(sleepPeriod / 50);
-
-                    if (cancellingRecovery) {
-                        log::debug("recovery attempts were cancelled.");
-                        recovering = false;
-                        recoverAttempt = 0;
-                        state = ConnectionState::Disconnected;
-                        return;
-                    }
-                }
+                // cancelling wakes the thread up, so the wait is cut short if the user gives up
+                recoveryTimer = timers.schedule(backoff, [this] {
+                    recoveryTimer.reset();
+                });
 
                 return;
             }
@@ -1002,26 +1393,6 @@ protected:
             ));
             return;
         }
-
-        if (this->established()) {
-            this->maybeSendKeepalive();
-        }
-
-        // poll for any incoming packets
-
-        while (auto task_ = taskQueue.popTimeout(Duration::fromMillis(50))) {
-            auto task = std::move(task_.value());
-
-            if (std::holds_alternative<TaskPingServers>(task)) {
-                this->handlePingTask();
-            } else if (std::holds_alternative<TaskSendPacket>(task)) {
-                this->handleSendPacketTask(std::move(std::get<TaskSendPacket>(task)));
-            } else if (std::holds_alternative<TaskPingActive>(task)) {
-                this->handlePingActive();
-            }
-        }
-
-        std::this_thread::yield();
     }
 
     void maybeSendKeepalive() {
@@ -1036,7 +1407,7 @@ protected:
         if (sinceLastPacket > Duration::fromSecs(20)) {
             // timed out, disconnect the tcp socket but allow to reconnect
             log::warn("timed out, time since last received packet: {}", sinceLastPacket.toString());
-            socket.disconnect();
+            socket.disconnectTcp();
         } else if (sinceLastPacket > Duration::fromSecs(10) && sinceLastKeepalive > Duration::fromSecs(3)) {
             this->sendKeepalive();
         }
@@ -1059,25 +1430,101 @@ protected:
         recoverAttempt = 0;
         state = ConnectionState::Disconnected;
 
-        ErrorQueues::get().error("Connection to the server was lost. Failed to reconnect after 3 attempts.");
+        ErrorQueues::get().error(fmt::format("Connection to the server was lost. Failed to reconnect after {} attempts.", RECOVERY_MAX_ATTEMPTS));
     }
 
-    void handlePingTask() {
+    // Delay before the next reconnect attempt: at least half of the exponential delay, plus a random part of the other half
+    Duration recoveryBackoff(uint8_t attempt) {
+        uint64_t delay = std::min(RECOVERY_BASE_DELAY_MS << std::min<uint8_t>(attempt - 1, 16), RECOVERY_MAX_DELAY_MS);
+        std::uniform_int_distribution<uint64_t> jitter(0, delay / 2);
+
+        return Duration::fromMillis(delay / 2 + jitter(backoffRng));
+    }
+
+    // Resolve the address of the server we are connecting to without blocking, `std::nullopt` means the lookup is still running
+    // and the network thread is woken up once it finishes.
+    std::optional<Result<std::vector<SocketAddress>>> resolveConnectedAddress() {
+        return connectedAddress.tryResolveAll([this] {
+            socket.wake();
+        });
+    }
+
+    void handlePingTask(const TaskPingServers& task) {
         auto& gsm = GameServerManager::get();
         auto active = gsm.getActiveId();
 
+        std::vector<std::string> unresolvedIds;
+        std::vector<std::string> unresolvedHosts;
+
+        // every server is pinged a few times, all of them at once, so the whole list is done after one timeout at most
+        auto targets = std::make_shared<std::vector<PingTarget>>();
+
         for (auto& [serverId, server] : gsm.getAllServers()) {
             if (serverId == active) continue;
+            if (!task.serverIds.empty() && std::find(task.serverIds.begin(), task.serverIds.end(), serverId) == task.serverIds.end()) continue;
 
             NetworkAddress addr(server.address);
 
+            // resolving might take a while, don't let it hold up the network thread
+            auto resolved = addr.tryResolve();
+            if (!resolved) {
+                unresolvedIds.push_back(serverId);
+                unresolvedHosts.push_back(addr.getHost());
+                continue;
+            }
+
+            if (resolved->isErr()) {
+                log::debug("not pinging {}, failed to resolve: {}", addr.toString(), resolved->unwrapErr());
+                continue;
+            }
+
+            targets->push_back(PingTarget {
+                .serverId = serverId,
+                .address = resolved->unwrap(),
+                .round = pinger.beginRound(serverId),
+            });
+        }
+
+        if (!targets->empty()) {
+            this->sendPingSamples(*targets);
+
+            for (uint8_t i = 1; i < ServerPinger::SAMPLES; i++) {
+                timers.schedule(Duration::fromMillis(ServerPinger::SAMPLE_INTERVAL_MS * i), [this, targets] {
+                    this->sendPingSamples(*targets);
+                });
+            }
+
+            // one tick of leeway, so that the last samples are past the timeout by then
+            auto lastSample = ServerPinger::SAMPLE_INTERVAL_MS * (ServerPinger::SAMPLES - 1);
+            timers.schedule(Duration::fromMillis(lastSample + ServerPinger::TIMEOUT_MS + TimerWheel::TICK_MS), [this] {
+                for (auto& [serverId, stats] : pinger.expire()) {
+                    log::debug("ping to {}: {}/{} samples answered", serverId, stats.received, stats.sent);
+                    GameServerManager::get().updatePing(serverId, stats);
+                }
+            });
+        }
+
+        if (unresolvedHosts.empty()) return;
+
+        // look up all the remaining servers at once, and ping them once that's done
+        DnsResolver::get().prefetch(unresolvedHosts, [this, ids = std::move(unresolvedIds)] {
+            taskQueue.push(TaskPingServers { ids });
+            socket.wake();
+        });
+    }
+
+    void sendPingSamples(const std::vector<PingTarget>& targets) {
+        for (auto& target : targets) {
+            // a newer round for the same server was started in the meantime
+            auto pingId = pinger.startSample(target.serverId, target.round);
+            if (!pingId) continue;
+
 #ifdef GLOBED_DEBUG
-            auto addrString = addr.resolveToString().unwrapOr("<unresolved>");
-            log::debug("sending ping to {}", addrString);
+            log::debug("sending ping to {}", target.address.toString());
 #endif
 
-            auto pingId = gsm.startPing(serverId);
-            auto result = socket.sendPacketTo(PingPacket::create(pingId), addr);
+            // if this fails, the sample simply times out and counts as lost
+            auto result = socket.sendPacketTo(PingPacket::create(*pingId), target.address);
 
             if (result.isErr()) {
                 log::debug("failed to send ping: {}", result.unwrapErr());
@@ -1086,13 +1533,18 @@ protected:
         }
     }
 
-    void handleSendPacketTask(TaskSendPacket task) {
+    void handleSendPacket(SendScheduler::Entry&& task) {
+        // use the compact encoding if the server supports it
+        if (task.packet->getPacketId() == PlayerDataPacket::PACKET_ID && serverProtocol >= PlayerDataCodec::MIN_PROTOCOL) {
+            task.packet = playerDataCodec.lock()->compress(static_cast<PlayerDataPacket&>(*task.packet));
+        }
+
         if (task.packet->getUseTcp()) {
             lastTcpExchange = SystemTime::now();
         }
 
         try {
-            auto result = socket.sendPacket(task.packet);
+            auto result = socket.sendPacketBundled(task.packet);
             if (!result) {
                 auto error = result.unwrapErr();
                 log::debug("failed to send packet {}: {}", task.packet->getPacketId(), error);
@@ -1101,7 +1553,11 @@ protected:
             }
         } catch (const std::exception& e) {
             this->onConnectionError(e.what());
+            return;
         }
+
+        sendQueue.recordSent(task);
+        NetworkTelemetry::get().recordTime(*task.packet, PacketStage::Queue, task.queuedAt.elapsed());
     }
 
     void handlePingActive() {
@@ -1124,6 +1580,8 @@ NetworkManager::NetworkManager() : impl(new NetworkManager::Impl()) {}
 
 NetworkManager::~NetworkManager() {
     delete impl;
+    // listeners destroyed along with the impl must not reach into it anymore
+    impl = nullptr;
 }
 
 Result<> NetworkManager::connect(const NetworkAddress& address, std::string_view serverId, bool standalone) {
@@ -1168,6 +1626,14 @@ void NetworkManager::updateServerPing() {
     impl->updateServerPing();
 }
 
+void NetworkManager::setImpairment(std::optional<ImpairmentConfig> config) {
+    impl->setImpairment(std::move(config));
+}
+
+std::optional<ImpairmentConfig> NetworkManager::getImpairment() {
+    return impl->getImpairment();
+}
+
 void NetworkManager::addListener(CCNode* target, packetid_t id, PacketListener* listener) {
     impl->addListener(target, listener);
 }
@@ -1189,6 +1655,12 @@ void NetworkManager::togglePacketLogging(bool enabled) {
     impl->togglePacketLogging(enabled);
 }
 
+void NetworkManager::dispatchReplayedPacket(std::shared_ptr<Packet> packet) {
+    auto& pool = PacketListenerPool::get();
+    pool.pushPacket(std::move(packet));
+    pool.update(0.f);
+}
+
 uint16_t NetworkManager::getUsedProtocol() {
     return impl->getUsedProtocol();
 }
@@ -1201,6 +1673,14 @@ uint16_t NetworkManager::getServerProtocol() {
     return impl->getServerProtocol();
 }
 
+uint32_t NetworkManager::getReceivedLevelData() {
+    return impl->getReceivedLevelData();
+}
+
+LinkStats NetworkManager::getLinkStats() {
+    return impl->getLinkStats();
+}
+
 bool NetworkManager::standalone() {
     return impl->isStandalone();
 }
@@ -1264,7 +1744,9 @@ bool NetworkManager::isProtocolSupported(uint16_t version) {
 }
 
 void NetworkManager::unregisterPacketListener(packetid_t packet, PacketListener* listener, bool suppressUnhandled) {
-    impl->unregisterPacketListener(packet, listener, suppressUnhandled);
+    if (impl) {
+        impl->unregisterPacketListener(packet, listener, suppressUnhandled);
+    }
 }
 
 /* packet sending */
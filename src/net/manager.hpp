@@ -5,6 +5,8 @@
 
 #include <util/singleton.hpp>
 
+#include <optional>
+
 using packetid_t = uint16_t;
 
 class PacketListener;
@@ -12,6 +14,8 @@ class NetworkAddress;
 struct GameServer;
 class Packet;
 struct UserPrivacyFlags;
+struct LinkStats;
+struct ImpairmentConfig;
 
 template <typename T>
 concept HasPacketID = requires { T::PACKET_ID; };
@@ -96,9 +100,13 @@ public:
     // Removes all listeners.
     void removeAllListeners();
 
-    // Enable whether packets are logged to a file (and to the console)
+    // Enable whether packets are captured to a file (see `SessionCapture`)
     void togglePacketLogging(bool enabled);
 
+    // Deliver a packet to the listeners right away, as if it was received from the server.
+    // Used by `SessionReplay`, must be called on the main thread.
+    void dispatchReplayedPacket(std::shared_ptr<Packet> packet);
+
     // Returns the protocol version of this client
     uint16_t getUsedProtocol();
 
@@ -108,6 +116,18 @@ public:
     // Get the maximum protocol version of the currently connected server
     uint16_t getServerProtocol();
 
+    // Amount of level data packets received so far (wraps around). The server answers every player data packet with one,
+    // so this can be compared against the amount of sent player data to estimate loss.
+    uint32_t getReceivedLevelData();
+
+    // Loss, jitter and reordering of the UDP link, measured from sequence numbers. Only active with servers on protocol v17+.
+    LinkStats getLinkStats();
+
+    // Simulate a bad connection by delaying, dropping, duplicating and reordering datagrams (see `NetworkImpairment`),
+    // `std::nullopt` turns it off. Can also be set with the `globed-net-impairment` launch argument.
+    void setImpairment(std::optional<ImpairmentConfig> config);
+    std::optional<ImpairmentConfig> getImpairment();
+
     // Returns true if we are connected to a standalone game server, not tied to any central server.
     bool standalone();
 
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Latency of a game server, measured over a few samples by `ServerPinger`
+struct PingStats {
+    int median = -1;    // in ms, -1 if none of the samples were answered
+    int jitter = 0;     // average difference between consecutive answered samples, in ms
+    uint8_t sent = 0;
+    uint8_t received = 0;
+    uint32_t playerCount = 0;
+};
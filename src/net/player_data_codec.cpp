@@ -0,0 +1,120 @@
+#include "player_data_codec.hpp"
+
+#include <algorithm>
+
+void PlayerDataCodec::reset() {
+    sentFrames = {};
+    receivedFrames = {};
+    lastSentFrame = 0;
+    ackedSentFrame = 0;
+    lastReceivedFrame = 0;
+    sinceKeyframe = 0;
+}
+
+std::shared_ptr<PlayerDataCompactPacket> PlayerDataCodec::compress(PlayerDataPacket& packet) {
+    auto out = makePooled<PlayerDataCompactPacket>();
+
+    lastSentFrame = nextFrameId(lastSentFrame);
+
+    out->frame = lastSentFrame;
+    out->levelDataAck = lastReceivedFrame;
+    out->data = CompactPlayerData::fromPlayerData(packet.data);
+    out->meta = packet.meta;
+    out->counterChanges = std::move(packet.counterChanges);
+
+    // delta encode against the newest frame the server has, unless it's time for a keyframe
+    auto& acked = sentFrames[ackedSentFrame % HISTORY_SIZE];
+    if (ackedSentFrame != 0 && acked.id == ackedSentFrame && isInHistory(ackedSentFrame) && sinceKeyframe < KEYFRAME_INTERVAL) {
+        out->baseFrame = ackedSentFrame;
+        out->base = acked.data;
+        sinceKeyframe++;
+    } else {
+        out->baseFrame = 0;
+        sinceKeyframe = 0;
+    }
+
+    sentFrames[lastSentFrame % HISTORY_SIZE] = SentFrame {
+        .id = lastSentFrame,
+        .data = out->data.quantized,
+    };
+
+    return out;
+}
+
+ByteBuffer::DecodeResult<std::shared_ptr<LevelDataPacket>> PlayerDataCodec::expand(LevelDataCompactPacket& packet) {
+    // the server has received one of our frames, so we can use it as the base from now on.
+    // an ack that fell out of the history can't be compared reliably anymore, so any new one replaces it
+    if (packet.playerDataAck != 0 && (ackedSentFrame == 0 || !isInHistory(ackedSentFrame) || isNewer(packet.playerDataAck, ackedSentFrame))) {
+        ackedSentFrame = packet.playerDataAck;
+    }
+
+    const ReceivedFrame* base = nullptr;
+    if (packet.baseFrame != 0) {
+        auto& slot = receivedFrames[packet.baseFrame % HISTORY_SIZE];
+        if (slot.id != packet.baseFrame) {
+            return Err(ByteBuffer::DecodeError::MissingDeltaBase);
+        }
+
+        base = &slot;
+    }
+
+    ByteBuffer buf(std::move(packet.payload));
+
+    GLOBED_UNWRAP_INTO(buf.readLength(), size_t count);
+
+    auto out = makePooled<LevelDataPacket>();
+    out->players.reserve(count);
+
+    ReceivedFrame frame;
+    frame.id = packet.frame;
+    frame.players.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        GLOBED_UNWRAP_INTO(buf.readI32(), int accountId);
+
+        const QuantizedPlayerData* playerBase = nullptr;
+        if (base) {
+            // the server usually sends players in the same order every time, so check the same index first
+            auto& players = base->players;
+            if (i < players.size() && players[i].first == accountId) {
+                playerBase = &players[i].second;
+            } else {
+                auto it = std::find_if(players.begin(), players.end(), [&](auto& p) { return p.first == accountId; });
+                if (it != players.end()) {
+                    playerBase = &it->second;
+                }
+            }
+        }
+
+        GLOBED_UNWRAP_INTO(CompactPlayerData::decode(buf, playerBase), auto data);
+
+        frame.players.emplace_back(accountId, data.quantized);
+        out->players.emplace_back(accountId, data.toPlayerData());
+    }
+
+    GLOBED_UNWRAP_INTO(buf.readValue<std::optional<std::map<uint16_t, int>>>(), out->customItems);
+
+    // only remember the frame once it has been fully decoded
+    if (lastReceivedFrame == 0 || isNewer(packet.frame, lastReceivedFrame)) {
+        lastReceivedFrame = packet.frame;
+    }
+
+    receivedFrames[packet.frame % HISTORY_SIZE] = std::move(frame);
+
+    return Ok(std::move(out));
+}
+
+uint8_t PlayerDataCodec::nextFrameId(uint8_t id) {
+    id++;
+    return id == 0 ? 1 : id;
+}
+
+bool PlayerDataCodec::isInHistory(uint8_t id) const {
+    // the server only keeps the last HISTORY_SIZE frames, older ones may already be overwritten
+    return static_cast<uint8_t>(lastSentFrame - id) < HISTORY_SIZE;
+}
+
+bool PlayerDataCodec::isNewer(uint8_t id, uint8_t than) {
+    uint8_t diff = id - than;
+    return diff != 0 && diff < 128;
+}
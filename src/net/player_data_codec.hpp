@@ -0,0 +1,57 @@
+#pragma once
+#include <data/packets/client/game.hpp>
+#include <data/packets/server/game.hpp>
+
+#include <array>
+
+/*
+* PlayerDataCodec - state for the compact player data encoding (protocol v14).
+*
+* Every frame is delta encoded against the newest frame the other side has acknowledged. Acknowledgements are piggybacked
+* on the packets going the other way, as every `LevelDataCompactPacket` is a response to a `PlayerDataCompactPacket`.
+* Frame IDs are a wrapping 8-bit counter that skips 0, which is used to mean "no frame".
+*
+* Not thread safe.
+*/
+class PlayerDataCodec {
+public:
+    // First protocol version that supports the compact encoding
+    static constexpr uint16_t MIN_PROTOCOL = 14;
+    // How many frames are remembered in each direction
+    static constexpr size_t HISTORY_SIZE = 32;
+    // Force a keyframe every this many frames, so that a desync can never last long
+    static constexpr size_t KEYFRAME_INTERVAL = 90;
+
+    // Forget all the state, must be called whenever a new session is established
+    void reset();
+
+    // Convert a `PlayerDataPacket` into a `PlayerDataCompactPacket`. Moves the counter changes out of `packet`.
+    std::shared_ptr<PlayerDataCompactPacket> compress(PlayerDataPacket& packet);
+
+    // Expand a `LevelDataCompactPacket` into a `LevelDataPacket`. Moves the payload out of `packet`.
+    ByteBuffer::DecodeResult<std::shared_ptr<LevelDataPacket>> expand(LevelDataCompactPacket& packet);
+
+private:
+    struct SentFrame {
+        uint8_t id = 0;
+        QuantizedPlayerData data;
+    };
+
+    struct ReceivedFrame {
+        uint8_t id = 0;
+        std::vector<std::pair<int, QuantizedPlayerData>> players;
+    };
+
+    std::array<SentFrame, HISTORY_SIZE> sentFrames;
+    std::array<ReceivedFrame, HISTORY_SIZE> receivedFrames;
+    uint8_t lastSentFrame = 0;
+    uint8_t ackedSentFrame = 0;
+    uint8_t lastReceivedFrame = 0;
+    size_t sinceKeyframe = 0;
+
+    static uint8_t nextFrameId(uint8_t id);
+    // Returns true if the sent frame `id` is recent enough that the server still has it
+    bool isInHistory(uint8_t id) const;
+    // Returns true if `id` is newer than `than`, taking wrapping into account
+    static bool isNewer(uint8_t id, uint8_t than);
+};
@@ -0,0 +1,101 @@
+#include "poll_waker.hpp"
+
+#include <defs/assert.hpp>
+#include <util/net.hpp>
+
+#ifdef GEODE_IS_WINDOWS
+# include <WinSock2.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#ifdef GEODE_IS_ANDROID
+# include <sys/eventfd.h>
+#endif
+
+PollWaker::PollWaker() {
+#if defined(GEODE_IS_ANDROID)
+    _read = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    GLOBED_REQUIRE(_read != -1, fmt::format("failed to create an eventfd: {}", util::net::lastErrorString()));
+#elif defined(GLOBED_IS_UNIX)
+    int fds[2];
+    GLOBED_REQUIRE(::pipe(fds) == 0, fmt::format("failed to create a pipe: {}", util::net::lastErrorString()));
+
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    _read = fds[0];
+    _write = fds[1];
+#else
+    // a udp socket that sends datagrams to itself
+    SOCKET sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+    GLOBED_REQUIRE(sock != INVALID_SOCKET, fmt::format("failed to create a wakeup socket: {}", util::net::lastErrorString()));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    int addrLen = sizeof(addr);
+    bool ok = ::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0
+        && ::getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0
+        && ::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+
+    unsigned long mode = 1;
+    ok = ok && ioctlsocket(sock, FIONBIO, &mode) == 0;
+
+    GLOBED_REQUIRE(ok, fmt::format("failed to set up the wakeup socket: {}", util::net::lastErrorString()));
+
+    _read = sock;
+    _write = sock;
+#endif
+}
+
+PollWaker::~PollWaker() {
+#if defined(GEODE_IS_ANDROID)
+    ::close(_read);
+#elif defined(GLOBED_IS_UNIX)
+    ::close(_read);
+    ::close(_write);
+#else
+    ::closesocket(_read);
+#endif
+}
+
+void PollWaker::wake() {
+    // only the first wakeup writes anything, the poller will see the rest once it drains
+    if (_pending.exchange(true)) return;
+
+#if defined(GEODE_IS_ANDROID)
+    uint64_t one = 1;
+    (void) ::write(_read, &one, sizeof(one));
+#elif defined(GLOBED_IS_UNIX)
+    char byte = 0;
+    (void) ::write(_write, &byte, 1);
+#else
+    char byte = 0;
+    (void) ::send(_write, &byte, 1, 0);
+#endif
+}
+
+void PollWaker::drain() {
+#if defined(GEODE_IS_ANDROID)
+    uint64_t value;
+    (void) ::read(_read, &value, sizeof(value));
+#elif defined(GLOBED_IS_UNIX)
+    char buf[64];
+    while (::read(_read, buf, sizeof(buf)) > 0) {}
+#else
+    char buf[64];
+    while (::recv(_read, buf, sizeof(buf), 0) > 0) {}
+#endif
+
+    // cleared only after reading, so a wakeup can never be left behind unread with `_pending` still set
+    _pending = false;
+}
+
+PollWaker::Handle PollWaker::handle() const {
+    return _read;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <defs/platform.hpp>
+#include <asp/sync.hpp>
+
+/*
+* PollWaker - a descriptor that can be added to a poll set to interrupt it from another thread.
+*
+* Uses an eventfd on Android, a self-pipe on other unix systems and a loopback UDP socket on Windows,
+* as WSAPoll only accepts sockets.
+*/
+class PollWaker {
+public:
+#ifdef GLOBED_IS_UNIX
+    using Handle = int;
+#else
+    using Handle = size_t; // SOCKET
+#endif
+
+    PollWaker();
+    ~PollWaker();
+
+    PollWaker(const PollWaker&) = delete;
+    PollWaker& operator=(const PollWaker&) = delete;
+
+    // Make the descriptor readable, waking up whoever is polling it. Thread safe, repeated calls before `drain` are coalesced.
+    void wake();
+
+    // Consume all pending wakeups, must be called once the descriptor was reported as readable.
+    // Whatever the wakeup was for must be checked after this call, not before.
+    void drain();
+
+    // Descriptor that should be polled for reading
+    Handle handle() const;
+
+private:
+    Handle _read;
+#ifndef GEODE_IS_ANDROID
+    Handle _write; // same as `_read` on Windows
+#endif
+
+    asp::AtomicBool _pending = false;
+};
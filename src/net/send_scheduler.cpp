@@ -0,0 +1,147 @@
+#include "send_scheduler.hpp"
+
+#include <data/packets/all.hpp>
+
+using namespace asp::time;
+
+SendClass SendScheduler::classify(const Packet& packet) {
+    switch (packet.getPacketId()) {
+        case PlayerDataPacket::PACKET_ID:
+        case PlayerDataCompactPacket::PACKET_ID:
+            return SendClass::Realtime;
+
+#ifdef GLOBED_VOICE_SUPPORT
+        // also covers `RawPacket`s that carry voice frames
+        case VoicePacket::PACKET_ID:
+            return SendClass::Voice;
+#endif
+
+        case RequestPlayerProfilesPacket::PACKET_ID:
+        case RequestGlobalPlayerListPacket::PACKET_ID:
+        case RequestLevelListPacket::PACKET_ID:
+        case RequestPlayerCountPacket::PACKET_ID:
+        case RequestRoomPlayerListPacket::PACKET_ID:
+        case RequestRoomListPacket::PACKET_ID:
+        case AdminGetPunishmentHistoryPacket::PACKET_ID:
+        case ConnectionTestPacket::PACKET_ID:
+            return SendClass::Bulk;
+
+        default:
+            return SendClass::Control;
+    }
+}
+
+const char* SendScheduler::className(SendClass cls) {
+    switch (cls) {
+        case SendClass::Realtime: return "realtime";
+        case SendClass::Voice: return "voice";
+        case SendClass::Control: return "control";
+        case SendClass::Bulk: return "bulk";
+    }
+
+    return "unknown";
+}
+
+void SendScheduler::push(std::shared_ptr<Packet> packet) {
+    auto cls = classify(*packet);
+    size_t idx = static_cast<size_t>(cls);
+
+    auto state = _state.lock();
+    auto& queue = state->queues[idx];
+    auto& metrics = state->metrics[idx];
+
+    if (cls == SendClass::Realtime) {
+        for (auto& entry : queue) {
+            if (entry.packet->getPacketId() == packet->getPacketId()) {
+                coalesce(*packet, *entry.packet);
+                // keeps its place in the queue and `queuedAt`, so the latency covers the whole wait of the slot
+                entry.packet = std::move(packet);
+                metrics.coalesced++;
+                return;
+            }
+        }
+    }
+
+    queue.push_back(Entry {
+        .packet = std::move(packet),
+        .sendClass = cls,
+        .queuedAt = Instant::now(),
+    });
+
+    metrics.depth = queue.size();
+    metrics.maxDepth = std::max(metrics.maxDepth, metrics.depth);
+}
+
+std::optional<SendScheduler::Entry> SendScheduler::pop() {
+    auto state = _state.lock();
+
+    for (size_t i = 0; i < CLASS_COUNT; i++) {
+        auto& queue = state->queues[i];
+        if (queue.empty()) continue;
+
+        auto entry = std::move(queue.front());
+        queue.pop_front();
+        state->metrics[i].depth = queue.size();
+
+        return entry;
+    }
+
+    return std::nullopt;
+}
+
+void SendScheduler::recordSent(const Entry& entry) {
+    uint64_t latency = entry.queuedAt.elapsed().micros();
+
+    auto state = _state.lock();
+    auto& metrics = state->metrics[static_cast<size_t>(entry.sendClass)];
+
+    metrics.sent++;
+    metrics.totalLatencyMicros += latency;
+    metrics.maxLatencyMicros = std::max(metrics.maxLatencyMicros, latency);
+}
+
+void SendScheduler::clear() {
+    auto state = _state.lock();
+
+    for (size_t i = 0; i < CLASS_COUNT; i++) {
+        state->queues[i].clear();
+        state->metrics[i].depth = 0;
+    }
+}
+
+std::array<SendScheduler::ClassMetrics, SendScheduler::CLASS_COUNT> SendScheduler::metrics() {
+    return _state.lock()->metrics;
+}
+
+void SendScheduler::resetMetrics() {
+    auto state = _state.lock();
+
+    for (size_t i = 0; i < CLASS_COUNT; i++) {
+        state->metrics[i] = ClassMetrics {
+            .depth = state->queues[i].size(),
+        };
+    }
+}
+
+void SendScheduler::coalesce(Packet& newer, Packet& older) {
+    auto* newPd = newer.tryDowncast<PlayerDataPacket>();
+    auto* oldPd = older.tryDowncast<PlayerDataPacket>();
+
+    if (!newPd || !oldPd) return;
+
+    // the metadata is only sent every so often, don't lose it
+    if (!newPd->meta && oldPd->meta) {
+        newPd->meta = std::move(oldPd->meta);
+    }
+
+    // counter changes are deltas, all of them have to reach the server and in order
+    if (!oldPd->counterChanges.empty()) {
+        oldPd->counterChanges.insert(
+            oldPd->counterChanges.end(),
+            std::make_move_iterator(newPd->counterChanges.begin()),
+            std::make_move_iterator(newPd->counterChanges.end())
+        );
+
+        newPd->counterChanges = std::move(oldPd->counterChanges);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include <asp/sync.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <data/packets/packet.hpp>
+
+// Priority classes of outgoing packets, in the order they are sent
+enum class SendClass : uint8_t {
+    Realtime, // player state, only the newest one matters
+    Voice,
+    Control,  // everything that isn't any of the other classes
+    Bulk,     // requests for big lists that nobody is waiting on in realtime
+};
+
+/*
+* SendScheduler - outgoing packet queue of the network thread.
+*
+* Packets are split into priority classes, so that a burst of requests can never delay player data or voice.
+* Realtime packets are latest-wins: queueing a packet while an older one with the same ID is still waiting replaces it
+* (carrying over anything from the older one that must not be lost, like counter changes).
+*
+* `push` is thread safe, everything else must only be called from the network thread.
+*/
+class SendScheduler {
+public:
+    static constexpr size_t CLASS_COUNT = 4;
+
+    struct Entry {
+        std::shared_ptr<Packet> packet;
+        SendClass sendClass;
+        asp::time::Instant queuedAt;
+    };
+
+    struct ClassMetrics {
+        size_t depth = 0;     // packets waiting right now
+        size_t maxDepth = 0;
+        size_t sent = 0;
+        size_t coalesced = 0; // realtime packets that were replaced by a newer one
+        uint64_t totalLatencyMicros = 0;
+        uint64_t maxLatencyMicros = 0;
+    };
+
+    static SendClass classify(const Packet& packet);
+    static const char* className(SendClass cls);
+
+    void push(std::shared_ptr<Packet> packet);
+
+    // Take the next packet that should be sent, or `std::nullopt` if all queues are empty
+    std::optional<Entry> pop();
+
+    // Record the queueing latency of a packet returned by `pop`, once it was written to the socket
+    void recordSent(const Entry& entry);
+
+    // Drop every queued packet, called when disconnecting
+    void clear();
+
+    // Metrics of every class since the last `resetMetrics`
+    std::array<ClassMetrics, CLASS_COUNT> metrics();
+    void resetMetrics();
+
+private:
+    struct State {
+        std::array<std::deque<Entry>, CLASS_COUNT> queues;
+        std::array<ClassMetrics, CLASS_COUNT> metrics;
+    };
+
+    asp::Mutex<State> _state;
+
+    // Merge whatever must survive from `older` into `newer`, before `older` is dropped
+    static void coalesce(Packet& newer, Packet& older);
+};
@@ -0,0 +1,135 @@
+#include "server_pinger.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+using namespace asp::time;
+
+ServerPinger::ServerPinger() : nextPingId(std::random_device{}()) {}
+
+uint32_t ServerPinger::beginRound(const std::string& serverId) {
+    uint32_t id = nextRound++;
+
+    rounds[serverId] = Round {
+        .id = id,
+        .rtts = std::vector<int>(SAMPLES, -1),
+    };
+
+    return id;
+}
+
+std::optional<uint32_t> ServerPinger::startSample(const std::string& serverId, uint32_t round) {
+    auto it = rounds.find(serverId);
+    if (it == rounds.end() || it->second.id != round || it->second.started >= SAMPLES) {
+        return std::nullopt;
+    }
+
+    uint32_t pingId = nextPingId++;
+
+    pending.emplace(pingId, PendingSample {
+        .serverId = serverId,
+        .round = round,
+        .sample = it->second.started++,
+        .sentAt = Instant::now(),
+    });
+
+    return pingId;
+}
+
+bool ServerPinger::owns(uint32_t pingId) const {
+    return pending.contains(pingId);
+}
+
+std::optional<ServerPinger::Result> ServerPinger::finishSample(uint32_t pingId, uint32_t playerCount) {
+    auto node = pending.extract(pingId);
+    if (node.empty()) return std::nullopt;
+
+    auto& sample = node.mapped();
+
+    auto it = rounds.find(sample.serverId);
+    if (it == rounds.end() || it->second.id != sample.round) {
+        // answer to a round that was replaced since
+        return std::nullopt;
+    }
+
+    it->second.rtts[sample.sample] = static_cast<int>(sample.sentAt.elapsed().millis());
+    it->second.playerCount = playerCount;
+
+    return this->tryComplete(sample.serverId);
+}
+
+std::vector<ServerPinger::Result> ServerPinger::expire() {
+    std::vector<std::string> touched;
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->second.sentAt.elapsed() < Duration::fromMillis(TIMEOUT_MS)) {
+            ++it;
+            continue;
+        }
+
+        auto round = rounds.find(it->second.serverId);
+        if (round != rounds.end() && round->second.id == it->second.round) {
+            round->second.lost++;
+            touched.push_back(it->second.serverId);
+        }
+
+        it = pending.erase(it);
+    }
+
+    std::vector<Result> out;
+
+    for (auto& serverId : touched) {
+        if (auto result = this->tryComplete(serverId)) {
+            out.push_back(std::move(*result));
+        }
+    }
+
+    return out;
+}
+
+void ServerPinger::clear() {
+    rounds.clear();
+    pending.clear();
+}
+
+std::optional<ServerPinger::Result> ServerPinger::tryComplete(const std::string& serverId) {
+    auto it = rounds.find(serverId);
+    if (it == rounds.end()) return std::nullopt;
+
+    auto& round = it->second;
+
+    std::vector<int> answered;
+    for (int rtt : round.rtts) {
+        if (rtt != -1) answered.push_back(rtt);
+    }
+
+    if (answered.size() + round.lost < SAMPLES) return std::nullopt;
+
+    PingStats stats {
+        .sent = SAMPLES,
+        .received = static_cast<uint8_t>(answered.size()),
+        .playerCount = round.playerCount,
+    };
+
+    // consecutive in the order they were sent, not the order they arrived in
+    if (answered.size() > 1) {
+        int total = 0;
+        for (size_t i = 1; i < answered.size(); i++) {
+            total += std::abs(answered[i] - answered[i - 1]);
+        }
+
+        stats.jitter = total / static_cast<int>(answered.size() - 1);
+    }
+
+    if (!answered.empty()) {
+        std::sort(answered.begin(), answered.end());
+
+        size_t mid = answered.size() / 2;
+        stats.median = answered.size() % 2 ? answered[mid] : (answered[mid - 1] + answered[mid]) / 2;
+    }
+
+    rounds.erase(it);
+
+    return Result { serverId, stats };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <asp/time/Instant.hpp>
+
+#include "ping_stats.hpp"
+
+/*
+* ServerPinger - measures the latency of all the servers in the list at once.
+*
+* Every round sends `SAMPLES` pings to each server, `SAMPLE_INTERVAL_MS` apart so that they don't all end up in the same queue.
+* A server's result is ready as soon as all of its samples were answered, anything that is still unanswered after `TIMEOUT_MS`
+* is counted as lost. Starting a new round for a server that is still being measured drops the old one.
+*
+* It only keeps the books, sending the pings is up to the caller. Not thread safe, only used by the network thread.
+*/
+class ServerPinger {
+public:
+    using Result = std::pair<std::string, PingStats>;
+
+    static constexpr uint8_t SAMPLES = 3;
+    static constexpr uint64_t SAMPLE_INTERVAL_MS = 100;
+    static constexpr uint64_t TIMEOUT_MS = 1500;
+
+    ServerPinger();
+
+    // Start measuring a server, returns the round that has to be passed to `startSample`
+    uint32_t beginRound(const std::string& serverId);
+
+    // Register a sample that is about to be sent, returns the ID to put in the ping packet,
+    // or `std::nullopt` if the round was replaced by a newer one or already has all of its samples
+    std::optional<uint32_t> startSample(const std::string& serverId, uint32_t round);
+
+    // Whether the ping ID was handed out by `startSample` and is still waiting for an answer
+    bool owns(uint32_t pingId) const;
+
+    // Called for every ping response, returns the result of the server if this was the last sample it was waiting for
+    std::optional<Result> finishSample(uint32_t pingId, uint32_t playerCount);
+
+    // Give up on samples older than `TIMEOUT_MS`, returns the results of the servers that have nothing left to wait for
+    std::vector<Result> expire();
+
+    void clear();
+
+private:
+    struct Round {
+        uint32_t id;
+        uint8_t started = 0;
+        uint8_t lost = 0;
+        std::vector<int> rtts; // indexed by sample, -1 if not answered (yet)
+        uint32_t playerCount = 0;
+    };
+
+    struct PendingSample {
+        std::string serverId;
+        uint32_t round;
+        uint8_t sample;
+        asp::time::Instant sentAt;
+    };
+
+    uint32_t nextPingId;
+    uint32_t nextRound = 1;
+    std::unordered_map<std::string, Round> rounds;
+    std::unordered_map<uint32_t, PendingSample> pending;
+
+    // Returns the result and forgets the round if there is nothing left to wait for
+    std::optional<Result> tryComplete(const std::string& serverId);
+};
@@ -0,0 +1,152 @@
+#include "session_capture.hpp"
+
+#include <defs/geode.hpp>
+#include <data/bytebuffer.hpp>
+#include <data/packets/all.hpp>
+#include <globed/tracing.hpp>
+#include <util/format.hpp>
+
+using namespace geode::prelude;
+using namespace asp::time;
+
+SessionCapture::SessionCapture() {
+    thread.setStartFunction([] { geode::utils::thread::setName("Capture Thread"); });
+    thread.setLoopFunction(&SessionCapture::threadFunc);
+}
+
+SessionCapture::~SessionCapture() {
+    if (threadStarted) {
+        TRACE("[SessionCapture] waiting for thread to stop");
+        this->stop();
+        thread.stopAndWait();
+    }
+}
+
+std::filesystem::path SessionCapture::directory() {
+    return Mod::get()->getSaveDir() / "captures";
+}
+
+Result<std::filesystem::path> SessionCapture::start() {
+    this->stop();
+
+    auto folder = directory();
+    GLOBED_UNWRAP(geode::utils::file::createDirectoryAll(folder));
+
+    auto path = folder / fmt::format("{}.gcap", util::format::fileDateTime(SystemTime::now()));
+
+    // the writer thread is only started once someone actually wants to capture
+    if (!threadStarted) {
+        thread.start(this);
+        threadStarted = true;
+    }
+
+    queue.push(OpenFile {
+        .path = path,
+        .startedAt = Instant::now(),
+    });
+
+    *activeFile.lock() = path;
+    active = true;
+
+    log::info("Capturing packets to {}", path);
+
+    return Ok(path);
+}
+
+void SessionCapture::stop() {
+    if (!active) return;
+
+    active = false;
+    activeFile.lock()->reset();
+    queue.push(CloseFile {});
+}
+
+bool SessionCapture::isActive() const {
+    return active;
+}
+
+std::optional<std::filesystem::path> SessionCapture::activePath() const {
+    return *activeFile.lock();
+}
+
+bool SessionCapture::isRedacted(packetid_t id) {
+    switch (id) {
+        case LoginPacket::PACKET_ID:
+        case AdminAuthPacket::PACKET_ID:
+        case AdminSetAdminPasswordPacket::PACKET_ID:
+        case SessionKeysPacket::PACKET_ID:
+        case SessionTicketPacket::PACKET_ID:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void SessionCapture::record(CaptureDirection direction, packetid_t id, const uint8_t* payload, size_t size) {
+    if (!active) return;
+
+    if (isRedacted(id)) {
+        size = 0;
+    }
+
+    queue.push(Record {
+        .at = Instant::now(),
+        .direction = direction,
+        .id = id,
+        .payload = std::vector<uint8_t>(payload, payload + size),
+    });
+}
+
+void SessionCapture::threadFunc(decltype(thread)::StopToken&) {
+    auto message = queue.popTimeout(Duration::fromMillis(200));
+
+    if (!message) {
+        // nothing happened for a while, make sure everything so far actually made it to the disk
+        if (file.is_open()) {
+            file.flush();
+        }
+
+        return;
+    }
+
+    this->handleMessage(*message);
+}
+
+void SessionCapture::handleMessage(Message& message) {
+    if (auto* open = std::get_if<OpenFile>(&message)) {
+        this->closeFile();
+
+        file.open(open->path, std::ios::binary | std::ios::app);
+        if (!file.is_open()) {
+            log::warn("Failed to open the capture file {}", open->path);
+            return;
+        }
+
+        startedAt = open->startedAt;
+
+        ByteBuffer header;
+        header.writeU32(MAGIC);
+        header.writeU32(VERSION);
+        file.write(reinterpret_cast<const char*>(header.dataPtr()), header.size());
+    } else if (std::holds_alternative<CloseFile>(message)) {
+        this->closeFile();
+    } else if (auto* record = std::get_if<Record>(&message)) {
+        // records that were queued right before the capture was stopped
+        if (!file.is_open()) return;
+
+        ByteBuffer header;
+        header.writeU64(record->at.durationSince(startedAt).micros());
+        header.writeU8(static_cast<uint8_t>(record->direction));
+        header.writeU16(record->id);
+        header.writeU32(record->payload.size());
+
+        file.write(reinterpret_cast<const char*>(header.dataPtr()), header.size());
+        file.write(reinterpret_cast<const char*>(record->payload.data()), record->payload.size());
+    }
+}
+
+void SessionCapture::closeFile() {
+    if (file.is_open()) {
+        file.close();
+    }
+}
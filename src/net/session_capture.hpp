@@ -0,0 +1,96 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include <asp/sync.hpp>
+#include <asp/thread/Thread.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <data/packets/packet.hpp>
+#include <util/singleton.hpp>
+
+enum class CaptureDirection : uint8_t {
+    Inbound = 0,
+    Outbound = 1,
+};
+
+/*
+* SessionCapture - records every packet sent or received to a single append-only file.
+*
+* Packets are recorded in plaintext (after decryption / before encryption), the calling thread only copies the payload
+* into a queue and a background thread does all the writing. Captures get shared, so packets carrying credentials or keys
+* (see `isRedacted`) are recorded without their payload.
+*
+* File format (all integers big endian, as written by `ByteBuffer`):
+*   u32 magic, u32 version
+*   then any amount of records: u64 microseconds since the capture started, u8 direction, u16 packet id,
+*   u32 payload length, payload (the encoded packet, without the packet header)
+*
+* Thread safe.
+*/
+class SessionCapture : public SingletonBase<SessionCapture> {
+protected:
+    friend class SingletonBase;
+    SessionCapture();
+    ~SessionCapture();
+
+public:
+    static constexpr uint32_t MAGIC = 0x474c4350; // "GLCP"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(packetid_t) + sizeof(uint32_t);
+
+    // Where captures are saved by default
+    static std::filesystem::path directory();
+
+    // Start capturing into a new file in `directory()`, stops the current capture if there is one. Returns the path of the file.
+    Result<std::filesystem::path> start();
+
+    // Stop capturing, packets recorded before this call still end up in the file
+    void stop();
+
+    bool isActive() const;
+
+    // The file that is currently being written to, if a capture is active
+    std::optional<std::filesystem::path> activePath() const;
+
+    // Whether packets with this id are recorded with an empty payload, as it would let anyone holding the capture take over the session
+    static bool isRedacted(packetid_t id);
+
+    // Record a packet, does nothing if no capture is active
+    void record(CaptureDirection direction, packetid_t id, const uint8_t* payload, size_t size);
+
+private:
+    struct Record {
+        asp::time::Instant at;
+        CaptureDirection direction;
+        packetid_t id;
+        std::vector<uint8_t> payload;
+    };
+
+    struct OpenFile {
+        std::filesystem::path path;
+        asp::time::Instant startedAt;
+    };
+
+    struct CloseFile {};
+
+    using Message = std::variant<Record, OpenFile, CloseFile>;
+
+    asp::AtomicBool active = false;
+    mutable asp::Mutex<std::optional<std::filesystem::path>> activeFile;
+    asp::Channel<Message> queue;
+    asp::Thread<SessionCapture*> thread;
+    bool threadStarted = false;
+
+    // only used by the writer thread
+    std::ofstream file;
+    asp::time::Instant startedAt = asp::time::Instant::now();
+
+    void threadFunc(decltype(thread)::StopToken&);
+    void handleMessage(Message& message);
+    void closeFile();
+};
@@ -0,0 +1,229 @@
+#include "session_replay.hpp"
+
+#include "game_socket.hpp"
+#include "impairment.hpp"
+#include "manager.hpp"
+#include "player_data_codec.hpp"
+#include "session_capture.hpp"
+
+#include <data/packets/all.hpp>
+#include <game/interpolator.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+using namespace geode::prelude;
+using namespace asp::time;
+
+static std::unique_ptr<PlayerInterpolator> makeInterpolator(uint32_t tps) {
+    return std::make_unique<PlayerInterpolator>(InterpolatorSettings {
+        .realtime = false,
+        .isPlatformer = false,
+        .expectedDelta = 1.0f / static_cast<float>(tps),
+    });
+}
+
+Result<SessionReplay::Stats> SessionReplay::run(const std::filesystem::path& path, const Options& options) {
+    std::ifstream file(path, std::ios::binary);
+    GLOBED_REQUIRE_SAFE(file.is_open(), fmt::format("failed to open {}", path.string()))
+
+    util::data::bytevector contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ByteBuffer input(std::move(contents));
+
+    auto magic = input.readU32();
+    auto version = input.readU32();
+    GLOBED_REQUIRE_SAFE(magic.isOk() && version.isOk(), "truncated capture, the header is incomplete")
+    GLOBED_REQUIRE_SAFE(*magic == SessionCapture::MAGIC, "not a packet capture")
+    GLOBED_REQUIRE_SAFE(*version == SessionCapture::VERSION, fmt::format("unsupported capture version {}", *version))
+
+    GameSocket decoder;
+    PlayerDataCodec codec;
+    auto interpolator = makeInterpolator(options.tps);
+
+    std::optional<NetworkImpairment> impairment;
+    if (options.impairment) {
+        impairment.emplace(*options.impairment);
+    }
+
+    Stats stats;
+    ByteBuffer frame;
+    std::vector<NetworkImpairment::Datagram> impaired;
+
+    // capture time that the interpolator was ticked up to
+    double timeCounter = 0.0;
+    uint64_t lastTimestamp = 0;
+
+    // `data` must be a full packet with its header, `timestamp` is when it arrives in capture time
+    auto deliver = [&](ByteBuffer& data, uint64_t timestamp) {
+        // catch the interpolator up to the time this packet arrived at, frame by frame like the game would
+        double packetTime = static_cast<double>(timestamp) / 1'000'000.0;
+        while (timeCounter + options.frameDelta <= packetTime) {
+            timeCounter += options.frameDelta;
+            interpolator->tick(options.frameDelta);
+            stats.interpolatorTicks++;
+        }
+
+        // replayed packets must not show up in the live net stats or in the capture that is being written
+        auto decoded = decoder.decodePacket(data, true, CipherStream::Tcp, false);
+        if (!decoded) {
+            stats.decodeFailures++;
+            log::debug("[replay] failed to decode packet: {}", decoded.unwrapErr());
+            return;
+        }
+
+        std::shared_ptr<Packet> packet = std::move(decoded.unwrap());
+
+        if (auto* loggedIn = packet->tryDowncast<LoggedInPacket>()) {
+            // new session
+            codec.reset();
+            interpolator = makeInterpolator(loggedIn->tps ? loggedIn->tps : options.tps);
+        } else if (auto* compact = packet->tryDowncast<LevelDataCompactPacket>()) {
+            auto expanded = codec.expand(*compact);
+            if (!expanded) {
+                stats.decodeFailures++;
+                log::debug("[replay] failed to expand compact level data: {}", ByteBuffer::strerror(expanded.unwrapErr()));
+                return;
+            }
+
+            packet = std::move(expanded.unwrap());
+        }
+
+        if (auto* levelData = packet->tryDowncast<LevelDataPacket>()) {
+            stats.levelDataPackets++;
+
+            for (const auto& player : levelData->players) {
+                if (!interpolator->hasPlayer(player.accountId)) {
+                    interpolator->addPlayer(player.accountId);
+                }
+
+                interpolator->updatePlayer(player.accountId, player.data, static_cast<float>(timeCounter));
+            }
+        }
+
+        if (options.dispatchToListeners) {
+            NetworkManager::get().dispatchReplayedPacket(std::move(packet));
+        }
+    };
+
+    // delivers everything the impairment layer held back until `timestamp`, each one at the time it was due
+    auto deliverImpaired = [&](uint64_t timestamp) {
+        impaired.clear();
+        impairment->takeDue(ImpairDirection::Inbound, timestamp, impaired);
+
+        for (auto& datagram : impaired) {
+            auto buf = ByteBuffer::borrowed(datagram.data.data(), datagram.data.size());
+            deliver(buf, datagram.due);
+        }
+    };
+
+    auto started = Instant::now();
+
+    while (input.getPosition() < input.size()) {
+        auto timestamp = input.readU64();
+        auto direction = input.readU8();
+        auto id = input.readU16();
+        auto length = input.readU32();
+
+        size_t payloadStart = input.getPosition();
+
+        if (!timestamp || !direction || !id || !length || input.skip(*length).isErr()) {
+            // the game was likely closed in the middle of writing a record
+            log::warn("[replay] capture ends with a truncated record, stopping there");
+            break;
+        }
+
+        lastTimestamp = *timestamp;
+
+        if (static_cast<CaptureDirection>(*direction) == CaptureDirection::Outbound) {
+            stats.outbound++;
+            continue;
+        }
+
+        stats.inbound++;
+        stats.inboundBytes += *length;
+
+        // these were recorded without their payload, so there is nothing to decode
+        if (SessionCapture::isRedacted(*id)) {
+            continue;
+        }
+
+        // the payload is plaintext, so the header says it's not encrypted and the cleartext check must be skipped
+        frame.clear();
+        frame.writeValue<PacketHeader>(PacketHeader {
+            .id = *id,
+            .encrypted = false,
+        });
+        frame.grow(*length);
+        std::memcpy(frame.dataPtr() + PacketHeader::SIZE, input.dataPtr() + payloadStart, *length);
+        frame.setPosition(0);
+
+        if (impairment) {
+            impairment->submit(ImpairDirection::Inbound, frame.dataPtr(), frame.size(), true, *timestamp);
+            deliverImpaired(*timestamp);
+        } else {
+            deliver(frame, *timestamp);
+        }
+    }
+
+    // whatever is still held back arrives after the end of the capture, up to the last one that is due
+    if (impairment) {
+        while (auto next = impairment->untilNext(0)) {
+            deliverImpaired(*next);
+        }
+
+        stats.impairment = impairment->stats();
+    }
+
+    stats.captureLength = Duration::fromMicros(lastTimestamp);
+    stats.took = started.elapsed();
+
+    return Ok(stats);
+}
+
+bool SessionReplay::runDetached(std::filesystem::path path, Options options, std::function<void(Result<Stats>)> onFinish) {
+    static std::atomic<bool> running = false;
+
+    if (running.exchange(true)) return false;
+
+    // listeners may only be called on the main thread
+    options.dispatchToListeners = false;
+
+    std::thread([path = std::move(path), options = std::move(options), onFinish = std::move(onFinish)]() mutable {
+        geode::utils::thread::setName("Replay Thread");
+
+        auto result = run(path, options);
+        running = false;
+
+        Loader::get()->queueInMainThread([onFinish = std::move(onFinish), result = std::move(result)]() mutable {
+            onFinish(std::move(result));
+        });
+    }).detach();
+
+    return true;
+}
+
+std::optional<std::filesystem::path> SessionReplay::latestCapture() {
+    std::error_code ec;
+    std::optional<std::filesystem::path> latest;
+    std::filesystem::file_time_type latestTime;
+
+    // the active capture is still being written to
+    auto active = SessionCapture::get().activePath();
+
+    for (auto& entry : std::filesystem::directory_iterator(SessionCapture::directory(), ec)) {
+        if (entry.path().extension() != ".gcap") continue;
+        if (active && entry.path() == *active) continue;
+
+        auto time = entry.last_write_time(ec);
+        if (ec) continue;
+
+        if (!latest || time > latestTime) {
+            latest = entry.path();
+            latestTime = time;
+        }
+    }
+
+    return latest;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+
+#include <defs/minimal_geode.hpp>
+#include <asp/time/Duration.hpp>
+
+#include "impairment.hpp"
+
+/*
+* SessionReplay - feeds a capture made by `SessionCapture` back through the client, as fast as possible.
+*
+* Every inbound packet is decoded with `GameSocket::decodePacket` (without being recorded in the net stats or the active capture),
+* compact level data is expanded the same way as it is
+* when connected, and level data is fed into a standalone `PlayerInterpolator` that is ticked at a fixed rate in between
+* packets (using the capture timestamps, not the wall clock). Optionally, packets are also delivered to the packet listeners.
+* Outbound packets are only counted.
+*
+* With an impairment config, the capture is replayed as if it arrived over a worse connection. The same seed always gives
+* the same result, so interpolation can be compared between builds under exactly the same conditions.
+*
+* Must be called on the main thread if `dispatchToListeners` is enabled.
+*/
+class SessionReplay {
+public:
+    struct Options {
+        bool dispatchToListeners = false;
+        float frameDelta = 1.f / 60.f; // how often the interpolator is ticked, in capture time
+        uint32_t tps = 30;              // server tps, used until the capture contains a `LoggedInPacket`
+        std::optional<ImpairmentConfig> impairment; // inbound packets go through a `NetworkImpairment` on capture time first
+    };
+
+    struct Stats {
+        size_t inbound = 0;
+        size_t outbound = 0;
+        size_t decodeFailures = 0;
+        size_t levelDataPackets = 0;
+        size_t interpolatorTicks = 0;
+        uint64_t inboundBytes = 0;
+        NetworkImpairment::Stats impairment; // all zero unless `Options::impairment` is set
+        asp::time::Duration captureLength;
+        asp::time::Duration took;
+    };
+
+    static Result<Stats> run(const std::filesystem::path& path, const Options& options = {});
+
+    // Runs the replay on a separate thread so that the game doesn't freeze, then calls `onFinish` with the result on the main thread.
+    // Listeners are never dispatched to. Returns false and does nothing if a replay is already running.
+    static bool runDetached(std::filesystem::path path, Options options, std::function<void(Result<Stats>)> onFinish);
+
+    // The newest capture in `SessionCapture::directory()`
+    static std::optional<std::filesystem::path> latestCapture();
+};
@@ -0,0 +1,89 @@
+#include "tcp_frame_reader.hpp"
+
+#include "tcp_socket.hpp"
+#include <data/bytebuffer.hpp>
+#include <util/net.hpp>
+
+using namespace util::data;
+
+constexpr size_t LENGTH_PREFIX_SIZE = sizeof(uint32_t);
+
+TcpFrameReader::TcpFrameReader(size_t maxFrameSize) : _buffer(INITIAL_CAPACITY), _maxFrameSize(maxFrameSize) {}
+
+Result<size_t> TcpFrameReader::fill(TcpSocket& socket) {
+    GLOBED_REQUIRE_SAFE(socket.connected, "attempting to call TcpFrameReader::fill on a disconnected socket")
+
+    size_t buffered = _end - _start;
+
+    if (buffered == 0) {
+        _start = _end = 0;
+    }
+
+    // make sure the frame that is currently being received fits once it is complete
+    size_t needed = LENGTH_PREFIX_SIZE;
+    if (auto length = this->pendingFrameLength()) {
+        GLOBED_REQUIRE_SAFE(*length < _maxFrameSize, "packet is too big, rejecting")
+        needed += *length;
+    }
+
+    // also compact when there is little space left at the end, so that a single recv can still read a lot at once
+    bool lowOnSpace = _buffer.size() - _end < _buffer.size() / 4;
+
+    if (_start + needed > _buffer.size() || lowOnSpace) {
+        // move the partial frame to the front, this only ever copies less than one frame
+        if (_start > 0) {
+            std::memmove(_buffer.data(), _buffer.data() + _start, buffered);
+            _start = 0;
+            _end = buffered;
+        }
+
+        if (needed > _buffer.size()) {
+            _buffer.resize(needed);
+        }
+    }
+
+    auto result = socket.receive(reinterpret_cast<char*>(_buffer.data() + _end), _buffer.size() - _end).result;
+    if (result < 0) return Err(fmt::format("tcp recv failed ({}): {}", result, util::net::lastErrorString()));
+    if (result == 0) return Err("connection was closed by the server");
+
+    _end += result;
+
+    return Ok(static_cast<size_t>(result));
+}
+
+Result<std::optional<std::pair<byte*, size_t>>> TcpFrameReader::nextFrame() {
+    auto length = this->pendingFrameLength();
+    if (!length) {
+        return Ok(std::nullopt);
+    }
+
+    GLOBED_REQUIRE_SAFE(*length < _maxFrameSize, "packet is too big, rejecting")
+
+    if (_end - _start - LENGTH_PREFIX_SIZE < *length) {
+        return Ok(std::nullopt);
+    }
+
+    byte* frame = _buffer.data() + _start + LENGTH_PREFIX_SIZE;
+    _start += LENGTH_PREFIX_SIZE + *length;
+
+    return Ok(std::make_pair(frame, *length));
+}
+
+bool TcpFrameReader::hasFrame() const {
+    auto length = this->pendingFrameLength();
+    return length && _end - _start - LENGTH_PREFIX_SIZE >= *length;
+}
+
+void TcpFrameReader::clear() {
+    _start = _end = 0;
+}
+
+std::optional<size_t> TcpFrameReader::pendingFrameLength() const {
+    if (_end - _start < LENGTH_PREFIX_SIZE) {
+        return std::nullopt;
+    }
+
+    // the length is always 4 bytes so this can't fail
+    auto lengthBuf = ByteBuffer::borrowed(const_cast<byte*>(_buffer.data() + _start), LENGTH_PREFIX_SIZE);
+    return lengthBuf.readU32().unwrapOr(0);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <defs/minimal_geode.hpp>
+#include <util/data.hpp>
+
+class TcpSocket;
+
+/*
+* TcpFrameReader - buffered reader for the length-prefixed frames of a TCP stream.
+*
+* `fill` pulls everything that is currently available with a single `recv`, after which `nextFrame` yields every complete
+* frame in the buffer without any further syscalls. A partial frame stays buffered until the rest of it arrives,
+* so the caller never has to block waiting for it.
+*/
+class TcpFrameReader {
+public:
+    static constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+
+    // Frames with a length of `maxFrameSize` or more are rejected
+    TcpFrameReader(size_t maxFrameSize);
+
+    // Read whatever is available on the socket with a single `recv`. Blocks if nothing is available, so it should be called after polling.
+    // Returns the amount of bytes received.
+    Result<size_t> fill(TcpSocket& socket);
+
+    // Returns the next complete frame without its length prefix, or `std::nullopt` if there is no complete frame buffered.
+    // The frame is only valid until the next call to `fill` or `clear`, and may be modified in place (e.g. to decrypt it).
+    Result<std::optional<std::pair<util::data::byte*, size_t>>> nextFrame();
+
+    // Whether a complete frame is buffered and can be taken without calling `fill` first.
+    bool hasFrame() const;
+
+    // Drop all buffered data, must be called whenever the connection changes.
+    void clear();
+
+private:
+    std::vector<util::data::byte> _buffer;
+    size_t _start = 0; // start of the unconsumed data
+    size_t _end = 0;   // end of the received data
+    size_t _maxFrameSize;
+
+    // Length of the frame at `_start`, if its length prefix was fully received
+    std::optional<size_t> pendingFrameLength() const;
+};
@@ -1,11 +1,12 @@
 #include "tcp_socket.hpp"
 
-#include "address.hpp"
 #include <util/net.hpp>
+#include <asp/time/Instant.hpp>
 
 #ifdef GEODE_IS_WINDOWS
 # include <WinSock2.h>
 #else
+# include <sys/socket.h>
 # include <netinet/in.h>
 # include <fcntl.h>
 # include <poll.h>
@@ -18,57 +19,236 @@ constexpr static int WouldBlock = WSAEWOULDBLOCK;
 constexpr static int WouldBlock = EINPROGRESS;
 #endif
 
+#ifdef GEODE_IS_WINDOWS
+using RawSocket = SOCKET;
+constexpr static RawSocket InvalidSocket = INVALID_SOCKET;
+#else
+using RawSocket = int;
+constexpr static RawSocket InvalidSocket = -1;
+#endif
+
 using namespace geode::prelude;
+using namespace asp::time;
+
+static Result<> setNonBlockingRaw(RawSocket socket, bool nb) {
+#ifdef GEODE_IS_WINDOWS
+    unsigned long mode = nb ? 1 : 0;
+    if (SOCKET_ERROR == ioctlsocket(socket, FIONBIO, &mode)) return Err(fmt::format("ioctlsocket failed: {}", util::net::lastErrorString()));
+#else
+    int flags = fcntl(socket, F_GETFL);
+
+    if (nb) {
+        if (fcntl(socket, F_SETFL, flags | O_NONBLOCK) < 0) return Err(fmt::format("fcntl(O_NONBLOCK) failed: {}", util::net::lastErrorString()));
+    } else {
+        if (fcntl(socket, F_SETFL, flags & (~O_NONBLOCK)) < 0) return Err(fmt::format("fcntl(~O_NONBLOCK) failed: {}", util::net::lastErrorString()));
+    }
+#endif
 
-TcpSocket::TcpSocket() : socket_(0) {
-    destAddr_ = std::make_unique<sockaddr_in>();
-    std::memset(destAddr_.get(), 0, sizeof(sockaddr_in));
+    return Ok();
 }
 
+static void closeRaw(RawSocket socket) {
+#ifdef GEODE_IS_WINDOWS
+    ::closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+TcpSocket::TcpSocket() : socket_(0) {}
+
 TcpSocket::~TcpSocket() {
     this->close();
 }
 
 Result<> TcpSocket::connect(const NetworkAddress& address) {
+    GLOBED_UNWRAP_INTO(address.resolveAll(), auto addresses);
+
+    return this->connect(addresses);
+}
+
+Result<> TcpSocket::connect(const std::vector<SocketAddress>& addresses) {
+    GLOBED_UNWRAP(this->startConnect(addresses));
+
+    std::vector<GLOBED_SOCKET_POLLFD> fds;
+
+    while (true) {
+        GLOBED_UNWRAP_INTO(this->continueConnect(), bool done);
+        if (done) return Ok();
+
+        auto& pending = connecting_->pendingSockets;
+        fds.resize(pending.size());
+        for (size_t i = 0; i < pending.size(); i++) {
+            fds[i].fd = static_cast<RawSocket>(pending[i]);
+            fds[i].events = POLLOUT;
+            fds[i].revents = 0;
+        }
+
+        int timeout = static_cast<int>(this->untilConnectStep().value_or(Duration::fromMillis(0)).millis());
+        if (GLOBED_SOCKET_POLL(fds.data(), fds.size(), timeout) == -1) {
+            auto err = fmt::format("tcp poll failed: {}", util::net::lastErrorString());
+            this->abandonConnect();
+            return Err(std::move(err));
+        }
+    }
+}
+
+Result<> TcpSocket::startConnect(const std::vector<SocketAddress>& addresses) {
     // close any socket if still open
     this->close();
 
-    destAddr_->sin_family = AF_INET;
+    GLOBED_REQUIRE_SAFE(!addresses.empty(), "no addresses to connect to");
 
-    GLOBED_UNWRAP_INTO(address.resolve(), *destAddr_)
+    auto& state = connecting_.emplace();
+    state.addresses = addresses;
 
-    // create socket
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    socket_ = sock;
+    this->startAttempt(state);
+    state.nextAttemptAt = CONNECTION_ATTEMPT_DELAY_MS;
 
-    GLOBED_REQUIRE_SAFE(sock != -1, "failed to create a tcp socket: socket failed");
+    return Ok();
+}
 
-    // attempt a connection with a 5 second timeout
-    GLOBED_UNWRAP(this->setNonBlocking(true));
+void TcpSocket::startAttempt(ConnectState& state) {
+    while (state.nextAddr < state.addresses.size()) {
+        size_t idx = state.nextAddr++;
+        auto& addr = state.addresses[idx];
+
+        RawSocket sock = ::socket(addr.family(), SOCK_STREAM, 0);
+        if (sock == InvalidSocket) {
+            state.lastError = fmt::format("failed to create a tcp socket: {}", util::net::lastErrorString());
+            continue;
+        }
+
+        if (auto res = setNonBlockingRaw(sock, true); !res) {
+            state.lastError = std::move(res).unwrapErr();
+            closeRaw(sock);
+            continue;
+        }
+
+        int code = ::connect(sock, addr.sockaddrPtr(), addr.sockaddrLength());
+
+        // 0 (connected right away, local connection?) or EWOULDBLOCK (expected result)
+        if (code == 0 || util::net::lastErrorCode() == WouldBlock) {
+            state.pendingSockets.push_back(static_cast<Handle>(sock));
+            state.pendingAddrs.push_back(idx);
+            return;
+        }
+
+        state.lastError = fmt::format("tcp connect to {} failed: {}", addr.toString(), util::net::lastErrorString());
+        closeRaw(sock);
+    }
+}
 
-    int code = ::connect(socket_, reinterpret_cast<struct sockaddr*>(destAddr_.get()), sizeof(sockaddr_in));
+Result<bool> TcpSocket::continueConnect() {
+    GLOBED_REQUIRE_SAFE(connecting_.has_value(), "attempting to call TcpSocket::continueConnect without a connection in progress");
 
-    // if the code isn't 0 (success) or EWOULDBLOCK (expected result), close socket and return error
-    if (code != 0 && util::net::lastErrorCode() != WouldBlock) {
-        this->close();
+    auto& state = *connecting_;
+    auto& pending = state.pendingSockets;
+
+    // see which of the attempts finished, without waiting for any of them
+    std::vector<GLOBED_SOCKET_POLLFD> fds(pending.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        fds[i].fd = static_cast<RawSocket>(pending[i]);
+        fds[i].events = POLLOUT;
+        fds[i].revents = 0;
+    }
+
+    if (!fds.empty() && GLOBED_SOCKET_POLL(fds.data(), fds.size(), 0) == -1) {
+        auto err = fmt::format("tcp poll failed: {}", util::net::lastErrorString());
+        this->abandonConnect();
+        return Err(std::move(err));
+    }
 
-        return Err(fmt::format("tcp connect failed ({}): {}", code, util::net::lastErrorString()));
+    std::optional<std::pair<Handle, size_t>> winner;
+
+    // backwards, so that erasing doesn't shift the attempts that are yet to be checked
+    for (size_t i = pending.size(); i-- > 0;) {
+        if (fds[i].revents == 0) continue;
+
+        auto sock = static_cast<RawSocket>(pending[i]);
+        size_t addrIdx = state.pendingAddrs[i];
+        pending.erase(pending.begin() + i);
+        state.pendingAddrs.erase(state.pendingAddrs.begin() + i);
+
+        int error = 0;
+        socklen_t errorLen = sizeof(error);
+        if (::getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorLen) != 0) {
+            error = util::net::lastErrorCode();
+        }
+
+        if (error == 0 && !winner) {
+            winner = std::make_pair(static_cast<Handle>(sock), addrIdx);
+        } else {
+            if (error != 0) {
+                state.lastError = fmt::format("tcp connect to {} failed: {}", state.addresses[addrIdx].toString(), util::net::lastErrorString(error));
+            }
+
+            closeRaw(sock);
+        }
+    }
+
+    if (winner) {
+        destAddr_ = state.addresses[winner->second];
+
+        // abandon the attempts that lost the race
+        this->abandonConnect();
+
+        socket_ = winner->first;
+        GLOBED_UNWRAP(this->setNonBlocking(false));
+
+        connected = true;
+        return Ok(true);
     }
 
-    GLOBED_UNWRAP(this->setNonBlocking(false));
+    uint64_t elapsed = state.startedAt.elapsed().millis();
+    if (elapsed >= CONNECT_TIMEOUT_MS) {
+        this->abandonConnect();
+        return Err(fmt::format("connection timed out, failed to connect after {} seconds.", CONNECT_TIMEOUT_MS / 1000));
+    }
 
-    // if the connection succeeded without blocking (local connection?), just return
-    if (code == 0) {
-        return Ok();
+    // don't wait for the delay if every attempt so far already failed
+    bool moreAddresses = state.nextAddr < state.addresses.size();
+    if (moreAddresses && pending.size() < MAX_PENDING_ATTEMPTS && (pending.empty() || elapsed >= state.nextAttemptAt)) {
+        this->startAttempt(state);
+        state.nextAttemptAt = state.startedAt.elapsed().millis() + CONNECTION_ATTEMPT_DELAY_MS;
     }
 
-    // im crying why does this actually poll for double the length????
-    GLOBED_UNWRAP_INTO(this->poll(2500, false), auto pollResult);
+    if (pending.empty()) {
+        auto err = std::move(state.lastError);
+        this->abandonConnect();
+        return Err(std::move(err));
+    }
 
-    GLOBED_REQUIRE_SAFE(pollResult, "connection timed out, failed to connect after 5 seconds.")
+    return Ok(false);
+}
 
-    connected = true;
-    return Ok();
+bool TcpSocket::isConnecting() const {
+    return connecting_.has_value();
+}
+
+const std::vector<TcpSocket::Handle>& TcpSocket::pendingAttempts() const {
+    static const std::vector<Handle> none;
+    return connecting_ ? connecting_->pendingSockets : none;
+}
+
+std::optional<Duration> TcpSocket::untilConnectStep() const {
+    if (!connecting_) return std::nullopt;
+
+    uint64_t elapsed = connecting_->startedAt.elapsed().millis();
+    bool moreAddresses = connecting_->nextAddr < connecting_->addresses.size();
+    uint64_t stepAt = moreAddresses ? std::min<uint64_t>(connecting_->nextAttemptAt, CONNECT_TIMEOUT_MS) : CONNECT_TIMEOUT_MS;
+
+    return Duration::fromMillis(stepAt > elapsed ? stepAt - elapsed : 0);
+}
+
+void TcpSocket::abandonConnect() {
+    if (!connecting_) return;
+
+    for (auto sock : connecting_->pendingSockets) {
+        closeRaw(static_cast<RawSocket>(sock));
+    }
+
+    connecting_.reset();
 }
 
 Result<int> TcpSocket::send(const char* data, unsigned int dataSize) {
@@ -142,6 +322,7 @@ Result<> TcpSocket::recvExact(char* buffer, int bufferSize) {
 
 bool TcpSocket::close() {
     connected = false;
+    this->abandonConnect();
 
     if (socket_ == -1) {
         return false;
@@ -175,20 +356,11 @@ Result<bool> TcpSocket::poll(int msDelay, bool in) {
 }
 
 Result<> TcpSocket::setNonBlocking(bool nb) {
-#ifdef GEODE_IS_WINDOWS
-    unsigned long mode = nb ? 1 : 0;
-    if (SOCKET_ERROR == ioctlsocket(socket_, FIONBIO, &mode)) return Err(fmt::format("ioctlsocket failed: {}", util::net::lastErrorString()));
-#else
-    int flags = fcntl(socket_, F_GETFL);
-
-    if (nb) {
-        if (fcntl(socket_, F_SETFL, flags | O_NONBLOCK) < 0) return Err(fmt::format("fcntl(O_NONBLOCK) failed: {}", util::net::lastErrorString()));
-    } else {
-        if (fcntl(socket_, F_SETFL, flags & (~O_NONBLOCK)) < 0) return Err(fmt::format("fcntl(~O_NONBLOCK) failed: {}", util::net::lastErrorString()));
-    }
-#endif
+    return setNonBlockingRaw(socket_, nb);
+}
 
-    return Ok();
+const SocketAddress& TcpSocket::peerAddress() const {
+    return destAddr_;
 }
 
 void TcpSocket::maybeDisconnect() {
@@ -1,19 +1,57 @@
 #pragma once
 #include "socket.hpp"
 
+#include "address.hpp"
+
 #include <defs/platform.hpp>
 #include <defs/assert.hpp>
 #include <asp/sync.hpp>
+#include <asp/time/Duration.hpp>
+#include <asp/time/Instant.hpp>
 
-struct sockaddr_in;
+#include <optional>
+#include <vector>
 
 class TcpSocket : public Socket {
 public:
+    // Delay before starting a connection attempt to the next address, while the previous one is still pending (RFC 8305)
+    static constexpr int CONNECTION_ATTEMPT_DELAY_MS = 250;
+    static constexpr int CONNECT_TIMEOUT_MS = 5000;
+    // How many connection attempts may be pending at the same time
+    static constexpr size_t MAX_PENDING_ATTEMPTS = 4;
+
+#ifdef GLOBED_IS_UNIX
+    using Handle = int;
+#else
+    using Handle = size_t; // SOCKET
+#endif
+
     using Socket::send;
     TcpSocket();
     ~TcpSocket();
 
+    // Connects to the first address of the host that accepts the connection. If it has multiple addresses (like both
+    // an IPv4 and an IPv6 one), connection attempts are raced against each other ("happy eyeballs").
+    // Note that this blocks until connected, and might block for DNS lookup if the host is a domain name that isn't cached yet.
     Result<> connect(const NetworkAddress& address) override;
+    Result<> connect(const std::vector<SocketAddress>& addresses);
+
+    // Same as `connect`, but never blocks. `continueConnect` has to be called until it returns true or an error,
+    // ideally whenever one of the `pendingAttempts` sockets becomes writable or `untilConnectStep` has passed.
+    Result<> startConnect(const std::vector<SocketAddress>& addresses);
+
+    // Check the pending connection attempts and start new ones if it is time to, returns true once connected
+    Result<bool> continueConnect();
+
+    // Whether a connection started with `startConnect` is still in progress
+    bool isConnecting() const;
+
+    // Sockets of the attempts that are still pending, they become writable once they connect or fail
+    const std::vector<Handle>& pendingAttempts() const;
+
+    // Time until `continueConnect` has to be called again even if no socket became writable, `std::nullopt` if not connecting
+    std::optional<asp::time::Duration> untilConnectStep() const;
+
     Result<int> send(const char* data, unsigned int dataSize) override;
     Result<> sendAll(const char* data, unsigned int dataSize);
     RecvResult receive(char* buffer, int bufferSize) override;
@@ -24,6 +62,9 @@ public:
     Result<bool> poll(int msDelay, bool in = true) override;
     Result<> setNonBlocking(bool nb) override;
 
+    // Address of the server that the socket is connected to
+    const SocketAddress& peerAddress() const;
+
     asp::AtomicBool connected = false;
 
 #ifdef GLOBED_IS_UNIX
@@ -33,7 +74,23 @@ public:
 #endif
 
 private:
-    std::unique_ptr<sockaddr_in> destAddr_;
+    struct ConnectState {
+        std::vector<SocketAddress> addresses;
+        std::vector<Handle> pendingSockets;
+        std::vector<size_t> pendingAddrs; // index into `addresses` for each of `pendingSockets`
+        size_t nextAddr = 0;
+        uint64_t nextAttemptAt = 0; // milliseconds since `startedAt`
+        asp::time::Instant startedAt = asp::time::Instant::now();
+        std::string lastError = "connection timed out";
+    };
+
+    SocketAddress destAddr_;
+    std::optional<ConnectState> connecting_;
+
+    // start a non-blocking connection to the next address that we can create a socket for
+    void startAttempt(ConnectState& state);
+    // close all pending attempts and forget about the connection
+    void abandonConnect();
 
     void maybeDisconnect();
 };
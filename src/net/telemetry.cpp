@@ -0,0 +1,308 @@
+#include "telemetry.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+
+#include <defs/geode.hpp>
+#include <globed/tracing.hpp>
+#include <util/format.hpp>
+#include <asp/time/SystemTime.hpp>
+
+using namespace geode::prelude;
+using namespace asp::time;
+
+static_assert(NetworkTelemetry::STAGE_COUNT == static_cast<size_t>(PacketStage::Dispatch) + 1);
+
+/* Histogram */
+
+void NetworkTelemetry::Histogram::record(uint64_t micros) {
+    size_t bucket = std::min<size_t>(std::bit_width(micros), BUCKET_COUNT - 1);
+
+    count.fetch_add(1, std::memory_order::relaxed);
+    totalMicros.fetch_add(micros, std::memory_order::relaxed);
+    buckets[bucket].fetch_add(1, std::memory_order::relaxed);
+
+    uint64_t prevMax = maxMicros.load(std::memory_order::relaxed);
+    while (prevMax < micros && !maxMicros.compare_exchange_weak(prevMax, micros, std::memory_order::relaxed));
+}
+
+NetworkTelemetry::StageSnapshot NetworkTelemetry::Histogram::load() const {
+    StageSnapshot out;
+    out.count = count.load(std::memory_order::relaxed);
+    out.totalMicros = totalMicros.load(std::memory_order::relaxed);
+    out.maxMicros = maxMicros.load(std::memory_order::relaxed);
+
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        out.buckets[i] = buckets[i].load(std::memory_order::relaxed);
+    }
+
+    return out;
+}
+
+void NetworkTelemetry::Histogram::reset() {
+    count = 0;
+    totalMicros = 0;
+    maxMicros = 0;
+
+    for (auto& bucket : buckets) {
+        bucket = 0;
+    }
+}
+
+uint64_t NetworkTelemetry::StageSnapshot::avgMicros() const {
+    return count == 0 ? 0 : totalMicros / count;
+}
+
+uint64_t NetworkTelemetry::StageSnapshot::percentileMicros(double percentile) const {
+    if (count == 0) return 0;
+
+    // the buckets are read one by one while other threads may be recording, so they don't always add up to `count`
+    uint64_t total = 0;
+    for (auto b : buckets) total += b;
+
+    uint64_t target = static_cast<uint64_t>(static_cast<double>(total) * percentile / 100.0);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < BUCKET_COUNT - 1; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            return std::min<uint64_t>(uint64_t(1) << i, maxMicros);
+        }
+    }
+
+    return maxMicros;
+}
+
+/* NetworkTelemetry */
+
+NetworkTelemetry::NetworkTelemetry() {
+    writerThread.setStartFunction([] { geode::utils::thread::setName("Telemetry Thread"); });
+    writerThread.setLoopFunction(&NetworkTelemetry::writerFunc);
+}
+
+NetworkTelemetry::~NetworkTelemetry() {
+    if (writerStarted) {
+        TRACE("[NetworkTelemetry] waiting for thread to stop");
+        writerThread.stopAndWait();
+    }
+}
+
+const char* NetworkTelemetry::stageName(PacketStage stage) {
+    switch (stage) {
+        case PacketStage::Encode: return "encode";
+        case PacketStage::Encrypt: return "encrypt";
+        case PacketStage::Queue: return "queue";
+        case PacketStage::Decrypt: return "decrypt";
+        case PacketStage::Decode: return "decode";
+        case PacketStage::Dispatch: return "dispatch";
+    }
+
+    return "unknown";
+}
+
+void NetworkTelemetry::recordIn(packetid_t id, const char* name, size_t bytes) {
+    auto& slot = this->slotFor(id, name);
+    slot.packetsIn.fetch_add(1, std::memory_order::relaxed);
+    slot.bytesIn.fetch_add(bytes, std::memory_order::relaxed);
+}
+
+void NetworkTelemetry::recordOut(packetid_t id, const char* name, size_t bytes) {
+    auto& slot = this->slotFor(id, name);
+    slot.packetsOut.fetch_add(1, std::memory_order::relaxed);
+    slot.bytesOut.fetch_add(bytes, std::memory_order::relaxed);
+}
+
+void NetworkTelemetry::recordTime(packetid_t id, const char* name, PacketStage stage, Duration took) {
+    this->slotFor(id, name).stages[static_cast<size_t>(stage)].record(took.micros());
+}
+
+void NetworkTelemetry::recordIn(const Packet& packet, size_t bytes) {
+    this->recordIn(packet.getPacketId(), packet.getPacketName(), bytes);
+}
+
+void NetworkTelemetry::recordOut(const Packet& packet, size_t bytes) {
+    this->recordOut(packet.getPacketId(), packet.getPacketName(), bytes);
+}
+
+void NetworkTelemetry::recordTime(const Packet& packet, PacketStage stage, Duration took) {
+    this->recordTime(packet.getPacketId(), packet.getPacketName(), stage, took);
+}
+
+std::vector<NetworkTelemetry::PacketSnapshot> NetworkTelemetry::snapshot() const {
+    std::vector<PacketSnapshot> out;
+
+    auto take = [&](const Slot& slot, packetid_t id, const char* name) {
+        PacketSnapshot snap {
+            .id = id,
+            .name = name ? name : "unknown",
+            .packetsIn = slot.packetsIn.load(std::memory_order::relaxed),
+            .packetsOut = slot.packetsOut.load(std::memory_order::relaxed),
+            .bytesIn = slot.bytesIn.load(std::memory_order::relaxed),
+            .bytesOut = slot.bytesOut.load(std::memory_order::relaxed),
+        };
+
+        if (snap.packetsIn == 0 && snap.packetsOut == 0) {
+            // might only have timings so far, keep it if so
+            bool anyTimings = std::any_of(slot.stages.begin(), slot.stages.end(), [](auto& h) {
+                return h.count.load(std::memory_order::relaxed) != 0;
+            });
+
+            if (!anyTimings) return;
+        }
+
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            snap.stages[i] = slot.stages[i].load();
+        }
+
+        out.push_back(snap);
+    };
+
+    for (auto& slot : slots) {
+        packetid_t id = slot.id.load(std::memory_order::acquire);
+        if (id == 0) continue;
+
+        take(slot, id, slot.name.load(std::memory_order::relaxed));
+    }
+
+    take(overflow, 0, "other");
+
+    std::sort(out.begin(), out.end(), [](auto& a, auto& b) {
+        return a.bytesIn + a.bytesOut > b.bytesIn + b.bytesOut;
+    });
+
+    return out;
+}
+
+void NetworkTelemetry::reset() {
+    // slots are never given up, so that a thread that is recording right now can't end up writing into another packet's slot
+    auto resetSlot = [](Slot& slot) {
+        slot.packetsIn = 0;
+        slot.packetsOut = 0;
+        slot.bytesIn = 0;
+        slot.bytesOut = 0;
+
+        for (auto& stage : slot.stages) {
+            stage.reset();
+        }
+    };
+
+    for (auto& slot : slots) {
+        resetSlot(slot);
+    }
+
+    resetSlot(overflow);
+
+    *link.lock() = {};
+}
+
+void NetworkTelemetry::setLinkStats(const LinkStats& stats) {
+    *link.lock() = stats;
+}
+
+std::string NetworkTelemetry::toJson() const {
+    matjson::Value root = matjson::Value::object();
+    root["timestamp"] = util::format::formatDateTime(SystemTime::now());
+    root["packets"] = matjson::Value::array();
+
+    auto linkStats = *link.lock();
+    if (linkStats.active) {
+        root["link"] = matjson::makeObject({
+            {"upstreamLoss", linkStats.upstreamLoss},
+            {"downstreamLoss", linkStats.downstreamLoss},
+            {"reordering", linkStats.reordering},
+            {"jitterMs", linkStats.jitterMs},
+            {"rttMs", linkStats.rttMs},
+        });
+    }
+
+    auto& packets = root["packets"].asArray().unwrap();
+
+    for (auto& snap : this->snapshot()) {
+        matjson::Value obj = matjson::Value::object();
+        obj["id"] = snap.id;
+        obj["name"] = std::string(snap.name);
+        obj["packetsIn"] = snap.packetsIn;
+        obj["packetsOut"] = snap.packetsOut;
+        obj["bytesIn"] = snap.bytesIn;
+        obj["bytesOut"] = snap.bytesOut;
+
+        matjson::Value stages = matjson::Value::object();
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            auto& stage = snap.stages[i];
+            if (stage.count == 0) continue;
+
+            stages[stageName(static_cast<PacketStage>(i))] = matjson::makeObject({
+                {"count", stage.count},
+                {"avgMicros", stage.avgMicros()},
+                {"p50Micros", stage.percentileMicros(50.0)},
+                {"p99Micros", stage.percentileMicros(99.0)},
+                {"maxMicros", stage.maxMicros},
+            });
+        }
+
+        obj["stages"] = std::move(stages);
+        packets.push_back(std::move(obj));
+    }
+
+    return root.dump();
+}
+
+void NetworkTelemetry::writeSnapshot() {
+    pendingWrites.push(this->toJson());
+
+    // called from both the main and the network thread, only one of them gets to start the writer
+    if (!writerStarted.exchange(true)) {
+        writerThread.start(this);
+    }
+}
+
+void NetworkTelemetry::writerFunc(decltype(writerThread)::StopToken&) {
+    auto json = pendingWrites.popTimeout(Duration::fromMillis(200));
+    if (!json) return;
+
+    // only the newest snapshot matters if the disk couldn't keep up
+    while (auto newer = pendingWrites.tryPop()) {
+        json = std::move(newer);
+    }
+
+    auto path = Mod::get()->getSaveDir() / "net-telemetry.json";
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        log::warn("Failed to open {} for writing", path);
+        return;
+    }
+
+    file.write(json->data(), json->size());
+}
+
+NetworkTelemetry::Slot& NetworkTelemetry::slotFor(packetid_t id, const char* name) {
+    if (id == 0) return overflow;
+
+    size_t start = id % SLOT_COUNT;
+
+    for (size_t i = 0; i < SLOT_COUNT; i++) {
+        auto& slot = slots[(start + i) % SLOT_COUNT];
+
+        packetid_t current = slot.id.load(std::memory_order::acquire);
+        if (current == id) {
+            return slot;
+        }
+
+        if (current == 0) {
+            // a concurrent `snapshot` can briefly see the id without the name, it handles that
+            if (slot.id.compare_exchange_strong(current, id, std::memory_order::acq_rel)) {
+                slot.name.store(name, std::memory_order::release);
+                return slot;
+            }
+
+            // lost the race, the slot might have been claimed for this very id
+            if (current == id) {
+                return slot;
+            }
+        }
+    }
+
+    return overflow;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <asp/sync.hpp>
+#include <asp/thread/Thread.hpp>
+#include <asp/time/Duration.hpp>
+
+#include <data/packets/packet.hpp>
+#include "udp_sequencer.hpp"
+#include <util/singleton.hpp>
+
+// Steps that a packet goes through, each one has its own latency histogram
+enum class PacketStage : uint8_t {
+    Encode,
+    Encrypt,
+    Queue,    // waiting in the send queue before being sent
+    Decrypt,
+    Decode,
+    Dispatch, // waiting for the main thread to hand it to the listeners
+};
+
+/*
+* NetworkTelemetry - per packet type counters and latency histograms.
+*
+* Recording is lock-free and can be done from any thread. Packet types get a slot in a fixed size table the first time
+* they are seen, if the table ever fills up the remaining types are counted together under ID 0.
+* Snapshots are written to the disk by a background thread, so `writeSnapshot` is cheap enough to call from the network thread.
+*/
+class NetworkTelemetry : public SingletonBase<NetworkTelemetry> {
+protected:
+    friend class SingletonBase;
+    NetworkTelemetry();
+    ~NetworkTelemetry();
+
+public:
+    static constexpr size_t STAGE_COUNT = 6;
+    static constexpr size_t SLOT_COUNT = 128;
+    // bucket N counts samples in [2^(N-1), 2^N) microseconds, the last one everything above
+    static constexpr size_t BUCKET_COUNT = 24;
+
+    struct StageSnapshot {
+        uint64_t count = 0;
+        uint64_t totalMicros = 0;
+        uint64_t maxMicros = 0;
+        std::array<uint64_t, BUCKET_COUNT> buckets = {};
+
+        uint64_t avgMicros() const;
+
+        // Upper bound of the bucket that the given percentile (0 - 100) falls in
+        uint64_t percentileMicros(double percentile) const;
+    };
+
+    struct PacketSnapshot {
+        packetid_t id;
+        const char* name;
+        uint64_t packetsIn, packetsOut;
+        uint64_t bytesIn, bytesOut;
+        std::array<StageSnapshot, STAGE_COUNT> stages;
+    };
+
+    static const char* stageName(PacketStage stage);
+
+    void recordIn(packetid_t id, const char* name, size_t bytes);
+    void recordOut(packetid_t id, const char* name, size_t bytes);
+    void recordTime(packetid_t id, const char* name, PacketStage stage, asp::time::Duration took);
+
+    void recordIn(const Packet& packet, size_t bytes);
+    void recordOut(const Packet& packet, size_t bytes);
+    void recordTime(const Packet& packet, PacketStage stage, asp::time::Duration took);
+
+    // Link quality to include in the next snapshot, see `UdpSequencer`
+    void setLinkStats(const LinkStats& stats);
+
+    // Every packet type that was seen so far, sorted by total bytes (in and out) in descending order
+    std::vector<PacketSnapshot> snapshot() const;
+
+    void reset();
+
+    // Snapshot encoded as JSON
+    std::string toJson() const;
+
+    // Take a snapshot with `toJson` and queue it to be written to `net-telemetry.json` in the save directory
+    void writeSnapshot();
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> totalMicros = 0;
+        std::atomic<uint64_t> maxMicros = 0;
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets = {};
+
+        void record(uint64_t micros);
+        StageSnapshot load() const;
+        void reset();
+    };
+
+    struct Slot {
+        std::atomic<packetid_t> id = 0; // 0 means the slot is free
+        std::atomic<const char*> name = nullptr;
+        std::atomic<uint64_t> packetsIn = 0, packetsOut = 0;
+        std::atomic<uint64_t> bytesIn = 0, bytesOut = 0;
+        std::array<Histogram, STAGE_COUNT> stages;
+    };
+
+    std::array<Slot, SLOT_COUNT> slots;
+    Slot overflow; // packet types that didn't fit in `slots`
+
+    asp::Mutex<LinkStats> link;
+
+    asp::Channel<std::string> pendingWrites;
+    asp::Thread<NetworkTelemetry*> writerThread;
+    std::atomic<bool> writerStarted = false;
+
+    void writerFunc(decltype(writerThread)::StopToken&);
+
+    // Find or claim the slot of the packet ID, open addressing with linear probing
+    Slot& slotFor(packetid_t id, const char* name);
+};
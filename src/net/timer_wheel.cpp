@@ -0,0 +1,126 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+
+using namespace asp::time;
+
+TimerWheel::TimerWheel() : _start(Instant::now()) {}
+
+TimerWheel::TimerId TimerWheel::schedule(Duration delay, Callback&& callback) {
+    return this->insert(Timer {
+        .id = _nextId++,
+        .deadline = this->now() + delay.millis(),
+        .interval = 0,
+        .callback = std::move(callback),
+    });
+}
+
+TimerWheel::TimerId TimerWheel::scheduleRepeating(Duration interval, Callback&& callback) {
+    // an interval shorter than a tick would fire on every advance anyway
+    uint64_t intervalMs = std::max<uint64_t>(interval.millis(), TICK_MS);
+
+    return this->insert(Timer {
+        .id = _nextId++,
+        .deadline = this->now() + intervalMs,
+        .interval = intervalMs,
+        .callback = std::move(callback),
+    });
+}
+
+void TimerWheel::cancel(TimerId id) {
+    auto it = _slotOf.find(id);
+    if (it == _slotOf.end()) return;
+
+    auto& slot = _slots[it->second];
+    std::erase_if(slot, [id](const Timer& t) { return t.id == id; });
+
+    _slotOf.erase(it);
+}
+
+void TimerWheel::clear() {
+    for (auto& slot : _slots) {
+        slot.clear();
+    }
+
+    _slotOf.clear();
+}
+
+std::optional<Duration> TimerWheel::untilNext() const {
+    if (_slotOf.empty()) {
+        return std::nullopt;
+    }
+
+    // walk the slots in expiry order, the first slot with a timer due in this rotation has the earliest one
+    uint64_t now = this->now();
+    uint64_t nowTick = now / TICK_MS;
+    std::optional<uint64_t> earliest;
+
+    for (size_t i = 0; i < SLOT_COUNT; i++) {
+        auto& slot = _slots[(nowTick + i) % SLOT_COUNT];
+
+        for (auto& timer : slot) {
+            if (!earliest || timer.deadline < *earliest) {
+                earliest = timer.deadline;
+            }
+        }
+
+        if (earliest && *earliest / TICK_MS <= nowTick + i) {
+            break;
+        }
+    }
+
+    return Duration::fromMillis(*earliest > now ? *earliest - now : 0);
+}
+
+void TimerWheel::advance() {
+    uint64_t now = this->now();
+    uint64_t nowTick = now / TICK_MS;
+
+    // only go through every slot once, even if we fell more than a rotation behind
+    uint64_t firstTick = std::max(_lastTick, nowTick >= SLOT_COUNT ? nowTick - SLOT_COUNT + 1 : 0);
+
+    std::vector<Timer> due;
+
+    for (uint64_t tick = firstTick; tick <= nowTick; tick++) {
+        auto& slot = _slots[tick % SLOT_COUNT];
+
+        for (size_t i = 0; i < slot.size();) {
+            if (slot[i].deadline <= now) {
+                _slotOf.erase(slot[i].id);
+                due.push_back(std::move(slot[i]));
+                slot[i] = std::move(slot.back());
+                slot.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    _lastTick = nowTick;
+
+    // fire the callbacks only after the wheel is consistent again, as they may schedule or cancel timers
+    for (auto& timer : due) {
+        if (timer.interval != 0) {
+            timer.deadline = now + timer.interval;
+            auto callback = timer.callback;
+            this->insert(std::move(timer));
+            callback();
+        } else {
+            timer.callback();
+        }
+    }
+}
+
+uint64_t TimerWheel::now() const {
+    return Instant::now().durationSince(_start).millis();
+}
+
+TimerWheel::TimerId TimerWheel::insert(Timer&& timer) {
+    TimerId id = timer.id;
+    size_t slot = (timer.deadline / TICK_MS) % SLOT_COUNT;
+
+    _slotOf[id] = slot;
+    _slots[slot].push_back(std::move(timer));
+
+    return id;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <asp/time/Duration.hpp>
+#include <asp/time/Instant.hpp>
+
+/*
+* TimerWheel - hashed timing wheel that drives all the timers of the network thread.
+*
+* Timers are put in the slot of the tick they expire in, so scheduling, cancelling and firing are all constant time
+* regardless of how many timers exist. Timers further away than one rotation simply stay in their slot for more rounds.
+* Callbacks run on the thread that calls `advance`, and may schedule or cancel other timers.
+*
+* Not thread safe.
+*/
+class TimerWheel {
+public:
+    using Callback = std::function<void()>;
+    using TimerId = uint64_t;
+
+    static constexpr uint64_t TICK_MS = 10;
+    static constexpr size_t SLOT_COUNT = 256;
+
+    TimerWheel();
+
+    // Run `callback` once, after `delay`
+    TimerId schedule(asp::time::Duration delay, Callback&& callback);
+
+    // Run `callback` every `interval`, until cancelled
+    TimerId scheduleRepeating(asp::time::Duration interval, Callback&& callback);
+
+    // Cancel a timer, does nothing if it already fired or was cancelled
+    void cancel(TimerId id);
+
+    // Cancel all timers
+    void clear();
+
+    // Time until the earliest timer is due, or `std::nullopt` if there are no timers
+    std::optional<asp::time::Duration> untilNext() const;
+
+    // Run all the timers that are due
+    void advance();
+
+private:
+    struct Timer {
+        TimerId id;
+        uint64_t deadline; // in ms since `_start`
+        uint64_t interval; // 0 for one-shot timers
+        Callback callback;
+    };
+
+    asp::time::Instant _start;
+    uint64_t _lastTick = 0;
+    TimerId _nextId = 1;
+    std::array<std::vector<Timer>, SLOT_COUNT> _slots;
+    std::unordered_map<TimerId, size_t> _slotOf;
+
+    uint64_t now() const;
+    TimerId insert(Timer&& timer);
+};
@@ -2,7 +2,17 @@
 
 #include <data/bytebuffer.hpp>
 
-Result<std::vector<uint8_t>> UdpFrameBuffer::pushFrameFromBuffer(ByteBuffer& buf) {
+using namespace util::data;
+using namespace asp::time;
+
+UdpFrameBuffer::UdpFrameBuffer() {
+    // so that a typical packet never has to allocate, `resize` within the capacity is free
+    for (auto& slot : slots) {
+        slot.data.reserve(SLOT_PREALLOC_SIZE);
+    }
+}
+
+Result<std::optional<std::pair<byte*, size_t>>> UdpFrameBuffer::pushFrameFromBuffer(ByteBuffer& buf) {
     uint32_t packetId;
     uint8_t frameIdx, frameCount;
 
@@ -18,65 +28,165 @@ Result<std::vector<uint8_t>> UdpFrameBuffer::pushFrameFromBuffer(ByteBuffer& buf
         return Err(fmt::to_string(rres.unwrapErr()));
     }
 
-    auto& frames = packets[packetId];
-
     // do some sanity checks
 
     if (frameIdx >= frameCount) {
         return Err("frame index/count invalid");
     }
 
-    for (const auto& frame : frames) {
-        if (frame.idx == frameIdx) {
-            return Err("repeated udp frame");
+    // a late copy of a frame of a packet that was already completed
+    if (this->wasCompleted(packetId)) {
+        _stats.duplicates++;
+        return Ok(std::nullopt);
+    }
+
+    auto& slot = this->slotFor(packetId, frameCount);
+
+    if (slot.frameCount != frameCount) {
+        return Err("mismatched frame idx/max");
+    }
+
+    if (slot.received.test(frameIdx)) {
+        _stats.duplicates++;
+        return Ok(std::nullopt);
+    }
+
+    const byte* frameData = buf.dataPtr() + buf.getPosition();
+    size_t frameSize = buf.size() - buf.getPosition();
+    bool isLast = frameIdx == frameCount - 1;
+
+    if (isLast) {
+        GLOBED_REQUIRE_SAFE(slot.fragmentSize == 0 || frameSize <= slot.fragmentSize, "last udp frame is bigger than the others")
+
+        slot.lastSize = frameSize;
+
+        if (slot.fragmentSize == 0) {
+            // can't tell where it goes yet, hold onto it until another frame arrives
+            slot.pendingLast.assign(frameData, frameData + frameSize);
+            slot.hasPendingLast = true;
+        } else {
+            GLOBED_UNWRAP(this->writeFrame(slot, frameIdx * slot.fragmentSize, frameData, frameSize));
         }
+    } else {
+        if (slot.fragmentSize == 0) {
+            GLOBED_REQUIRE_SAFE(frameSize > 0, "empty udp frame")
+            GLOBED_REQUIRE_SAFE(!slot.hasPendingLast || slot.lastSize <= frameSize, "last udp frame is bigger than the others")
+
+            slot.fragmentSize = frameSize;
+        } else {
+            GLOBED_REQUIRE_SAFE(frameSize == slot.fragmentSize, "mismatched udp frame size");
+        }
+
+        GLOBED_UNWRAP(this->writeFrame(slot, frameIdx * slot.fragmentSize, frameData, frameSize));
 
-        if (frame.max != frameCount) {
-            return Err("mismatched frame idx/max");
+        if (slot.hasPendingLast) {
+            GLOBED_UNWRAP(this->writeFrame(slot, (frameCount - 1) * slot.fragmentSize, slot.pendingLast.data(), slot.lastSize));
+            slot.hasPendingLast = false;
         }
     }
 
-    std::vector<uint8_t> data;
-    size_t remainderLength = buf.size() - buf.getPosition();
-    data.resize(remainderLength);
+    slot.received.set(frameIdx);
+    slot.receivedCount++;
 
-    auto result = buf.readBytesInto(data.data(), remainderLength);
-    if (!result) {
-        return Err(fmt::to_string(result.unwrapErr()));
+    // check if we got all the needed frames
+    if (slot.receivedCount < frameCount) {
+        return Ok(std::nullopt);
     }
 
-    frames.push_back(Frame {
-        .idx = frameIdx,
-        .max = frameCount,
-        .data = std::move(data)
-    });
+    // single frame packets never learn the fragment size, but then the last frame is the whole packet
+    this->markCompleted(slot);
 
-    // check if we got all the needed frames
-    if (frames.size() == frameCount) {
-        std::sort(frames.begin(), frames.end(), [](auto& a, auto& b) {
-            return a.idx < b.idx;
-        });
+    if (slot.hasPendingLast) {
+        return Ok(std::make_pair(slot.pendingLast.data(), slot.lastSize));
+    }
 
-        std::vector<uint8_t> data;
+    return Ok(std::make_pair(slot.data.data(), (frameCount - 1) * slot.fragmentSize + slot.lastSize));
+}
 
-        // calculate full frame size
-        size_t totalSize = 0;
-        for (auto& frame : frames) {
-            totalSize += frame.data.size();
+void UdpFrameBuffer::clear() {
+    for (auto& slot : slots) {
+        slot.active = false;
+    }
+
+    completedHead = 0;
+    completedCount = 0;
+    _stats = {};
+}
+
+bool UdpFrameBuffer::wasCompleted(uint32_t packetId) const {
+    for (size_t i = 0; i < completedCount; i++) {
+        if (completedIds[i] == packetId) return true;
+    }
+
+    return false;
+}
+
+void UdpFrameBuffer::markCompleted(Slot& slot) {
+    slot.active = false;
+    _stats.completed++;
+
+    completedIds[completedHead] = slot.packetId;
+    completedHead = (completedHead + 1) % COMPLETED_HISTORY;
+    completedCount = std::min(completedCount + 1, COMPLETED_HISTORY);
+}
+
+const UdpFrameBuffer::Stats& UdpFrameBuffer::stats() const {
+    return _stats;
+}
+
+UdpFrameBuffer::Slot& UdpFrameBuffer::slotFor(uint32_t packetId, uint8_t frameCount) {
+    Slot* freeSlot = nullptr;
+    Slot* oldest = nullptr;
+
+    for (auto& slot : slots) {
+        if (slot.active && slot.startedAt.elapsed() > FRAME_TIMEOUT) {
+            // a frame was most likely lost, this packet is never getting completed
+            slot.active = false;
+            _stats.evictions++;
+        }
+
+        if (!slot.active) {
+            if (!freeSlot) freeSlot = &slot;
+            continue;
         }
 
-        data.reserve(totalSize);
+        if (slot.packetId == packetId) {
+            return slot;
+        }
 
-        for (auto& frame : frames) {
-            data.insert(data.end(), frame.data.begin(), frame.data.end());
+        if (!oldest || slot.startedAt.elapsed() > oldest->startedAt.elapsed()) {
+            oldest = &slot;
         }
+    }
 
-        return Ok(std::move(data));
+    Slot* slot = freeSlot;
+    if (!slot) {
+        slot = oldest;
+        _stats.evictions++;
     }
 
-    return Ok(std::vector<uint8_t>{});
+    slot->active = true;
+    slot->packetId = packetId;
+    slot->frameCount = frameCount;
+    slot->receivedCount = 0;
+    slot->received.reset();
+    slot->startedAt = Instant::now();
+    slot->fragmentSize = 0;
+    slot->hasPendingLast = false;
+    slot->lastSize = 0;
+
+    return *slot;
 }
 
-void UdpFrameBuffer::clear() {
-    packets.clear();
+Result<> UdpFrameBuffer::writeFrame(Slot& slot, size_t offset, const byte* data, size_t size) {
+    GLOBED_REQUIRE_SAFE(offset + size <= MAX_PACKET_SIZE, "fragmented udp packet is too big")
+
+    // the buffer is kept between packets, so this only allocates until it reaches the size of the biggest packet
+    if (slot.data.size() < offset + size) {
+        slot.data.resize(offset + size);
+    }
+
+    std::memcpy(slot.data.data() + offset, data, size);
+
+    return Ok();
 }
@@ -1,21 +1,84 @@
 #pragma once
 
 #include <defs/minimal_geode.hpp>
+#include <util/data.hpp>
+
+#include <bitset>
+#include <asp/time/Instant.hpp>
 
 class ByteBuffer;
 
+/*
+* UdpFrameBuffer - reassembly of fragmented UDP packets.
+*
+* Partial packets live in a fixed amount of slots, each with its own preallocated buffer that is reused between packets.
+* Every frame except the last one has the same size, so frames are written straight to `idx * fragmentSize` and a completed
+* packet needs no sorting or copying. Packets that are not completed in time (e.g. because a frame was lost) are evicted,
+* and when all slots are busy the oldest packet is evicted, so memory usage stays bounded no matter how lossy the connection is.
+* The IDs of the last few completed packets are remembered, so that late copies of their frames are counted as duplicates
+* instead of claiming a slot for a packet that is never going to be completed again.
+*/
 class UdpFrameBuffer {
 public:
-    // push a new frame, if a packet is completed, return the full data
-    Result<std::vector<uint8_t>> pushFrameFromBuffer(ByteBuffer& buf);
+    static constexpr size_t SLOT_COUNT = 16;
+    static constexpr size_t MAX_PACKET_SIZE = 2 << 18;
+    static constexpr asp::time::Duration FRAME_TIMEOUT = asp::time::Duration::fromMillis(2000);
+    // Bytes allocated for every slot up front, bigger packets grow the buffer of their slot
+    static constexpr size_t SLOT_PREALLOC_SIZE = 32 * 1024;
+    // How many completed packet IDs are remembered to recognize duplicate frames
+    static constexpr size_t COMPLETED_HISTORY = 32;
+
+    struct Stats {
+        size_t completed = 0;
+        size_t evictions = 0;
+        size_t duplicates = 0;
+    };
+
+    // Push a new frame. If it completes a packet, returns a view of the full packet data,
+    // which is only valid until the next call to `pushFrameFromBuffer` or `clear`.
+    Result<std::optional<std::pair<util::data::byte*, size_t>>> pushFrameFromBuffer(ByteBuffer& buf);
 
+    UdpFrameBuffer();
+
+    // Drop all partial packets and reset the stats
     void clear();
+
+    const Stats& stats() const;
+
 private:
-    struct Frame {
-        uint8_t idx;
-        uint8_t max;
-        std::vector<uint8_t> data;
+    struct Slot {
+        bool active = false;
+        uint32_t packetId;
+        uint8_t frameCount;
+        size_t receivedCount;
+        std::bitset<256> received;
+        asp::time::Instant startedAt = asp::time::Instant::now();
+
+        // size of every frame except the last one, 0 if no such frame was received yet
+        size_t fragmentSize;
+
+        // the last frame, if it arrived before `fragmentSize` was known
+        std::vector<util::data::byte> pendingLast;
+        bool hasPendingLast;
+        size_t lastSize;
+
+        std::vector<util::data::byte> data;
     };
 
-    std::map<int, std::vector<Frame>> packets;
+    std::array<Slot, SLOT_COUNT> slots;
+    Stats _stats;
+
+    // ring buffer of the IDs of recently completed packets
+    std::array<uint32_t, COMPLETED_HISTORY> completedIds;
+    size_t completedHead = 0;
+    size_t completedCount = 0;
+
+    bool wasCompleted(uint32_t packetId) const;
+    void markCompleted(Slot& slot);
+
+    // Find the slot of the given packet, or claim a new one for it
+    Slot& slotFor(uint32_t packetId, uint8_t frameCount);
+
+    // Copy a frame into the slot buffer, growing it if needed
+    Result<> writeFrame(Slot& slot, size_t offset, const util::data::byte* data, size_t size);
 };
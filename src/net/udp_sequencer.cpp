@@ -0,0 +1,183 @@
+#include "udp_sequencer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace asp::time;
+
+// the server acks the newest datagram and the 32 before it
+constexpr int ACK_WINDOW = 32;
+// how many of the server's datagrams are kept track of
+constexpr size_t RECEIVE_WINDOW = 64;
+
+// weight of a new sample. loss and reordering get one sample per datagram, so at 30 datagrams a second
+// that averages over roughly the last two seconds
+constexpr float RATIO_SMOOTHING = 1.f / 64.f;
+constexpr float RTT_SMOOTHING = 1.f / 8.f;
+constexpr float JITTER_SMOOTHING = 1.f / 16.f; // same as in RFC 3550
+
+static void addSample(float& value, float sample, float weight) {
+    value += (sample - value) * weight;
+}
+
+void UdpSequencer::reset() {
+    active = false;
+    nextSequence = 1;
+    startedAt = Instant::now();
+    sent = {};
+
+    receivedAny = false;
+    highestReceived = 0;
+    receivedWindow = 0;
+    windowSpan = 0;
+
+    hasTransit = false;
+    lastTransit = 0;
+
+    stats = {};
+    *published.lock() = {};
+}
+
+void UdpSequencer::enable() {
+    active = true;
+    stats.active = true;
+    *published.lock() = stats;
+}
+
+bool UdpSequencer::isActive() const {
+    return active;
+}
+
+SequenceHeader UdpSequencer::nextHeader() const {
+    return SequenceHeader {
+        .sequence = nextSequence,
+        .ack = highestReceived,
+        .ackBits = static_cast<uint32_t>(receivedWindow >> 1),
+        .timestamp = static_cast<uint32_t>(startedAt.elapsed().micros()),
+    };
+}
+
+void UdpSequencer::onSent(const SequenceHeader& header) {
+    // an entry that is still pending here was never acked nor fell out of the ack window, so there is nothing to say about it
+    sent[header.sequence % SENT_HISTORY] = SentDatagram {
+        .sequence = header.sequence,
+        .pending = true,
+        .sentAt = Instant::now(),
+    };
+
+    // 0 means "nothing received" in acks, so it is never used as a sequence number
+    nextSequence = header.sequence + 1;
+    if (nextSequence == 0) nextSequence = 1;
+}
+
+void UdpSequencer::onReceived(const SequenceHeader& header) {
+    if (!active) return;
+
+    this->processAcks(header);
+    this->trackReceived(header);
+    this->trackJitter(header);
+
+    *published.lock() = stats;
+}
+
+LinkStats UdpSequencer::getStats() const {
+    return *published.lock();
+}
+
+void UdpSequencer::processAcks(const SequenceHeader& header) {
+    // the server hasn't received anything from us yet
+    if (header.ack == 0) return;
+
+    for (auto& entry : sent) {
+        if (!entry.pending) continue;
+
+        // how far behind the newest acked datagram this one is, negative if the server hasn't seen that far yet
+        auto behind = static_cast<int16_t>(static_cast<uint16_t>(header.ack - entry.sequence));
+        if (behind < 0) continue;
+
+        bool acked = behind == 0 || (behind <= ACK_WINDOW && (header.ackBits & (uint32_t(1) << (behind - 1))) != 0);
+
+        if (acked) {
+            // older ones could have waited on the server for a while before being acked
+            if (behind == 0) {
+                float rtt = static_cast<float>(entry.sentAt.elapsed().micros()) / 1000.f;
+                if (stats.rttMs == 0.f) {
+                    stats.rttMs = rtt;
+                } else {
+                    addSample(stats.rttMs, rtt, RTT_SMOOTHING);
+                }
+            }
+
+            entry.pending = false;
+            addSample(stats.upstreamLoss, 0.f, RATIO_SMOOTHING);
+        } else if (behind > ACK_WINDOW) {
+            // out of the window without ever being acked
+            entry.pending = false;
+            addSample(stats.upstreamLoss, 1.f, RATIO_SMOOTHING);
+        }
+    }
+}
+
+void UdpSequencer::trackReceived(const SequenceHeader& header) {
+    if (!receivedAny) {
+        receivedAny = true;
+        highestReceived = header.sequence;
+        receivedWindow = 1;
+        windowSpan = 1;
+        return;
+    }
+
+    auto ahead = static_cast<int16_t>(static_cast<uint16_t>(header.sequence - highestReceived));
+
+    if (ahead > 0) {
+        // after a long gap everything in the window is lost anyway, no need to shift any further than that
+        size_t shift = std::min<size_t>(ahead, RECEIVE_WINDOW * 2);
+
+        for (size_t i = 0; i < shift; i++) {
+            // the oldest datagram leaves the window, if it hasn't arrived by now it's considered lost
+            if (windowSpan == RECEIVE_WINDOW) {
+                bool received = (receivedWindow >> (RECEIVE_WINDOW - 1)) & 1;
+                addSample(stats.downstreamLoss, received ? 0.f : 1.f, RATIO_SMOOTHING);
+            } else {
+                windowSpan++;
+            }
+
+            receivedWindow <<= 1;
+        }
+
+        receivedWindow |= 1;
+
+        // the server skips 0 when wrapping around, it's not lost just because it never arrives
+        size_t zeroBit = header.sequence;
+        if (zeroBit < static_cast<size_t>(ahead) && zeroBit < windowSpan) {
+            receivedWindow |= uint64_t(1) << zeroBit;
+        }
+
+        highestReceived = header.sequence;
+        addSample(stats.reordering, 0.f, RATIO_SMOOTHING);
+    } else if (ahead < 0) {
+        size_t behind = static_cast<size_t>(-static_cast<int32_t>(ahead));
+        if (behind >= windowSpan) return; // too late to matter
+
+        uint64_t bit = uint64_t(1) << behind;
+        if (receivedWindow & bit) return; // duplicate
+
+        receivedWindow |= bit;
+        addSample(stats.reordering, 1.f, RATIO_SMOOTHING);
+    }
+}
+
+void UdpSequencer::trackJitter(const SequenceHeader& header) {
+    // the clocks aren't synchronized, but only the difference between two transit times matters
+    auto arrival = static_cast<uint32_t>(startedAt.elapsed().micros());
+    auto transit = static_cast<int32_t>(arrival - header.timestamp);
+
+    if (hasTransit) {
+        auto delta = static_cast<int32_t>(static_cast<uint32_t>(transit) - static_cast<uint32_t>(lastTransit));
+        float deltaMs = std::abs(static_cast<float>(delta)) / 1000.f;
+        addSample(stats.jitterMs, deltaMs, JITTER_SMOOTHING);
+    }
+
+    hasTransit = true;
+    lastTransit = transit;
+}
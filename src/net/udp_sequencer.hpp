@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+
+#include <asp/sync.hpp>
+#include <asp/time/Instant.hpp>
+
+#include <data/bytebuffer.hpp>
+
+// Sent in front of every UDP datagram once sequencing is on (protocol v17+). Ours are in cleartext, the server encrypts its own
+// with the session cipher. Must match `SequenceHeader` on the server.
+struct SequenceHeader {
+    static constexpr size_t SIZE = sizeof(uint16_t) * 2 + sizeof(uint32_t) * 2;
+
+    uint16_t sequence;  // starts at 1 and wraps around, skipping 0
+    uint16_t ack;       // newest sequence number received from the other side, 0 if none yet
+    uint32_t ackBits;   // bit `n` is set if `ack - 1 - n` was received as well
+    uint32_t timestamp; // microseconds since the sender started counting, wraps around
+};
+
+GLOBED_SERIALIZABLE_STRUCT(SequenceHeader, (sequence, ack, ackBits, timestamp));
+
+// Rolling estimates of the quality of the UDP link, all of them smoothed over roughly the last few seconds
+struct LinkStats {
+    bool active = false;        // false if the server doesn't sequence datagrams, everything else is zero then
+    float upstreamLoss = 0.f;   // fraction of our datagrams that the server never acked
+    float downstreamLoss = 0.f; // fraction of the server's datagrams that never arrived
+    float reordering = 0.f;     // fraction of the server's datagrams that arrived after a newer one
+    float jitterMs = 0.f;       // interarrival jitter of the server's datagrams (RFC 3550)
+    float rttMs = 0.f;          // time until our datagrams get acked, 0 until the first ack
+};
+
+/*
+* UdpSequencer - numbers our datagrams and measures the link from the sequence headers the server sends back.
+*
+* Sequencing is only enabled once the server negotiated protocol v17 over tcp, never by a datagram, as anyone can send one
+* of those. Only headers that were authenticated with the session cipher may be passed to `onReceived`. Datagrams that we
+* can't judge yet (the server only acks when it has something to send) are left alone instead of being counted as lost.
+*
+* `getStats` is thread safe, everything else must only be called from the network thread.
+*/
+class UdpSequencer {
+public:
+    void reset();
+
+    // Start sequencing our datagrams and measuring the server's, until `reset`
+    void enable();
+
+    // Whether the server sequences its datagrams, and so ours should be sequenced too
+    bool isActive() const;
+
+    // Header for the next datagram, the sequence number is only used up by `onSent`
+    SequenceHeader nextHeader() const;
+
+    // Called once a datagram with this header was handed to the socket
+    void onSent(const SequenceHeader& header);
+
+    // Called for every sequenced datagram from the server once its header was authenticated, does nothing unless enabled
+    void onReceived(const SequenceHeader& header);
+
+    LinkStats getStats() const;
+
+private:
+    // how many of our datagrams are remembered, anything older is forgotten without being judged
+    static constexpr size_t SENT_HISTORY = 64;
+
+    struct SentDatagram {
+        uint16_t sequence = 0;
+        bool pending = false;
+        asp::time::Instant sentAt = asp::time::Instant::now();
+    };
+
+    bool active = false;
+    uint16_t nextSequence = 1;
+    asp::time::Instant startedAt = asp::time::Instant::now();
+    std::array<SentDatagram, SENT_HISTORY> sent;
+
+    bool receivedAny = false;
+    uint16_t highestReceived = 0;
+    uint64_t receivedWindow = 0; // bit `n` is set if `highestReceived - n` was received
+    size_t windowSpan = 0;       // how many bits of the window are in use, the rest is from before the first datagram
+
+    bool hasTransit = false;
+    int32_t lastTransit = 0;
+
+    LinkStats stats;
+    asp::Mutex<LinkStats> published;
+
+    void processAcks(const SequenceHeader& header);
+    void trackReceived(const SequenceHeader& header);
+    void trackJitter(const SequenceHeader& header);
+};
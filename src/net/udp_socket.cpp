@@ -13,11 +13,33 @@
 # include <poll.h>
 #endif
 
+// batched datagram syscalls, macOS and iOS don't have these
+#ifdef GEODE_IS_ANDROID
+# define GLOBED_HAS_MMSG 1
+#endif
+
 UdpSocket::UdpSocket() : socket_(0) {
-    destAddr_ = std::make_unique<sockaddr_in>();
-    std::memset(destAddr_.get(), 0, sizeof(sockaddr_in));
+    // prefer a dual-stack socket, so that the same socket can ping and connect to servers of either family
+    family_ = AF_INET6;
+    auto sock = socket(AF_INET6, SOCK_DGRAM, 0);
+
+    if (sock != -1) {
+        int v6only = 0;
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&v6only), sizeof(v6only)) != 0) {
+#ifdef GEODE_IS_WINDOWS
+            ::closesocket(sock);
+#else
+            ::close(sock);
+#endif
+            sock = -1;
+        }
+    }
+
+    if (sock == -1) {
+        family_ = AF_INET;
+        sock = socket(AF_INET, SOCK_DGRAM, 0);
+    }
 
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
     socket_ = sock;
 
     GLOBED_REQUIRE(sock != -1, "failed to create a udp socket: socket failed");
@@ -28,9 +50,13 @@ UdpSocket::~UdpSocket() {
 }
 
 Result<> UdpSocket::connect(const NetworkAddress& address) {
-    destAddr_->sin_family = AF_INET;
+    GLOBED_UNWRAP_INTO(address.resolve(), auto addr)
+
+    return this->connect(addr);
+}
 
-    GLOBED_UNWRAP_INTO(address.resolve(), *destAddr_)
+Result<> UdpSocket::connect(const SocketAddress& address) {
+    GLOBED_UNWRAP_INTO(this->forSocket(address), destAddr_)
 
     connected = true;
     return Ok();
@@ -39,7 +65,7 @@ Result<> UdpSocket::connect(const NetworkAddress& address) {
 Result<int> UdpSocket::send(const char* data, unsigned int dataSize) {
     GLOBED_REQUIRE_SAFE(connected, "attempting to call UdpSocket::send on a disconnected socket")
 
-    int retval = sendto(socket_, data, dataSize, 0, reinterpret_cast<struct sockaddr*>(destAddr_.get()), sizeof(sockaddr_in));
+    int retval = sendto(socket_, data, dataSize, 0, destAddr_.sockaddrPtr(), destAddr_.sockaddrLength());
 
     if (retval == -1) {
         return Err(fmt::format("sendto failed ({}): {}", retval, util::net::lastErrorString()));
@@ -48,15 +74,13 @@ Result<int> UdpSocket::send(const char* data, unsigned int dataSize) {
     return Ok(retval);
 }
 
-Result<int> UdpSocket::sendTo(const char* data, unsigned int dataSize, const NetworkAddress& address) {
+Result<int> UdpSocket::sendTo(const char* data, unsigned int dataSize, const SocketAddress& address) {
     // stinky windows returns wsa error 10014 if sockaddr is a stack pointer
-    std::unique_ptr<sockaddr_in> addr = std::make_unique<sockaddr_in>();
+    auto addr = std::make_unique<SocketAddress>();
 
-    addr->sin_family = AF_INET;
+    GLOBED_UNWRAP_INTO(this->forSocket(address), *addr)
 
-    GLOBED_UNWRAP_INTO(address.resolve(), *addr)
-
-    int retval = sendto(socket_, data, dataSize, 0, reinterpret_cast<struct sockaddr*>(addr.get()), sizeof(sockaddr));
+    int retval = sendto(socket_, data, dataSize, 0, addr->sockaddrPtr(), addr->sockaddrLength());
 
     if (retval == -1) {
         return Err(fmt::format("sendto failed ({}): {}", retval, util::net::lastErrorString()));
@@ -70,14 +94,14 @@ void UdpSocket::disconnect() {
 }
 
 RecvResult UdpSocket::receive(char* buffer, int bufferSize) {
-    sockaddr_in source;
+    sockaddr_in6 source;
     socklen_t addrLen = sizeof(source);
 
     int result = recvfrom(socket_, buffer, bufferSize, 0, reinterpret_cast<struct sockaddr*>(&source), &addrLen);
 
     bool fromServer = false;
-    if (this->connected) {
-        fromServer = util::net::sameSockaddr(source, *destAddr_);
+    if (this->connected && result >= 0) {
+        fromServer = SocketAddress::fromSockaddr(reinterpret_cast<struct sockaddr*>(&source), addrLen) == destAddr_;
     }
 
     return RecvResult {
@@ -86,6 +110,112 @@ RecvResult UdpSocket::receive(char* buffer, int bufferSize) {
     };
 }
 
+Result<size_t> UdpSocket::receiveBatch(char* buffer, size_t slotSize, RecvResult* results, size_t count) {
+    count = std::min(count, MAX_BATCH_SIZE);
+    if (count == 0) return Ok(0);
+
+#ifdef GLOBED_HAS_MMSG
+    mmsghdr msgs[MAX_BATCH_SIZE];
+    iovec iovecs[MAX_BATCH_SIZE];
+    sockaddr_in6 sources[MAX_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i].iov_base = buffer + i * slotSize;
+        iovecs[i].iov_len = slotSize;
+
+        std::memset(&msgs[i], 0, sizeof(mmsghdr));
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &sources[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+    }
+
+    // MSG_WAITFORONE - block for the first datagram only
+    int received = ::recvmmsg(socket_, msgs, count, MSG_WAITFORONE, nullptr);
+    if (received == -1) {
+        return Err(fmt::format("recvmmsg failed: {}", util::net::lastErrorString()));
+    }
+
+    for (int i = 0; i < received; i++) {
+        results[i] = RecvResult {
+            .fromServer = this->connected
+                && SocketAddress::fromSockaddr(reinterpret_cast<struct sockaddr*>(&sources[i]), msgs[i].msg_hdr.msg_namelen) == destAddr_,
+            .result = static_cast<int>(msgs[i].msg_len),
+        };
+    }
+
+    return Ok(static_cast<size_t>(received));
+#else
+    size_t received = 0;
+
+    do {
+        auto result = this->receive(buffer + received * slotSize, slotSize);
+        if (result.result < 0) {
+            // still hand out what was received so far
+            if (received > 0) break;
+
+            return Err(fmt::format("udp recv failed ({}): {}", result.result, util::net::lastErrorString()));
+        }
+
+        results[received++] = result;
+    } while (received < count && this->poll(0).unwrapOr(false));
+
+    return Ok(received);
+#endif
+}
+
+Result<size_t> UdpSocket::sendBatch(const Datagram* datagrams, size_t count) {
+    GLOBED_REQUIRE_SAFE(connected, "attempting to call UdpSocket::sendBatch on a disconnected socket")
+
+    count = std::min(count, MAX_BATCH_SIZE);
+    if (count == 0) return Ok(0);
+
+#ifdef GLOBED_HAS_MMSG
+    mmsghdr msgs[MAX_BATCH_SIZE];
+    iovec iovecs[MAX_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i++) {
+        iovecs[i].iov_base = const_cast<char*>(datagrams[i].data);
+        iovecs[i].iov_len = datagrams[i].size;
+
+        std::memset(&msgs[i], 0, sizeof(mmsghdr));
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = destAddr_.sockaddrPtr();
+        msgs[i].msg_hdr.msg_namelen = destAddr_.sockaddrLength();
+    }
+
+    int sent = ::sendmmsg(socket_, msgs, count, 0);
+    if (sent == -1) {
+        return Err(fmt::format("sendmmsg failed: {}", util::net::lastErrorString()));
+    }
+
+    return Ok(static_cast<size_t>(sent));
+#else
+    for (size_t i = 0; i < count; i++) {
+        GLOBED_UNWRAP(this->send(datagrams[i].data, datagrams[i].size));
+    }
+
+    return Ok(count);
+#endif
+}
+
+Result<uint16_t> UdpSocket::bindLoopback() {
+    GLOBED_UNWRAP_INTO(this->forSocket(*SocketAddress::parseIp("127.0.0.1", 0)), auto addr)
+
+    if (::bind(socket_, addr.sockaddrPtr(), addr.sockaddrLength()) != 0) {
+        return Err(fmt::format("bind failed: {}", util::net::lastErrorString()));
+    }
+
+    sockaddr_in6 bound;
+    socklen_t addrLen = sizeof(bound);
+    if (::getsockname(socket_, reinterpret_cast<struct sockaddr*>(&bound), &addrLen) != 0) {
+        return Err(fmt::format("getsockname failed: {}", util::net::lastErrorString()));
+    }
+
+    return Ok(SocketAddress::fromSockaddr(reinterpret_cast<struct sockaddr*>(&bound), addrLen).port());
+}
+
 bool UdpSocket::close() {
     if (!connected) return true;
 
@@ -114,4 +244,14 @@ Result<bool> UdpSocket::poll(int msDelay, bool in) {
 
 Result<> UdpSocket::setNonBlocking(bool nb) {
     GLOBED_UNIMPL("UdpSocket::setNonBlocking")
-}
\ No newline at end of file
+}
+
+Result<SocketAddress> UdpSocket::forSocket(const SocketAddress& address) const {
+    if (family_ == AF_INET6) {
+        return Ok(address.toMappedV6());
+    }
+
+    GLOBED_REQUIRE_SAFE(address.isV4(), fmt::format("cannot send to {}, IPv6 is not available", address.toString()))
+
+    return Ok(address);
+}
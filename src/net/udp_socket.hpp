@@ -1,21 +1,42 @@
 #pragma once
 #include "socket.hpp"
+#include "address.hpp"
 
 #include <defs/platform.hpp>
 #include <asp/sync.hpp>
 
-struct sockaddr_in;
-
 class UdpSocket : public Socket {
 public:
+    // Upper limit of datagrams handled by a single `receiveBatch` or `sendBatch` call
+    static constexpr size_t MAX_BATCH_SIZE = 32;
+
+    struct Datagram {
+        const char* data;
+        unsigned int size;
+    };
+
     using Socket::send;
     UdpSocket();
     ~UdpSocket();
 
+    // Note that this might block for DNS lookup if the host is a domain name that isn't cached yet
     Result<> connect(const NetworkAddress& address) override;
+    Result<> connect(const SocketAddress& address);
     Result<int> send(const char* data, unsigned int dataSize) override;
-    Result<int> sendTo(const char* data, unsigned int dataSize, const NetworkAddress& address);
+    Result<int> sendTo(const char* data, unsigned int dataSize, const SocketAddress& address);
     RecvResult receive(char* buffer, int bufferSize) override;
+
+    // Receive up to `count` datagrams, the n-th one is written to `buffer + n * slotSize` and its size and origin to `results[n]`.
+    // Blocks until at least one datagram arrives, the rest are only taken if they are already queued.
+    // Uses a single `recvmmsg` call where available. Returns the amount of datagrams received.
+    Result<size_t> receiveBatch(char* buffer, size_t slotSize, RecvResult* results, size_t count);
+
+    // Send multiple datagrams to the connected address, using a single `sendmmsg` call where available.
+    // Returns the amount of datagrams sent, which may be less than `count`.
+    Result<size_t> sendBatch(const Datagram* datagrams, size_t count);
+
+    // Bind to a random port on the loopback interface, returns the port. Only used for benchmarks.
+    Result<uint16_t> bindLoopback();
     bool close() override;
     virtual void disconnect();
     Result<bool> poll(int msDelay, bool in = true) override;
@@ -30,5 +51,10 @@ public:
 #endif
 
 private:
-    std::unique_ptr<sockaddr_in> destAddr_;
+    // AF_INET6 if the socket is dual-stack and can talk to both IPv4 and IPv6 hosts, AF_INET if IPv6 is unavailable
+    int family_;
+    SocketAddress destAddr_;
+
+    // Convert the address into one that can be passed to this socket (IPv4 addresses must be mapped for dual-stack sockets)
+    Result<SocketAddress> forSocket(const SocketAddress& address) const;
 };
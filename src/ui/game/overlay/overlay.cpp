@@ -1,6 +1,7 @@
 #include "overlay.hpp"
 
 #include <managers/settings.hpp>
+#include <net/udp_sequencer.hpp>
 
 using namespace geode::prelude;
 
@@ -43,6 +44,15 @@ bool GlobedOverlay::init() {
         .parent(this)
         .id("ping-label"_spr);
 
+    // only shown once the server sends sequence numbers
+    Build<CCLabelBMFont>::create("", "bigFont.fnt")
+        .opacity(static_cast<uint8_t>(settings.opacity * 255))
+        .scale(0.6f)
+        .visible(false)
+        .store(linkLabel)
+        .parent(this)
+        .id("link-label"_spr);
+
 #ifdef GLOBED_DEBUG
     std::string versionStr = Mod::get()->getVersion().toVString();
     Build<CCLabelBMFont>::create(versionStr.c_str(), "bigFont.fnt")
@@ -68,10 +78,32 @@ void GlobedOverlay::updatePing(uint32_t ms) {
     this->updateLayout();
 }
 
+void GlobedOverlay::updateLinkStats(const LinkStats& stats) {
+    auto& settings = GlobedSettings::get();
+    if (!settings.overlay.enabled) return;
+
+    if (!stats.active) {
+        if (linkLabel->isVisible()) {
+            linkLabel->setVisible(false);
+            this->updateLayout();
+        }
+
+        return;
+    }
+
+    float loss = std::max(stats.upstreamLoss, stats.downstreamLoss) * 100.f;
+    auto fmted = fmt::format("{:.1f}% loss, {:.1f} ms jitter", loss, stats.jitterMs);
+    linkLabel->setString(fmted.c_str());
+    linkLabel->setVisible(true);
+    this->updateLayout();
+}
+
 void GlobedOverlay::updateWithDisconnected() {
     auto& settings = GlobedSettings::get();
     if (!settings.overlay.enabled) return;
 
+    linkLabel->setVisible(false);
+
     if (settings.overlay.hideConditionally) {
         this->setVisible(false);
         return;
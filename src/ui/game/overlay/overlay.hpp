@@ -1,11 +1,14 @@
 #pragma once
 #include <defs/all.hpp>
 
+struct LinkStats;
+
 class GlobedOverlay : public cocos2d::CCNode {
 public:
     bool init();
 
     void updatePing(uint32_t ms);
+    void updateLinkStats(const LinkStats& stats);
     void updateWithDisconnected();
     void updateWithEditor();
 
@@ -14,5 +17,6 @@ public:
 private:
     cocos2d::CCLabelBMFont
         *pingLabel = nullptr,
+        *linkLabel = nullptr,
         *versionLabel = nullptr;
 };
@@ -149,6 +149,9 @@ bool GlobedServersLayer::init() {
 
     this->updateServerList(0.f);
 
+    // don't make the list wait for the first scheduled ping
+    this->pingServers(0.f);
+
     initializing = false;
 
     return true;
@@ -234,6 +237,13 @@ void GlobedServersLayer::updateServerList(float) {
         return;
     }
 
+    // a different server has the lowest ping now, sort the list again
+    if (gsm.rankingChanged) {
+        gsm.rankingChanged = false;
+        serverList->forceRefresh();
+        return;
+    }
+
     // if there were no pending changes, still update the server data (ping, players, etc.)
     serverList->softRefresh();
 }
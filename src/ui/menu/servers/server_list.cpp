@@ -46,13 +46,14 @@ void GlobedServerList::softRefresh() {
     auto& gsm = GameServerManager::get();
 
     auto active = gsm.getActiveId();
+    auto best = gsm.getBestId();
 
     bool authenticated = NetworkManager::get().established();
 
     for (auto* slc : *listLayer) {
         auto server = gsm.getServer(slc->gsview.id);
         if (server.has_value()) {
-            slc->updateWith(server.value(), authenticated && slc->gsview.id == active);
+            slc->updateWith(server.value(), authenticated && slc->gsview.id == active, slc->gsview.id == best);
         }
     }
 }
@@ -66,10 +67,11 @@ CCArray* GlobedServerList::createServerList() {
     bool authenticated = nm.established();
 
     auto activeServer = gsm.getActiveId();
+    auto best = gsm.getBestId();
 
-    for (const auto& [serverId, server] : gsm.getAllServers()) {
-        bool active = authenticated && serverId == activeServer;
-        auto cell = ServerListCell::create(server, active);
+    for (const auto& server : gsm.getRankedServers()) {
+        bool active = authenticated && server.id == activeServer;
+        auto cell = ServerListCell::create(server, active, server.id == best);
         ret->addObject(cell);
     }
 
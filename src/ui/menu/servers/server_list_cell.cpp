@@ -13,7 +13,7 @@
 
 using namespace geode::prelude;
 
-bool ServerListCell::init(const GameServer& gsview, bool active) {
+bool ServerListCell::init(const GameServer& gsview, bool active, bool recommended) {
     if (!CCLayer::init()) return false;
 
     Build<CCLayer>::create()
@@ -49,12 +49,12 @@ bool ServerListCell::init(const GameServer& gsview, bool active) {
         .parent(this)
         .store(btnMenu);
 
-    this->updateWith(gsview, active);
+    this->updateWith(gsview, active, recommended);
 
     return true;
 }
 
-void ServerListCell::updateWith(const GameServer& gsview, bool active) {
+void ServerListCell::updateWith(const GameServer& gsview, bool active, bool recommended) {
     bool btnChanged = (active != this->active);
 
     this->gsview = gsview;
@@ -64,7 +64,7 @@ void ServerListCell::updateWith(const GameServer& gsview, bool active) {
     labelName->limitLabelWidth(205.f, 0.7f, 0.1f);
 
     labelPing->setString(fmt::format("{} ms", gsview.ping == -1 ? "?" : std::to_string(gsview.ping)).c_str());
-    labelExtra->setString(fmt::format("Region: {}, players: {}", gsview.region, gsview.playerCount).c_str());
+    labelExtra->setString(fmt::format("Region: {}, players: {}{}", gsview.region, gsview.playerCount, recommended ? " (lowest ping)" : "").c_str());
 
     labelName->setColor(active ? ACTIVE_COLOR : INACTIVE_COLOR);
     labelExtra->setColor(active ? ACTIVE_COLOR : INACTIVE_COLOR);
@@ -140,9 +140,9 @@ void ServerListCell::requestTokenAndConnect() {
     });
 }
 
-ServerListCell* ServerListCell::create(const GameServer& gsview, bool active) {
+ServerListCell* ServerListCell::create(const GameServer& gsview, bool active, bool recommended) {
     auto ret = new ServerListCell;
-    if (ret->init(gsview, active)) {
+    if (ret->init(gsview, active, recommended)) {
         ret->autorelease();
         return ret;
     }
@@ -9,10 +9,10 @@ public:
     static constexpr cocos2d::ccColor3B ACTIVE_COLOR = {0, 255, 25};
     static constexpr cocos2d::ccColor3B INACTIVE_COLOR = {255, 255, 255};
 
-    void updateWith(const GameServer& gsview, bool active);
+    void updateWith(const GameServer& gsview, bool active, bool recommended = false);
     void requestTokenAndConnect();
 
-    static ServerListCell* create(const GameServer& gsview, bool active);
+    static ServerListCell* create(const GameServer& gsview, bool active, bool recommended = false);
 
     GameServer gsview;
     bool active;
@@ -23,5 +23,5 @@ private:
     cocos2d::CCMenu* btnMenu;
     CCMenuItemSpriteExtra* btnConnect = nullptr;
 
-    bool init(const GameServer& gsview, bool active);
+    bool init(const GameServer& gsview, bool active, bool recommended);
 };
\ No newline at end of file
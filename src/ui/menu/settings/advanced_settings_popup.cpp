@@ -1,9 +1,14 @@
 #include "advanced_settings_popup.hpp"
 
+#include "net_stats_popup.hpp"
+
 #include <managers/account.hpp>
 #include <managers/settings.hpp>
 #include <net/manager.hpp>
 #include <net/address.hpp>
+#include <net/impairment.hpp>
+#include <net/session_replay.hpp>
+#include <util/bench.hpp>
 #include <util/debug.hpp>
 #include <util/format.hpp>
 #include <util/ui.hpp>
@@ -68,6 +73,109 @@ bool AdvancedSettingsPopup::setup() {
         .pos(rlayout.center - CCPoint{0.f, 60.f})
         .parent(menu);
 
+    Build<ButtonSprite>::create("Benchmarks", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.8f)
+        .intoMenuItem([](auto) {
+            bool started = util::bench::runAllDetached([] {
+                Notification::create("Benchmark results were written to the log", NotificationIcon::Success)->show();
+            });
+
+            if (!started) {
+                Notification::create("Benchmarks are already running", NotificationIcon::Warning)->show();
+            }
+        })
+        .pos(rlayout.center - CCPoint{0.f, 90.f})
+        .parent(menu);
+
+    Build<ButtonSprite>::create("Net stats", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.8f)
+        .intoMenuItem([](auto) {
+            NetStatsPopup::create()->show();
+        })
+        .pos(rlayout.center - CCPoint{0.f, 120.f})
+        .parent(menu);
+
+    Build<ButtonSprite>::create("Replay capture", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.8f)
+        .intoMenuItem([](auto) {
+            auto path = SessionReplay::latestCapture();
+            if (!path) {
+                Notification::create("No packet captures found", NotificationIcon::Error)->show();
+                return;
+            }
+
+            // replays over the simulated network too, if it's on
+            auto options = SessionReplay::Options {
+                .impairment = NetworkManager::get().getImpairment(),
+            };
+
+            bool started = SessionReplay::runDetached(*path, std::move(options), [path = *path](Result<SessionReplay::Stats> res) {
+                if (!res) {
+                    log::warn("Failed to replay {}: {}", path, res.unwrapErr());
+                    Notification::create("Failed to replay the capture", NotificationIcon::Error)->show();
+                    return;
+                }
+
+                auto& stats = res.unwrap();
+                log::debug(
+                    "Replayed {} ({} of capture) in {}: {} inbound ({} bytes), {} outbound, {} level data, {} interpolator ticks, {} failed to decode",
+                    path, stats.captureLength.toString(), stats.took.toString(),
+                    stats.inbound, stats.inboundBytes, stats.outbound,
+                    stats.levelDataPackets, stats.interpolatorTicks, stats.decodeFailures
+                );
+
+                if (stats.impairment.submitted > 0) {
+                    log::debug(
+                        "Replay impairment: {} dropped, {} duplicated, {} reordered",
+                        stats.impairment.dropped, stats.impairment.duplicated, stats.impairment.reordered
+                    );
+                }
+
+                Notification::create("Replay results were written to the log", NotificationIcon::Success)->show();
+            });
+
+            if (!started) {
+                Notification::create("A capture is already being replayed", NotificationIcon::Warning)->show();
+            }
+        })
+        .pos(rlayout.center - CCPoint{0.f, 150.f})
+        .parent(menu);
+
+    Build<ButtonSprite>::create("Bad network", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.8f)
+        .intoMenuItem([](auto) {
+            // fixed seeds, so that the same preset always behaves the same
+            static constexpr std::array PRESETS = {
+                std::pair{"mild", "latency=40,jitter=15,loss=0.01,seed=1"},
+                std::pair{"bad", "latency=120,jitter=60,loss=0.05,dup=0.01,reorder=0.03,seed=1"},
+                std::pair{"terrible", "latency=250,jitter=150,loss=0.15,dup=0.03,reorder=0.1,seed=1"},
+            };
+
+            // cycles through the presets and then back to off
+            auto& nm = NetworkManager::get();
+            auto current = nm.getImpairment();
+
+            size_t next = 0;
+            if (current) {
+                auto it = std::find_if(PRESETS.begin(), PRESETS.end(), [&](auto& preset) {
+                    return ImpairmentConfig::parse(preset.second).unwrap().toString() == current->toString();
+                });
+
+                next = it == PRESETS.end() ? PRESETS.size() : (it - PRESETS.begin()) + 1;
+            }
+
+            if (next >= PRESETS.size()) {
+                nm.setImpairment(std::nullopt);
+                Notification::create("Network simulation disabled", NotificationIcon::Success)->show();
+                return;
+            }
+
+            nm.setImpairment(ImpairmentConfig::parse(PRESETS[next].second).unwrap());
+            Notification::create(fmt::format("Simulating a {} network", PRESETS[next].first), NotificationIcon::Warning)->show();
+        })
+        .pos(rlayout.center - CCPoint{0.f, 180.f})
+        .parent(menu);
+
     auto* thing = Build(CCMenuItemToggler::createWithStandardSprites(this, menu_selector(AdvancedSettingsPopup::onPacketLog), 0.7f))
         .parent(menu)
         .collect();
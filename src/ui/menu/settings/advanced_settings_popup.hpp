@@ -4,7 +4,7 @@
 class AdvancedSettingsPopup : public geode::Popup<> {
 public:
     static constexpr float POPUP_WIDTH = 240.f;
-    static constexpr float POPUP_HEIGHT = 200.f;
+    static constexpr float POPUP_HEIGHT = 260.f;
 
     static AdvancedSettingsPopup* create();
 
@@ -0,0 +1,98 @@
+#include "net_stats_popup.hpp"
+
+#include <net/telemetry.hpp>
+#include <util/format.hpp>
+#include <util/ui.hpp>
+
+using namespace geode::prelude;
+
+bool NetStatsPopup::setup() {
+    auto rlayout = util::ui::getPopupLayoutAnchored(m_size);
+    this->setTitle("Network stats");
+
+    Build(MDTextArea::create("", CCSize{POPUP_WIDTH - 30.f, POPUP_HEIGHT - 80.f}))
+        .pos(rlayout.center + CCPoint{0.f, 5.f})
+        .parent(m_mainLayer)
+        .store(textArea);
+
+    auto* menu = Build<ButtonSprite>::create("Reset", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.7f)
+        .intoMenuItem([this](auto) {
+            NetworkTelemetry::get().reset();
+            this->refresh(0.f);
+        })
+        .intoNewParent(CCMenu::create())
+        .layout(RowLayout::create()->setGap(5.f))
+        .pos(rlayout.fromBottom(22.f))
+        .parent(m_mainLayer)
+        .collect();
+
+    Build<ButtonSprite>::create("Save", "bigFont.fnt", "GJ_button_01.png", 0.75f)
+        .scale(0.7f)
+        .intoMenuItem([this](auto) {
+            NetworkTelemetry::get().writeSnapshot();
+            Notification::create("Saved to net-telemetry.json in the save folder", NotificationIcon::Success)->show();
+        })
+        .parent(menu);
+
+    menu->updateLayout();
+
+    this->refresh(0.f);
+    this->schedule(schedule_selector(NetStatsPopup::refresh), 1.f);
+
+    return true;
+}
+
+void NetStatsPopup::refresh(float) {
+    auto snapshot = NetworkTelemetry::get().snapshot();
+
+    if (snapshot.empty()) {
+        textArea->setString("No packets were sent or received yet.");
+        return;
+    }
+
+    std::string text;
+
+    for (auto& packet : snapshot) {
+        text += fmt::format(
+            "**{}** ({})\n\nin: {} ({}), out: {} ({})\n\n",
+            packet.name, packet.id,
+            packet.packetsIn, util::format::formatBytes(packet.bytesIn),
+            packet.packetsOut, util::format::formatBytes(packet.bytesOut)
+        );
+
+        std::string timings;
+        for (size_t i = 0; i < NetworkTelemetry::STAGE_COUNT; i++) {
+            auto& stage = packet.stages[i];
+            if (stage.count == 0) continue;
+
+            if (!timings.empty()) timings += ", ";
+
+            timings += fmt::format(
+                "{} {}us (p99 {}us)",
+                NetworkTelemetry::stageName(static_cast<PacketStage>(i)),
+                stage.avgMicros(),
+                stage.percentileMicros(99.0)
+            );
+        }
+
+        if (!timings.empty()) {
+            text += timings + "\n\n";
+        }
+
+        text += "---\n\n";
+    }
+
+    textArea->setString(text.c_str());
+}
+
+NetStatsPopup* NetStatsPopup::create() {
+    auto ret = new NetStatsPopup;
+    if (ret->initAnchored(POPUP_WIDTH, POPUP_HEIGHT)) {
+        ret->autorelease();
+        return ret;
+    }
+
+    delete ret;
+    return nullptr;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <defs/geode.hpp>
+
+// Shows the per packet type network telemetry, refreshed every second
+class NetStatsPopup : public geode::Popup<> {
+public:
+    static constexpr float POPUP_WIDTH = 420.f;
+    static constexpr float POPUP_HEIGHT = 280.f;
+
+    static NetStatsPopup* create();
+
+private:
+    geode::MDTextArea* textArea = nullptr;
+
+    bool setup() override;
+    void refresh(float dt);
+};
@@ -225,6 +225,8 @@ void GlobedSettingsLayer::createSettingsCells(int category) {
             registerSetting(cat, settings.globed.editorSupport, "View players in editor", "Enables the ability to see people playing your level while in the editor. Note: <cy>this does not let you build levels together!</c>");
             registerSetting(cat, settings.globed.fragmentationLimit, "Packet limit", "Press the \"Test\" button to calibrate the maximum packet size. Should fix some of the issues with players not appearing in a level.", Type::PacketFragmentation);
             registerSetting(cat, settings.globed.tpsCap, "TPS cap", "Maximum amount of packets per second sent between the client and the server. Useful only for very silly things.");
+            registerSetting(cat, settings.globed.adaptiveSendRate, "Adaptive send rate", "Sends your position only once a second while you are alone on a level, and less often when the connection is struggling.");
+            registerSetting(cat, settings.globed.directPlayerUpdates, "Direct player updates", "Applies player data as soon as it arrives instead of on the next frame. Lowers the latency of other players by up to one frame. <cy>Experimental.</c>");
 
 #ifndef GEODE_IS_ANDROID
             registerSetting(cat, settings.globed.useDiscordRPC, "Discord RPC", "If you have the Discord Rich Presence standalone mod, this option will toggle a Globed-specific RPC on your profile.", Type::DiscordRPC);
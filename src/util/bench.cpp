@@ -0,0 +1,406 @@
+#include "bench.hpp"
+
+#include <atomic>
+#include <thread>
+
+#include <data/arena.hpp>
+#include <data/bytebuffer.hpp>
+#include <data/packets/all.hpp>
+#include <data/packets/pool.hpp>
+#include <data/types/game.hpp>
+#include <data/types/gd.hpp>
+#include <data/types/user.hpp>
+#include <net/address.hpp>
+#include <net/impairment.hpp>
+#include <net/udp_frame_buffer.hpp>
+#include <net/udp_socket.hpp>
+#include <util/debug.hpp>
+
+using namespace geode::prelude;
+
+namespace {
+    // shaped like the protocol enums, which all have a handful of enumerators
+    enum class BenchSparseEnum : uint8_t {
+        A = 0, B = 1, C = 2, D = 10, E = 20
+    };
+
+    enum class BenchWideEnum : uint32_t {
+        A = 0, B = 1, C = 2, D = 50000, E = 100000
+    };
+
+    GLOBED_SERIALIZABLE_ENUM(BenchSparseEnum, A, B, C, D, E);
+    GLOBED_SERIALIZABLE_ENUM(BenchWideEnum, A, B, C, D, E);
+
+    // the big ones show how the lookup scales with the amount of enumerators, the linear scan grows with it
+    enum class BenchManyContiguousEnum : uint8_t {
+        V0, V1, V2, V3, V4, V5, V6, V7,
+        V8, V9, V10, V11, V12, V13, V14, V15,
+        V16, V17, V18, V19, V20, V21, V22, V23,
+        V24, V25, V26, V27, V28, V29, V30, V31,
+        V32, V33, V34, V35, V36, V37, V38, V39,
+        V40, V41, V42, V43, V44, V45, V46, V47
+    };
+
+    // spans more than the bitmap limit of `EnumValidator`, so this takes the binary search
+    enum class BenchManySparseEnum : uint16_t {
+        V0 = 0, V1 = 97, V2 = 194, V3 = 291, V4 = 388, V5 = 485, V6 = 582, V7 = 679,
+        V8 = 776, V9 = 873, V10 = 970, V11 = 1067, V12 = 1164, V13 = 1261, V14 = 1358, V15 = 1455,
+        V16 = 1552, V17 = 1649, V18 = 1746, V19 = 1843, V20 = 1940, V21 = 2037, V22 = 2134, V23 = 2231,
+        V24 = 2328, V25 = 2425, V26 = 2522, V27 = 2619, V28 = 2716, V29 = 2813, V30 = 2910, V31 = 3007,
+        V32 = 3104, V33 = 3201, V34 = 3298, V35 = 3395, V36 = 3492, V37 = 3589, V38 = 3686, V39 = 3783,
+        V40 = 3880, V41 = 3977, V42 = 4074, V43 = 4171, V44 = 4268, V45 = 4365, V46 = 4462, V47 = 4559
+    };
+
+    GLOBED_SERIALIZABLE_ENUM(BenchManyContiguousEnum,
+        V0, V1, V2, V3, V4, V5, V6, V7,
+        V8, V9, V10, V11, V12, V13, V14, V15,
+        V16, V17, V18, V19, V20, V21, V22, V23,
+        V24, V25, V26, V27, V28, V29, V30, V31,
+        V32, V33, V34, V35, V36, V37, V38, V39,
+        V40, V41, V42, V43, V44, V45, V46, V47
+    );
+
+    GLOBED_SERIALIZABLE_ENUM(BenchManySparseEnum,
+        V0, V1, V2, V3, V4, V5, V6, V7,
+        V8, V9, V10, V11, V12, V13, V14, V15,
+        V16, V17, V18, V19, V20, V21, V22, V23,
+        V24, V25, V26, V27, V28, V29, V30, V31,
+        V32, V33, V34, V35, V36, V37, V38, V39,
+        V40, V41, V42, V43, V44, V45, V46, V47
+    );
+}
+
+namespace util::bench {
+    template <typename E>
+    static void benchEnum(std::string_view name) {
+        constexpr size_t ITERATIONS = 1024 * 1024;
+
+        std::vector<E> values;
+        boost::mp11::mp_for_each<boost::describe::describe_enumerators<E>>([&](auto descriptor) {
+            values.push_back(descriptor.value);
+        });
+
+        ByteBuffer buf;
+        for (size_t i = 0; i < ITERATIONS; i++) {
+            buf.writeValue<E>(values[i % values.size()]);
+        }
+
+        size_t failed = 0;
+
+        util::debug::Benchmarker bb;
+        auto took = bb.run([&] {
+            buf.setPosition(0);
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                if (buf.readValue<E>().isErr()) failed++;
+            }
+        });
+
+        // what enum decoding did before `EnumValidator`, for comparison
+        using P = std::underlying_type_t<E>;
+        size_t linearFailed = 0;
+
+        auto linearTook = bb.run([&] {
+            buf.setPosition(0);
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                P underlying = buf.readValue<P>().unwrapOr(P{});
+
+                bool found = false;
+                boost::mp11::mp_for_each<boost::describe::describe_enumerators<E>>([&](auto descriptor) {
+                    found = found || static_cast<P>(descriptor.value) == underlying;
+                });
+
+                if (!found) linearFailed++;
+            }
+        });
+
+        log::info(
+            "[bench] {} ({} enumerators): decoded {} values in {}, {} with a linear scan ({} / {} failed)",
+            name, values.size(), ITERATIONS, took.toString(), linearTook.toString(), failed, linearFailed
+        );
+    }
+
+    void enumDecode() {
+        benchEnum<GlobedCounterChange::Type>("GlobedCounterChange::Type");
+        benchEnum<PlayerIconType>("PlayerIconType");
+        benchEnum<PunishmentType>("PunishmentType");
+        benchEnum<BenchSparseEnum>("sparse enum");
+        benchEnum<BenchWideEnum>("wide sparse enum");
+        benchEnum<BenchManyContiguousEnum>("big contiguous enum");
+        benchEnum<BenchManySparseEnum>("big sparse enum");
+    }
+
+    void vectorCodec() {
+        constexpr size_t ITERATIONS = 4096;
+        constexpr size_t ID_COUNT = 512;
+
+        std::vector<LevelId> ids(ID_COUNT);
+        for (size_t i = 0; i < ID_COUNT; i++) {
+            ids[i] = 100'000'000 + static_cast<LevelId>(i) * 37;
+        }
+
+        ByteBuffer buf;
+        util::debug::Benchmarker bb;
+
+        auto encodeTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                buf.clear();
+                buf.writeValue(ids);
+            }
+        });
+
+        size_t failed = 0;
+
+        auto decodeTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                buf.setPosition(0);
+                if (buf.readValue<std::vector<LevelId>>().isErr()) failed++;
+            }
+        });
+
+        log::info("[bench] vector of {} level IDs, {} iterations: encoding took {}, decoding took {} ({} failed)", ID_COUNT, ITERATIONS, encodeTook.toString(), decodeTook.toString(), failed);
+    }
+
+    void arenaDecode() {
+        constexpr size_t ITERATIONS = 4096;
+        constexpr size_t PLAYER_COUNT = 64;
+
+        std::vector<AssociatedPlayerData> players;
+        for (size_t i = 0; i < PLAYER_COUNT; i++) {
+            players.emplace_back(static_cast<int>(i) + 1, PlayerData{});
+        }
+
+        ByteBuffer buf;
+        buf.writeValue(players);
+
+        size_t failed = 0;
+        util::debug::Benchmarker bb;
+
+        auto heapTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                buf.setPosition(0);
+                if (buf.readValue<std::vector<AssociatedPlayerData>>().isErr()) failed++;
+            }
+        });
+
+        PacketArena arena;
+        buf.setMemoryResource(&arena);
+
+        auto arenaTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                buf.setPosition(0);
+                if (buf.readValue<std::pmr::vector<AssociatedPlayerData>>().isErr()) failed++;
+                arena.reset();
+            }
+        });
+
+        buf.setMemoryResource(nullptr);
+
+        log::info("[bench] {} players, {} iterations: decoding took {} on the heap, {} in an arena ({} failed)", PLAYER_COUNT, ITERATIONS, heapTook.toString(), arenaTook.toString(), failed);
+    }
+
+    void packetPool() {
+        constexpr size_t ITERATIONS = 64 * 1024;
+
+        // log the counters accumulated since startup first, to see how the pools did in actual gameplay
+        auto& stats = PacketPoolStats::get();
+        log::info(
+            "[bench] packet pools since last reset: {} heap allocations, {} reused, {} returned, {} freed; arenas: {} created, {} reused",
+            stats.allocations.load(), stats.reused.load(), stats.returned.load(), stats.freed.load(),
+            stats.arenaAllocations.load(), stats.arenasReused.load()
+        );
+
+        util::debug::Benchmarker bb;
+
+        auto sharedTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                std::shared_ptr<Packet> packet = std::make_shared<PlayerDataPacket>();
+                (void) packet->getPacketId();
+            }
+        });
+
+        auto pooledTook = bb.run([&] {
+            for (size_t i = 0; i < ITERATIONS; i++) {
+                std::shared_ptr<Packet> packet = makePooled<PlayerDataPacket>();
+                (void) packet->getPacketId();
+            }
+        });
+
+        log::info("[bench] {} packets: std::make_shared took {}, pooled took {}", ITERATIONS, sharedTook.toString(), pooledTook.toString());
+
+        stats.reset();
+    }
+
+    void udpLoopback() {
+        constexpr size_t DATAGRAMS = 64 * 1024;
+        constexpr size_t BATCH = UdpSocket::MAX_BATCH_SIZE;
+        constexpr size_t DATAGRAM_SIZE = 64;
+        constexpr size_t SLOT_SIZE = 2048;
+
+        UdpSocket receiver, sender;
+
+        auto port = receiver.bindLoopback();
+        if (!port) {
+            log::warn("[bench] udp loopback: {}", port.unwrapErr());
+            return;
+        }
+
+        (void) sender.connect(NetworkAddress("127.0.0.1", *port));
+        // UdpSocket only closes connected sockets
+        (void) receiver.connect(NetworkAddress("127.0.0.1", *port));
+
+        std::vector<char> payload(DATAGRAM_SIZE, 0x42);
+        std::vector<char> slots(BATCH * SLOT_SIZE);
+        RecvResult results[BATCH];
+
+        UdpSocket::Datagram datagrams[BATCH];
+        for (auto& dg : datagrams) {
+            dg = { payload.data(), DATAGRAM_SIZE };
+        }
+
+        size_t lost = 0;
+
+        // waits for `expected` datagrams, giving up if they don't arrive (datagrams can be dropped even over loopback)
+        auto receiveSingle = [&](size_t expected) {
+            for (size_t i = 0; i < expected; i++) {
+                if (!receiver.poll(100).unwrapOr(false)) {
+                    lost += expected - i;
+                    return;
+                }
+
+                (void) receiver.receive(slots.data(), SLOT_SIZE);
+            }
+        };
+
+        auto receiveBatched = [&](size_t expected) {
+            size_t received = 0;
+            while (received < expected) {
+                if (!receiver.poll(100).unwrapOr(false)) {
+                    lost += expected - received;
+                    return;
+                }
+
+                received += receiver.receiveBatch(slots.data(), SLOT_SIZE, results, BATCH).unwrapOr(0);
+            }
+        };
+
+        util::debug::Benchmarker bb;
+
+        auto singleTook = bb.run([&] {
+            for (size_t i = 0; i < DATAGRAMS; i += BATCH) {
+                for (size_t j = 0; j < BATCH; j++) {
+                    (void) sender.send(payload.data(), DATAGRAM_SIZE);
+                }
+
+                receiveSingle(BATCH);
+            }
+        });
+
+        auto batchTook = bb.run([&] {
+            for (size_t i = 0; i < DATAGRAMS; i += BATCH) {
+                size_t sent = sender.sendBatch(datagrams, BATCH).unwrapOr(0);
+                receiveBatched(sent);
+            }
+        });
+
+        auto perSecond = [](size_t count, asp::time::Duration took) {
+            auto micros = std::max<uint64_t>(took.micros(), 1);
+            return static_cast<uint64_t>(count) * 1'000'000 / micros;
+        };
+
+        log::info(
+            "[bench] udp loopback, {} datagrams of {} bytes: one at a time took {} ({} pkt/s), batched took {} ({} pkt/s), {} lost",
+            DATAGRAMS, DATAGRAM_SIZE,
+            singleTook.toString(), perSecond(DATAGRAMS, singleTook),
+            batchTook.toString(), perSecond(DATAGRAMS, batchTook),
+            lost
+        );
+    }
+
+    void impairedReassembly() {
+        constexpr size_t PACKETS = 16 * 1024;
+        constexpr uint8_t FRAMES = 4;
+        constexpr size_t FRAME_PAYLOAD = 1000;
+        // on a fake clock, so the whole thing runs as fast as possible
+        constexpr uint64_t PACKET_INTERVAL_MICROS = 10'000;
+
+        auto config = ImpairmentConfig::parse("latency=50,jitter=30,loss=0.03,dup=0.02,reorder=0.1,seed=42").unwrap();
+
+        NetworkImpairment impairment(config);
+        UdpFrameBuffer frames;
+        std::vector<NetworkImpairment::Datagram> due;
+        ByteBuffer buf;
+        size_t errors = 0;
+
+        auto deliver = [&](uint64_t now) {
+            impairment.takeDue(ImpairDirection::Inbound, now, due);
+
+            for (auto& datagram : due) {
+                auto view = ByteBuffer::borrowed(datagram.data.data(), datagram.data.size());
+                if (frames.pushFrameFromBuffer(view).isErr()) {
+                    errors++;
+                }
+            }
+
+            due.clear();
+        };
+
+        util::debug::Benchmarker bb;
+
+        auto took = bb.run([&] {
+            for (size_t i = 0; i < PACKETS; i++) {
+                uint64_t now = i * PACKET_INTERVAL_MICROS;
+
+                for (uint8_t frame = 0; frame < FRAMES; frame++) {
+                    buf.clear();
+                    buf.writeU32(static_cast<uint32_t>(i));
+                    buf.writeU8(frame);
+                    buf.writeU8(FRAMES);
+                    buf.grow(FRAME_PAYLOAD);
+
+                    impairment.submit(ImpairDirection::Inbound, buf.dataPtr(), buf.size(), true, now);
+                }
+
+                deliver(now);
+            }
+
+            deliver(std::numeric_limits<uint64_t>::max());
+        });
+
+        // with a fixed seed, everything except the time is the same on every run
+        auto& istats = impairment.stats();
+        auto& fstats = frames.stats();
+
+        log::info(
+            "[bench] reassembly of {} packets over an impaired link ({}): took {}, {} completed, {} evicted, {} duplicate frames, {} errors ({} frames dropped, {} duplicated, {} reordered)",
+            PACKETS, config.toString(), took.toString(),
+            fstats.completed, fstats.evictions, fstats.duplicates, errors,
+            istats.dropped, istats.duplicated, istats.reordered
+        );
+    }
+
+    void runAll() {
+        enumDecode();
+        vectorCodec();
+        arenaDecode();
+        packetPool();
+        udpLoopback();
+        impairedReassembly();
+    }
+
+    bool runAllDetached(std::function<void()> onFinish) {
+        static std::atomic<bool> running = false;
+
+        if (running.exchange(true)) return false;
+
+        std::thread([onFinish = std::move(onFinish)]() mutable {
+            geode::utils::thread::setName("Benchmark Thread");
+
+            runAll();
+            running = false;
+
+            Loader::get()->queueInMainThread(std::move(onFinish));
+        }).detach();
+
+        return true;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+
+// Micro-benchmarks for hot paths that are otherwise hard to measure in-game.
+// They are only ran manually (from the advanced settings popup) and the results are written to the log.
+namespace util::bench {
+    // Measures the cost of decoding small enums like the ones in the protocol, compared to a linear scan over the enumerators.
+    void enumDecode();
+
+    // Measures the cost of encoding and decoding large vectors of level IDs.
+    void vectorCodec();
+
+    // Compares decoding a vector of player data on the heap and in a `PacketArena`.
+    void arenaDecode();
+
+    // Compares creating and releasing packets with `std::make_shared` and from the packet pools, and logs the pool counters.
+    void packetPool();
+
+    // Compares sending and receiving small datagrams over loopback one at a time and in batches.
+    void udpLoopback();
+
+    // Reassembles fragmented packets that went through a `NetworkImpairment` with a fixed seed, and logs how many made it.
+    void impairedReassembly();
+
+    // Runs every benchmark.
+    void runAll();
+
+    // Runs every benchmark on a separate thread so that the game doesn't freeze, then calls `onFinish` on the main thread.
+    // Returns false and does nothing if the benchmarks are already running.
+    bool runAllDetached(std::function<void()> onFinish);
+}
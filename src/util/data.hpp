@@ -4,6 +4,9 @@
 #include <vector>
 #include <array>
 #include <bit>
+#include <cstring>
+#include <memory_resource>
+#include <type_traits>
 
 #include <asp/misc/traits.hpp>
 #include <asp/data/util.hpp>
@@ -18,6 +21,16 @@ namespace util::data {
     template <typename T>
     concept IsPrimitive = asp::data::is_primitive<T>;
 
+    // Primitives whose in-memory representation can be copied to/from the wire as-is (modulo endianness).
+    // `bool` is excluded, as not every byte value is a valid bool.
+    template <typename T>
+    concept IsBulkPrimitive = IsPrimitive<T> && !std::is_same_v<T, bool>;
+
+    // Containers and strings that allocate through a `std::pmr::memory_resource` (`std::pmr::vector`, `std::pmr::string`, etc.)
+    template <typename T>
+    concept IsPmrAllocated = requires { typename T::allocator_type; typename T::value_type; }
+        && std::is_same_v<typename T::allocator_type, std::pmr::polymorphic_allocator<typename T::value_type>>;
+
     // macos github actions runner has no std::bit_cast support
 #ifdef __cpp_lib_bit_cast
     template <typename To, typename From>
@@ -45,6 +58,32 @@ namespace util::data {
         return val;
     }
 
+    // Byteswaps `count` consecutive values of `Size` bytes each, in place. The data does not have to be aligned.
+    // This is a plain loop over unsigned integers, so compilers are able to vectorize it.
+    template <size_t Size>
+    inline void byteswapBytes(byte* data, size_t count) {
+        static_assert(Size == 1 || Size == 2 || Size == 4 || Size == 8, "invalid element size");
+
+        if constexpr (Size > 1) {
+            using U = std::conditional_t<Size == 2, uint16_t, std::conditional_t<Size == 4, uint32_t, uint64_t>>;
+
+            for (size_t i = 0; i < count; i++) {
+                U value;
+                std::memcpy(&value, data + i * Size, Size);
+                value = byteswap(value);
+                std::memcpy(data + i * Size, &value, Size);
+            }
+        }
+    }
+
+    // Like `byteswapBytes`, but only if the platform is little endian.
+    template <size_t Size>
+    inline void maybeByteswapBytes(byte* data, size_t count) {
+        if constexpr (GLOBED_LITTLE_ENDIAN) {
+            byteswapBytes<Size>(data, count);
+        }
+    }
+
     // Converts the bit count into bytes required to fit it.
     // That means, 15 or 16 bits equals 2 bytes, but 17 bits equals 3 bytes.
     constexpr size_t bitsToBytes(size_t bits) {
@@ -27,6 +27,10 @@ namespace util::format {
         return formatDateTime(tp, ms);
     }
 
+    std::string fileDateTime(const asp::time::SystemTime& tp) {
+        return fmt::format("{:%Y-%m-%d_%H-%M-%S}", fmt::localtime(tp.to_time_t()));
+    }
+
     std::string formatBytes(uint64_t bytes) {
         // i did not write this myself
         static const char* suffixes[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB", "EiB", "ZiB", "YiB"};
@@ -14,6 +14,9 @@ namespace util::format {
 
     std::string dateTime(const asp::time::SystemTime& tp, bool ms = true);
 
+    // example: 2023-11-16_19-43-50, safe to use in file names on every platform
+    std::string fileDateTime(const asp::time::SystemTime& tp);
+
     // example: 123.4KiB
     std::string formatBytes(uint64_t bytes);
 
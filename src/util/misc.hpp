@@ -4,9 +4,12 @@
 #include <data/types/basic/either.hpp>
 
 #include <functional>
+#include <map>
+#include <memory_resource>
 #include <string_view>
 #include <type_traits>
 #include <optional>
+#include <vector>
 
 // i hate c++
 #define _GLOBED_STRNUM "1234567890"
@@ -52,6 +55,16 @@ namespace util::misc {
     template <typename T, typename Y>
     struct is_map<std::map<T, Y>> : std::true_type {};
 
+    template <typename T, typename Y>
+    struct is_map<std::pmr::map<T, Y>> : std::true_type {};
+
+    // unlike `asp::is_std_vector`, this also matches vectors with a custom allocator
+    template <typename>
+    struct is_vector : std::false_type {};
+
+    template <typename T, typename A>
+    struct is_vector<std::vector<T, A>> : std::true_type {};
+
 
     template <typename... Ts, typename T>
     bool is_any_of_dynamic(T* object) {
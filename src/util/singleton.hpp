@@ -27,6 +27,11 @@ public:
         return instance;
     }
 
+    // False once the instance was destroyed during static destruction, `get` must not be called then
+    static bool alive() {
+        return !destructed;
+    }
+
 protected:
     static inline bool destructed = false;
 